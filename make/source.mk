@@ -1,6 +1,7 @@
 COMMON_SRC = \
             build/build_config.c \
             build/debug.c \
+            build/profiler.c \
             build/version.c \
             $(TARGET_DIR_SRC) \
             main.c \
@@ -12,6 +13,7 @@ COMMON_SRC = \
             common/huffman_table.c \
             common/maths.c \
             common/printf.c \
+            common/sdft.c \
             common/streambuf.c \
             common/typeconversion.c \
             config/config_eeprom.c \
@@ -27,6 +29,7 @@ COMMON_SRC = \
             drivers/bus_spi.c \
             drivers/bus_spi_config.c \
             drivers/bus_spi_pinconfig.c \
+            drivers/bus_spi_queue.c \
             drivers/bus_spi_soft.c \
             drivers/buttons.c \
             drivers/display.c \
@@ -80,6 +83,7 @@ FC_SRC = \
             drivers/rx_xn297.c \
             drivers/pwm_esc_detect.c \
             drivers/pwm_output.c \
+            drivers/dshot_telemetry.c \
             drivers/rx_pwm.c \
             drivers/serial_softserial.c \
             fc/fc_core.c \
@@ -94,6 +98,7 @@ FC_SRC = \
             flight/imu.c \
             flight/mixer.c \
             flight/pid.c \
+            flight/rpm_filter.c \
             flight/servos.c \
             io/serial_4way.c \
             io/serial_4way_avrootloader.c \
@@ -189,14 +194,17 @@ SPEED_OPTIMISED_SRC := $(SPEED_OPTIMISED_SRC) \
             common/encoding.c \
             common/filter.c \
             common/maths.c \
+            common/sdft.c \
             common/typeconversion.c \
             drivers/adc.c \
             drivers/buf_writer.c \
             drivers/bus.c \
             drivers/bus_spi.c \
+            drivers/bus_spi_queue.c \
             drivers/exti.c \
             drivers/io.c \
             drivers/pwm_output.c \
+            drivers/dshot_telemetry.c \
             drivers/rcc.c \
             drivers/serial.c \
             drivers/serial_uart.c \
@@ -210,6 +218,7 @@ SPEED_OPTIMISED_SRC := $(SPEED_OPTIMISED_SRC) \
             flight/imu.c \
             flight/mixer.c \
             flight/pid.c \
+            flight/rpm_filter.c \
             io/serial.c \
             rx/ibus.c \
             rx/rx.c \
@@ -291,7 +300,8 @@ endif
 ifneq ($(filter ONBOARDFLASH,$(FEATURES)),)
 SRC += \
             drivers/flash_m25p16.c \
-            io/flashfs.c
+            io/flashfs.c \
+            msp/msp_dataflash_stream.c
 endif
 
 SRC += $(COMMON_SRC)
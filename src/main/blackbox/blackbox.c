@@ -16,6 +16,7 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <math.h>
@@ -79,13 +80,16 @@
 #define DEFAULT_BLACKBOX_DEVICE     BLACKBOX_DEVICE_SERIAL
 #endif
 
-PG_REGISTER_WITH_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 0);
+PG_REGISTER_WITH_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 3);
 
 PG_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig,
     .p_denom = 32,
     .device = DEFAULT_BLACKBOX_DEVICE,
     .on_motor_test = 0, // default off
-    .record_acc = 1
+    .record_acc = 1,
+    .deferred = 0,
+    .encoding = BLACKBOX_ENCODING_VB,
+    .mode = BLACKBOX_MODE_NORMAL
 );
 
 #define BLACKBOX_SHUTDOWN_TIMEOUT_MILLIS 200
@@ -154,6 +158,7 @@ typedef struct blackboxDeltaFieldDefinition_s {
     uint8_t Ppredict;
     uint8_t Pencode;
     uint8_t condition; // Decide whether this field should appear in the log
+    uint8_t PpredictLinear; // P frame predictor of BLACKBOX_ENCODING_RICE_LINEAR, PREDICT(0) to keep Ppredict
 } blackboxDeltaFieldDefinition_t;
 
 /**
@@ -201,9 +206,9 @@ static const blackboxDeltaFieldDefinition_t blackboxMainFields[] = {
     {"rssi",       -1, UNSIGNED, .Ipredict = PREDICT(0),       .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(TAG8_8SVB), FLIGHT_LOG_FIELD_CONDITION_RSSI},
 
     /* Gyros and accelerometers base their P-predictions on the average of the previous 2 frames to reduce noise impact */
-    {"gyroADC",     0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"gyroADC",     1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
-    {"gyroADC",     2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS)},
+    {"gyroADC",     0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"gyroADC",     1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"gyroADC",     2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(ALWAYS), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
     {"accSmooth",   0, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), FLIGHT_LOG_FIELD_CONDITION_ACC},
     {"accSmooth",   1, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), FLIGHT_LOG_FIELD_CONDITION_ACC},
     {"accSmooth",   2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), FLIGHT_LOG_FIELD_CONDITION_ACC},
@@ -212,15 +217,15 @@ static const blackboxDeltaFieldDefinition_t blackboxMainFields[] = {
     {"debug",       2, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), FLIGHT_LOG_FIELD_CONDITION_DEBUG},
     {"debug",       3, SIGNED,   .Ipredict = PREDICT(0),       .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), FLIGHT_LOG_FIELD_CONDITION_DEBUG},
     /* Motors only rarely drops under minthrottle (when stick falls below mincommand), so predict minthrottle for it and use *unsigned* encoding (which is large for negative numbers but more compact for positive ones): */
-    {"motor",       0, UNSIGNED, .Ipredict = PREDICT(MINMOTOR), .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(AVERAGE_2), .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_1)},
+    {"motor",       0, UNSIGNED, .Ipredict = PREDICT(MINMOTOR), .Iencode = ENCODING(UNSIGNED_VB), .Ppredict = PREDICT(AVERAGE_2), .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_1), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
     /* Subsequent motors base their I-frame values on the first one, P-frame values on the average of last two frames: */
-    {"motor",       1, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_2)},
-    {"motor",       2, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_3)},
-    {"motor",       3, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_4)},
-    {"motor",       4, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_5)},
-    {"motor",       5, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_6)},
-    {"motor",       6, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_7)},
-    {"motor",       7, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_8)},
+    {"motor",       1, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_2), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"motor",       2, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_3), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"motor",       3, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_4), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"motor",       4, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_5), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"motor",       5, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_6), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"motor",       6, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_7), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
+    {"motor",       7, UNSIGNED, .Ipredict = PREDICT(MOTOR_0), .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(AVERAGE_2),     .Pencode = ENCODING(SIGNED_VB), CONDITION(AT_LEAST_MOTORS_8), .PpredictLinear = PREDICT(STRAIGHT_LINE)},
 
     /* Tricopter tail servo */
     {"servo",       5, UNSIGNED, .Ipredict = PREDICT(1500),    .Iencode = ENCODING(SIGNED_VB),   .Ppredict = PREDICT(PREVIOUS),      .Pencode = ENCODING(SIGNED_VB), CONDITION(TRICOPTER)}
@@ -309,6 +314,15 @@ typedef struct blackboxGpsState_s {
     uint8_t GPS_numSat;
 } blackboxGpsState_t;
 
+#ifdef GPS
+// The GPS data a G and H frame are written from
+typedef struct blackboxGpsFix_s {
+    int32_t home[2];
+    gpsSolutionData_t sol;
+    bool homeDue;               // the periodic H frame is due
+} blackboxGpsFix_t;
+#endif
+
 // This data is updated really infrequently:
 typedef struct blackboxSlowState_s {
     uint32_t flightModeFlags; // extend this data size (from uint16_t)
@@ -356,6 +370,74 @@ STATIC_UNIT_TESTED int32_t blackboxSInterval = 0;
 STATIC_UNIT_TESTED int32_t blackboxSlowFrameIterationTimer;
 static bool blackboxLoggedAnyFrames;
 
+#ifdef USE_BLACKBOX_DEFERRED
+/*
+ * In deferred mode the PID loop only copies the state of the FC into this ring, TASK_BLACKBOX encodes and writes it
+ * later. Everything a frame is encoded from is in the snapshot, so the slow, GPS and event frames written with it
+ * match the main frame. The PID loop is the only writer of the head and the task the only writer of the tail.
+ *
+ * Events logged from outside the encoder wait in the event ring, each one is written just before the snapshot that
+ * was queued after it.
+ */
+#define BLACKBOX_SNAPSHOT_RING_SIZE 16
+#define BLACKBOX_EVENT_RING_SIZE 4
+
+typedef struct blackboxSnapshot_s {
+    blackboxMainState_t state;
+    blackboxSlowState_t slow;
+    uint32_t armingBeepTimeUs;
+#ifdef GPS
+    blackboxGpsFix_t gps;
+#endif
+    uint32_t iteration;
+    bool intraframe;
+    bool slowFrameDue;          // the slow frame is written even if it didn't change
+} blackboxSnapshot_t;
+
+typedef struct blackboxQueuedEvent_s {
+    flightLogEvent_t event;
+    uint8_t snapshotIndex;      // the snapshot ring head when the event was logged
+} blackboxQueuedEvent_t;
+
+static blackboxSnapshot_t blackboxSnapshotRing[BLACKBOX_SNAPSHOT_RING_SIZE];
+static volatile uint8_t blackboxSnapshotHead;
+static volatile uint8_t blackboxSnapshotTail;
+static blackboxQueuedEvent_t blackboxEventRing[BLACKBOX_EVENT_RING_SIZE];
+static uint8_t blackboxEventHead;
+static uint8_t blackboxEventTail;
+static bool blackboxSnapshotResync;
+static bool blackboxSnapshotEncoding;
+static uint32_t blackboxDroppedFrames;
+static bool blackboxDeferred;
+
+static void blackboxQueueSnapshot(timeUs_t currentTimeUs, bool intraframe);
+static void blackboxQueueEvent(FlightLogEvent event, const flightLogEventData_t *data);
+static void blackboxEncodeSnapshots(void);
+#endif
+
+static void blackboxWriteEvent(FlightLogEvent event, const flightLogEventData_t *data);
+
+#ifdef USE_BLACKBOX_GYRO_RAW
+/*
+ * In gyro raw mode the gyro fills one block while the other waits for the device. A full block is handed to the
+ * logger and only given back once it has been written, when both are waiting the samples are dropped and counted.
+ * The gyro is the only writer of the block it fills and the logger the only writer of a ready block.
+ */
+static blackboxGyroRawBlock_t blackboxGyroRawBlocks[2];
+static volatile bool blackboxGyroRawBlockReady[2];
+static uint8_t blackboxGyroRawFillIndex;
+static uint8_t blackboxGyroRawWriteIndex;
+// Samples in a full block, fewer than BLACKBOX_GYRO_RAW_BLOCK_SAMPLES when the device buffers are small
+static uint8_t blackboxGyroRawBlockSamples;
+static volatile bool blackboxGyroRawActive;
+static uint16_t blackboxGyroRawPendingDrops;
+static uint32_t blackboxGyroRawDroppedSamples;
+// blackboxConfig()->mode was BLACKBOX_MODE_GYRO_RAW when the log was started
+static bool blackboxGyroRawMode;
+
+STATIC_ASSERT(offsetof(blackboxGyroRawBlock_t, samples) == BLACKBOX_GYRO_RAW_BLOCK_HEADER_SIZE, gyro_raw_block_header_not_packed);
+#endif
+
 /*
  * We store voltages in I-frames relative to this, which was the voltage when the blackbox was activated.
  * This helps out since the voltage is only expected to fall from that point and we can reduce our diffs
@@ -363,6 +445,11 @@ static bool blackboxLoggedAnyFrames;
  */
 static uint16_t vbatReference;
 
+// blackboxConfig()->encoding when the log was started, the header describes the fields with it
+static uint8_t blackboxEncoding;
+// Rice coding state of each P frame field, restarted by every I frame so a decoder can pick up from any of them
+static blackboxRiceState_t blackboxRiceStates[ARRAYLEN(blackboxMainFields)];
+
 static blackboxGpsState_t gpsHistory;
 static blackboxSlowState_t slowHistory;
 
@@ -475,10 +562,21 @@ static bool testBlackboxCondition(FlightLogFieldCondition condition)
 
 static void blackboxSetState(BlackboxState newState)
 {
+#ifdef USE_BLACKBOX_GYRO_RAW
+    // The gyro only queues samples while the log is running
+    blackboxGyroRawActive = blackboxGyroRawMode && newState == BLACKBOX_STATE_RUNNING;
+#endif
+
     //Perform initial setup required for the new state
     switch (newState) {
     case BLACKBOX_STATE_PREPARE_LOG_FILE:
         blackboxLoggedAnyFrames = false;
+#ifdef USE_BLACKBOX_DEFERRED
+        blackboxSnapshotTail = blackboxSnapshotHead;
+        blackboxEventTail = blackboxEventHead;
+        blackboxSnapshotResync = false;
+        blackboxDroppedFrames = 0;
+#endif
         break;
     case BLACKBOX_STATE_SEND_HEADER:
         blackboxHeaderBudget = 0;
@@ -507,13 +605,14 @@ static void blackboxSetState(BlackboxState newState)
     blackboxState = newState;
 }
 
-static void writeIntraframe(void)
+static void writeIntraframe(uint32_t iteration)
 {
     blackboxMainState_t *blackboxCurrent = blackboxHistory[0];
 
+    blackboxFrameBegin();
     blackboxWrite('I');
 
-    blackboxWriteUnsignedVB(blackboxIteration);
+    blackboxWriteUnsignedVB(iteration);
     blackboxWriteUnsignedVB(blackboxCurrent->time);
 
     blackboxWriteSignedVBArray(blackboxCurrent->axisPID_P, XYZ_AXIS_COUNT);
@@ -595,6 +694,12 @@ static void writeIntraframe(void)
         blackboxWriteSignedVB(blackboxCurrent->servo[5] - 1500);
     }
 
+    blackboxFrameCommit();
+
+    for (unsigned i = 0; i < ARRAYLEN(blackboxRiceStates); i++) {
+        blackboxRiceStateInit(&blackboxRiceStates[i]);
+    }
+
     //Rotate our history buffers:
 
     //The current state becomes the new "before" state
@@ -607,26 +712,31 @@ static void writeIntraframe(void)
     blackboxLoggedAnyFrames = true;
 }
 
-static void blackboxWriteMainStateArrayUsingAveragePredictor(int arrOffsetInHistory, int count)
+static int loadMainStateArrayResiduals(int32_t *residuals, int arrOffsetInHistory, int count, bool straightLine)
 {
     int16_t *curr  = (int16_t*) ((char*) (blackboxHistory[0]) + arrOffsetInHistory);
     int16_t *prev1 = (int16_t*) ((char*) (blackboxHistory[1]) + arrOffsetInHistory);
     int16_t *prev2 = (int16_t*) ((char*) (blackboxHistory[2]) + arrOffsetInHistory);
 
     for (int i = 0; i < count; i++) {
-        // Predictor is the average of the previous two history states
-        int32_t predictor = (prev1[i] + prev2[i]) / 2;
+        // Predictor is the average of the previous two history states, or the line through them
+        const int32_t predictor = straightLine ? 2 * prev1[i] - prev2[i] : (prev1[i] + prev2[i]) / 2;
 
-        blackboxWriteSignedVB(curr[i] - predictor);
+        residuals[i] = curr[i] - predictor;
     }
+    return count;
 }
 
-static void writeInterframe(void)
+/*
+ * Fill residuals with the values of the P frame fields minus their predictions, in the order of the field
+ * definitions. Returns the number of fields, optionalFieldCount is set to the number of fields in the TAG8_8SVB group.
+ */
+static int loadInterframeResiduals(int32_t *residuals, int *optionalFieldCount)
 {
     blackboxMainState_t *blackboxCurrent = blackboxHistory[0];
     blackboxMainState_t *blackboxLast = blackboxHistory[1];
-
-    blackboxWrite('P');
+    const bool straightLine = blackboxEncoding == BLACKBOX_ENCODING_RICE_LINEAR;
+    int count = 0;
 
     //No need to store iteration count since its delta is always 1
 
@@ -634,18 +744,13 @@ static void writeInterframe(void)
      * Since the difference between the difference between successive times will be nearly zero (due to consistent
      * looptime spacing), use second-order differences.
      */
-    blackboxWriteSignedVB((int32_t) (blackboxHistory[0]->time - 2 * blackboxHistory[1]->time + blackboxHistory[2]->time));
+    residuals[count++] = (int32_t) (blackboxHistory[0]->time - 2 * blackboxHistory[1]->time + blackboxHistory[2]->time);
 
-    int32_t deltas[8];
-    arraySubInt32(deltas, blackboxCurrent->axisPID_P, blackboxLast->axisPID_P, XYZ_AXIS_COUNT);
-    blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
+    arraySubInt32(&residuals[count], blackboxCurrent->axisPID_P, blackboxLast->axisPID_P, XYZ_AXIS_COUNT);
+    count += XYZ_AXIS_COUNT;
 
-    /*
-     * The PID I field changes very slowly, most of the time +-2, so use an encoding
-     * that can pack all three fields into one byte in that situation.
-     */
-    arraySubInt32(deltas, blackboxCurrent->axisPID_I, blackboxLast->axisPID_I, XYZ_AXIS_COUNT);
-    blackboxWriteTag2_3S32(deltas);
+    arraySubInt32(&residuals[count], blackboxCurrent->axisPID_I, blackboxLast->axisPID_I, XYZ_AXIS_COUNT);
+    count += XYZ_AXIS_COUNT;
 
     /*
      * The PID D term is frequently set to zero for yaw, which makes the result from the calculation
@@ -653,71 +758,119 @@ static void writeInterframe(void)
      */
     for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
         if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_0 + x)) {
-            blackboxWriteSignedVB(blackboxCurrent->axisPID_D[x] - blackboxLast->axisPID_D[x]);
+            residuals[count++] = blackboxCurrent->axisPID_D[x] - blackboxLast->axisPID_D[x];
         }
     }
 
-    /*
-     * RC tends to stay the same or fairly small for many frames at a time, so use an encoding that
-     * can pack multiple values per byte:
-     */
     for (int x = 0; x < 4; x++) {
-        deltas[x] = blackboxCurrent->rcCommand[x] - blackboxLast->rcCommand[x];
+        residuals[count++] = blackboxCurrent->rcCommand[x] - blackboxLast->rcCommand[x];
     }
 
-    blackboxWriteTag8_4S16(deltas);
-
     //Check for sensors that are updated periodically (so deltas are normally zero)
-    int optionalFieldCount = 0;
+    const int optionalFieldStart = count;
 
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_VBAT)) {
-        deltas[optionalFieldCount++] = (int32_t) blackboxCurrent->vbatLatest - blackboxLast->vbatLatest;
+        residuals[count++] = (int32_t) blackboxCurrent->vbatLatest - blackboxLast->vbatLatest;
     }
 
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_AMPERAGE_ADC)) {
-        deltas[optionalFieldCount++] = (int32_t) blackboxCurrent->amperageLatest - blackboxLast->amperageLatest;
+        residuals[count++] = (int32_t) blackboxCurrent->amperageLatest - blackboxLast->amperageLatest;
     }
 
 #ifdef MAG
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_MAG)) {
         for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
-            deltas[optionalFieldCount++] = blackboxCurrent->magADC[x] - blackboxLast->magADC[x];
+            residuals[count++] = blackboxCurrent->magADC[x] - blackboxLast->magADC[x];
         }
     }
 #endif
 
 #ifdef BARO
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_BARO)) {
-        deltas[optionalFieldCount++] = blackboxCurrent->BaroAlt - blackboxLast->BaroAlt;
+        residuals[count++] = blackboxCurrent->BaroAlt - blackboxLast->BaroAlt;
     }
 #endif
 
 #ifdef SONAR
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_SONAR)) {
-        deltas[optionalFieldCount++] = blackboxCurrent->sonarRaw - blackboxLast->sonarRaw;
+        residuals[count++] = blackboxCurrent->sonarRaw - blackboxLast->sonarRaw;
     }
 #endif
 
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_RSSI)) {
-        deltas[optionalFieldCount++] = (int32_t) blackboxCurrent->rssi - blackboxLast->rssi;
+        residuals[count++] = (int32_t) blackboxCurrent->rssi - blackboxLast->rssi;
     }
 
-    blackboxWriteTag8_8SVB(deltas, optionalFieldCount);
+    *optionalFieldCount = count - optionalFieldStart;
 
-    //Since gyros, accs and motors are noisy, base their predictions on the average of the history:
-    blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, gyroADC),   XYZ_AXIS_COUNT);
+    //Since gyros, accs and motors are noisy, base their predictions on the average of the history.
+    //The fields with a PpredictLinear in blackboxMainFields use the straight line instead when it is selected:
+    count += loadMainStateArrayResiduals(&residuals[count], offsetof(blackboxMainState_t, gyroADC), XYZ_AXIS_COUNT, straightLine);
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_ACC)) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, accSmooth), XYZ_AXIS_COUNT);
+        count += loadMainStateArrayResiduals(&residuals[count], offsetof(blackboxMainState_t, accSmooth), XYZ_AXIS_COUNT, false);
     }
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_DEBUG)) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, debug), DEBUG16_VALUE_COUNT);
+        count += loadMainStateArrayResiduals(&residuals[count], offsetof(blackboxMainState_t, debug), DEBUG16_VALUE_COUNT, false);
     }
-    blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, motor),     getMotorCount());
+    count += loadMainStateArrayResiduals(&residuals[count], offsetof(blackboxMainState_t, motor), getMotorCount(), straightLine);
 
     if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_TRICOPTER)) {
-        blackboxWriteSignedVB(blackboxCurrent->servo[5] - blackboxLast->servo[5]);
+        residuals[count++] = blackboxCurrent->servo[5] - blackboxLast->servo[5];
     }
 
+    return count;
+}
+
+static void writeInterframe(void)
+{
+    int32_t residuals[ARRAYLEN(blackboxMainFields)];
+    int optionalFieldCount;
+    const int fieldCount = loadInterframeResiduals(residuals, &optionalFieldCount);
+
+    blackboxFrameBegin();
+    blackboxWrite('P');
+
+    if (blackboxEncoding != BLACKBOX_ENCODING_VB) {
+        for (int i = 0; i < fieldCount; i++) {
+            blackboxWriteRice(&blackboxRiceStates[i], residuals[i]);
+        }
+        blackboxFlushBits();
+    } else {
+        int32_t *residual = residuals;
+
+        // time and the PID P terms
+        blackboxWriteSignedVBArray(residual, 1 + XYZ_AXIS_COUNT);
+        residual += 1 + XYZ_AXIS_COUNT;
+
+        /*
+         * The PID I field changes very slowly, most of the time +-2, so use an encoding
+         * that can pack all three fields into one byte in that situation.
+         */
+        blackboxWriteTag2_3S32(residual);
+        residual += XYZ_AXIS_COUNT;
+
+        for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
+            if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_0 + x)) {
+                blackboxWriteSignedVB(*residual++);
+            }
+        }
+
+        /*
+         * RC tends to stay the same or fairly small for many frames at a time, so use an encoding that
+         * can pack multiple values per byte:
+         */
+        blackboxWriteTag8_4S16(residual);
+        residual += 4;
+
+        blackboxWriteTag8_8SVB(residual, optionalFieldCount);
+        residual += optionalFieldCount;
+
+        // gyros, accs, debug, motors and the tail servo
+        blackboxWriteSignedVBArray(residual, residuals + fieldCount - residual);
+    }
+
+    blackboxFrameCommit();
+
     //Rotate our history buffers
     blackboxHistory[2] = blackboxHistory[1];
     blackboxHistory[1] = blackboxHistory[0];
@@ -732,6 +885,7 @@ static void writeSlowFrame(void)
 {
     int32_t values[3];
 
+    blackboxFrameBegin();
     blackboxWrite('S');
 
     blackboxWriteUnsignedVB(slowHistory.flightModeFlags);
@@ -745,6 +899,8 @@ static void writeSlowFrame(void)
     values[2] = slowHistory.rxFlightChannelsValid ? 1 : 0;
     blackboxWriteTag2_3S32(values);
 
+    blackboxFrameCommit();
+
     blackboxSlowFrameIterationTimer = 0;
 }
 
@@ -766,32 +922,28 @@ static void loadSlowState(blackboxSlowState_t *slow)
  * If allowPeriodicWrite is true, the frame is also logged if it has been more than blackboxSInterval logging iterations
  * since the field was last logged.
  */
-STATIC_UNIT_TESTED bool writeSlowFrameIfNeeded(void)
+static bool writeSlowFrameIfChanged(const blackboxSlowState_t *newSlowState, bool periodic)
 {
-    // Write the slow frame peridocially so it can be recovered if we ever lose sync
-    bool shouldWrite = blackboxSlowFrameIterationTimer >= blackboxSInterval;
-
-    if (shouldWrite) {
-        loadSlowState(&slowHistory);
-    } else {
-        blackboxSlowState_t newSlowState;
-
-        loadSlowState(&newSlowState);
-
-        // Only write a slow frame if it was different from the previous state
-        if (memcmp(&newSlowState, &slowHistory, sizeof(slowHistory)) != 0) {
-            // Use the new state as our new history
-            memcpy(&slowHistory, &newSlowState, sizeof(slowHistory));
-            shouldWrite = true;
-        }
-    }
+    // Only write a slow frame if it was different from the previous state, or periodically so it can be recovered
+    // if we ever lose sync
+    const bool shouldWrite = periodic || memcmp(newSlowState, &slowHistory, sizeof(slowHistory)) != 0;
 
     if (shouldWrite) {
+        // Use the new state as our new history
+        memcpy(&slowHistory, newSlowState, sizeof(slowHistory));
         writeSlowFrame();
     }
     return shouldWrite;
 }
 
+STATIC_UNIT_TESTED bool writeSlowFrameIfNeeded(void)
+{
+    blackboxSlowState_t newSlowState;
+    loadSlowState(&newSlowState);
+
+    return writeSlowFrameIfChanged(&newSlowState, blackboxSlowFrameIterationTimer >= blackboxSInterval);
+}
+
 void blackboxValidateConfig(void)
 {
     // If we've chosen an unsupported device, change the device to serial
@@ -809,8 +961,121 @@ void blackboxValidateConfig(void)
     default:
         blackboxConfigMutable()->device = BLACKBOX_DEVICE_SERIAL;
     }
+
+    if (blackboxConfig()->encoding > BLACKBOX_ENCODING_RICE_LINEAR) {
+        blackboxConfigMutable()->encoding = BLACKBOX_ENCODING_VB;
+    }
+
+    if (blackboxConfig()->mode > BLACKBOX_MODE_GYRO_RAW) {
+        blackboxConfigMutable()->mode = BLACKBOX_MODE_NORMAL;
+    }
+}
+
+#ifdef USE_BLACKBOX_GYRO_RAW
+static void blackboxGyroRawResetBlocks(void)
+{
+    for (int i = 0; i < 2; i++) {
+        blackboxGyroRawBlocks[i].frameType = 'R';
+        blackboxGyroRawBlocks[i].sampleCount = 0;
+        blackboxGyroRawBlockReady[i] = false;
+    }
+    blackboxGyroRawFillIndex = 0;
+    blackboxGyroRawWriteIndex = 0;
+}
+
+/*
+ * Queue one unfiltered gyro sample, called by the gyro for every sample it reads. Does nothing unless a log is running
+ * in BLACKBOX_MODE_GYRO_RAW.
+ */
+void blackboxGyroRawSample(const int16_t *adcRaw, timeUs_t sampleTimeUs)
+{
+    if (!blackboxGyroRawActive) {
+        return;
+    }
+
+    const uint8_t index = blackboxGyroRawFillIndex;
+    if (blackboxGyroRawBlockReady[index]) {
+        // Both blocks are waiting for the device
+        if (blackboxGyroRawPendingDrops < UINT16_MAX) {
+            blackboxGyroRawPendingDrops++;
+        }
+        blackboxGyroRawDroppedSamples++;
+        return;
+    }
+
+    blackboxGyroRawBlock_t *block = &blackboxGyroRawBlocks[index];
+    if (block->sampleCount == 0) {
+        block->timeUs = sampleTimeUs;
+        block->droppedSamples = blackboxGyroRawPendingDrops;
+        blackboxGyroRawPendingDrops = 0;
+    }
+
+    int16_t *sample = block->samples[block->sampleCount];
+    sample[X] = adcRaw[X];
+    sample[Y] = adcRaw[Y];
+    sample[Z] = adcRaw[Z];
+
+    if (++block->sampleCount == blackboxGyroRawBlockSamples) {
+        blackboxGyroRawBlockReady[index] = true;
+        blackboxGyroRawFillIndex = index ^ 1;
+    }
 }
 
+static bool blackboxWriteGyroRawBlock(blackboxGyroRawBlock_t *block)
+{
+    const int length = BLACKBOX_GYRO_RAW_BLOCK_HEADER_SIZE + block->sampleCount * sizeof(block->samples[0]);
+    if (!blackboxDeviceHasSpace(length)) {
+        return false;
+    }
+    blackboxWriteBuf((const uint8_t *)block, length);
+    blackboxLoggedAnyFrames = true;
+    return true;
+}
+
+// Write the blocks the gyro has filled, in the order they were filled
+static void blackboxWriteGyroRawBlocks(void)
+{
+    while (blackboxGyroRawBlockReady[blackboxGyroRawWriteIndex]) {
+        blackboxGyroRawBlock_t *block = &blackboxGyroRawBlocks[blackboxGyroRawWriteIndex];
+        if (!blackboxWriteGyroRawBlock(block)) {
+            // Retried on the next call, the gyro drops samples if it runs out of blocks meanwhile
+            break;
+        }
+        block->sampleCount = 0;
+        blackboxGyroRawBlockReady[blackboxGyroRawWriteIndex] = false;
+        blackboxGyroRawWriteIndex ^= 1;
+    }
+}
+
+/*
+ * Stop queueing samples and write everything queued so far, including the block the gyro was filling. Called when
+ * the log is paused or finished.
+ */
+static void blackboxGyroRawFlush(void)
+{
+    blackboxGyroRawActive = false;
+
+    blackboxWriteGyroRawBlocks();
+
+    blackboxGyroRawBlock_t *block = &blackboxGyroRawBlocks[blackboxGyroRawFillIndex];
+    if (!blackboxGyroRawBlockReady[blackboxGyroRawFillIndex] && block->sampleCount > 0 && blackboxWriteGyroRawBlock(block)) {
+        block->sampleCount = 0;
+    }
+
+    // Whatever the device had no room for is lost, the next block reports it
+    for (int i = 0; i < 2; i++) {
+        blackboxGyroRawPendingDrops = MIN(blackboxGyroRawPendingDrops + blackboxGyroRawBlocks[i].sampleCount, UINT16_MAX);
+        blackboxGyroRawDroppedSamples += blackboxGyroRawBlocks[i].sampleCount;
+    }
+    blackboxGyroRawResetBlocks();
+}
+
+uint32_t blackboxGetGyroRawDroppedSamples(void)
+{
+    return blackboxGyroRawDroppedSamples;
+}
+#endif
+
 static void blackboxResetIterationTimers(void)
 {
     blackboxIteration = 0;
@@ -839,6 +1104,16 @@ static void blackboxStart(void)
     blackboxHistory[2] = &blackboxHistoryRing[2];
 
     vbatReference = getBatteryVoltageLatest();
+    blackboxEncoding = blackboxConfig()->encoding;
+#ifdef USE_BLACKBOX_GYRO_RAW
+    blackboxGyroRawMode = blackboxConfig()->mode == BLACKBOX_MODE_GYRO_RAW;
+    // A block is written whole, so it takes at most half the device buffers and the next one fits while it drains
+    const int gyroRawBlockBytes = blackboxGetDeviceBufferSize() / 2 - BLACKBOX_GYRO_RAW_BLOCK_HEADER_SIZE;
+    blackboxGyroRawBlockSamples = constrain(gyroRawBlockBytes / (int)sizeof(blackboxGyroRawBlocks[0].samples[0]), 1, BLACKBOX_GYRO_RAW_BLOCK_SAMPLES);
+    blackboxGyroRawResetBlocks();
+    blackboxGyroRawPendingDrops = 0;
+    blackboxGyroRawDroppedSamples = 0;
+#endif
 
     //No need to clear the content of blackboxHistoryRing since our first frame will be an intra which overwrites it
 
@@ -877,7 +1152,15 @@ void blackboxFinish(void)
 
     case BLACKBOX_STATE_RUNNING:
     case BLACKBOX_STATE_PAUSED:
-        blackboxLogEvent(FLIGHT_LOG_EVENT_LOG_END, NULL);
+#ifdef USE_BLACKBOX_DEFERRED
+        blackboxEncodeQueuedFrames(micros());
+#endif
+#ifdef USE_BLACKBOX_GYRO_RAW
+        if (blackboxGyroRawMode) {
+            blackboxGyroRawFlush();
+        }
+#endif
+        blackboxWriteEvent(FLIGHT_LOG_EVENT_LOG_END, NULL);
 
         // Fall through
     default:
@@ -934,20 +1217,26 @@ bool inMotorTestMode(void) {
 }
 
 #ifdef GPS
-static void writeGPSHomeFrame(void)
+static void writeGPSHomeFrame(const blackboxGpsFix_t *fix)
 {
+    blackboxFrameBegin();
     blackboxWrite('H');
 
-    blackboxWriteSignedVB(GPS_home[0]);
-    blackboxWriteSignedVB(GPS_home[1]);
+    blackboxWriteSignedVB(fix->home[0]);
+    blackboxWriteSignedVB(fix->home[1]);
     //TODO it'd be great if we could grab the GPS current time and write that too
 
-    gpsHistory.GPS_home[0] = GPS_home[0];
-    gpsHistory.GPS_home[1] = GPS_home[1];
+    blackboxFrameCommit();
+
+    gpsHistory.GPS_home[0] = fix->home[0];
+    gpsHistory.GPS_home[1] = fix->home[1];
 }
 
-static void writeGPSFrame(timeUs_t currentTimeUs)
+static void writeGPSFrame(const blackboxGpsFix_t *fix, timeUs_t currentTimeUs)
 {
+    const gpsSolutionData_t *sol = &fix->sol;
+
+    blackboxFrameBegin();
     blackboxWrite('G');
 
     /*
@@ -961,27 +1250,28 @@ static void writeGPSFrame(timeUs_t currentTimeUs)
         blackboxWriteUnsignedVB(currentTimeUs - blackboxHistory[1]->time);
     }
 
-    blackboxWriteUnsignedVB(gpsSol.numSat);
-    blackboxWriteSignedVB(gpsSol.llh.lat - gpsHistory.GPS_home[LAT]);
-    blackboxWriteSignedVB(gpsSol.llh.lon - gpsHistory.GPS_home[LON]);
-    blackboxWriteUnsignedVB(gpsSol.llh.alt);
-    blackboxWriteUnsignedVB(gpsSol.groundSpeed);
-    blackboxWriteUnsignedVB(gpsSol.groundCourse);
+    blackboxWriteUnsignedVB(sol->numSat);
+    blackboxWriteSignedVB(sol->llh.lat - gpsHistory.GPS_home[LAT]);
+    blackboxWriteSignedVB(sol->llh.lon - gpsHistory.GPS_home[LON]);
+    blackboxWriteUnsignedVB(sol->llh.alt);
+    blackboxWriteUnsignedVB(sol->groundSpeed);
+    blackboxWriteUnsignedVB(sol->groundCourse);
+
+    blackboxFrameCommit();
 
-    gpsHistory.GPS_numSat = gpsSol.numSat;
-    gpsHistory.GPS_coord[LAT] = gpsSol.llh.lat;
-    gpsHistory.GPS_coord[LON] = gpsSol.llh.lon;
+    gpsHistory.GPS_numSat = sol->numSat;
+    gpsHistory.GPS_coord[LAT] = sol->llh.lat;
+    gpsHistory.GPS_coord[LON] = sol->llh.lon;
 }
 #endif
 
 /**
  * Fill the current state of the blackbox using values read from the flight controller
  */
-static void loadMainState(timeUs_t currentTimeUs)
+static void loadMainState(blackboxMainState_t *blackboxCurrent, timeUs_t currentTimeUs)
 {
-#ifndef UNIT_TEST
-    blackboxMainState_t *blackboxCurrent = blackboxHistory[0];
-
+    // Unit tests provide the flight state only when they ask for it
+#if !defined(UNIT_TEST) || defined(BLACKBOX_TEST_FLIGHT_STATE)
     blackboxCurrent->time = currentTimeUs;
 
     for (int i = 0; i < XYZ_AXIS_COUNT; i++) {
@@ -1027,10 +1317,31 @@ static void loadMainState(timeUs_t currentTimeUs)
     blackboxCurrent->servo[5] = servo[5];
 #endif
 #else
+    UNUSED(blackboxCurrent);
     UNUSED(currentTimeUs);
 #endif // UNIT_TEST
 }
 
+/*
+ * The definitions hold the P frame predictors and encodings of BLACKBOX_ENCODING_VB, the Rice encodings code every
+ * field the same way.
+ */
+static uint8_t blackboxDeltaFieldHeaderValue(const blackboxDeltaFieldDefinition_t *def, int headerIndex)
+{
+    const bool isPredictor = headerIndex == BLACKBOX_SIMPLE_FIELD_HEADER_COUNT;
+
+    if (blackboxEncoding == BLACKBOX_ENCODING_VB || (!isPredictor && def->Pencode == FLIGHT_LOG_FIELD_ENCODING_NULL)) {
+        return isPredictor ? def->Ppredict : def->Pencode;
+    }
+    if (!isPredictor) {
+        return FLIGHT_LOG_FIELD_ENCODING_ADAPTIVE_RICE;
+    }
+    if (blackboxEncoding == BLACKBOX_ENCODING_RICE_LINEAR && def->PpredictLinear != FLIGHT_LOG_FIELD_PREDICTOR_0) {
+        return def->PpredictLinear;
+    }
+    return def->Ppredict;
+}
+
 /**
  * Transmit the header information for the given field definitions. Transmitted header lines look like:
  *
@@ -1129,6 +1440,8 @@ static bool sendFieldDefinition(char mainFrameChar, char deltaFrameChar, const v
                 if (def->fieldNameIndex != -1) {
                     blackboxPrintf("[%d]", def->fieldNameIndex);
                 }
+            } else if (xmitState.headerIndex >= BLACKBOX_SIMPLE_FIELD_HEADER_COUNT) {
+                blackboxPrintf("%d", blackboxDeltaFieldHeaderValue((const blackboxDeltaFieldDefinition_t *) def, xmitState.headerIndex));
             } else {
                 //The other headers are integers
                 blackboxPrintf("%d", def->arr[xmitState.headerIndex - 1]);
@@ -1181,6 +1494,7 @@ static bool blackboxWriteSysinfo(void)
         BLACKBOX_PRINT_HEADER_LINE("I interval", "%d",                      blackboxIInterval);
         BLACKBOX_PRINT_HEADER_LINE("P interval", "%d/%d",                   blackboxGetRateNum(), blackboxGetRateDenom());
         BLACKBOX_PRINT_HEADER_LINE("P denom", "%d",                         blackboxConfig()->p_denom);
+        BLACKBOX_PRINT_HEADER_LINE("P encoding", "%d",                      blackboxEncoding);
         BLACKBOX_PRINT_HEADER_LINE("minthrottle", "%d",                     motorConfig()->minthrottle);
         BLACKBOX_PRINT_HEADER_LINE("maxthrottle", "%d",                     motorConfig()->maxthrottle);
         BLACKBOX_PRINT_HEADER_LINE("gyro_scale","0x%x",                     castFloatBytesToInt(1.0f));
@@ -1207,6 +1521,15 @@ static bool blackboxWriteSysinfo(void)
             );
 
         BLACKBOX_PRINT_HEADER_LINE("looptime", "%d",                        gyro.targetLooptime);
+#ifdef USE_BLACKBOX_GYRO_RAW
+        BLACKBOX_PRINT_HEADER_LINE_CUSTOM(
+            if (blackboxGyroRawMode) {
+                // samples per block, sample interval in us and degrees per second per LSB of the R frames
+                blackboxPrintfHeaderLine("gyro_raw", "%d,%d,0x%x", blackboxGyroRawBlockSamples, gyro.targetLooptime,
+                    castFloatBytesToInt(gyroRawScale()));
+            }
+            );
+#endif
         BLACKBOX_PRINT_HEADER_LINE("gyro_sync_denom", "%d",                 gyroConfig()->gyro_sync_denom);
         BLACKBOX_PRINT_HEADER_LINE("pid_process_denom", "%d",               pidConfig()->pid_process_denom);
         BLACKBOX_PRINT_HEADER_LINE("rc_rate", "%d",                         currentControlRateProfile->rcRate8);
@@ -1298,21 +1621,20 @@ static bool blackboxWriteSysinfo(void)
     }
 
     xmitState.headerIndex++;
-#endif // UNIT_TEST
     return false;
+#else
+    // The unit tests write no system information, the decoder is given what it needs directly
+    return true;
+#endif // UNIT_TEST
 }
 
 /**
  * Write the given event to the log immediately
  */
-void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data)
+static void blackboxWriteEvent(FlightLogEvent event, const flightLogEventData_t *data)
 {
-    // Only allow events to be logged after headers have been written
-    if (!(blackboxState == BLACKBOX_STATE_RUNNING || blackboxState == BLACKBOX_STATE_PAUSED)) {
-        return;
-    }
-
     //Shared header for event frames
+    blackboxFrameBegin();
     blackboxWrite('E');
     blackboxWrite(event);
 
@@ -1343,33 +1665,67 @@ void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data)
         blackboxWrite(0);
         break;
     }
+
+    blackboxFrameCommit();
+}
+
+/**
+ * Log the given event, in deferred mode TASK_BLACKBOX writes it after the frames queued before it
+ */
+void blackboxLogEvent(FlightLogEvent event, flightLogEventData_t *data)
+{
+    // Only allow events to be logged after headers have been written
+    if (!(blackboxState == BLACKBOX_STATE_RUNNING || blackboxState == BLACKBOX_STATE_PAUSED)) {
+        return;
+    }
+
+#ifdef USE_BLACKBOX_DEFERRED
+    // Events from the encoder go straight in between the frames it writes
+    if (blackboxDeferred && !blackboxSnapshotEncoding) {
+        blackboxQueueEvent(event, data);
+        return;
+    }
+#endif
+
+    blackboxWriteEvent(event, data);
 }
 
 /* If an arming beep has played since it was last logged, write the time of the arming beep to the log as a synchronization point */
-static void blackboxCheckAndLogArmingBeep(void)
+static void blackboxLogArmingBeepIfChanged(uint32_t armingBeepTimeUs)
 {
     // Use != so that we can still detect a change if the counter wraps
-    if (getArmingBeepTimeMicros() != blackboxLastArmingBeep) {
-        blackboxLastArmingBeep = getArmingBeepTimeMicros();
+    if (armingBeepTimeUs != blackboxLastArmingBeep) {
+        blackboxLastArmingBeep = armingBeepTimeUs;
         flightLogEvent_syncBeep_t eventData;
         eventData.time = blackboxLastArmingBeep;
         blackboxLogEvent(FLIGHT_LOG_EVENT_SYNC_BEEP, (flightLogEventData_t *)&eventData);
     }
 }
 
+static void blackboxCheckAndLogArmingBeep(void)
+{
+    blackboxLogArmingBeepIfChanged(getArmingBeepTimeMicros());
+}
+
 /* monitor the flight mode event status and trigger an event record if the state changes */
-static void blackboxCheckAndLogFlightMode(void)
+static void blackboxLogFlightModeIfChanged(uint32_t flightModeFlags)
 {
-    // Use != so that we can still detect a change if the counter wraps
-    if (memcmp(&rcModeActivationMask, &blackboxLastFlightModeFlags, sizeof(blackboxLastFlightModeFlags))) {
+    if (flightModeFlags != blackboxLastFlightModeFlags) {
         flightLogEvent_flightMode_t eventData; // Add new data for current flight mode flags
         eventData.lastFlags = blackboxLastFlightModeFlags;
-        memcpy(&blackboxLastFlightModeFlags, &rcModeActivationMask, sizeof(blackboxLastFlightModeFlags));
-        memcpy(&eventData.flags, &rcModeActivationMask, sizeof(eventData.flags));
+        blackboxLastFlightModeFlags = flightModeFlags;
+        eventData.flags = flightModeFlags;
         blackboxLogEvent(FLIGHT_LOG_EVENT_FLIGHTMODE, (flightLogEventData_t *)&eventData);
     }
 }
 
+static void blackboxCheckAndLogFlightMode(void)
+{
+    uint32_t flightModeFlags;
+    memcpy(&flightModeFlags, &rcModeActivationMask, sizeof(flightModeFlags));
+    blackboxLogFlightModeIfChanged(flightModeFlags);
+}
+
 STATIC_UNIT_TESTED bool blackboxShouldLogPFrame(void)
 {
     return blackboxPFrameIndex == 0 && blackboxConfig()->p_denom != 0;
@@ -1388,13 +1744,39 @@ STATIC_UNIT_TESTED bool blackboxShouldLogIFrame(void)
  * still be interpreted correctly.
  */
 #ifdef GPS
-STATIC_UNIT_TESTED bool blackboxShouldLogGpsHomeFrame(void)
+static void loadGpsFix(blackboxGpsFix_t *fix)
 {
-    if (GPS_home[0] != gpsHistory.GPS_home[0] || GPS_home[1] != gpsHistory.GPS_home[1]
-        || (blackboxPFrameIndex == blackboxIInterval / 2 && blackboxIFrameIndex % 128 == 0)) {
-        return true;
+    fix->home[0] = GPS_home[0];
+    fix->home[1] = GPS_home[1];
+    fix->sol = gpsSol;
+    fix->homeDue = blackboxPFrameIndex == blackboxIInterval / 2 && blackboxIFrameIndex % 128 == 0;
+}
+
+static bool blackboxShouldLogGpsHomeFrame(const blackboxGpsFix_t *fix)
+{
+    return fix->home[0] != gpsHistory.GPS_home[0] || fix->home[1] != gpsHistory.GPS_home[1] || fix->homeDue;
+}
+
+static void writeGPSFramesIfChanged(const blackboxGpsFix_t *fix, timeUs_t currentTimeUs)
+{
+    if (feature(FEATURE_GPS)) {
+        if (blackboxShouldLogGpsHomeFrame(fix)) {
+            writeGPSHomeFrame(fix);
+            writeGPSFrame(fix, currentTimeUs);
+        } else if (fix->sol.numSat != gpsHistory.GPS_numSat
+                || fix->sol.llh.lat != gpsHistory.GPS_coord[LAT]
+                || fix->sol.llh.lon != gpsHistory.GPS_coord[LON]) {
+            //We could check for velocity changes as well but I doubt it changes independent of position
+            writeGPSFrame(fix, currentTimeUs);
+        }
     }
-    return false;
+}
+
+static void writeGPSFramesIfNeeded(timeUs_t currentTimeUs)
+{
+    blackboxGpsFix_t fix;
+    loadGpsFix(&fix);
+    writeGPSFramesIfChanged(&fix, currentTimeUs);
 }
 #endif // GPS
 
@@ -1416,6 +1798,29 @@ STATIC_UNIT_TESTED void blackboxAdvanceIterationTimers(void)
 // Called once every FC loop in order to log the current state
 STATIC_UNIT_TESTED void blackboxLogIteration(timeUs_t currentTimeUs)
 {
+#ifdef USE_BLACKBOX_GYRO_RAW
+    if (blackboxGyroRawMode) {
+        // Nothing but the gyro samples is logged, they bypass the frame encoder
+#ifdef USE_BLACKBOX_DEFERRED
+        if (blackboxDeferred) {
+            return;
+        }
+#endif
+        blackboxWriteGyroRawBlocks();
+        blackboxDeviceFlush();
+        return;
+    }
+#endif
+
+#ifdef USE_BLACKBOX_DEFERRED
+    if (blackboxDeferred) {
+        if (blackboxShouldLogIFrame() || blackboxShouldLogPFrame()) {
+            blackboxQueueSnapshot(currentTimeUs, blackboxShouldLogIFrame());
+        }
+        return;
+    }
+#endif
+
     // Write a keyframe every blackboxIInterval frames so we can resynchronise upon missing frames
     if (blackboxShouldLogIFrame()) {
         /*
@@ -1426,8 +1831,8 @@ STATIC_UNIT_TESTED void blackboxLogIteration(timeUs_t currentTimeUs)
             writeSlowFrameIfNeeded();
         }
 
-        loadMainState(currentTimeUs);
-        writeIntraframe();
+        loadMainState(blackboxHistory[0], currentTimeUs);
+        writeIntraframe(blackboxIteration);
     } else {
         blackboxCheckAndLogArmingBeep();
         blackboxCheckAndLogFlightMode(); // Check for FlightMode status change event
@@ -1439,21 +1844,11 @@ STATIC_UNIT_TESTED void blackboxLogIteration(timeUs_t currentTimeUs)
              */
             writeSlowFrameIfNeeded();
 
-            loadMainState(currentTimeUs);
+            loadMainState(blackboxHistory[0], currentTimeUs);
             writeInterframe();
         }
 #ifdef GPS
-        if (feature(FEATURE_GPS)) {
-            if (blackboxShouldLogGpsHomeFrame()) {
-                writeGPSHomeFrame();
-                writeGPSFrame(currentTimeUs);
-            } else if (gpsSol.numSat != gpsHistory.GPS_numSat
-                    || gpsSol.llh.lat != gpsHistory.GPS_coord[LAT]
-                    || gpsSol.llh.lon != gpsHistory.GPS_coord[LON]) {
-                //We could check for velocity changes as well but I doubt it changes independent of position
-                writeGPSFrame(currentTimeUs);
-            }
-        }
+        writeGPSFramesIfNeeded(currentTimeUs);
 #endif
     }
 
@@ -1461,6 +1856,141 @@ STATIC_UNIT_TESTED void blackboxLogIteration(timeUs_t currentTimeUs)
     blackboxDeviceFlush();
 }
 
+#ifdef USE_BLACKBOX_DEFERRED
+static void blackboxQueueSnapshot(timeUs_t currentTimeUs, bool intraframe)
+{
+    const uint8_t head = blackboxSnapshotHead;
+    const uint8_t nextHead = (head + 1) % BLACKBOX_SNAPSHOT_RING_SIZE;
+
+    if (nextHead == blackboxSnapshotTail) {
+        // The encoder fell behind, drop the frame rather than wait. The P frame chain is broken, restart it with an I frame
+        blackboxDroppedFrames++;
+        blackboxSnapshotResync = true;
+        return;
+    }
+
+    blackboxSnapshot_t *snapshot = &blackboxSnapshotRing[head];
+    loadMainState(&snapshot->state, currentTimeUs);
+    loadSlowState(&snapshot->slow);
+    snapshot->armingBeepTimeUs = getArmingBeepTimeMicros();
+#ifdef GPS
+    loadGpsFix(&snapshot->gps);
+#endif
+    snapshot->iteration = blackboxIteration;
+    snapshot->intraframe = intraframe || blackboxSnapshotResync;
+    blackboxSnapshotResync = false;
+
+    // The slow frame timer runs with the PID loop, so the periodic slow frame is taken here
+    snapshot->slowFrameDue = false;
+    if (!snapshot->intraframe || blackboxIsOnlyLoggingIntraframes()) {
+        snapshot->slowFrameDue = blackboxSlowFrameIterationTimer >= blackboxSInterval;
+        if (snapshot->slowFrameDue) {
+            blackboxSlowFrameIterationTimer = 0;
+        }
+    }
+
+    blackboxSnapshotHead = nextHead;
+}
+
+static void blackboxQueueEvent(FlightLogEvent event, const flightLogEventData_t *data)
+{
+    const uint8_t nextHead = (blackboxEventHead + 1) % BLACKBOX_EVENT_RING_SIZE;
+
+    if (nextHead == blackboxEventTail) {
+        blackboxDroppedFrames++;
+        return;
+    }
+
+    blackboxQueuedEvent_t *queued = &blackboxEventRing[blackboxEventHead];
+    queued->event.event = event;
+    if (data) {
+        queued->event.data = *data;
+    }
+    queued->snapshotIndex = blackboxSnapshotHead;
+    blackboxEventHead = nextHead;
+}
+
+// Writes the queued events that go in front of the snapshot at snapshotIndex
+static void blackboxWriteQueuedEvents(uint8_t snapshotIndex)
+{
+    while (blackboxEventTail != blackboxEventHead && blackboxEventRing[blackboxEventTail].snapshotIndex == snapshotIndex) {
+        const flightLogEvent_t *queued = &blackboxEventRing[blackboxEventTail].event;
+        blackboxWriteEvent(queued->event, &queued->data);
+        blackboxEventTail = (blackboxEventTail + 1) % BLACKBOX_EVENT_RING_SIZE;
+    }
+}
+
+// The encoding half of blackboxLogIteration() for a frame queued by the PID loop
+static void blackboxEncodeSnapshot(const blackboxSnapshot_t *snapshot)
+{
+    *blackboxHistory[0] = snapshot->state;
+
+    if (snapshot->intraframe) {
+        if (blackboxIsOnlyLoggingIntraframes()) {
+            writeSlowFrameIfChanged(&snapshot->slow, snapshot->slowFrameDue);
+        }
+        writeIntraframe(snapshot->iteration);
+    } else {
+        blackboxLogArmingBeepIfChanged(snapshot->armingBeepTimeUs);
+        blackboxLogFlightModeIfChanged(snapshot->slow.flightModeFlags);
+        writeSlowFrameIfChanged(&snapshot->slow, snapshot->slowFrameDue);
+        writeInterframe();
+#ifdef GPS
+        writeGPSFramesIfChanged(&snapshot->gps, snapshot->state.time);
+#endif
+    }
+}
+
+// Encodes the queued frames and writes the queued events in between them, along with the events the frames log
+static void blackboxEncodeSnapshots(void)
+{
+    blackboxSnapshotEncoding = true;
+    uint8_t tail = blackboxSnapshotTail;
+    while (tail != blackboxSnapshotHead) {
+        blackboxWriteQueuedEvents(tail);
+        blackboxEncodeSnapshot(&blackboxSnapshotRing[tail]);
+        tail = (tail + 1) % BLACKBOX_SNAPSHOT_RING_SIZE;
+        blackboxSnapshotTail = tail;
+    }
+    blackboxWriteQueuedEvents(tail);
+    blackboxSnapshotEncoding = false;
+}
+
+/*
+ * Encodes and writes the frames queued by the PID loop, runs as TASK_BLACKBOX.
+ */
+void blackboxEncodeQueuedFrames(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    if (blackboxState != BLACKBOX_STATE_RUNNING && blackboxState != BLACKBOX_STATE_PAUSED) {
+        // The log was stopped under the queued frames
+        blackboxSnapshotTail = blackboxSnapshotHead;
+        blackboxEventTail = blackboxEventHead;
+        return;
+    }
+
+#ifdef USE_BLACKBOX_GYRO_RAW
+    if (blackboxGyroRawMode) {
+        // No frames are queued in this mode, only events
+        blackboxWriteQueuedEvents(blackboxSnapshotHead);
+        blackboxWriteGyroRawBlocks();
+        blackboxDeviceFlush();
+        return;
+    }
+#endif
+
+    blackboxEncodeSnapshots();
+
+    blackboxDeviceFlush();
+}
+
+uint32_t blackboxGetDroppedFrames(void)
+{
+    return blackboxDroppedFrames;
+}
+#endif
+
 /**
  * Call each flight loop iteration to perform blackbox logging.
  */
@@ -1579,6 +2109,15 @@ void blackboxUpdate(timeUs_t currentTimeUs)
         // On entry to this state, blackboxIteration, blackboxPFrameIndex and blackboxIFrameIndex are reset to 0
         // Prevent the Pausing of the log on the mode switch if in Motor Test Mode
         if (blackboxModeActivationConditionPresent && !IS_RC_MODE_ACTIVE(BOXBLACKBOX) && !startedLoggingInTestMode) {
+#ifdef USE_BLACKBOX_DEFERRED
+            // The resume event must not end up in front of frames logged before the pause
+            blackboxEncodeQueuedFrames(currentTimeUs);
+#endif
+#ifdef USE_BLACKBOX_GYRO_RAW
+            if (blackboxGyroRawMode) {
+                blackboxGyroRawFlush();
+            }
+#endif
             blackboxSetState(BLACKBOX_STATE_PAUSED);
         } else {
             blackboxLogIteration(currentTimeUs);
@@ -1685,6 +2224,9 @@ uint8_t blackboxGetRateDenom(void)
 void blackboxInit(void)
 {
     blackboxResetIterationTimers();
+#ifdef USE_BLACKBOX_DEFERRED
+    blackboxDeferred = blackboxConfig()->deferred;
+#endif
 
     // an I-frame is written every 32ms
     // gyro.targetLooptime is 1000 for 1kHz loop, 500 for 2kHz loop etc, gyro.targetLooptime is rounded for short looptimes
@@ -34,11 +34,25 @@ typedef enum BlackboxDevice {
     BLACKBOX_DEVICE_SERIAL = 3
 } BlackboxDevice_e;
 
+typedef enum {
+    BLACKBOX_ENCODING_VB = 0,           // variable byte and tag codes
+    BLACKBOX_ENCODING_RICE,             // adaptive Rice codes for the P frame fields
+    BLACKBOX_ENCODING_RICE_LINEAR       // as above, gyros and motors predicted on a straight line instead of their average
+} blackboxEncoding_e;
+
+typedef enum {
+    BLACKBOX_MODE_NORMAL = 0,           // filtered flight state in I/P frames at the blackbox rate
+    BLACKBOX_MODE_GYRO_RAW              // unfiltered gyro samples at the gyro rate in R frames, nothing else
+} blackboxMode_e;
+
 typedef struct blackboxConfig_s {
     uint16_t p_denom; // I-frame interval / P-frame interval
     uint8_t device;
     uint8_t on_motor_test;
     uint8_t record_acc;
+    uint8_t deferred; // encode in TASK_BLACKBOX instead of the PID loop
+    uint8_t encoding; // blackboxEncoding_e
+    uint8_t mode; // blackboxMode_e
 } blackboxConfig_t;
 
 PG_DECLARE(blackboxConfig_t, blackboxConfig);
@@ -54,12 +68,15 @@ uint8_t blackboxGetRateNum(void);
 uint8_t blackboxGetRateDenom(void);
 void blackboxValidateConfig(void);
 void blackboxFinish(void);
+void blackboxEncodeQueuedFrames(timeUs_t currentTimeUs);
+uint32_t blackboxGetDroppedFrames(void);
 bool blackboxMayEditConfig(void);
+void blackboxGyroRawSample(const int16_t *adcRaw, timeUs_t sampleTimeUs);
+uint32_t blackboxGetGyroRawDroppedSamples(void);
 #ifdef UNIT_TEST
 STATIC_UNIT_TESTED void blackboxLogIteration(timeUs_t currentTimeUs);
 STATIC_UNIT_TESTED bool blackboxShouldLogPFrame(void);
 STATIC_UNIT_TESTED bool blackboxShouldLogIFrame(void);
-STATIC_UNIT_TESTED bool blackboxShouldLogGpsHomeFrame(void);
 STATIC_UNIT_TESTED bool writeSlowFrameIfNeeded(void);
 // Called once every FC loop in order to keep track of how many FC loop iterations have passed
 STATIC_UNIT_TESTED void blackboxAdvanceIterationTimers(void);
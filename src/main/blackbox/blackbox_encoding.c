@@ -266,9 +266,9 @@ int blackboxWriteTag2_3SVariable(int32_t *values)
     int selector = BITS_2;
     int selector2 = 0;
     // Require more than 877 bits?
-    if (values[0] >= 256 || values[0] < -256
-            || values[1] >= 128 || values[1] < -128
-            || values[2] >= 128 || values[2] < -128) {
+    if (values[0] >= 128 || values[0] < -128
+            || values[1] >= 64 || values[1] < -64
+            || values[2] >= 64 || values[2] < -64) {
         selector = BITS_32;
    // Require more than 554 bits?
     } else if (values[0] >= 16 || values[0] < -16
@@ -473,6 +473,54 @@ void blackboxWriteTag8_8SVB(int32_t *values, int valueCount)
     }
 }
 
+// Bits not yet written, MSB first
+static uint32_t blackboxBitBuffer;
+static uint8_t blackboxBitCount;
+
+// count must be 24 or less
+static void blackboxWriteBits(uint32_t bits, int count)
+{
+    blackboxBitBuffer = (blackboxBitBuffer << count) | (bits & ((1U << count) - 1));
+    blackboxBitCount += count;
+    while (blackboxBitCount >= 8) {
+        blackboxBitCount -= 8;
+        blackboxWrite(blackboxBitBuffer >> blackboxBitCount);
+    }
+}
+
+/**
+ * Write a signed integer with adaptive Rice coding, the state of the field is updated. The bits are packed with those
+ * of the previous call, blackboxFlushBits() must be called before anything else is written to the log.
+ */
+void blackboxWriteRice(blackboxRiceState_t *state, int32_t value)
+{
+    const uint32_t zigzag = zigzagEncode(value);
+    const int k = blackboxRiceParameter(state);
+    const uint32_t quotient = zigzag >> k;
+
+    if (quotient < BLACKBOX_RICE_ESCAPE) {
+        // quotient one bits and a zero
+        blackboxWriteBits((1U << (quotient + 1)) - 2, quotient + 1);
+        blackboxWriteBits(zigzag, k);
+    } else {
+        blackboxWriteBits((1U << BLACKBOX_RICE_ESCAPE) - 1, BLACKBOX_RICE_ESCAPE);
+        blackboxWriteBits(zigzag >> 16, 16);
+        blackboxWriteBits(zigzag, 16);
+    }
+
+    blackboxRiceStateUpdate(state, zigzag);
+}
+
+/**
+ * Pad the bits written by blackboxWriteRice() with zeros up to the next byte.
+ */
+void blackboxFlushBits(void)
+{
+    if (blackboxBitCount > 0) {
+        blackboxWriteBits(0, 8 - blackboxBitCount);
+    }
+}
+
 /** Write unsigned integer **/
 void blackboxWriteU32(int32_t value)
 {
@@ -17,6 +17,48 @@
 
 #pragma once
 
+#include <stdint.h>
+
+/*
+ * Adaptive Rice coding: a value v is written as (v >> k) one bits, a zero bit and the k low bits of v. Every field has
+ * its own k, taken from the mean of the values it had recently, so the encoder and the decoder can track it without
+ * anything extra in the log.
+ */
+#define BLACKBOX_RICE_INITIAL_SUM   4   // mean of 4 for the first value, k = 2
+#define BLACKBOX_RICE_HALVING_COUNT 16  // the mean forgets the older values once this many are in it
+#define BLACKBOX_RICE_MAX_K         16
+#define BLACKBOX_RICE_ESCAPE        24  // this many one bits are followed by the value in 32 bits
+#define BLACKBOX_RICE_VALUE_LIMIT   (1 << 20)
+
+typedef struct blackboxRiceState_s {
+    uint32_t sum;
+    uint8_t count;
+} blackboxRiceState_t;
+
+static inline void blackboxRiceStateInit(blackboxRiceState_t *state)
+{
+    state->sum = BLACKBOX_RICE_INITIAL_SUM;
+    state->count = 1;
+}
+
+static inline int blackboxRiceParameter(const blackboxRiceState_t *state)
+{
+    int k = 0;
+    while (k < BLACKBOX_RICE_MAX_K && ((uint32_t)state->count << k) < state->sum) {
+        k++;
+    }
+    return k;
+}
+
+static inline void blackboxRiceStateUpdate(blackboxRiceState_t *state, uint32_t value)
+{
+    state->sum += value < BLACKBOX_RICE_VALUE_LIMIT ? value : BLACKBOX_RICE_VALUE_LIMIT;
+    if (++state->count == BLACKBOX_RICE_HALVING_COUNT) {
+        state->sum >>= 1;
+        state->count >>= 1;
+    }
+}
+
 int blackboxPrintf(const char *fmt, ...);
 void blackboxPrintfHeaderLine(const char *name, const char *fmt, ...);
 
@@ -29,5 +71,7 @@ void blackboxWriteTag2_3S32(int32_t *values);
 int blackboxWriteTag2_3SVariable(int32_t *values);
 void blackboxWriteTag8_4S16(int32_t *values);
 void blackboxWriteTag8_8SVB(int32_t *values, int valueCount);
+void blackboxWriteRice(blackboxRiceState_t *state, int32_t value);
+void blackboxFlushBits(void);
 void blackboxWriteU32(int32_t value);
 void blackboxWriteFloat(float value);
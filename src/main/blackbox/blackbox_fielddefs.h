@@ -98,7 +98,8 @@ typedef enum FlightLogFieldEncoding {
     FLIGHT_LOG_FIELD_ENCODING_TAG2_3S32       = 7,
     FLIGHT_LOG_FIELD_ENCODING_TAG8_4S16       = 8,
     FLIGHT_LOG_FIELD_ENCODING_NULL            = 9, // Nothing is written to the file, take value to be zero
-    FLIGHT_LOG_FIELD_ENCODING_TAG2_3SVARIABLE = 10
+    FLIGHT_LOG_FIELD_ENCODING_TAG2_3SVARIABLE = 10,
+    FLIGHT_LOG_FIELD_ENCODING_ADAPTIVE_RICE   = 11  // Signed adaptive Rice code, consecutive fields share bytes and the last one is padded to a byte
 } FlightLogFieldEncoding;
 
 typedef enum FlightLogFieldSign {
@@ -144,6 +145,25 @@ typedef union flightLogEventData_u {
     flightLogEvent_loggingResume_t loggingResume;
 } flightLogEventData_t;
 
+/*
+ * An 'R' frame of the gyro raw capture mode. The block is written to the device as it sits in memory, little endian,
+ * so the gyro fills it in place and it goes out in one write. A full block holds the samples per block of the gyro_raw
+ * header line, at most BLACKBOX_GYRO_RAW_BLOCK_SAMPLES and fewer on devices with small buffers, only the last block of
+ * a log can hold less. droppedSamples counts the samples lost just before this block, while both
+ * blocks were waiting for the device.
+ */
+#define BLACKBOX_GYRO_RAW_BLOCK_SAMPLES 64
+
+typedef struct blackboxGyroRawBlock_s {
+    uint8_t frameType;          // 'R'
+    uint8_t sampleCount;
+    uint16_t droppedSamples;
+    uint32_t timeUs;            // of the first sample
+    int16_t samples[BLACKBOX_GYRO_RAW_BLOCK_SAMPLES][3];    // gyroADCRaw X, Y, Z, before calibration and alignment
+} blackboxGyroRawBlock_t;
+
+#define BLACKBOX_GYRO_RAW_BLOCK_HEADER_SIZE 8
+
 typedef struct flightLogEvent_s {
     FlightLogEvent event;
     flightLogEventData_t data;
@@ -13,6 +13,8 @@
 
 #include "common/maths.h"
 
+#include "drivers/time.h"
+
 #include "flight/pid.h"
 
 #include "io/asyncfatfs/asyncfatfs.h"
@@ -63,8 +65,76 @@ void blackboxOpen(void)
     }
 }
 
+/*
+ * Frames are encoded into this buffer and handed to the device in one call when they are complete, instead of going
+ * through the device switch for every byte.
+ */
+static struct {
+    uint8_t data[BLACKBOX_FRAME_BUFFER_SIZE];
+    uint16_t length;
+    bool active;
+} blackboxFrameBuffer;
+
+static void blackboxDeviceWrite(const uint8_t *data, int length)
+{
+    switch (blackboxConfig()->device) {
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        flashfsWrite(data, length, false); // Write asynchronously
+        break;
+#endif
+#ifdef USE_SDCARD
+    case BLACKBOX_DEVICE_SDCARD:
+        afatfs_fwrite(blackboxSDCard.logFile, data, length); // Ignore failures due to buffers filling up
+        break;
+#endif
+    case BLACKBOX_DEVICE_SERIAL:
+    default:
+        // The space was reserved already, so ports without a bulk write never wait for room here
+        serialWriteBuf(blackboxPort, data, length);
+        break;
+    }
+}
+
+/*
+ * Start collecting the bytes of a frame, they reach the device on blackboxFrameCommit().
+ */
+void blackboxFrameBegin(void)
+{
+    blackboxFrameBuffer.length = 0;
+    blackboxFrameBuffer.active = true;
+}
+
+void blackboxFrameCommit(void)
+{
+    if (blackboxFrameBuffer.length > 0) {
+        blackboxDeviceWrite(blackboxFrameBuffer.data, blackboxFrameBuffer.length);
+    }
+    blackboxFrameBuffer.length = 0;
+    blackboxFrameBuffer.active = false;
+}
+
+/*
+ * Write a block that is already laid out as it goes to the device, bypassing the frame buffer. The caller checks
+ * blackboxDeviceHasSpace() first.
+ */
+void blackboxWriteBuf(const uint8_t *data, int length)
+{
+    blackboxDeviceWrite(data, length);
+}
+
 void blackboxWrite(uint8_t value)
 {
+    if (blackboxFrameBuffer.active) {
+        if (blackboxFrameBuffer.length == BLACKBOX_FRAME_BUFFER_SIZE) {
+            // A frame larger than the buffer goes out in pieces
+            blackboxDeviceWrite(blackboxFrameBuffer.data, blackboxFrameBuffer.length);
+            blackboxFrameBuffer.length = 0;
+        }
+        blackboxFrameBuffer.data[blackboxFrameBuffer.length++] = value;
+        return;
+    }
+
     switch (blackboxConfig()->device) {
 #ifdef USE_FLASHFS
     case BLACKBOX_DEVICE_FLASH:
@@ -89,6 +159,14 @@ int blackboxWriteString(const char *s)
     int length;
     const uint8_t *pos;
 
+    if (blackboxFrameBuffer.active) {
+        // Keep the string in order with the rest of the frame
+        for (pos = (const uint8_t*) s; *pos; pos++) {
+            blackboxWrite(*pos);
+        }
+        return pos - (const uint8_t*) s;
+    }
+
     switch (blackboxConfig()->device) {
 
 #ifdef USE_FLASHFS
@@ -447,6 +525,11 @@ static bool blackboxSDCardBeginLog(void)
 bool blackboxDeviceBeginLog(void)
 {
     switch (blackboxConfig()->device) {
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        flashfsLogBegin(millis());
+        return true;
+#endif // USE_FLASHFS
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
         return blackboxSDCardBeginLog();
@@ -466,11 +549,16 @@ bool blackboxDeviceBeginLog(void)
  */
 bool blackboxDeviceEndLog(bool retainLog)
 {
-#ifndef USE_SDCARD
+#if !defined(USE_SDCARD) && !defined(USE_FLASHFS)
     UNUSED(retainLog);
 #endif
 
     switch (blackboxConfig()->device) {
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        flashfsLogEnd(retainLog);
+        return true;
+#endif // USE_FLASHFS
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
         // Keep retrying until the close operation queues
@@ -519,32 +607,81 @@ unsigned int blackboxGetLogNumber(void)
     return 0;
 }
 
+// Bytes that can be handed to the device right now without overflowing its buffers
+static int32_t blackboxDeviceFreeSpace(void)
+{
+    switch (blackboxConfig()->device) {
+    case BLACKBOX_DEVICE_SERIAL:
+        return serialTxBytesFree(blackboxPort);
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        return flashfsGetWriteBufferFreeSpace();
+#endif
+#ifdef USE_SDCARD
+    case BLACKBOX_DEVICE_SDCARD:
+        return afatfs_getFreeBufferSpace();
+#endif
+    default:
+        return 0;
+    }
+}
+
 /**
  * Call once every loop iteration in order to maintain the global blackboxHeaderBudget with the number of bytes we can
  * transmit this iteration.
  */
 void blackboxReplenishHeaderBudget(void)
 {
-    int32_t freeSpace;
+    const int32_t freeSpace = blackboxDeviceFreeSpace();
+
+    blackboxHeaderBudget = MIN(MIN(freeSpace, blackboxHeaderBudget + blackboxMaxHeaderBytesPerIteration), BLACKBOX_MAX_ACCUMULATED_HEADER_BUDGET);
+}
 
+/*
+ * The most the device buffers can hold, a write larger than this never fits however much of them is drained.
+ */
+int32_t blackboxGetDeviceBufferSize(void)
+{
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
-        freeSpace = serialTxBytesFree(blackboxPort);
-        break;
+        // As in blackboxDeviceReserveBufferSpace(), one byte of the tx buffer is unusable and the USB VCP has none
+        return blackboxPort->txBufferSize ? (int32_t)blackboxPort->txBufferSize - 1 : INT32_MAX;
 #ifdef USE_FLASHFS
     case BLACKBOX_DEVICE_FLASH:
-        freeSpace = flashfsGetWriteBufferFreeSpace();
-        break;
+        return flashfsGetWriteBufferSize();
 #endif
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
-        freeSpace = afatfs_getFreeBufferSpace();
-        break;
+        // The free space is counted in whole cache sectors, a write up to a sector fits once one is free
+        return AFATFS_SECTOR_SIZE;
 #endif
     default:
-        freeSpace = 0;
+        return 0;
     }
-    blackboxHeaderBudget = MIN(MIN(freeSpace, blackboxHeaderBudget + blackboxMaxHeaderBytesPerIteration), BLACKBOX_MAX_ACCUMULATED_HEADER_BUDGET);
+}
+
+/*
+ * Bytes the device accepted but failed to store, since it was initialised.
+ */
+uint32_t blackboxGetDeviceDroppedBytes(void)
+{
+    switch (blackboxConfig()->device) {
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        return flashfsGetDroppedBytes();
+#endif
+    default:
+        return 0;
+    }
+}
+
+/*
+ * True if a write of this many bytes fits in the device buffers now. Unlike blackboxDeviceReserveBufferSpace() this
+ * isn't limited by the header budget, it is meant for writes larger than a header line.
+ */
+bool blackboxDeviceHasSpace(int32_t bytes)
+{
+    return bytes <= blackboxDeviceFreeSpace();
 }
 
 /**
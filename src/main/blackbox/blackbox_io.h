@@ -35,12 +35,19 @@ typedef enum {
  */
 #define BLACKBOX_TARGET_HEADER_BUDGET_PER_ITERATION 64
 
+// Room for the largest regular frame, an I frame with 8 motors and all the optional fields is below 128 bytes
+#define BLACKBOX_FRAME_BUFFER_SIZE 256
+
 extern int32_t blackboxHeaderBudget;
 
 void blackboxOpen(void);
 void blackboxWrite(uint8_t value);
+void blackboxWriteBuf(const uint8_t *data, int length);
 int blackboxWriteString(const char *s);
 
+void blackboxFrameBegin(void);
+void blackboxFrameCommit(void);
+
 void blackboxDeviceFlush(void);
 bool blackboxDeviceFlushForce(void);
 bool blackboxDeviceOpen(void);
@@ -57,3 +64,6 @@ unsigned int blackboxGetLogNumber(void);
 
 void blackboxReplenishHeaderBudget(void);
 blackboxBufferReserveStatus_e blackboxDeviceReserveBufferSpace(int32_t bytes);
+bool blackboxDeviceHasSpace(int32_t bytes);
+int32_t blackboxGetDeviceBufferSize(void);
+uint32_t blackboxGetDeviceDroppedBytes(void);
@@ -70,6 +70,8 @@ typedef enum {
     DEBUG_FFT_FREQ,
     DEBUG_FRSKY_D_RX,
     DEBUG_GYRO_RAW,
+    DEBUG_RPM_FILTER,
+    DEBUG_RX_TIMING,
     DEBUG_COUNT
 } debugType_e;
 
@@ -0,0 +1,117 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_PROFILER
+
+#if defined(SIMULATOR_BUILD) || defined(UNIT_TEST)
+#include <time.h>
+#endif
+
+#include "build/profiler.h"
+
+#include "common/maths.h"
+#include "common/utils.h"
+
+profilerScope_t profilerScopes[PROFILER_SCOPE_COUNT];
+
+static const char * const profilerScopeNames[] = {
+    "GYRO_FILTERS",
+    "PID",
+    "MIXER",
+    "MOTOR_WRITE",
+    "BLACKBOX",
+    "AFATFS_POLL",
+};
+
+STATIC_ASSERT(ARRAYLEN(profilerScopeNames) == PROFILER_SCOPE_COUNT, profiler_scope_names_count);
+STATIC_ASSERT((PROFILER_RING_SIZE & (PROFILER_RING_SIZE - 1)) == 0, profiler_ring_size_power_of_2);
+
+#if defined(SIMULATOR_BUILD) || defined(UNIT_TEST)
+// nanoseconds, wraps every 4.3s like the cycle counter does at 1GHz
+uint32_t profilerHostCycles(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000000U + ts.tv_nsec;
+}
+#endif
+
+void profilerInit(void)
+{
+#if !defined(SIMULATOR_BUILD) && !defined(UNIT_TEST)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(STM32F7)
+    DWT->LAR = 0xC5ACCE55; // unlock the DWT registers
+#endif
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    profilerReset();
+}
+
+void profilerReset(void)
+{
+    memset(profilerScopes, 0, sizeof(profilerScopes));
+}
+
+uint32_t profilerClockHz(void)
+{
+#if defined(SIMULATOR_BUILD) || defined(UNIT_TEST)
+    return 1000000000;
+#else
+    return SystemCoreClock;
+#endif
+}
+
+uint32_t profilerCyclesToNs(uint32_t cycles)
+{
+    return ((uint64_t)cycles * 1000000000) / profilerClockHz();
+}
+
+const char *profilerScopeName(profilerScope_e scope)
+{
+    return profilerScopeNames[scope];
+}
+
+uint32_t profilerScopeLatest(profilerScope_e scope)
+{
+    const profilerScope_t *profilerScope = &profilerScopes[scope];
+    return profilerScope->count ? profilerScope->cycles[(profilerScope->count - 1) & (PROFILER_RING_SIZE - 1)] : 0;
+}
+
+// average over the samples in the ring buffer
+uint32_t profilerScopeAverage(profilerScope_e scope)
+{
+    const profilerScope_t *profilerScope = &profilerScopes[scope];
+    const uint32_t sampleCount = MIN(profilerScope->count, PROFILER_RING_SIZE);
+    if (sampleCount == 0) {
+        return 0;
+    }
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < sampleCount; i++) {
+        sum += profilerScope->cycles[i];
+    }
+    return sum / sampleCount;
+}
+
+#endif // USE_PROFILER
@@ -0,0 +1,89 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*
+ * Hot path profiler, build with OPTIONS=USE_PROFILER to enable it.
+ *
+ * PROFILE_BEGIN(scope) and PROFILE_END(scope) bracket a section of code in the same block and record
+ * its duration in cycles of the DWT cycle counter (nanoseconds from clock_gettime on SITL) into a
+ * ring buffer per scope. Without USE_PROFILER both macros compile to nothing.
+ */
+
+typedef enum {
+    PROFILER_SCOPE_GYRO_FILTERS,
+    PROFILER_SCOPE_PID,
+    PROFILER_SCOPE_MIXER,
+    PROFILER_SCOPE_MOTOR_WRITE,     // motor output, DMA buffer setup for DShot
+    PROFILER_SCOPE_BLACKBOX,
+    PROFILER_SCOPE_AFATFS_POLL,
+    PROFILER_SCOPE_COUNT
+} profilerScope_e;
+
+#define PROFILER_RING_SIZE 32u      // must be a power of 2
+
+typedef struct profilerScope_s {
+    uint32_t cycles[PROFILER_RING_SIZE];
+    uint32_t count;                 // total number of samples recorded, the newest is at cycles[(count - 1) % PROFILER_RING_SIZE]
+    uint32_t maxCycles;
+} profilerScope_t;
+
+#ifdef USE_PROFILER
+
+extern profilerScope_t profilerScopes[PROFILER_SCOPE_COUNT];
+
+#if defined(SIMULATOR_BUILD) || defined(UNIT_TEST)
+uint32_t profilerHostCycles(void);
+#endif
+
+static inline uint32_t profilerCycles(void)
+{
+#if defined(SIMULATOR_BUILD) || defined(UNIT_TEST)
+    return profilerHostCycles();
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+static inline void profilerRecord(profilerScope_e scope, uint32_t cycles)
+{
+    profilerScope_t *profilerScope = &profilerScopes[scope];
+    profilerScope->cycles[profilerScope->count & (PROFILER_RING_SIZE - 1)] = cycles;
+    profilerScope->count++;
+    if (cycles > profilerScope->maxCycles) {
+        profilerScope->maxCycles = cycles;
+    }
+}
+
+#define PROFILE_BEGIN(scope) const uint32_t profilerStart_ ## scope = profilerCycles()
+#define PROFILE_END(scope) profilerRecord(scope, profilerCycles() - profilerStart_ ## scope)
+
+void profilerInit(void);
+void profilerReset(void);
+uint32_t profilerClockHz(void);
+uint32_t profilerCyclesToNs(uint32_t cycles);
+const char *profilerScopeName(profilerScope_e scope);
+uint32_t profilerScopeLatest(profilerScope_e scope);
+uint32_t profilerScopeAverage(profilerScope_e scope);
+
+#else
+
+#define PROFILE_BEGIN(scope)
+#define PROFILE_END(scope)
+
+#endif
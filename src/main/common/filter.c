@@ -196,6 +196,109 @@ float biquadFilterApply(biquadFilter_t *filter, float input)
     return result;
 }
 
+/*
+ * Filter bank
+ *
+ * Every stage is a direct form 2 transposed biquad; a PT1 is stored as a first order biquad
+ * (b0 = k, a1 = k - 1), which produces the same output as pt1FilterApply. All three axes
+ * share the stage coefficients but have their own state, so a stage is filled from a single
+ * biquadFilter_t and copied into each lane.
+ */
+void filterBankInit(filterBank_t *bank)
+{
+    memset(bank, 0, sizeof(filterBank_t));
+}
+
+static int filterBankAddStage(filterBank_t *bank, float b0, float b1, float b2, float a1, float a2)
+{
+    if (bank->stageCount >= FILTER_BANK_MAX_STAGES) {
+        return -1;
+    }
+    filterBankStage_t *stage = &bank->stage[bank->stageCount];
+    for (int lane = 0; lane < FILTER_BANK_LANES; lane++) {
+        stage->b0[lane] = b0;
+        stage->b1[lane] = b1;
+        stage->b2[lane] = b2;
+        stage->a1[lane] = a1;
+        stage->a2[lane] = a2;
+        stage->x1[lane] = 0;
+        stage->x2[lane] = 0;
+    }
+    return bank->stageCount++;
+}
+
+int filterBankAddBiquad(filterBank_t *bank, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType)
+{
+    biquadFilter_t filter;
+    biquadFilterInit(&filter, filterFreq, refreshRate, Q, filterType);
+    return filterBankAddStage(bank, filter.b0, filter.b1, filter.b2, filter.a1, filter.a2);
+}
+
+int filterBankAddPt1(filterBank_t *bank, uint8_t f_cut, float dT)
+{
+    pt1Filter_t filter;
+    pt1FilterInit(&filter, f_cut, dT);
+    return filterBankAddStage(bank, filter.k, 0, 0, filter.k - 1.0f, 0);
+}
+
+#if defined(__arm__) && !defined(__ARM_NEON)
+// Cortex-M4/M7 have a scalar single precision FPU only, so unroll the axes and let the
+// compiler interleave the three independent multiply-accumulate chains
+void filterBankApply(filterBank_t *bank, float *values)
+{
+    float x = values[0];
+    float y = values[1];
+    float z = values[2];
+
+    for (int i = 0; i < bank->stageCount; i++) {
+        filterBankStage_t *stage = &bank->stage[i];
+
+        const float rx = stage->b0[0] * x + stage->x1[0];
+        const float ry = stage->b0[1] * y + stage->x1[1];
+        const float rz = stage->b0[2] * z + stage->x1[2];
+
+        stage->x1[0] = stage->b1[0] * x - stage->a1[0] * rx + stage->x2[0];
+        stage->x1[1] = stage->b1[1] * y - stage->a1[1] * ry + stage->x2[1];
+        stage->x1[2] = stage->b1[2] * z - stage->a1[2] * rz + stage->x2[2];
+
+        stage->x2[0] = stage->b2[0] * x - stage->a2[0] * rx;
+        stage->x2[1] = stage->b2[1] * y - stage->a2[1] * ry;
+        stage->x2[2] = stage->b2[2] * z - stage->a2[2] * rz;
+
+        x = rx;
+        y = ry;
+        z = rz;
+    }
+
+    values[0] = x;
+    values[1] = y;
+    values[2] = z;
+}
+#else
+// Portable vector version using the GCC vector extension, one lane per axis
+typedef float filterBankVector_t __attribute__((vector_size(FILTER_BANK_LANES * sizeof(float))));
+
+void filterBankApply(filterBank_t *bank, float *values)
+{
+    filterBankVector_t input = { values[0], values[1], values[2], 0 };
+
+    for (int i = 0; i < bank->stageCount; i++) {
+        filterBankStage_t *stage = &bank->stage[i];
+        filterBankVector_t *x1 = (filterBankVector_t *)stage->x1;
+        filterBankVector_t *x2 = (filterBankVector_t *)stage->x2;
+
+        const filterBankVector_t result = *(filterBankVector_t *)stage->b0 * input + *x1;
+        *x1 = *(filterBankVector_t *)stage->b1 * input - *(filterBankVector_t *)stage->a1 * result + *x2;
+        *x2 = *(filterBankVector_t *)stage->b2 * input - *(filterBankVector_t *)stage->a2 * result;
+        input = result;
+    }
+
+    values[0] = input[0];
+    values[1] = input[1];
+    values[2] = input[2];
+}
+#endif
+
 /*
  * FIR filter
  */
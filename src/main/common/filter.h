@@ -44,6 +44,26 @@ typedef struct biquadFilter_s {
     float x1, x2, y1, y2;
 } biquadFilter_t;
 
+// Filter bank: a cascade of biquad stages applied to X, Y and Z in one call.
+// Coefficients and state are stored structure-of-arrays, one lane per axis, padded to 4 lanes
+#define FILTER_BANK_LANES       4
+#define FILTER_BANK_MAX_STAGES  4
+
+typedef struct filterBankStage_s {
+    float b0[FILTER_BANK_LANES];
+    float b1[FILTER_BANK_LANES];
+    float b2[FILTER_BANK_LANES];
+    float a1[FILTER_BANK_LANES];
+    float a2[FILTER_BANK_LANES];
+    float x1[FILTER_BANK_LANES];
+    float x2[FILTER_BANK_LANES];
+} __attribute__((aligned(16))) filterBankStage_t;
+
+typedef struct filterBank_s {
+    filterBankStage_t stage[FILTER_BANK_MAX_STAGES];
+    uint8_t stageCount;
+} filterBank_t;
+
 typedef struct firFilterDenoise_s {
     int filledCount;
     int targetCount;
@@ -106,5 +126,10 @@ float firFilterCalcPartialAverage(const firFilter_t *filter, uint8_t count);
 float firFilterCalcMovingAverage(const firFilter_t *filter);
 float firFilterLastInput(const firFilter_t *filter);
 
+void filterBankInit(filterBank_t *bank);
+int filterBankAddBiquad(filterBank_t *bank, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType);
+int filterBankAddPt1(filterBank_t *bank, uint8_t f_cut, float dT);
+void filterBankApply(filterBank_t *bank, float *values);
+
 void firFilterDenoiseInit(firFilterDenoise_t *filter, uint8_t gyroSoftLpfHz, uint16_t targetLooptime);
 float firFilterDenoiseUpdate(firFilterDenoise_t *filter, float input);
@@ -0,0 +1,87 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "common/maths.h"
+#include "common/sdft.h"
+
+// Each new sample rotates every bin by its twiddle factor, adds the new sample and removes the one
+// leaving the window. The bins are damped slightly (SDFT_DAMPING_FACTOR ^ SDFT_SAMPLE_SIZE for the
+// sample leaving the window) so that float rounding errors decay instead of accumulating forever.
+#define SDFT_DAMPING_FACTOR 0.9999f
+
+static bool twiddleInitialised = false;
+static float twiddleRe[SDFT_BIN_COUNT + 1];
+static float twiddleIm[SDFT_BIN_COUNT + 1];
+static float rPowerN;
+
+static void sdftInitTwiddle(void)
+{
+    for (int bin = 0; bin <= SDFT_BIN_COUNT; bin++) {
+        const float phi = 2.0f * M_PIf * bin / SDFT_SAMPLE_SIZE;
+        twiddleRe[bin] = SDFT_DAMPING_FACTOR * cosf(phi);
+        twiddleIm[bin] = SDFT_DAMPING_FACTOR * sinf(phi);
+    }
+    rPowerN = powf(SDFT_DAMPING_FACTOR, SDFT_SAMPLE_SIZE);
+    twiddleInitialised = true;
+}
+
+/*
+ * Only bins startBin to endBin are produced by sdftWindowedSquaredMagnitude(), the Hann window
+ * needs one extra bin either side of that range
+ */
+void sdftInit(sdft_t *sdft, uint8_t startBin, uint8_t endBin)
+{
+    if (!twiddleInitialised) {
+        sdftInitTwiddle();
+    }
+    memset(sdft, 0, sizeof(sdft_t));
+    sdft->startBin = MAX(startBin, 1);
+    sdft->endBin = MIN(endBin, SDFT_BIN_COUNT - 1);
+}
+
+void sdftPush(sdft_t *sdft, float sample)
+{
+    const float delta = sample - rPowerN * sdft->samples[sdft->idx];
+
+    sdft->samples[sdft->idx] = sample;
+    sdft->idx = (sdft->idx + 1) % SDFT_SAMPLE_SIZE;
+
+    for (int bin = sdft->startBin - 1; bin <= sdft->endBin + 1; bin++) {
+        const float re = sdft->re[bin];
+        const float im = sdft->im[bin];
+        sdft->re[bin] = twiddleRe[bin] * re - twiddleIm[bin] * im + delta;
+        sdft->im[bin] = twiddleRe[bin] * im + twiddleIm[bin] * re;
+    }
+}
+
+/*
+ * Squared magnitude of bins startBin to endBin, output[0] holds startBin. The Hann window is applied
+ * in the frequency domain as a convolution with the kernel [-0.25, 0.5, -0.25]
+ */
+void sdftWindowedSquaredMagnitude(const sdft_t *sdft, float *output)
+{
+    for (int bin = sdft->startBin; bin <= sdft->endBin; bin++) {
+        const float re = 0.5f * sdft->re[bin] - 0.25f * (sdft->re[bin - 1] + sdft->re[bin + 1]);
+        const float im = 0.5f * sdft->im[bin] - 0.25f * (sdft->im[bin - 1] + sdft->im[bin + 1]);
+        output[bin - sdft->startBin] = re * re + im * im;
+    }
+}
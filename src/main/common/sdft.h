@@ -0,0 +1,37 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Sliding DFT: the spectrum of the last SDFT_SAMPLE_SIZE samples, updated with O(bins) work per sample
+#define SDFT_SAMPLE_SIZE    32
+#define SDFT_BIN_COUNT      (SDFT_SAMPLE_SIZE / 2)
+
+typedef struct sdft_s {
+    uint8_t idx;                            // index of the oldest sample in the ring buffer
+    uint8_t startBin;
+    uint8_t endBin;
+    float samples[SDFT_SAMPLE_SIZE];
+    float re[SDFT_BIN_COUNT + 1];           // bins 0 (DC) to SDFT_BIN_COUNT (nyquist)
+    float im[SDFT_BIN_COUNT + 1];
+} sdft_t;
+
+void sdftInit(sdft_t *sdft, uint8_t startBin, uint8_t endBin);
+void sdftPush(sdft_t *sdft, float sample);
+void sdftWindowedSquaredMagnitude(const sdft_t *sdft, float *output);
@@ -38,8 +38,6 @@ extern uint8_t __config_start;   // configured via linker script when building b
 extern uint8_t __config_end;
 #endif
 
-static uint16_t eepromConfigSize;
-
 typedef enum {
     CR_CLASSICATION_SYSTEM   = 0,
     CR_CLASSICATION_PROFILE_LAST = CR_CLASSICATION_SYSTEM,
@@ -49,12 +47,27 @@ typedef enum {
 #define CRC_START_VALUE         0xFFFF
 #define CRC_CHECK_VALUE         0x1D0F  // pre-calculated value of CRC that includes the CRC itself
 
+/*
+ * The config region is a journal: a header followed by the commits appended by each save. A commit only holds the PG
+ * records that differ from their latest copy in the journal, so saving a changed setting programs a few words instead
+ * of erasing the sector and rewriting every PG. When the commit doesn't fit in the rest of the region, the region is
+ * erased and a single commit with all the PGs is written (compaction).
+ * A commit torn by a reset during a save ends the journal, the commits before it are still used and the next save
+ * compacts.
+ */
+
 // Header for the saved copy.
 typedef struct {
     uint8_t eepromConfigVersion;
     uint8_t magic_be;           // magic number, should be 0xBE
 } PG_PACKED configHeader_t;
 
+// Header for each commit, followed by its PG records and the CRC of the commit. Commits start word aligned.
+typedef struct {
+    uint16_t size;              // from the start of this header to the end of the CRC
+    uint16_t sequence;          // one more than the previous commit
+} PG_PACKED configCommit_t;
+
 // Header for each stored PG.
 typedef struct {
     // split up.
@@ -67,12 +80,7 @@ typedef struct {
 
     uint8_t pg[];
 } PG_PACKED configRecord_t;
-
-// Footer for the saved copy.
-typedef struct {
-    uint16_t terminator;
-} PG_PACKED configFooter_t;
-// checksum is appended just after footer. It is not included in footer to make checksum calculation consistent
+// checksum is appended just after the records. The inverted checksum is included in the checksum calculation
 
 // Used to check the compiler packing at build time.
 typedef struct {
@@ -80,6 +88,23 @@ typedef struct {
     uint32_t word;
 } PG_PACKED packingTest_t;
 
+#define CONFIG_COMMIT_ALIGN(offset)     (((offset) + 3) & ~3)
+#define CONFIG_COMMIT_ERASED            0xFFFF  // size of a commit in erased flash
+#define CONFIG_COMMIT_EMPTY_SIZE        (sizeof(configCommit_t) + sizeof(uint16_t))
+
+// Latest record of each PG, an open addressing hash table on the PGN holding the offset of the record from
+// __config_start, 0 for an empty slot. It is built by one pass over the journal.
+#define CONFIG_INDEX_SIZE               128     // power of 2, larger than the number of PGs
+static uint16_t configIndex[CONFIG_INDEX_SIZE];
+
+typedef struct configJournal_s {
+    uint16_t size;              // bytes used from __config_start, the next commit goes at CONFIG_COMMIT_ALIGN(size)
+    uint16_t sequence;          // of the last commit
+    bool clean;                 // only erased flash follows the last commit, so a commit can be appended
+} configJournal_t;
+
+static configJournal_t configJournal;
+
 void initEEPROM(void)
 {
     // Verify that this architecture packs as expected.
@@ -87,15 +112,91 @@ void initEEPROM(void)
     BUILD_BUG_ON(offsetof(packingTest_t, word) != 1);
     BUILD_BUG_ON(sizeof(packingTest_t) != 5);
 
-    BUILD_BUG_ON(sizeof(configFooter_t) != 2);
+    BUILD_BUG_ON(sizeof(configCommit_t) != 4);
     BUILD_BUG_ON(sizeof(configRecord_t) != 6);
 }
 
-// Scan the EEPROM config. Returns true if the config is valid.
-bool isEEPROMContentValid(void)
+static unsigned configRegionSize(void)
+{
+    return &__config_end - &__config_start;
+}
+
+static const configRecord_t *configRecordAt(unsigned offset)
+{
+    return (const configRecord_t *)(&__config_start + offset);
+}
+
+static bool configIndexInsert(unsigned offset)
+{
+    const pgn_t pgn = configRecordAt(offset)->pgn;
+    for (int ii = 0; ii < CONFIG_INDEX_SIZE; ii++) {
+        const int slot = (pgn + ii) & (CONFIG_INDEX_SIZE - 1);
+        if (configIndex[slot] == 0 || configRecordAt(configIndex[slot])->pgn == pgn) {
+            configIndex[slot] = offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+// find the latest config record for reg in the index
+// return NULL when record is not found
+static const configRecord_t *findEEPROM(const pgRegistry_t *reg)
+{
+    for (int ii = 0; ii < CONFIG_INDEX_SIZE; ii++) {
+        const int slot = (pgN(reg) + ii) & (CONFIG_INDEX_SIZE - 1);
+        if (configIndex[slot] == 0) {
+            break;
+        }
+        const configRecord_t *record = configRecordAt(configIndex[slot]);
+        if (record->pgn == pgN(reg)) {
+            return record;
+        }
+    }
+    // record not found
+    return NULL;
+}
+
+// Check the commit at offset and add its records to the index. Returns false for a torn or corrupt commit.
+static bool scanCommit(unsigned offset)
+{
+    const configCommit_t *commit = (const configCommit_t *)(&__config_start + offset);
+
+    if (commit->size < CONFIG_COMMIT_EMPTY_SIZE || offset + commit->size > configRegionSize()) {
+        return false;
+    }
+    // CRC has the property that if the CRC itself is included in the calculation the resulting CRC will have constant value
+    if (crc16_ccitt_update(CRC_START_VALUE, commit, commit->size) != CRC_CHECK_VALUE) {
+        return false;
+    }
+
+    // the records must fill the commit exactly
+    const unsigned recordsStart = offset + sizeof(*commit);
+    const unsigned recordsEnd = offset + commit->size - sizeof(uint16_t);
+    unsigned p = recordsStart;
+    while (p < recordsEnd) {
+        const configRecord_t *record = configRecordAt(p);
+        if (record->size < sizeof(*record) || p + record->size > recordsEnd) {
+            return false;
+        }
+        p += record->size;
+    }
+
+    for (p = recordsStart; p < recordsEnd; p += configRecordAt(p)->size) {
+        if ((configRecordAt(p)->flags & CR_CLASSIFICATION_MASK) == CR_CLASSICATION_SYSTEM && !configIndexInsert(p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Scan the EEPROM journal once, indexing the latest record of each PG. Returns true if the config is valid.
+static bool scanEEPROM(void)
 {
-    const uint8_t *p = &__config_start;
-    const configHeader_t *header = (const configHeader_t *)p;
+    const configHeader_t *header = (const configHeader_t *)&__config_start;
+
+    memset(configIndex, 0, sizeof(configIndex));
+    memset(&configJournal, 0, sizeof(configJournal));
 
     if (header->eepromConfigVersion != EEPROM_CONF_VERSION) {
         return false;
@@ -104,77 +205,49 @@ bool isEEPROMContentValid(void)
         return false;
     }
 
-    uint16_t crc = CRC_START_VALUE;
-    crc = crc16_ccitt_update(crc, header, sizeof(*header));
-    p += sizeof(*header);
-
+    int commitCount = 0;
+    unsigned offset = CONFIG_COMMIT_ALIGN(sizeof(*header));
     for (;;) {
-        const configRecord_t *record = (const configRecord_t *)p;
+        const configCommit_t *commit = (const configCommit_t *)(&__config_start + offset);
 
-        if (record->size == 0) {
+        if (offset + sizeof(*commit) > configRegionSize() || commit->size == CONFIG_COMMIT_ERASED) {
             // Found the end.  Stop scanning.
+            configJournal.clean = true;
             break;
         }
-        if (p + record->size >= &__config_end
-            || record->size < sizeof(*record)) {
-            // Too big or too small.
-            return false;
+        if (commitCount > 0 && commit->sequence != (uint16_t)(configJournal.sequence + 1)) {
+            break;
+        }
+        if (!scanCommit(offset)) {
+            break;
         }
 
-        crc = crc16_ccitt_update(crc, p, record->size);
-
-        p += record->size;
+        configJournal.sequence = commit->sequence;
+        configJournal.size = offset + commit->size;
+        offset = CONFIG_COMMIT_ALIGN(configJournal.size);
+        commitCount++;
     }
 
-    const configFooter_t *footer = (const configFooter_t *)p;
-    crc = crc16_ccitt_update(crc, footer, sizeof(*footer));
-    p += sizeof(*footer);
-
-    // include stored CRC in the CRC calculation
-    const uint16_t *storedCrc = (const uint16_t *)p;
-    crc = crc16_ccitt_update(crc, storedCrc, sizeof(*storedCrc));
-    p += sizeof(storedCrc);
-
-    eepromConfigSize = p - &__config_start;
-
-    // CRC has the property that if the CRC itself is included in the calculation the resulting CRC will have constant value
-    return crc == CRC_CHECK_VALUE;
+    return commitCount > 0;
 }
 
-uint16_t getEEPROMConfigSize(void)
+bool isEEPROMContentValid(void)
 {
-    return eepromConfigSize;
+    return scanEEPROM();
 }
 
-// find config record for reg + classification (profile info) in EEPROM
-// return NULL when record is not found
-// this function assumes that EEPROM content is valid
-static const configRecord_t *findEEPROM(const pgRegistry_t *reg, configRecordFlags_e classification)
-{
-    const uint8_t *p = &__config_start;
-    p += sizeof(configHeader_t);             // skip header
-    while (true) {
-        const configRecord_t *record = (const configRecord_t *)p;
-        if (record->size == 0
-            || p + record->size >= &__config_end
-            || record->size < sizeof(*record))
-            break;
-        if (pgN(reg) == record->pgn
-            && (record->flags & CR_CLASSIFICATION_MASK) == classification)
-            return record;
-        p += record->size;
-    }
-    // record not found
-    return NULL;
+uint16_t getEEPROMConfigSize(void)
+{
+    return configJournal.size;
 }
 
-// Initialize all PG records from EEPROM.
-// This functions processes all PGs sequentially, scanning EEPROM for each one. This is suboptimal,
-//   but each PG is loaded/initialized exactly once and in defined order.
+// Initialize all PG records from EEPROM, each one from its latest record in the journal.
 bool loadEEPROM(void)
 {
+    scanEEPROM();
+
     PG_FOREACH(reg) {
-        const configRecord_t *rec = findEEPROM(reg, CR_CLASSICATION_SYSTEM);
+        const configRecord_t *rec = findEEPROM(reg);
         if (rec) {
             // config from EEPROM is available, use it to initialize PG. pgLoad will handle version mismatch
             pgLoad(reg, rec->pg, rec->size - offsetof(configRecord_t, pg), rec->version);
@@ -185,22 +258,41 @@ bool loadEEPROM(void)
     return true;
 }
 
-static bool writeSettingsToEEPROM(void)
+// true if the PG in RAM differs from its latest record in the journal
+static bool configRecordChanged(const pgRegistry_t *reg)
 {
-    config_streamer_t streamer;
-    config_streamer_init(&streamer);
+    const configRecord_t *record = findEEPROM(reg);
+    return !record
+        || record->version != pgVersion(reg)
+        || record->size != sizeof(*record) + pgSize(reg)
+        || memcmp(record->pg, reg->address, pgSize(reg)) != 0;
+}
 
-    config_streamer_start(&streamer, (uintptr_t)&__config_start, &__config_end - &__config_start);
+static unsigned configCommitSize(bool allRecords)
+{
+    unsigned size = CONFIG_COMMIT_EMPTY_SIZE;
+    PG_FOREACH(reg) {
+        if (allRecords || configRecordChanged(reg)) {
+            size += sizeof(configRecord_t) + pgSize(reg);
+        }
+    }
+    return size;
+}
 
-    configHeader_t header = {
-        .eepromConfigVersion =  EEPROM_CONF_VERSION,
-        .magic_be =             0xBE,
+static int writeCommit(config_streamer_t *streamer, bool allRecords, unsigned size)
+{
+    const configCommit_t commit = {
+        .size = size,
+        .sequence = configJournal.sequence + 1,
     };
 
-    config_streamer_write(&streamer, (uint8_t *)&header, sizeof(header));
+    config_streamer_write(streamer, (uint8_t *)&commit, sizeof(commit));
     uint16_t crc = CRC_START_VALUE;
-    crc = crc16_ccitt_update(crc, (uint8_t *)&header, sizeof(header));
+    crc = crc16_ccitt_update(crc, (uint8_t *)&commit, sizeof(commit));
     PG_FOREACH(reg) {
+        if (!allRecords && !configRecordChanged(reg)) {
+            continue;
+        }
         const uint16_t regSize = pgSize(reg);
         configRecord_t record = {
             .size = sizeof(configRecord_t) + regSize,
@@ -210,44 +302,71 @@ static bool writeSettingsToEEPROM(void)
         };
 
         record.flags |= CR_CLASSICATION_SYSTEM;
-        config_streamer_write(&streamer, (uint8_t *)&record, sizeof(record));
+        config_streamer_write(streamer, (uint8_t *)&record, sizeof(record));
         crc = crc16_ccitt_update(crc, (uint8_t *)&record, sizeof(record));
-        config_streamer_write(&streamer, reg->address, regSize);
+        config_streamer_write(streamer, reg->address, regSize);
         crc = crc16_ccitt_update(crc, reg->address, regSize);
     }
 
-    configFooter_t footer = {
-        .terminator = 0,
-    };
-
-    config_streamer_write(&streamer, (uint8_t *)&footer, sizeof(footer));
-    crc = crc16_ccitt_update(crc, (uint8_t *)&footer, sizeof(footer));
-
     // include inverted CRC in big endian format in the CRC
     const uint16_t invertedBigEndianCrc = ~(((crc & 0xFF) << 8) | (crc >> 8));
-    config_streamer_write(&streamer, (uint8_t *)&invertedBigEndianCrc, sizeof(crc));
+    config_streamer_write(streamer, (uint8_t *)&invertedBigEndianCrc, sizeof(crc));
+
+    return config_streamer_flush(streamer);
+}
+
+static bool writeSettingsToEEPROM(void)
+{
+    config_streamer_t streamer;
+    config_streamer_init(&streamer);
+
+    if (scanEEPROM() && configJournal.clean) {
+        // append the changed PGs
+        const unsigned size = configCommitSize(false);
+        if (size == CONFIG_COMMIT_EMPTY_SIZE) {
+            return true;
+        }
+        const unsigned offset = CONFIG_COMMIT_ALIGN(configJournal.size);
+        if (offset + size <= configRegionSize()) {
+            config_streamer_start(&streamer, (uintptr_t)&__config_start + offset, configRegionSize() - offset);
+            writeCommit(&streamer, false, size);
+            return config_streamer_finish(&streamer) == 0;
+        }
+    }
+
+    // compact, erase the region and write all the PGs in the first commit
+    config_streamer_start(&streamer, (uintptr_t)&__config_start, configRegionSize());
+    config_streamer_erase(&streamer);
 
+    configHeader_t header = {
+        .eepromConfigVersion =  EEPROM_CONF_VERSION,
+        .magic_be =             0xBE,
+    };
+
+    config_streamer_write(&streamer, (uint8_t *)&header, sizeof(header));
     config_streamer_flush(&streamer);
+    writeCommit(&streamer, true, configCommitSize(true));
 
     const bool success = config_streamer_finish(&streamer) == 0;
 
     return success;
 }
 
+// true once the journal holds all the PGs as they are in RAM, with room left to append to it
+static bool isEEPROMContentSaved(void)
+{
+    return isEEPROMContentValid() && configJournal.clean && configCommitSize(false) == CONFIG_COMMIT_EMPTY_SIZE;
+}
+
 void writeConfigToEEPROM(void)
 {
-    bool success = false;
-    // write it
-    for (int attempt = 0; attempt < 3 && !success; attempt++) {
-        if (writeSettingsToEEPROM()) {
-            success = true;
+    // write it, an attempt that tears its commit leaves the journal unclean and the next one compacts
+    for (int attempt = 0; attempt < 3; attempt++) {
+        if (writeSettingsToEEPROM() && isEEPROMContentSaved()) {
+            return;
         }
     }
 
-    if (success && isEEPROMContentValid()) {
-        return;
-    }
-
     // Flash write failed - just die now
     failureMode(FAILURE_FLASH_WRITE_FAILED);
 }
@@ -19,6 +19,8 @@
 
 #include "platform.h"
 
+#include "common/utils.h"
+
 #include "drivers/system.h"
 
 #include "config/config_streamer.h"
@@ -70,7 +72,7 @@ void config_streamer_init(config_streamer_t *c)
 
 void config_streamer_start(config_streamer_t *c, uintptr_t base, int size)
 {
-    // base must start at FLASH_PAGE_SIZE boundary
+    // base must be word aligned, and at a FLASH_PAGE_SIZE boundary for config_streamer_erase()
     c->address = base;
     c->size = size;
     if (!c->unlocked) {
@@ -222,40 +224,62 @@ static uint32_t getFLASHSectorForEEPROM(void)
 }
 #endif
 
-static int write_word(config_streamer_t *c, uint32_t value)
+static int erase_page(uintptr_t address)
+{
+#if defined(STM32F7)
+    UNUSED(address);
+    FLASH_EraseInitTypeDef EraseInitStruct = {
+        .TypeErase     = FLASH_TYPEERASE_SECTORS,
+        .VoltageRange  = FLASH_VOLTAGE_RANGE_3, // 2.7-3.6V
+        .NbSectors     = 1
+    };
+    EraseInitStruct.Sector = getFLASHSectorForEEPROM();
+    uint32_t SECTORError;
+    const HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&EraseInitStruct, &SECTORError);
+    if (status != HAL_OK) {
+        return -1;
+    }
+#else
+#if defined(STM32F4)
+    UNUSED(address);
+    const FLASH_Status status = FLASH_EraseSector(getFLASHSectorForEEPROM(), VoltageRange_3); //0x08080000 to 0x080A0000
+#else
+    const FLASH_Status status = FLASH_ErasePage(address);
+#endif
+    if (status != FLASH_COMPLETE) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+// Erases the pages from the start address to the end of the streamer's region.
+int config_streamer_erase(config_streamer_t *c)
 {
     if (c->err != 0) {
         return c->err;
     }
-#if defined(STM32F7)
-    if (c->address % FLASH_PAGE_SIZE == 0) {
-        FLASH_EraseInitTypeDef EraseInitStruct = {
-            .TypeErase     = FLASH_TYPEERASE_SECTORS,
-            .VoltageRange  = FLASH_VOLTAGE_RANGE_3, // 2.7-3.6V
-            .NbSectors     = 1
-        };
-        EraseInitStruct.Sector = getFLASHSectorForEEPROM();
-        uint32_t SECTORError;
-        const HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&EraseInitStruct, &SECTORError);
-        if (status != HAL_OK) {
-            return -1;
+    for (uintptr_t address = c->address; address < c->address + c->size; address += FLASH_PAGE_SIZE) {
+        c->err = erase_page(address);
+        if (c->err != 0) {
+            break;
         }
     }
+    return c->err;
+}
+
+// Programs a word of the region, which must have been erased by config_streamer_erase()
+static int write_word(config_streamer_t *c, uint32_t value)
+{
+    if (c->err != 0) {
+        return c->err;
+    }
+#if defined(STM32F7)
     const HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, c->address, value);
     if (status != HAL_OK) {
         return -2;
     }
 #else
-    if (c->address % FLASH_PAGE_SIZE == 0) {
-#if defined(STM32F4)
-        const FLASH_Status status = FLASH_EraseSector(getFLASHSectorForEEPROM(), VoltageRange_3); //0x08080000 to 0x080A0000
-#else
-        const FLASH_Status status = FLASH_ErasePage(c->address);
-#endif
-        if (status != FLASH_COMPLETE) {
-            return -1;
-        }
-    }
     const FLASH_Status status = FLASH_ProgramWord(c->address, value);
     if (status != FLASH_COMPLETE) {
         return -2;
@@ -115,7 +115,8 @@
 #define PG_CAMERA_CONTROL_CONFIG 522
 #define PG_FRSKY_D_CONFIG 523
 #define PG_MAX7456_CONFIG 524
-#define PG_BETAFLIGHT_END 524
+#define PG_RPM_FILTER_CONFIG 525
+#define PG_BETAFLIGHT_END 525
 
 
 // OSD configuration (subject to change)
@@ -22,6 +22,7 @@
 #include "drivers/exti.h"
 #include "drivers/bus.h"
 #include "drivers/sensor.h"
+#include "drivers/gyro_sample_ring.h"
 #include "drivers/accgyro/accgyro_mpu.h"
 #if defined(SIMULATOR_BUILD) && defined(SIMULATOR_MULTITHREAD)
 #include <pthread.h>
@@ -66,6 +67,12 @@ typedef struct gyroDev_s {
     gyroRateKHz_e gyroRateKHz;
     uint8_t mpuDividerDrops;
     bool dataReady;
+#ifdef USE_GYRO_SAMPLE_RING
+    bool sampleRingActive;                                  // samples are read by the data ready interrupt and queued in sampleRing
+    uint8_t sampleRingDecimation;                           // interrupts to skip between samples, when the gyro runs faster than its divider allows
+    uint8_t sampleRingSkipCount;
+    gyroSampleRing_t sampleRing;
+#endif
 #if defined(SIMULATOR_BUILD) && defined(SIMULATOR_MULTITHREAD)
     pthread_mutex_t lock;
 #endif
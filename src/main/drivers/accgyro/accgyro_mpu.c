@@ -32,6 +32,7 @@
 #include "drivers/bus.h"
 #include "drivers/bus_i2c.h"
 #include "drivers/bus_spi.h"
+#include "drivers/bus_spi_queue.h"
 #include "drivers/exti.h"
 #include "drivers/io.h"
 #include "drivers/nvic.h"
@@ -107,6 +108,30 @@ static void mpu6050FindRevision(gyroDev_t *gyro)
  * Gyro interrupt service routine
  */
 #if defined(MPU_INT_EXTI)
+#ifdef USE_GYRO_SAMPLE_RING
+static bool mpuGyroReadSPIRaw(const busDevice_t *bus, int16_t *adcRaw);
+
+static void mpuGyroSampleRingPush(gyroDev_t *gyro)
+{
+    const timeUs_t sampleTimeUs = micros();
+    if (gyro->sampleRingSkipCount) {
+        gyro->sampleRingSkipCount--;
+        return;
+    }
+    gyro->sampleRingSkipCount = gyro->sampleRingDecimation;
+
+    gyroSample_t *sample = gyroSampleRingReserve(&gyro->sampleRing);
+    if (!sample) {
+        return;
+    }
+    // gyroADCRaw belongs to the gyro task, read straight into the sample
+    if (mpuGyroReadSPIRaw(&gyro->bus, sample->adcRaw)) {
+        sample->timeUs = sampleTimeUs;
+        gyroSampleRingCommit(&gyro->sampleRing);
+    }
+}
+#endif
+
 static void mpuIntExtiHandler(extiCallbackRec_t *cb)
 {
 #ifdef DEBUG_MPU_DATA_READY_INTERRUPT
@@ -117,6 +142,11 @@ static void mpuIntExtiHandler(extiCallbackRec_t *cb)
 #endif
     gyroDev_t *gyro = container_of(cb, gyroDev_t, exti);
     gyro->dataReady = true;
+#ifdef USE_GYRO_SAMPLE_RING
+    if (gyro->sampleRingActive) {
+        mpuGyroSampleRingPush(gyro);
+    }
+#endif
     if (gyro->updateFn) {
         gyro->updateFn(gyro);
     }
@@ -180,6 +210,7 @@ bool mpuAccRead(accDev_t *acc)
 {
     uint8_t data[6];
 
+    // while the sample ring is active the SPI bus masks the gyro data ready interrupt for this read
     const bool ack = acc->mpuConfiguration.readFn(&acc->bus, MPU_RA_ACCEL_XOUT_H, data, 6);
     if (!ack) {
         return false;
@@ -199,6 +230,58 @@ void mpuGyroSetIsrUpdate(gyroDev_t *gyro, sensorGyroUpdateFuncPtr updateFn)
     }
 }
 
+#ifdef USE_GYRO_SAMPLE_RING
+/*
+ * Move gyro reads into the data ready interrupt, which queues every sample for the gyro task.
+ * Only SPI gyros read with mpuGyroReadSPI are supported, since the read must be short enough for an interrupt.
+ */
+bool mpuGyroSampleRingEnable(gyroDev_t *gyro)
+{
+#if defined(MPU_INT_EXTI)
+    if (gyro->exti.fn != mpuIntExtiHandler || gyro->readFn != mpuGyroReadSPI) {
+        // data ready interrupt not configured
+        return false;
+    }
+    SPI_TypeDef *instance = gyro->bus.busdev_u.spi.instance;
+#ifdef USE_SPI_DMA_QUEUE
+    if (spiBusHasJobDma(instance)) {
+        // DMA jobs keep their chip select asserted after the job is queued
+        return false;
+    }
+#endif
+#ifdef USE_SDCARD
+    if (instance == SDCARD_SPI_INSTANCE) {
+        // the SD card holds its chip select across DMA transfers
+        return false;
+    }
+#endif
+#if defined(USE_RX_SPI) && defined(RX_SPI_INSTANCE)
+    if (instance == RX_SPI_INSTANCE) {
+        return false;
+    }
+#endif
+#if defined(USE_VTX_RTC6705) && defined(RTC6705_SPI_INSTANCE)
+    if (instance == RTC6705_SPI_INSTANCE) {
+        return false;
+    }
+#endif
+    // every other transaction on the bus now masks the interrupt while it holds a chip select
+    spiSetBusInterruptPriority(instance, NVIC_PRIO_MPU_INT_EXTI);
+    gyroSampleRingInit(&gyro->sampleRing);
+    // at 32kHz the sample rate divider has no effect, so skip interrupts instead
+    gyro->sampleRingDecimation = gyro->gyroRateKHz == GYRO_RATE_32_kHz ? gyro->mpuDividerDrops : 0;
+    gyro->sampleRingSkipCount = 0;
+    ATOMIC_BLOCK(NVIC_PRIO_MPU_INT_EXTI) {
+        gyro->sampleRingActive = true;
+    }
+    return true;
+#else
+    UNUSED(gyro);
+    return false;
+#endif
+}
+#endif
+
 bool mpuGyroRead(gyroDev_t *gyro)
 {
     uint8_t data[6];
@@ -232,23 +315,28 @@ gyroOverflow_e mpuGyroCheckOverflow(const gyroDev_t *gyro)
     return ret;
 }
 
-bool mpuGyroReadSPI(gyroDev_t *gyro)
+static bool mpuGyroReadSPIRaw(const busDevice_t *bus, int16_t *adcRaw)
 {
     static const uint8_t dataToSend[7] = {MPU_RA_GYRO_XOUT_H | 0x80, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
     uint8_t data[7];
 
-    const bool ack = spiBusTransfer(&gyro->bus, dataToSend, data, 7);
+    const bool ack = spiBusTransfer(bus, dataToSend, data, 7);
     if (!ack) {
         return false;
     }
 
-    gyro->gyroADCRaw[X] = (int16_t)((data[1] << 8) | data[2]);
-    gyro->gyroADCRaw[Y] = (int16_t)((data[3] << 8) | data[4]);
-    gyro->gyroADCRaw[Z] = (int16_t)((data[5] << 8) | data[6]);
+    adcRaw[X] = (int16_t)((data[1] << 8) | data[2]);
+    adcRaw[Y] = (int16_t)((data[3] << 8) | data[4]);
+    adcRaw[Z] = (int16_t)((data[5] << 8) | data[6]);
 
     return true;
 }
 
+bool mpuGyroReadSPI(gyroDev_t *gyro)
+{
+    return mpuGyroReadSPIRaw(&gyro->bus, gyro->gyroADCRaw);
+}
+
 #ifdef USE_SPI
 static bool detectSPISensorsAndUpdateDetectionResult(gyroDev_t *gyro)
 {
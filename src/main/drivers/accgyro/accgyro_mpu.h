@@ -220,6 +220,9 @@ bool mpuGyroRead(struct gyroDev_s *gyro);
 bool mpuGyroReadSPI(struct gyroDev_s *gyro);
 void mpuDetect(struct gyroDev_s *gyro);
 void mpuGyroSetIsrUpdate(struct gyroDev_s *gyro, sensorGyroUpdateFuncPtr updateFn);
+#ifdef USE_GYRO_SAMPLE_RING
+bool mpuGyroSampleRingEnable(struct gyroDev_s *gyro);
+#endif
 
 struct accDev_s;
 bool mpuAccRead(struct accDev_s *acc);
@@ -26,6 +26,7 @@
 #include "drivers/bus.h"
 #include "drivers/bus_spi.h"
 #include "drivers/bus_spi_impl.h"
+#include "drivers/bus_spi_queue.h"
 #include "drivers/exti.h"
 #include "drivers/io.h"
 #include "drivers/rcc.h"
@@ -127,6 +128,10 @@ void spiInitDevice(SPIDevice device)
 
     SPI_Init(spi->dev, &spiInit);
     SPI_Cmd(spi->dev, ENABLE);
+
+#ifdef USE_SPI_DMA_QUEUE
+    spiJobQueueInit(device);
+#endif
 }
 
 bool spiInit(SPIDevice device)
@@ -253,9 +258,14 @@ bool spiTransfer(SPI_TypeDef *instance, const uint8_t *txData, uint8_t *rxData,
 
 bool spiBusTransfer(const busDevice_t *bus, const uint8_t *txData, uint8_t *rxData, int length)
 {
+#ifdef USE_SPI_DMA_QUEUE
+    spiWaitJobsComplete(bus->busdev_u.spi.instance);
+#endif
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransfer(bus->busdev_u.spi.instance, txData, rxData, length);
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
     return true;
 }
 
@@ -300,24 +310,34 @@ void spiResetErrorCounter(SPI_TypeDef *instance)
 
 bool spiBusWriteRegister(const busDevice_t *bus, uint8_t reg, uint8_t data)
 {
+#ifdef USE_SPI_DMA_QUEUE
+    spiWaitJobsComplete(bus->busdev_u.spi.instance);
+#endif
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransferByte(bus->busdev_u.spi.instance, reg);
     while (spiIsBusBusy(bus->busdev_u.spi.instance)) {};
     spiTransferByte(bus->busdev_u.spi.instance, data);
     while (spiIsBusBusy(bus->busdev_u.spi.instance)) {};
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
 
     return true;
 }
 
 bool spiBusReadRegisterBuffer(const busDevice_t *bus, uint8_t reg, uint8_t *data, uint8_t length)
 {
+#ifdef USE_SPI_DMA_QUEUE
+    spiWaitJobsComplete(bus->busdev_u.spi.instance);
+#endif
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransferByte(bus->busdev_u.spi.instance, reg | 0x80); // read transaction
     while (spiIsBusBusy(bus->busdev_u.spi.instance)) {};
     spiTransfer(bus->busdev_u.spi.instance, NULL, data, length);
     while (spiIsBusBusy(bus->busdev_u.spi.instance)) {};
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
 
     return true;
 }
@@ -325,12 +345,17 @@ bool spiBusReadRegisterBuffer(const busDevice_t *bus, uint8_t reg, uint8_t *data
 uint8_t spiBusReadRegister(const busDevice_t *bus, uint8_t reg)
 {
     uint8_t data;
+#ifdef USE_SPI_DMA_QUEUE
+    spiWaitJobsComplete(bus->busdev_u.spi.instance);
+#endif
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransferByte(bus->busdev_u.spi.instance, reg | 0x80); // read transaction
     while (spiIsBusBusy(bus->busdev_u.spi.instance)) {};
     spiTransfer(bus->busdev_u.spi.instance, NULL, &data, 1);
     while (spiIsBusBusy(bus->busdev_u.spi.instance)) {};
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
 
     return data;
 }
@@ -339,4 +364,28 @@ void spiBusSetInstance(busDevice_t *bus, SPI_TypeDef *instance)
 {
     bus->busdev_u.spi.instance = instance;
 }
+
+void spiSetBusInterruptPriority(SPI_TypeDef *instance, uint8_t priority)
+{
+    const SPIDevice device = spiDeviceByInstance(instance);
+    if (device != SPIINVALID) {
+        spiDevice[device].interruptPriority = priority;
+    }
+}
+
+// returns the BASEPRI to restore with spiBusTransactionEnd()
+uint8_t spiBusTransactionBegin(SPI_TypeDef *instance)
+{
+    const uint8_t basepri = __get_BASEPRI();
+    const SPIDevice device = spiDeviceByInstance(instance);
+    if (device != SPIINVALID && spiDevice[device].interruptPriority) {
+        __set_BASEPRI_MAX(spiDevice[device].interruptPriority);
+    }
+    return basepri;
+}
+
+void spiBusTransactionEnd(uint8_t basepri)
+{
+    __set_BASEPRI(basepri);
+}
 #endif
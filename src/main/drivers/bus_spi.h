@@ -108,6 +108,11 @@ bool spiBusReadRegisterBuffer(const busDevice_t *bus, uint8_t reg, uint8_t *data
 uint8_t spiBusReadRegister(const busDevice_t *bus, uint8_t reg);
 void spiBusSetInstance(busDevice_t *bus, SPI_TypeDef *instance);
 
+// An interrupt handler that uses a bus is masked from chip select assertion to release of every other transaction on it
+void spiSetBusInterruptPriority(SPI_TypeDef *instance, uint8_t priority);
+uint8_t spiBusTransactionBegin(SPI_TypeDef *instance);
+void spiBusTransactionEnd(uint8_t basepri);
+
 typedef struct spiPinConfig_s {
     ioTag_t ioTagSck[SPIDEV_COUNT];
     ioTag_t ioTagMiso[SPIDEV_COUNT];
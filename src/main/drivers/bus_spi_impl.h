@@ -62,6 +62,7 @@ typedef struct SPIDevice_s {
     rccPeriphTag_t rcc;
     volatile uint16_t errorCount;
     bool leadingEdge;
+    uint8_t interruptPriority;      // of an interrupt handler that uses the bus, 0 if none
 #if defined(USE_HAL_DRIVER)
     SPI_HandleTypeDef hspi;
     DMA_HandleTypeDef hdma;
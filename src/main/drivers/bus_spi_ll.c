@@ -294,9 +294,11 @@ bool spiTransfer(SPI_TypeDef *instance, const uint8_t *txData, uint8_t *rxData,
 
 bool spiBusTransfer(const busDevice_t *bus, const uint8_t *txData, uint8_t *rxData, int length)
 {
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransfer(bus->busdev_u.spi.instance, txData, rxData, length);
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
     return true;
 }
 
@@ -334,20 +336,24 @@ void spiResetErrorCounter(SPI_TypeDef *instance)
 
 bool spiBusWriteRegister(const busDevice_t *bus, uint8_t reg, uint8_t data)
 {
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransferByte(bus->busdev_u.spi.instance, reg);
     spiTransferByte(bus->busdev_u.spi.instance, data);
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
 
     return true;
 }
 
 bool spiBusReadRegisterBuffer(const busDevice_t *bus, uint8_t reg, uint8_t *data, uint8_t length)
 {
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransferByte(bus->busdev_u.spi.instance, reg | 0x80); // read transaction
     spiTransfer(bus->busdev_u.spi.instance, NULL, data, length);
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
 
     return true;
 }
@@ -355,10 +361,12 @@ bool spiBusReadRegisterBuffer(const busDevice_t *bus, uint8_t reg, uint8_t *data
 uint8_t spiBusReadRegister(const busDevice_t *bus, uint8_t reg)
 {
     uint8_t data;
+    const uint8_t basepri = spiBusTransactionBegin(bus->busdev_u.spi.instance);
     IOLo(bus->busdev_u.spi.csnPin);
     spiTransferByte(bus->busdev_u.spi.instance, reg | 0x80); // read transaction
     spiTransfer(bus->busdev_u.spi.instance, NULL, &data, 1);
     IOHi(bus->busdev_u.spi.csnPin);
+    spiBusTransactionEnd(basepri);
 
     return data;
 }
@@ -369,4 +377,28 @@ void spiBusSetInstance(busDevice_t *bus, SPI_TypeDef *instance)
     bus->busdev_u.spi.instance = instance;
 }
 
+void spiSetBusInterruptPriority(SPI_TypeDef *instance, uint8_t priority)
+{
+    const SPIDevice device = spiDeviceByInstance(instance);
+    if (device != SPIINVALID) {
+        spiDevice[device].interruptPriority = priority;
+    }
+}
+
+// returns the BASEPRI to restore with spiBusTransactionEnd()
+uint8_t spiBusTransactionBegin(SPI_TypeDef *instance)
+{
+    const uint8_t basepri = __get_BASEPRI();
+    const SPIDevice device = spiDeviceByInstance(instance);
+    if (device != SPIINVALID && spiDevice[device].interruptPriority) {
+        __set_BASEPRI_MAX(spiDevice[device].interruptPriority);
+    }
+    return basepri;
+}
+
+void spiBusTransactionEnd(uint8_t basepri)
+{
+    __set_BASEPRI(basepri);
+}
+
 #endif
@@ -0,0 +1,279 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <platform.h>
+
+#ifdef USE_SPI_DMA_QUEUE
+
+#include "build/atomic.h"
+
+#include "drivers/bus.h"
+#include "drivers/bus_spi.h"
+#include "drivers/bus_spi_impl.h"
+#include "drivers/bus_spi_queue.h"
+#include "drivers/dma.h"
+#include "drivers/io.h"
+#include "drivers/nvic.h"
+#include "drivers/resource.h"
+#include "drivers/time.h"
+
+// longest wait for the jobs on a bus before they are abandoned, far longer than any job takes
+#define SPI_JOB_QUEUE_TIMEOUT_US 10000
+
+typedef struct spiDmaHardware_s {
+    DMA_Stream_TypeDef *txStream;
+    DMA_Stream_TypeDef *rxStream;
+    uint32_t channel;
+} spiDmaHardware_t;
+
+// the channel is fixed per SPI, the streams are chosen by the target to avoid the timer and UART streams it uses
+static const spiDmaHardware_t spiDmaHardware[SPIDEV_COUNT] = {
+#if defined(USE_SPI_DEVICE_1) && defined(SPI1_TX_DMA_STREAM) && defined(SPI1_RX_DMA_STREAM)
+    [SPIDEV_1] = { .txStream = SPI1_TX_DMA_STREAM, .rxStream = SPI1_RX_DMA_STREAM, .channel = DMA_Channel_3 },
+#endif
+#if defined(USE_SPI_DEVICE_2) && defined(SPI2_TX_DMA_STREAM) && defined(SPI2_RX_DMA_STREAM)
+    [SPIDEV_2] = { .txStream = SPI2_TX_DMA_STREAM, .rxStream = SPI2_RX_DMA_STREAM, .channel = DMA_Channel_0 },
+#endif
+#if defined(USE_SPI_DEVICE_3) && defined(SPI3_TX_DMA_STREAM) && defined(SPI3_RX_DMA_STREAM)
+    [SPIDEV_3] = { .txStream = SPI3_TX_DMA_STREAM, .rxStream = SPI3_RX_DMA_STREAM, .channel = DMA_Channel_0 },
+#endif
+};
+
+typedef struct spiJobQueue_s {
+    spiJob_t * volatile head;       // job on the bus, or next to run
+    spiJob_t *tail;
+    const spiDmaHardware_t *dma;    // NULL if jobs are run with polled transfers
+    volatile bool dmaInProgress;
+} spiJobQueue_t;
+
+static spiJobQueue_t spiJobQueues[SPIDEV_COUNT];
+
+static void spiJobQueueRun(SPIDevice device);
+
+static void spiJobComplete(SPIDevice device, spiJobState_e state)
+{
+    spiJobQueue_t *queue = &spiJobQueues[device];
+    spiJob_t *job = queue->head;
+
+    if (!job->holdCs) {
+        IOHi(job->bus->busdev_u.spi.csnPin);
+    }
+    queue->head = job->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    job->next = NULL;
+    // set last, the owner may reuse the job as soon as it sees the final state
+    job->state = state;
+    if (job->callback) {
+        job->callback(job);
+    }
+}
+
+static void spiJobStartDma(SPIDevice device, spiJob_t *job)
+{
+    static uint8_t dummyTx = 0xFF;
+    static uint8_t dummyRx;
+
+    const spiDmaHardware_t *dma = spiJobQueues[device].dma;
+    SPI_TypeDef *instance = spiInstanceByDevice(device);
+
+    DMA_DeInit(dma->rxStream);
+    DMA_DeInit(dma->txStream);
+
+    DMA_InitTypeDef DMA_InitStructure;
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_Channel = dma->channel;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)(&instance->DR);
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_BufferSize = job->length;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+
+    DMA_InitStructure.DMA_Memory0BaseAddr = job->rxData ? (uint32_t)job->rxData : (uint32_t)&dummyRx;
+    DMA_InitStructure.DMA_MemoryInc = job->rxData ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+    DMA_Init(dma->rxStream, &DMA_InitStructure);
+
+    DMA_InitStructure.DMA_Memory0BaseAddr = job->txData ? (uint32_t)job->txData : (uint32_t)&dummyTx;
+    DMA_InitStructure.DMA_MemoryInc = job->txData ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    DMA_Init(dma->txStream, &DMA_InitStructure);
+
+    // the receive stream completes last, so it signals the end of the job
+    DMA_ITConfig(dma->rxStream, DMA_IT_TC | DMA_IT_TE, ENABLE);
+
+    // discard any byte left over from a polled transfer
+    (void)instance->DR;
+
+    spiJobQueues[device].dmaInProgress = true;
+    DMA_Cmd(dma->rxStream, ENABLE);
+    DMA_Cmd(dma->txStream, ENABLE);
+    SPI_I2S_DMACmd(instance, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+}
+
+static void spiJobDmaIrqHandler(dmaChannelDescriptor_t *descriptor)
+{
+    const SPIDevice device = descriptor->userParam;
+    const spiDmaHardware_t *dma = spiJobQueues[device].dma;
+
+    const spiJobState_e state = DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TEIF) ? SPI_JOB_ERROR : SPI_JOB_DONE;
+    DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF | DMA_IT_HTIF | DMA_IT_TEIF | DMA_IT_DMEIF | DMA_IT_FEIF);
+
+    DMA_Cmd(dma->txStream, DISABLE);
+    DMA_Cmd(dma->rxStream, DISABLE);
+    SPI_I2S_DMACmd(spiInstanceByDevice(device), SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+    if (state == SPI_JOB_ERROR) {
+        spiDevice[device].errorCount++;
+    }
+
+    spiJobQueues[device].dmaInProgress = false;
+    spiJobComplete(device, state);
+    spiJobQueueRun(device);
+}
+
+// runs jobs until one is started on DMA or the queue is empty, called with the DMA interrupt masked or from it
+static void spiJobQueueRun(SPIDevice device)
+{
+    spiJobQueue_t *queue = &spiJobQueues[device];
+    SPI_TypeDef *instance = spiInstanceByDevice(device);
+
+    while (queue->head && !queue->dmaInProgress) {
+        spiJob_t *job = queue->head;
+        job->state = SPI_JOB_BUSY;
+        if (job->divisor) {
+            spiSetDivisor(instance, job->divisor);
+        }
+        IOLo(job->bus->busdev_u.spi.csnPin);
+        if (queue->dma && job->length) {
+            spiJobStartDma(device, job);
+            return;
+        }
+        if (job->length) {
+            spiTransfer(instance, job->txData, job->rxData, job->length);
+        }
+        spiJobComplete(device, SPI_JOB_DONE);
+    }
+}
+
+void spiJobQueueInit(SPIDevice device)
+{
+    spiJobQueue_t *queue = &spiJobQueues[device];
+    memset(queue, 0, sizeof(*queue));
+
+    const spiDmaHardware_t *dma = &spiDmaHardware[device];
+    if (!dma->txStream || !dma->rxStream) {
+        return;
+    }
+
+    const dmaIdentifier_e txIdentifier = dmaGetIdentifier(dma->txStream);
+    const dmaIdentifier_e rxIdentifier = dmaGetIdentifier(dma->rxStream);
+    if (dmaGetOwner(txIdentifier) != OWNER_FREE || dmaGetOwner(rxIdentifier) != OWNER_FREE) {
+        // a stream was taken by another driver, DShot for instance, run the jobs polled
+        return;
+    }
+    dmaInit(txIdentifier, OWNER_SPI_MOSI, RESOURCE_INDEX(device));
+    dmaInit(rxIdentifier, OWNER_SPI_MISO, RESOURCE_INDEX(device));
+    dmaSetHandler(rxIdentifier, spiJobDmaIrqHandler, NVIC_PRIO_SPI_DMA, device);
+
+    queue->dma = dma;
+}
+
+/*
+ * Add a job to the end of the queue of its bus. Returns false if the job is still in a queue.
+ */
+bool spiJobQueue(spiJob_t *job)
+{
+    const SPIDevice device = spiDeviceByInstance(job->bus->busdev_u.spi.instance);
+    if (device == SPIINVALID || spiIsJobBusy(job)) {
+        return false;
+    }
+
+    spiJobQueue_t *queue = &spiJobQueues[device];
+    job->next = NULL;
+    job->state = SPI_JOB_QUEUED;
+    ATOMIC_BLOCK(NVIC_PRIO_SPI_DMA) {
+        if (queue->tail) {
+            queue->tail->next = job;
+        } else {
+            queue->head = job;
+        }
+        queue->tail = job;
+        spiJobQueueRun(device);
+    }
+    return true;
+}
+
+bool spiBusHasJobDma(SPI_TypeDef *instance)
+{
+    const SPIDevice device = spiDeviceByInstance(instance);
+    return device != SPIINVALID && spiJobQueues[device].dma;
+}
+
+bool spiIsJobQueueBusy(SPI_TypeDef *instance)
+{
+    const SPIDevice device = spiDeviceByInstance(instance);
+    return device != SPIINVALID && spiJobQueues[device].head;
+}
+
+// fails every queued job, called with the DMA interrupt masked
+static void spiJobQueueAbort(SPIDevice device)
+{
+    spiJobQueue_t *queue = &spiJobQueues[device];
+
+    if (queue->dmaInProgress) {
+        DMA_Cmd(queue->dma->txStream, DISABLE);
+        DMA_Cmd(queue->dma->rxStream, DISABLE);
+        SPI_I2S_DMACmd(spiInstanceByDevice(device), SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+        queue->dmaInProgress = false;
+    }
+    while (queue->head) {
+        IOHi(queue->head->bus->busdev_u.spi.csnPin);
+        spiDevice[device].errorCount++;
+        spiJobComplete(device, SPI_JOB_ERROR);
+    }
+}
+
+/*
+ * Wait for the queue of a bus to empty. If it does not within SPI_JOB_QUEUE_TIMEOUT_US the remaining jobs complete
+ * with SPI_JOB_ERROR and false is returned; the bus is free either way.
+ */
+bool spiWaitJobsComplete(SPI_TypeDef *instance)
+{
+    const SPIDevice device = spiDeviceByInstance(instance);
+    if (device == SPIINVALID) {
+        return true;
+    }
+    const timeUs_t startUs = micros();
+    while (spiJobQueues[device].head) {
+        if (cmpTimeUs(micros(), startUs) > SPI_JOB_QUEUE_TIMEOUT_US) {
+            ATOMIC_BLOCK(NVIC_PRIO_SPI_DMA) {
+                spiJobQueueAbort(device);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // USE_SPI_DMA_QUEUE
@@ -0,0 +1,67 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "drivers/bus.h"
+#include "drivers/bus_spi.h"
+
+/*
+ * Queue of SPI transactions per bus, run by DMA when the target defines SPIn_TX_DMA_STREAM and SPIn_RX_DMA_STREAM
+ * for the bus, otherwise run with polled transfers before spiJobQueue() returns.
+ *
+ * Jobs may only be queued from task context. The job and its buffers belong to the queue until the job state is
+ * SPI_JOB_DONE or SPI_JOB_ERROR, so they must not live on the stack.
+ *
+ * Drivers that share a bus with queued jobs must call spiWaitJobsComplete() before asserting their chip select,
+ * the spiBus* register helpers already do. A bus whose jobs do not complete in time has them failed with
+ * SPI_JOB_ERROR, so a driver waiting on a job state always sees it end.
+ */
+
+typedef enum {
+    SPI_JOB_IDLE = 0,
+    SPI_JOB_QUEUED,
+    SPI_JOB_BUSY,
+    SPI_JOB_DONE,
+    SPI_JOB_ERROR
+} spiJobState_e;
+
+struct spiJob_s;
+typedef void spiJobCallbackFn(struct spiJob_s *job);
+
+typedef struct spiJob_s {
+    const busDevice_t *bus;         // instance and chip select
+    const uint8_t *txData;          // NULL to clock out 0xFF
+    uint8_t *rxData;                // NULL to discard the received bytes
+    uint16_t length;                // 0 only changes the chip select
+    uint16_t divisor;               // SPI clock divisor for the job, 0 leaves the bus clock unchanged
+    bool holdCs;                    // leave chip select low for the next job, which must be for the same device
+    spiJobCallbackFn *callback;     // called when the job completes, from the DMA interrupt if the bus uses DMA
+    volatile spiJobState_e state;
+    struct spiJob_s *next;
+} spiJob_t;
+
+void spiJobQueueInit(SPIDevice device);
+bool spiJobQueue(spiJob_t *job);
+bool spiBusHasJobDma(SPI_TypeDef *instance);
+bool spiIsJobQueueBusy(SPI_TypeDef *instance);
+bool spiWaitJobsComplete(SPI_TypeDef *instance);
+
+static inline bool spiIsJobBusy(const spiJob_t *job)
+{
+    return job->state == SPI_JOB_QUEUED || job->state == SPI_JOB_BUSY;
+}
@@ -29,10 +29,11 @@
 
 #ifdef USE_MAG_SPI_HMC5883
 
-#define DISABLE_HMC5883      IOHi(hmc5883CsPin)
-#define ENABLE_HMC5883       IOLo(hmc5883CsPin)
+#define DISABLE_HMC5883      {IOHi(hmc5883CsPin);spiBusTransactionEnd(hmc5883Basepri);}
+#define ENABLE_HMC5883       {hmc5883Basepri = spiBusTransactionBegin(HMC5883_SPI_INSTANCE);IOLo(hmc5883CsPin);}
 
 static IO_t hmc5883CsPin = IO_NONE;
+static uint8_t hmc5883Basepri;
 
 bool hmc5883SpiWriteCommand(uint8_t reg, uint8_t data)
 {
@@ -77,7 +78,7 @@ void hmc5883SpiInit(void)
     IOInit(hmc5883CsPin, OWNER_COMPASS_CS, 0);
     IOConfigGPIO(hmc5883CsPin, IOCFG_OUT_PP);
 
-    DISABLE_HMC5883;
+    IOHi(hmc5883CsPin);
 
     spiSetDivisor(HMC5883_SPI_INSTANCE, SPI_CLOCK_STANDARD);
 
@@ -0,0 +1,72 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * A DShot burst writes the compare registers of a run of timer channels through DMAR on every update of the timer,
+ * one word per channel for each bit. Only the run from the first to the last motor channel is written, and a run
+ * with a channel that is not a motor is refused, since that channel may be in use by something else.
+ */
+
+#define DSHOT_BURST_MAX_CHANNELS 4  // CCR1 to CCR4
+
+typedef struct dshotBurst_s {
+    uint8_t channelMask;    // bit per channel index of the motors on the timer
+    uint8_t firstChannel;
+    uint8_t channelCount;
+} dshotBurst_t;
+
+// adds the channel of a motor, returns true if the motor channels added so far form a run that can be sent
+static inline bool dshotBurstAddChannel(dshotBurst_t *burst, uint8_t channelIndex)
+{
+    if (channelIndex >= DSHOT_BURST_MAX_CHANNELS) {
+        burst->channelMask = 0xff;  // the burst can never be sent
+        return false;
+    }
+    burst->channelMask |= 1 << channelIndex;
+    if (burst->channelMask > (1 << DSHOT_BURST_MAX_CHANNELS) - 1) {
+        return false;
+    }
+
+    uint8_t first = 0;
+    while (!(burst->channelMask & (1 << first))) {
+        first++;
+    }
+    uint8_t last = DSHOT_BURST_MAX_CHANNELS - 1;
+    while (!(burst->channelMask & (1 << last))) {
+        last--;
+    }
+    burst->firstChannel = first;
+    burst->channelCount = last - first + 1;
+
+    return (burst->channelMask >> first) == (1 << burst->channelCount) - 1;
+}
+
+// offset of the first word of a channel in the burst buffer, the words of a bit are one per channel of the run
+static inline uint8_t dshotBurstBufferOffset(const dshotBurst_t *burst, uint8_t channelIndex)
+{
+    return channelIndex - burst->firstChannel;
+}
+
+static inline uint16_t dshotBurstLength(const dshotBurst_t *burst, uint8_t bitCount)
+{
+    return bitCount * burst->channelCount;
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#ifdef USE_DSHOT_TELEMETRY
+
+#include "common/maths.h"
+
+#include "drivers/dshot_telemetry.h"
+
+#define GCR_INVALID 0xff
+
+// 5 bit GCR code to nibble
+static const uint8_t gcrDecode[32] = {
+    GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID, GCR_INVALID,
+    GCR_INVALID, 0x9,         0xa,         0xb,         GCR_INVALID, 0xd,         0xe,         0xf,
+    GCR_INVALID, GCR_INVALID, 0x2,         0x3,         GCR_INVALID, 0x5,         0x6,         0x7,
+    GCR_INVALID, 0x0,         0x8,         0x1,         GCR_INVALID, 0x4,         0xc,         GCR_INVALID
+};
+
+/*
+ * Takes the 20 GCR bits of a response and returns eRPM / 100, 0 for a stopped motor or DSHOT_TELEMETRY_INVALID.
+ */
+uint16_t dshotDecodeTelemetryValue(uint32_t gcrValue)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        const uint8_t nibble = gcrDecode[(gcrValue >> (i * 5)) & 0x1f];
+        if (nibble == GCR_INVALID) {
+            return DSHOT_TELEMETRY_INVALID;
+        }
+        value = (value << 4) | nibble;
+    }
+
+    // the checksum nibble is the inverted xor of the data nibbles, so all four xor to 0xf
+    uint32_t csum = value ^ (value >> 8);
+    csum ^= csum >> 4;
+    if ((csum & 0xf) != 0xf) {
+        return DSHOT_TELEMETRY_INVALID;
+    }
+    value >>= 4;
+
+    if (value == 0x0fff) {
+        // longest period, the motor is not turning
+        return 0;
+    }
+
+    const uint32_t periodUs = (value & 0x01ff) << (value >> 9);
+    if (periodUs == 0) {
+        return DSHOT_TELEMETRY_INVALID;
+    }
+    return (60 * 1000000 / 100 + periodUs / 2) / periodUs;
+}
+
+/*
+ * Turns the timer ticks of the edges captured on the motor pin into a response value, see dshotDecodeTelemetryValue.
+ * The ticks are taken modulo 16 bits so the timer may wrap during the response.
+ */
+uint16_t dshotDecodeTelemetryPacket(const uint32_t *edgeTicks, int edgeCount, uint32_t bitTicks)
+{
+    if (edgeCount < 2 || bitTicks == 0) {
+        return DSHOT_TELEMETRY_INVALID;
+    }
+
+    uint32_t value = 0;
+    int bits = 0;
+    for (int i = 1; i <= edgeCount; i++) {
+        int len;
+        if (i < edgeCount) {
+            const uint16_t diff = edgeTicks[i] - edgeTicks[i - 1];
+            len = (diff + bitTicks / 2) / bitTicks;
+        } else {
+            // no edge ends the last run, the line stays at its idle level after it
+            len = DSHOT_TELEMETRY_FRAME_BITS - bits;
+        }
+        if (len <= 0) {
+            // a glitch shorter than half a bit
+            return DSHOT_TELEMETRY_INVALID;
+        }
+        // the edge back to the idle level may come a little after the last bit
+        len = MIN(len, DSHOT_TELEMETRY_FRAME_BITS - bits);
+
+        // a run of len bits starts with the 1 of its edge
+        value <<= len;
+        value |= 1 << (len - 1);
+        bits += len;
+        if (bits == DSHOT_TELEMETRY_FRAME_BITS) {
+            break;
+        }
+    }
+    return dshotDecodeTelemetryValue(value & 0xfffff);
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Bidirectional DShot: after every (inverted) frame the ESC answers on the same wire with 21 bits at 5/4 of the
+ * DShot bit rate. A level change marks a 1 bit, the first change is the start of the frame. The 20 bits after it
+ * are four GCR quintets holding 16 bits: a 3 bit shift, a 9 bit period base and a 4 bit checksum. The eRPM period
+ * in microseconds is base << shift.
+ */
+
+#define DSHOT_TELEMETRY_FRAME_BITS  21
+#define DSHOT_TELEMETRY_INVALID     0xffff
+
+// bit rate of the response relative to the frame, the response bit is 4/5 of a frame bit
+#define DSHOT_TELEMETRY_BIT_TICKS(frameBitTicks) (((frameBitTicks) * 4 + 2) / 5)
+
+uint16_t dshotDecodeTelemetryPacket(const uint32_t *edgeTicks, int edgeCount, uint32_t bitTicks);
+uint16_t dshotDecodeTelemetryValue(uint32_t gcrValue);
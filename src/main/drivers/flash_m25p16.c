@@ -17,14 +17,18 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "platform.h"
 
 #ifdef USE_FLASH_M25P16
 
+#include "common/maths.h"
+
 #include "flash.h"
 #include "flash_m25p16.h"
 #include "drivers/bus_spi.h"
+#include "drivers/bus_spi_queue.h"
 #include "drivers/io.h"
 #include "drivers/time.h"
 
@@ -57,11 +61,16 @@
 #define JEDEC_ID_MACRONIX_MX25L25635E  0xC22019
 #define JEDEC_ID_WINBOND_W25Q256       0xEF4019
 
-#define DISABLE_M25P16       IOHi(bus->busdev_u.spi.csnPin); __NOP()
-#define ENABLE_M25P16        __NOP(); IOLo(bus->busdev_u.spi.csnPin)
+#define DISABLE_M25P16       IOHi(bus->busdev_u.spi.csnPin); spiBusTransactionEnd(busBasepri); __NOP()
+#ifdef USE_SPI_DMA_QUEUE
+#define ENABLE_M25P16        spiWaitJobsComplete(bus->busdev_u.spi.instance); busBasepri = spiBusTransactionBegin(bus->busdev_u.spi.instance); IOLo(bus->busdev_u.spi.csnPin)
+#else
+#define ENABLE_M25P16        __NOP(); busBasepri = spiBusTransactionBegin(bus->busdev_u.spi.instance); IOLo(bus->busdev_u.spi.csnPin)
+#endif
 
 static busDevice_t busInstance;
 static busDevice_t *bus;
+static uint8_t busBasepri;
 static bool isLargeFlash = false;
 
 // Option to skip some sectors
@@ -74,6 +83,9 @@ static bool isLargeFlash = false;
 // The timeout we expect between being able to issue page program instructions
 #define DEFAULT_TIMEOUT_MILLIS       6
 
+// Attempts at sending a page whose jobs failed before it is given up on
+#define PAGE_PROGRAM_ATTEMPTS        3
+
 // These take sooooo long:
 #define SECTOR_ERASE_TIMEOUT_MILLIS  5000
 #define BULK_ERASE_TIMEOUT_MILLIS    21000
@@ -87,6 +99,36 @@ static flashGeometry_t geometry = {.pageSize = M25P16_PAGESIZE};
  */
 static bool couldBeBusy = false;
 
+#ifdef USE_SPI_DMA_QUEUE
+/*
+ * When the bus has DMA a page program is collected in one of two page buffers, command first, while the other one
+ * waits for the chip or is being sent. m25p16_service() moves the pages along without blocking: it polls the status
+ * register with a queued job until the previous program completes, then queues the write enable and the next page.
+ */
+typedef struct m25p16PageBuffer_s {
+    uint8_t data[5 + M25P16_PAGESIZE];
+    uint16_t length;
+} m25p16PageBuffer_t;
+
+static bool pageProgramAsync = false;  // the bus has DMA, page programs go through the page buffers
+static m25p16PageBuffer_t pageBuffers[2];
+static uint8_t pageFillIndex;           // buffer between m25p16_pageProgramBegin() and m25p16_pageProgramFinish()
+static bool pageFillValid;              // a buffer is taken by m25p16_pageProgramBegin()
+static uint8_t pageSendIndex;           // oldest finished page
+static uint8_t pagesQueued;             // finished pages the chip hasn't received completely
+static bool pageSending = false;
+static uint8_t pageSendAttempts;        // failed attempts at sending the oldest page
+static uint32_t droppedBytes;           // data of the pages given up on
+
+static spiJob_t writeEnableJob;
+static spiJob_t pageProgramJob;
+static spiJob_t statusJob;
+static bool statusPolling = false;
+static const uint8_t writeEnableCommand = M25P16_INSTRUCTION_WRITE_ENABLE;
+static const uint8_t readStatusCommand[2] = { M25P16_INSTRUCTION_READ_STATUS_REG, 0 };
+static uint8_t statusReply[2];
+#endif
+
 /**
  * Send the given command byte to the device.
  */
@@ -125,14 +167,122 @@ static uint8_t m25p16_readStatus(void)
     return in[1];
 }
 
+#ifdef USE_SPI_DMA_QUEUE
+/*
+ * Advance the page buffers, call regularly from task context. Each call does what can be done without waiting.
+ */
+void m25p16_service(void)
+{
+    if (!pageProgramAsync) {
+        return;
+    }
+
+    if (pageSending) {
+        if (spiIsJobBusy(&writeEnableJob) || spiIsJobBusy(&pageProgramJob)) {
+            return;
+        }
+        pageSending = false;
+        couldBeBusy = true;
+        if (writeEnableJob.state == SPI_JOB_DONE && pageProgramJob.state == SPI_JOB_DONE) {
+            // The page is in the chip, its buffer can be filled again while the chip programs it
+            pageSendIndex ^= 1;
+            pagesQueued--;
+            pageSendAttempts = 0;
+        } else if (++pageSendAttempts >= PAGE_PROGRAM_ATTEMPTS) {
+            // The bus keeps failing, give the buffer back rather than stop logging for good
+            droppedBytes += pageBuffers[pageSendIndex].length - (isLargeFlash ? 5 : 4);
+            pageSendIndex ^= 1;
+            pagesQueued--;
+            pageSendAttempts = 0;
+        }
+        // Otherwise the page is sent again once the chip is ready, programming the bits it already has is harmless
+    }
+
+    if (couldBeBusy) {
+        if (statusPolling) {
+            if (spiIsJobBusy(&statusJob)) {
+                return;
+            }
+            statusPolling = false;
+            couldBeBusy = statusJob.state != SPI_JOB_DONE || (statusReply[1] & M25P16_STATUS_FLAG_WRITE_IN_PROGRESS);
+        }
+        if (couldBeBusy) {
+            statusJob.bus = bus;
+            statusJob.txData = readStatusCommand;
+            statusJob.rxData = statusReply;
+            statusJob.length = sizeof(readStatusCommand);
+            statusPolling = spiJobQueue(&statusJob);
+            return;
+        }
+    }
+
+    if (pagesQueued > 0) {
+        m25p16PageBuffer_t *page = &pageBuffers[pageSendIndex];
+
+        writeEnableJob.bus = bus;
+        writeEnableJob.txData = &writeEnableCommand;
+        writeEnableJob.length = 1;
+        if (!spiJobQueue(&writeEnableJob)) {
+            // The page stays queued and is tried again by the next call
+            return;
+        }
+
+        pageProgramJob.bus = bus;
+        pageProgramJob.txData = page->data;
+        pageProgramJob.length = page->length;
+        if (!spiJobQueue(&pageProgramJob)) {
+            // Only the write enable went out, the chip isn't busy and the next call starts over
+            return;
+        }
+        pageSending = true;
+    }
+}
+#else
+void m25p16_service(void)
+{
+}
+#endif
+
+/*
+ * Bytes that were accepted by a page program but never reached the chip because the bus kept failing.
+ */
+uint32_t m25p16_getDroppedBytes(void)
+{
+#ifdef USE_SPI_DMA_QUEUE
+    return droppedBytes;
+#else
+    return 0;
+#endif
+}
+
 bool m25p16_isReady(void)
 {
+#ifdef USE_SPI_DMA_QUEUE
+    if (pageProgramAsync) {
+        m25p16_service();
+        return pagesQueued == 0 && !couldBeBusy;
+    }
+#endif
     // If couldBeBusy is false, don't bother to poll the flash chip for its status
     couldBeBusy = couldBeBusy && ((m25p16_readStatus() & M25P16_STATUS_FLAG_WRITE_IN_PROGRESS) != 0);
 
     return !couldBeBusy;
 }
 
+/*
+ * True if a page program can begin without waiting, always the case when the flash is ready.
+ */
+bool m25p16_isPageBufferFree(void)
+{
+#ifdef USE_SPI_DMA_QUEUE
+    if (pageProgramAsync) {
+        m25p16_service();
+        return pagesQueued < 2;
+    }
+#endif
+    return m25p16_isReady();
+}
+
 bool m25p16_waitForReady(uint32_t timeoutMillis)
 {
     uint32_t time = millis();
@@ -145,6 +295,21 @@ bool m25p16_waitForReady(uint32_t timeoutMillis)
     return true;
 }
 
+/*
+ * Wait as long as a page program can take for m25p16_pageProgramBegin() to be able to start one.
+ */
+bool m25p16_waitForPageBuffer(void)
+{
+    uint32_t time = millis();
+    while (!m25p16_isPageBufferFree()) {
+        if (millis() - time > DEFAULT_TIMEOUT_MILLIS) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 /**
  * Read chip identification and geometry information (into global `geometry`).
  *
@@ -262,6 +427,11 @@ bool m25p16_init(const flashConfig_t *flashConfig)
     spiSetDivisor(bus->busdev_u.spi.instance, SPI_CLOCK_FAST);
 #endif
 
+#ifdef USE_SPI_DMA_QUEUE
+    pageProgramAsync = spiBusHasJobDma(bus->busdev_u.spi.instance);
+    droppedBytes = 0;
+#endif
+
     return m25p16_readIdentification();
 }
 
@@ -304,29 +474,71 @@ void m25p16_eraseCompletely(void)
     m25p16_performOneByteCommand(M25P16_INSTRUCTION_BULK_ERASE);
 }
 
-void m25p16_pageProgramBegin(uint32_t address)
+/*
+ * Start a page program if it can be done without waiting, see m25p16_waitForPageBuffer(). Returns false otherwise,
+ * in which case the caller must not continue or finish the program.
+ */
+bool m25p16_pageProgramBegin(uint32_t address)
 {
+    if (!m25p16_isPageBufferFree()) {
+        return false;
+    }
+
     address = TRANSLATE_ADDR(address);
 
     uint8_t command[5] = { M25P16_INSTRUCTION_PAGE_PROGRAM };
     m25p16_setCommandAddress(&command[1], address, isLargeFlash);
 
-    m25p16_waitForReady(DEFAULT_TIMEOUT_MILLIS);
+#ifdef USE_SPI_DMA_QUEUE
+    if (pageProgramAsync) {
+        // The chip needn't be ready, only a page buffer must be free
+        pageFillValid = true;
+        pageFillIndex = (pageSendIndex + pagesQueued) & 1;
+        m25p16PageBuffer_t *page = &pageBuffers[pageFillIndex];
+        page->length = isLargeFlash ? 5 : 4;
+        memcpy(page->data, command, page->length);
+        return true;
+    }
+#endif
 
     m25p16_writeEnable();
 
     ENABLE_M25P16;
 
     spiTransfer(bus->busdev_u.spi.instance, command, NULL, isLargeFlash ? 5 : 4);
+
+    return true;
 }
 
 void m25p16_pageProgramContinue(const uint8_t *data, int length)
 {
+#ifdef USE_SPI_DMA_QUEUE
+    if (pageProgramAsync) {
+        if (!pageFillValid) {
+            return;
+        }
+        m25p16PageBuffer_t *page = &pageBuffers[pageFillIndex];
+        length = MIN(length, (int)sizeof(page->data) - page->length);
+        memcpy(page->data + page->length, data, length);
+        page->length += length;
+        return;
+    }
+#endif
     spiTransfer(bus->busdev_u.spi.instance, data, NULL, length);
 }
 
 void m25p16_pageProgramFinish(void)
 {
+#ifdef USE_SPI_DMA_QUEUE
+    if (pageProgramAsync) {
+        if (pageFillValid) {
+            pagesQueued++;
+            pageFillValid = false;
+        }
+        m25p16_service();
+        return;
+    }
+#endif
     DISABLE_M25P16;
 }
 
@@ -337,7 +549,9 @@ void m25p16_pageProgramFinish(void)
  *
  * Length must be smaller than the page size.
  *
- * This will wait for the flash to become ready before writing begins.
+ * This will wait for the flash to become ready before writing begins, and returns false without writing if it
+ * doesn't in time. When the bus has DMA it only waits for one of the two page buffers to be free, the page is sent
+ * and programmed in the background by m25p16_service().
  *
  * Datasheet indicates typical programming time is 0.8ms for 256 bytes, 0.2ms for 64 bytes, 0.05ms for 16 bytes.
  * (Although the maximum possible write time is noted as 5ms).
@@ -345,14 +559,17 @@ void m25p16_pageProgramFinish(void)
  * If you want to write multiple buffers (whose sum of sizes is still not more than the page size) then you can
  * break this operation up into one beginProgram call, one or more continueProgram calls, and one finishProgram call.
  */
-void m25p16_pageProgram(uint32_t address, const uint8_t *data, int length)
+bool m25p16_pageProgram(uint32_t address, const uint8_t *data, int length)
 {
-    address = TRANSLATE_ADDR(address);
-    m25p16_pageProgramBegin(address);
+    if (!m25p16_waitForPageBuffer() || !m25p16_pageProgramBegin(address)) {
+        return false;
+    }
 
     m25p16_pageProgramContinue(data, length);
 
     m25p16_pageProgramFinish();
+
+    return true;
 }
 
 /**
@@ -0,0 +1,106 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/axis.h"
+#include "common/time.h"
+
+/*
+ * Single producer, single consumer ring of raw gyro samples.
+ *
+ * The producer is the gyro data ready interrupt, the consumer is the gyro task. Only the producer writes head
+ * and overruns and only the consumer writes tail, so no locking is needed on a single core. When the ring is
+ * full the newest sample is dropped, the consumer never sees a partially written slot.
+ */
+
+#define GYRO_SAMPLE_RING_SIZE 16    // must be a power of 2, 500us of samples at 32kHz
+
+typedef struct gyroSample_s {
+    int16_t adcRaw[XYZ_AXIS_COUNT];
+    timeUs_t timeUs;
+} gyroSample_t;
+
+typedef struct gyroSampleRing_s {
+    volatile uint8_t head;          // next slot to write, producer only
+    volatile uint8_t tail;          // next slot to read, consumer only
+    volatile uint16_t overruns;     // samples dropped because the ring was full, producer only
+    gyroSample_t sample[GYRO_SAMPLE_RING_SIZE];
+} gyroSampleRing_t;
+
+// stops the compiler from moving slot accesses across the index update, a Cortex-M core sees its own stores in order
+#define GYRO_SAMPLE_RING_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+static inline void gyroSampleRingInit(gyroSampleRing_t *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->overruns = 0;
+}
+
+static inline uint8_t gyroSampleRingCount(const gyroSampleRing_t *ring)
+{
+    return (uint8_t)(ring->head - ring->tail) & (GYRO_SAMPLE_RING_SIZE - 1);
+}
+
+// returns a slot to fill, or NULL if the ring is full; the slot is published by gyroSampleRingCommit
+static inline gyroSample_t *gyroSampleRingReserve(gyroSampleRing_t *ring)
+{
+    const uint8_t head = ring->head;
+    if (((head + 1) & (GYRO_SAMPLE_RING_SIZE - 1)) == ring->tail) {
+        ring->overruns++;
+        return NULL;
+    }
+    return &ring->sample[head];
+}
+
+static inline void gyroSampleRingCommit(gyroSampleRing_t *ring)
+{
+    GYRO_SAMPLE_RING_BARRIER();
+    ring->head = (ring->head + 1) & (GYRO_SAMPLE_RING_SIZE - 1);
+}
+
+static inline bool gyroSampleRingPush(gyroSampleRing_t *ring, const int16_t *adcRaw, timeUs_t timeUs)
+{
+    gyroSample_t *sample = gyroSampleRingReserve(ring);
+    if (!sample) {
+        return false;
+    }
+    sample->adcRaw[X] = adcRaw[X];
+    sample->adcRaw[Y] = adcRaw[Y];
+    sample->adcRaw[Z] = adcRaw[Z];
+    sample->timeUs = timeUs;
+    gyroSampleRingCommit(ring);
+    return true;
+}
+
+static inline bool gyroSampleRingPop(gyroSampleRing_t *ring, gyroSample_t *sample)
+{
+    const uint8_t tail = ring->tail;
+    if (tail == ring->head) {
+        return false;
+    }
+    GYRO_SAMPLE_RING_BARRIER();
+    *sample = ring->sample[tail];
+    GYRO_SAMPLE_RING_BARRIER();
+    ring->tail = (tail + 1) & (GYRO_SAMPLE_RING_SIZE - 1);
+    return true;
+}
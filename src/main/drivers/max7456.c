@@ -32,6 +32,7 @@
 #include "config/parameter_group_ids.h"
 
 #include "drivers/bus_spi.h"
+#include "drivers/bus_spi_queue.h"
 #include "drivers/dma.h"
 #include "drivers/io.h"
 #include "drivers/light_led.h"
@@ -163,16 +164,22 @@
 
 // On shared SPI buss we want to change clock for OSD chip and restore for other devices.
 
+#ifdef USE_SPI_DMA_QUEUE
+    #define MAX7456_WAIT_SPI_JOBS spiWaitJobsComplete(MAX7456_SPI_INSTANCE);
+#else
+    #define MAX7456_WAIT_SPI_JOBS
+#endif
+
 #ifdef MAX7456_SPI_CLK
-    #define ENABLE_MAX7456        {spiSetDivisor(MAX7456_SPI_INSTANCE, max7456SpiClock);IOLo(max7456CsPin);}
+    #define ENABLE_MAX7456        {MAX7456_WAIT_SPI_JOBS max7456Basepri = spiBusTransactionBegin(MAX7456_SPI_INSTANCE);spiSetDivisor(MAX7456_SPI_INSTANCE, max7456SpiClock);IOLo(max7456CsPin);}
 #else
-    #define ENABLE_MAX7456        IOLo(max7456CsPin)
+    #define ENABLE_MAX7456        {MAX7456_WAIT_SPI_JOBS max7456Basepri = spiBusTransactionBegin(MAX7456_SPI_INSTANCE);IOLo(max7456CsPin);}
 #endif
 
 #ifdef MAX7456_RESTORE_CLK
-    #define DISABLE_MAX7456       {IOHi(max7456CsPin);spiSetDivisor(MAX7456_SPI_INSTANCE, MAX7456_RESTORE_CLK);}
+    #define DISABLE_MAX7456       {IOHi(max7456CsPin);spiSetDivisor(MAX7456_SPI_INSTANCE, MAX7456_RESTORE_CLK);spiBusTransactionEnd(max7456Basepri);}
 #else
-    #define DISABLE_MAX7456       IOHi(max7456CsPin)
+    #define DISABLE_MAX7456       {IOHi(max7456CsPin);spiBusTransactionEnd(max7456Basepri);}
 #endif
 
 #ifndef MAX7456_SPI_CLK
@@ -199,6 +206,12 @@ volatile bool dmaTransactionInProgress = false;
 
 static uint8_t spiBuff[MAX_CHARS2UPDATE*6];
 
+#if defined(USE_SPI_DMA_QUEUE) && !defined(MAX7456_DMA_CHANNEL_TX)
+// screen updates are queued on the SPI bus when it has DMA
+static busDevice_t max7456Bus;
+static spiJob_t max7456Job;
+#endif
+
 static uint8_t  videoSignalCfg;
 static uint8_t  videoSignalReg  = OSD_ENABLE; // OSD_ENABLE required to trigger first ReInit
 static uint8_t  displayMemoryModeReg = 0;
@@ -209,6 +222,7 @@ static uint8_t  vosRegValue; // VOS (Vertical offset register) value
 static bool  max7456Lock        = false;
 static bool fontIsLoading       = false;
 static IO_t max7456CsPin        = IO_NONE;
+static uint8_t max7456Basepri;
 
 static uint8_t max7456DeviceType;
 
@@ -226,6 +240,15 @@ static uint8_t max7456Send(uint8_t add, uint8_t data)
     return spiTransferByte(MAX7456_SPI_INSTANCE, data);
 }
 
+#if defined(USE_SPI_DMA_QUEUE) && !defined(MAX7456_DMA_CHANNEL_TX) && defined(MAX7456_RESTORE_CLK)
+static void max7456JobComplete(spiJob_t *job)
+{
+    UNUSED(job);
+    // called before the next job starts, give the other devices on the bus their clock back
+    spiSetDivisor(MAX7456_SPI_INSTANCE, MAX7456_RESTORE_CLK);
+}
+#endif
+
 #ifdef MAX7456_DMA_CHANNEL_TX
 static void max7456SendDma(void* tx_buffer, void* rx_buffer, uint16_t buffer_size)
 {
@@ -425,6 +448,16 @@ void max7456Init(const vcdProfile_t *pVcdProfile)
     IOInit(max7456CsPin, OWNER_OSD_CS, 0);
     IOConfigGPIO(max7456CsPin, SPI_IO_CS_CFG);
     IOHi(max7456CsPin);
+#if defined(USE_SPI_DMA_QUEUE) && !defined(MAX7456_DMA_CHANNEL_TX)
+    max7456Bus.bustype = BUSTYPE_SPI;
+    max7456Bus.busdev_u.spi.instance = MAX7456_SPI_INSTANCE;
+    max7456Bus.busdev_u.spi.csnPin = max7456CsPin;
+    max7456Job.bus = &max7456Bus;
+    max7456Job.txData = spiBuff;
+#ifdef MAX7456_RESTORE_CLK
+    max7456Job.callback = max7456JobComplete;
+#endif
+#endif
 
     // Detect device type by writing and reading CA[8] bit at CMAL[6].
     // Do this at half the speed for safety.
@@ -541,8 +574,10 @@ void max7456Write(uint8_t x, uint8_t y, const char *buff)
 
 bool max7456DmaInProgress(void)
 {
-#ifdef MAX7456_DMA_CHANNEL_TX
+#if defined(MAX7456_DMA_CHANNEL_TX)
     return dmaTransactionInProgress;
+#elif defined(USE_SPI_DMA_QUEUE)
+    return spiIsJobBusy(&max7456Job);
 #else
     return false;
 #endif
@@ -634,10 +669,20 @@ void max7456DrawScreen(void)
             if (buff_len > 0)
                 max7456SendDma(spiBuff, NULL, buff_len);
             #else
-            ENABLE_MAX7456;
-            for (k=0; k < buff_len; k++)
-                spiTransferByte(MAX7456_SPI_INSTANCE, spiBuff[k]);
-            DISABLE_MAX7456;
+            #ifdef USE_SPI_DMA_QUEUE
+            // the register reads above waited for the previous update, so spiBuff is free again
+            if (spiBusHasJobDma(MAX7456_SPI_INSTANCE)) {
+                max7456Job.length = buff_len;
+                max7456Job.divisor = max7456SpiClock;
+                spiJobQueue(&max7456Job);
+            } else
+            #endif
+            {
+                ENABLE_MAX7456;
+                for (k=0; k < buff_len; k++)
+                    spiTransferByte(MAX7456_SPI_INSTANCE, spiBuff[k]);
+                DISABLE_MAX7456;
+            }
             #endif // MAX7456_DMA_CHANNEL_TX
         }
         max7456Lock = false;
@@ -35,6 +35,12 @@ static pwmCompleteWriteFn *pwmCompleteWrite = NULL;
 #ifdef USE_DSHOT
 loadDmaBufferFn *loadDmaBuffer;
 #endif
+#ifdef USE_DSHOT_DMAR
+bool useBurstDshot = false;
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+bool useDshotTelemetry = false;
+#endif
 
 #ifdef USE_SERVOS
 static pwmOutputPort_t servos[MAX_SUPPORTED_SERVOS];
@@ -137,20 +143,20 @@ static void pwmWriteDshot(uint8_t index, float value)
     pwmWriteDshotInt(index, lrintf(value));
 }
 
-static uint8_t loadDmaBufferDshot(motorDmaOutput_t *const motor, uint16_t packet)
+static uint8_t loadDmaBufferDshot(uint32_t *dmaBuffer, int stride, uint16_t packet)
 {
     for (int i = 0; i < 16; i++) {
-        motor->dmaBuffer[i] = (packet & 0x8000) ? MOTOR_BIT_1 : MOTOR_BIT_0;  // MSB first
+        dmaBuffer[i * stride] = (packet & 0x8000) ? MOTOR_BIT_1 : MOTOR_BIT_0;  // MSB first
         packet <<= 1;
     }
 
     return DSHOT_DMA_BUFFER_SIZE;
 }
 
-static uint8_t loadDmaBufferProshot(motorDmaOutput_t *const motor, uint16_t packet)
+static uint8_t loadDmaBufferProshot(uint32_t *dmaBuffer, int stride, uint16_t packet)
 {
     for (int i = 0; i < 4; i++) {
-        motor->dmaBuffer[i] = PROSHOT_BASE_SYMBOL + ((packet & 0xF000) >> 12) * PROSHOT_BIT_WIDTH;  // Most significant nibble first
+        dmaBuffer[i * stride] = PROSHOT_BASE_SYMBOL + ((packet & 0xF000) >> 12) * PROSHOT_BIT_WIDTH;  // Most significant nibble first
         packet <<= 4;   // Shift 4 bits
     }
 
@@ -207,6 +213,17 @@ static void pwmCompleteOneshotMotorUpdate(uint8_t motorCount)
     }
 }
 
+void pwmStartMotorUpdate(uint8_t motorCount)
+{
+#ifdef USE_DSHOT_TELEMETRY
+    if (useDshotTelemetry) {
+        pwmStartDshotMotorUpdate(motorCount);
+    }
+#else
+    UNUSED(motorCount);
+#endif
+}
+
 void pwmCompleteMotorUpdate(uint8_t motorCount)
 {
     pwmCompleteWrite(motorCount);
@@ -264,6 +281,18 @@ void motorDevInit(const motorDevConfig_t *motorConfig, uint16_t idlePulse, uint8
 #endif
     }
 
+#ifdef USE_DSHOT_TELEMETRY
+    // ProShot has no answer from the ESC
+    useDshotTelemetry = isDshot && motorConfig->useDshotTelemetry && motorConfig->motorPwmProtocol != PWM_TYPE_PROSHOT1000;
+#endif
+#ifdef USE_DSHOT_DMAR
+    // the answers are captured with the DMA stream of each channel, so telemetry needs the per channel streams
+    useBurstDshot = isDshot && motorConfig->useBurstDshot;
+#ifdef USE_DSHOT_TELEMETRY
+    useBurstDshot = useBurstDshot && !useDshotTelemetry;
+#endif
+#endif
+
     if (!isDshot) {
         pwmWrite = &pwmWriteStandard;
         pwmCompleteWrite = useUnsyncedPwm ? &pwmCompleteWriteUnused : &pwmCompleteOneshotMotorUpdate;
@@ -285,10 +314,17 @@ void motorDevInit(const motorDevConfig_t *motorConfig, uint16_t idlePulse, uint8
 
 #ifdef USE_DSHOT
         if (isDshot) {
+            uint8_t output = motorConfig->motorPwmInversion ? timerHardware->output ^ TIMER_OUTPUT_INVERTED : timerHardware->output;
+#ifdef USE_DSHOT_TELEMETRY
+            // bidirectional DShot idles high so the ESC can pull the line low to answer
+            if (useDshotTelemetry) {
+                output ^= TIMER_OUTPUT_INVERTED;
+            }
+#endif
             pwmDshotMotorHardwareConfig(timerHardware,
                 motorIndex,
                 motorConfig->motorPwmProtocol,
-                motorConfig->motorPwmInversion ? timerHardware->output ^ TIMER_OUTPUT_INVERTED : timerHardware->output);
+                output);
             motors[motorIndex].enabled = true;
             continue;
         }
@@ -383,6 +419,7 @@ void pwmWriteDshotCommand(uint8_t index, uint8_t motorCount, uint8_t command)
         }
 
         for (; repeats; repeats--) {
+            pwmStartMotorUpdate(motorCount);
             for (uint8_t i = 0; i < motorCount; i++) {
                 if ((i == index) || (index == ALL_MOTORS)) {
                     motorDmaOutput_t *const motor = getMotorDmaOutput(i);
@@ -412,6 +449,12 @@ uint16_t prepareDshotPacket(motorDmaOutput_t *const motor, const uint16_t value)
         csum ^=  csum_data;   // xor data by nibbles
         csum_data >>= 4;
     }
+#ifdef USE_DSHOT_TELEMETRY
+    // an inverted checksum asks the ESC for an eRPM answer
+    if (useDshotTelemetry) {
+        csum = ~csum;
+    }
+#endif
     csum &= 0xf;
     // append checksum
     packet = (packet << 4) | csum;
@@ -19,6 +19,7 @@
 
 #include "platform.h"
 
+#include "drivers/dshot_burst.h"
 #include "drivers/io_types.h"
 #include "drivers/pwm_output_counts.h"
 #include "drivers/timer.h"
@@ -143,21 +144,51 @@ typedef enum {
 #define DSHOT_DMA_BUFFER_SIZE   18 /* resolution + frame reset (2us) */
 #define PROSHOT_DMA_BUFFER_SIZE 6  /* resolution + frame reset (2us) */
 
+
+#ifdef USE_DSHOT_TELEMETRY
+#define DSHOT_TELEMETRY_INPUT_LEN   32 /* edges captured from an eRPM response, 21 bits have at most 22 */
+#define DSHOT_DMA_BUFFER_ALLOC_SIZE DSHOT_TELEMETRY_INPUT_LEN
+#else
+#define DSHOT_DMA_BUFFER_ALLOC_SIZE DSHOT_DMA_BUFFER_SIZE
+#endif
+
 typedef struct {
     TIM_TypeDef *timer;
+#ifdef USE_DSHOT_DMAR
+    DMA_Stream_TypeDef *dmaBurstStream; // update stream owned by the timer, NULL if none was free
+    DMA_Stream_TypeDef *dmaBurstRef;    // dmaBurstStream while the motors can be sent in a burst, else NULL
+    dshotBurst_t dmaBurst;
+    uint16_t dmaBurstLength;
+    uint32_t dmaBurstBuffer[DSHOT_DMA_BUFFER_SIZE * DSHOT_BURST_MAX_CHANNELS];
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+    uint16_t outputPeriod;
+    volatile uint16_t outputPending;    // DMA sources of the channels still sending their frame
+#endif
     uint16_t timerDmaSources;
 } motorDmaTimer_t;
 
 typedef struct {
     ioTag_t ioTag;
     const timerHardware_t *timerHardware;
+#if defined(USE_DSHOT_DMAR) || defined(USE_DSHOT_TELEMETRY)
+    motorDmaTimer_t *timer;
+#endif
     uint16_t value;
     uint16_t timerDmaSource;
     volatile bool requestTelemetry;
+#ifdef USE_DSHOT_TELEMETRY
+    bool hasTelemetry;                  // false on complementary outputs, they can't capture
+    volatile bool isInput;
+    uint16_t dshotTelemetryValue;       // last valid eRPM / 100
+    uint16_t dshotTelemetryErrors;
+    TIM_OCInitTypeDef ocInitStruct;
+    DMA_InitTypeDef dmaInitStruct;
+#endif
 #if defined(STM32F3) || defined(STM32F4) || defined(STM32F7)
-    uint32_t dmaBuffer[DSHOT_DMA_BUFFER_SIZE];
+    uint32_t dmaBuffer[DSHOT_DMA_BUFFER_ALLOC_SIZE];
 #else
-    uint8_t dmaBuffer[DSHOT_DMA_BUFFER_SIZE];
+    uint8_t dmaBuffer[DSHOT_DMA_BUFFER_ALLOC_SIZE];
 #endif
 #if defined(STM32F7)
     TIM_HandleTypeDef TimHandle;
@@ -191,6 +222,8 @@ typedef struct motorDevConfig_s {
     uint8_t  motorPwmProtocol;              // Pwm Protocol
     uint8_t  motorPwmInversion;             // Active-High vs Active-Low. Useful for brushed FCs converted for brushless operation
     uint8_t  useUnsyncedPwm;
+    uint8_t  useBurstDshot;                 // send the frames of all motors on a timer with one DMA burst
+    uint8_t  useDshotTelemetry;             // bidirectional DShot, read the eRPM answer after every frame
     ioTag_t  ioTags[MAX_SUPPORTED_MOTORS];
 } motorDevConfig_t;
 
@@ -210,17 +243,31 @@ void pwmServoConfig(const struct timerHardware_s *timerHardware, uint8_t servoIn
 bool isMotorProtocolDshot(void);
 
 #ifdef USE_DSHOT
-typedef uint8_t loadDmaBufferFn(motorDmaOutput_t *const motor, uint16_t packet);  // function pointer used to encode a digital motor value into the DMA buffer representation
+typedef uint8_t loadDmaBufferFn(uint32_t *dmaBuffer, int stride, uint16_t packet);  // function pointer used to encode a digital motor value into the DMA buffer representation
 
 uint16_t prepareDshotPacket(motorDmaOutput_t *const motor, uint16_t value);
 
 extern loadDmaBufferFn *loadDmaBuffer;
+#ifdef USE_DSHOT_DMAR
+extern bool useBurstDshot;
+uint8_t pwmDshotTimerCount(void);
+uint8_t pwmDshotBurstTimerCount(void);
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+extern bool useDshotTelemetry;
+#endif
 
 uint32_t getDshotHz(motorPwmProtocolTypes_e pwmProtocolType);
 void pwmWriteDshotCommand(uint8_t index, uint8_t motorCount, uint8_t command);
 void pwmWriteDshotInt(uint8_t index, uint16_t value);
 void pwmDshotMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, motorPwmProtocolTypes_e pwmProtocolType, uint8_t output);
 void pwmCompleteDshotMotorUpdate(uint8_t motorCount);
+#ifdef USE_DSHOT_TELEMETRY
+void pwmStartDshotMotorUpdate(uint8_t motorCount);
+uint16_t getDshotTelemetry(uint8_t index);
+uint16_t getDshotTelemetryErrors(uint8_t index);
+bool isDshotTelemetryActive(void);
+#endif
 #endif
 
 #ifdef BEEPER
@@ -230,6 +277,7 @@ void beeperPwmInit(const ioTag_t tag, uint16_t frequency);
 #endif
 void pwmOutConfig(timerChannel_t *channel, const timerHardware_t *timerHardware, uint32_t hz, uint16_t period, uint16_t value, uint8_t inversion);
 
+void pwmStartMotorUpdate(uint8_t motorCount);
 void pwmWriteMotor(uint8_t index, float value);
 void pwmShutdownPulsesForAllMotors(uint8_t motorCount);
 void pwmCompleteMotorUpdate(uint8_t motorCount);
@@ -16,12 +16,17 @@
  */
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include "platform.h"
 
 #ifdef USE_DSHOT
 
+#include "common/maths.h"
+#include "common/utils.h"
+
+#include "drivers/dshot_telemetry.h"
 #include "drivers/io.h"
 #include "timer.h"
 #if defined(STM32F4)
@@ -33,16 +38,71 @@
 #include "drivers/nvic.h"
 #include "dma.h"
 #include "rcc.h"
+#include "resource.h"
 
 static uint8_t dmaMotorTimerCount = 0;
 static motorDmaTimer_t dmaMotorTimers[MAX_DMA_TIMERS];
 static motorDmaOutput_t dmaMotors[MAX_SUPPORTED_MOTORS];
 
+#ifdef USE_DSHOT_TELEMETRY
+static uint8_t dmaMotorCount = 0;
+static uint32_t dshotTelemetryBitTicks;
+#endif
+
+#ifdef USE_DSHOT_DMAR
+typedef struct timerUpDma_s {
+    TIM_TypeDef *timer;
+    DMA_Stream_TypeDef *stream;
+    uint32_t channel;
+} timerUpDma_t;
+
+// update request of each timer, the streams are picked to stay clear of the SPI and LED strip streams of the F4 targets.
+// TIM4 and TIM5 share a stream, so only the first of them to be configured gets a burst.
+static const timerUpDma_t timerUpDma[] = {
+    { TIM1, DMA2_Stream5, DMA_Channel_6 },
+    { TIM2, DMA1_Stream7, DMA_Channel_3 },
+    { TIM3, DMA1_Stream2, DMA_Channel_5 },
+    { TIM4, DMA1_Stream6, DMA_Channel_2 },
+    { TIM5, DMA1_Stream6, DMA_Channel_6 },
+#if defined(TIM8)
+    { TIM8, DMA2_Stream1, DMA_Channel_7 },
+#endif
+};
+
+static const timerUpDma_t *timerUpDmaByTimer(TIM_TypeDef *timer)
+{
+    for (unsigned i = 0; i < ARRAYLEN(timerUpDma); i++) {
+        if (timerUpDma[i].timer == timer) {
+            return &timerUpDma[i];
+        }
+    }
+    return NULL;
+}
+#endif
+
 motorDmaOutput_t *getMotorDmaOutput(uint8_t index)
 {
     return &dmaMotors[index];
 }
 
+#ifdef USE_DSHOT_DMAR
+uint8_t pwmDshotTimerCount(void)
+{
+    return dmaMotorTimerCount;
+}
+
+uint8_t pwmDshotBurstTimerCount(void)
+{
+    uint8_t count = 0;
+    for (int i = 0; i < dmaMotorTimerCount; i++) {
+        if (dmaMotorTimers[i].dmaBurstRef) {
+            count++;
+        }
+    }
+    return count;
+}
+#endif
+
 uint8_t getTimerIndex(TIM_TypeDef *timer)
 {
     for (int i = 0; i < dmaMotorTimerCount; i++) {
@@ -58,23 +118,163 @@ void pwmWriteDshotInt(uint8_t index, uint16_t value)
 {
     motorDmaOutput_t *const motor = &dmaMotors[index];
 
+#ifdef USE_DSHOT_DMAR
+    if (motor->timerHardware && motor->timer->dmaBurstRef) {
+        // every motor on the timer owns one word of each burst, at the offset of its channel in the run
+        const dshotBurst_t *burst = &motor->timer->dmaBurst;
+        const uint16_t packet = prepareDshotPacket(motor, value);
+        const uint8_t bufferOffset = dshotBurstBufferOffset(burst, timerLookupChannelIndex(motor->timerHardware->channel));
+        const uint8_t bufferSize = loadDmaBuffer(&motor->timer->dmaBurstBuffer[bufferOffset], burst->channelCount, packet);
+        motor->timer->dmaBurstLength = dshotBurstLength(burst, bufferSize);
+        return;
+    }
+#endif
+
     if (!motor->timerHardware || !motor->timerHardware->dmaRef) {
         return;
     }
 
     uint16_t packet = prepareDshotPacket(motor, value);
 
-    uint8_t bufferSize = loadDmaBuffer(motor, packet);
+    uint8_t bufferSize = loadDmaBuffer(motor->dmaBuffer, 1, packet);
 
+#ifdef USE_DSHOT_TELEMETRY
+    if (useDshotTelemetry) {
+        motor->timer->outputPending |= motor->timerDmaSource;
+    }
+#endif
     DMA_SetCurrDataCounter(motor->timerHardware->dmaRef, bufferSize);
     DMA_Cmd(motor->timerHardware->dmaRef, ENABLE);
 }
 
+#ifdef USE_DSHOT_TELEMETRY
+static void pwmDshotSetDirectionOutput(motorDmaOutput_t * const motor)
+{
+    const timerHardware_t *timerHardware = motor->timerHardware;
+    DMA_Stream_TypeDef *dmaRef = timerHardware->dmaRef;
+
+    TIM_DMACmd(timerHardware->tim, motor->timerDmaSource, DISABLE);
+    DMA_Cmd(dmaRef, DISABLE);
+    DMA_DeInit(dmaRef);
+
+    timerOCInit(timerHardware->tim, timerHardware->channel, &motor->ocInitStruct);
+    timerOCPreloadConfig(timerHardware->tim, timerHardware->channel, TIM_OCPreload_Enable);
+
+    DMA_Init(dmaRef, &motor->dmaInitStruct);
+    DMA_ITConfig(dmaRef, DMA_IT_TC, ENABLE);
+    motor->isInput = false;
+}
+
+static void pwmDshotSetDirectionInput(motorDmaOutput_t * const motor)
+{
+    const timerHardware_t *timerHardware = motor->timerHardware;
+    DMA_Stream_TypeDef *dmaRef = timerHardware->dmaRef;
+
+    DMA_Cmd(dmaRef, DISABLE);
+    DMA_DeInit(dmaRef);
+
+    TIM_ICInitTypeDef TIM_ICInitStructure;
+    TIM_ICStructInit(&TIM_ICInitStructure);
+    TIM_ICInitStructure.TIM_Channel = timerHardware->channel;
+    TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_BothEdge;
+    TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    TIM_ICInitStructure.TIM_ICFilter = 2;
+    TIM_ICInit(timerHardware->tim, &TIM_ICInitStructure);
+
+    // the stream copies the capture register on every edge, without an interrupt; the edges are read at the next update
+    DMA_InitTypeDef DMA_InitStructure = motor->dmaInitStruct;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+    DMA_InitStructure.DMA_BufferSize = DSHOT_TELEMETRY_INPUT_LEN;
+    DMA_Init(dmaRef, &DMA_InitStructure);
+
+    motor->isInput = true;
+    DMA_Cmd(dmaRef, ENABLE);
+    TIM_DMACmd(timerHardware->tim, motor->timerDmaSource, ENABLE);
+}
+
+// called from the DMA interrupt of the last channel of a timer to finish its frame
+static void pwmDshotTimerSetInput(motorDmaTimer_t *dmaTimer)
+{
+    // let the counter run free while listening so the edge times don't wrap within a response
+    TIM_SetAutoreload(dmaTimer->timer, 0xffff);
+
+    for (int i = 0; i < dmaMotorCount; i++) {
+        motorDmaOutput_t * const motor = &dmaMotors[i];
+        if (motor->timer == dmaTimer && motor->hasTelemetry) {
+            pwmDshotSetDirectionInput(motor);
+        }
+    }
+}
+
+/*
+ * Collects the answers to the previous frames and turns the pins back to outputs, must be called before the motors
+ * are written.
+ */
+void pwmStartDshotMotorUpdate(uint8_t motorCount)
+{
+    for (int i = 0; i < motorCount && i < dmaMotorCount; i++) {
+        motorDmaOutput_t * const motor = &dmaMotors[i];
+        if (!motor->isInput) {
+            continue;
+        }
+
+        DMA_Stream_TypeDef *dmaRef = motor->timerHardware->dmaRef;
+        TIM_DMACmd(motor->timerHardware->tim, motor->timerDmaSource, DISABLE);
+        DMA_Cmd(dmaRef, DISABLE);
+
+        const int edgeCount = DSHOT_TELEMETRY_INPUT_LEN - DMA_GetCurrDataCounter(dmaRef);
+        const uint16_t value = dshotDecodeTelemetryPacket(motor->dmaBuffer, edgeCount, dshotTelemetryBitTicks);
+        if (value != DSHOT_TELEMETRY_INVALID) {
+            motor->dshotTelemetryValue = value;
+        } else {
+            motor->dshotTelemetryErrors++;
+        }
+
+        pwmDshotSetDirectionOutput(motor);
+    }
+
+    for (int i = 0; i < dmaMotorTimerCount; i++) {
+        motorDmaTimer_t * const dmaTimer = &dmaMotorTimers[i];
+        if (dmaTimer->timer->ARR != dmaTimer->outputPeriod) {
+            TIM_SetAutoreload(dmaTimer->timer, dmaTimer->outputPeriod);
+            // load the bit period now rather than at the end of the free running count
+            TIM_GenerateEvent(dmaTimer->timer, TIM_EventSource_Update);
+        }
+    }
+}
+
+uint16_t getDshotTelemetry(uint8_t index)
+{
+    return dmaMotors[index].dshotTelemetryValue;
+}
+
+uint16_t getDshotTelemetryErrors(uint8_t index)
+{
+    return dmaMotors[index].dshotTelemetryErrors;
+}
+
+bool isDshotTelemetryActive(void)
+{
+    return useDshotTelemetry;
+}
+#endif
+
 void pwmCompleteDshotMotorUpdate(uint8_t motorCount)
 {
     UNUSED(motorCount);
 
     for (int i = 0; i < dmaMotorTimerCount; i++) {
+#ifdef USE_DSHOT_DMAR
+        if (dmaMotorTimers[i].dmaBurstRef) {
+            DMA_SetCurrDataCounter(dmaMotorTimers[i].dmaBurstRef, dmaMotorTimers[i].dmaBurstLength);
+            DMA_Cmd(dmaMotorTimers[i].dmaBurstRef, ENABLE);
+            TIM_SetCounter(dmaMotorTimers[i].timer, 0);
+            TIM_DMACmd(dmaMotorTimers[i].timer, TIM_DMA_Update, ENABLE);
+            continue;
+        }
+#endif
         TIM_SetCounter(dmaMotorTimers[i].timer, 0);
         TIM_DMACmd(dmaMotorTimers[i].timer, dmaMotorTimers[i].timerDmaSources, ENABLE);
     }
@@ -87,8 +287,102 @@ static void motor_DMA_IRQHandler(dmaChannelDescriptor_t *descriptor)
         DMA_Cmd(motor->timerHardware->dmaRef, DISABLE);
         TIM_DMACmd(motor->timerHardware->tim, motor->timerDmaSource, DISABLE);
         DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+#ifdef USE_DSHOT_TELEMETRY
+        if (useDshotTelemetry) {
+            motor->timer->outputPending &= ~motor->timerDmaSource;
+            if (!motor->timer->outputPending) {
+                pwmDshotTimerSetInput(motor->timer);
+            }
+        }
+#endif
+    }
+}
+
+#ifdef USE_DSHOT_DMAR
+static void motor_DMA_BurstIRQHandler(dmaChannelDescriptor_t *descriptor)
+{
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF)) {
+        motorDmaTimer_t * const dmaTimer = &dmaMotorTimers[descriptor->userParam];
+        DMA_Cmd(dmaTimer->dmaBurstStream, DISABLE);
+        TIM_DMACmd(dmaTimer->timer, TIM_DMA_Update, DISABLE);
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+    }
+}
+
+/*
+ * Sets up one stream on the update request of the timer to write the motor compare registers through DMAR on every
+ * bit, instead of a stream per channel. Returns false if the timer has no free update stream, its motors then use
+ * their own streams. The registers written are set as the motors are added.
+ */
+static bool pwmDshotBurstConfig(uint8_t timerIndex, uint8_t motorIndex)
+{
+    motorDmaTimer_t * const dmaTimer = &dmaMotorTimers[timerIndex];
+    const timerUpDma_t *upDma = timerUpDmaByTimer(dmaTimer->timer);
+    if (!upDma) {
+        return false;
+    }
+
+    const dmaIdentifier_e identifier = dmaGetIdentifier(upDma->stream);
+    if (dmaGetOwner(identifier) != OWNER_FREE) {
+        return false;
+    }
+
+    dmaInit(identifier, OWNER_MOTOR, RESOURCE_INDEX(motorIndex));
+    dmaSetHandler(identifier, motor_DMA_BurstIRQHandler, NVIC_BUILD_PRIORITY(1, 2), timerIndex);
+
+    DMA_Cmd(upDma->stream, DISABLE);
+    DMA_DeInit(upDma->stream);
+
+    DMA_InitTypeDef DMA_InitStructure;
+    DMA_StructInit(&DMA_InitStructure);
+    DMA_InitStructure.DMA_Channel = upDma->channel;
+    DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)dmaTimer->dmaBurstBuffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+    DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Enable;
+    DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+    DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+    DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&dmaTimer->timer->DMAR;
+    DMA_InitStructure.DMA_BufferSize = 0;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+
+    DMA_Init(upDma->stream, &DMA_InitStructure);
+    DMA_ITConfig(upDma->stream, DMA_IT_TC, ENABLE);
+
+    dmaTimer->dmaBurstStream = upDma->stream;
+    memset(&dmaTimer->dmaBurst, 0, sizeof(dmaTimer->dmaBurst));
+    dmaTimer->dmaBurstLength = 0;
+
+    return true;
+}
+
+static void pwmDshotBurstAddMotor(motorDmaTimer_t *dmaTimer, const timerHardware_t *timerHardware, motorPwmProtocolTypes_e pwmProtocolType)
+{
+    if (!dmaTimer->dmaBurstStream) {
+        return;
+    }
+
+    dshotBurst_t *burst = &dmaTimer->dmaBurst;
+    if (!dshotBurstAddChannel(burst, timerLookupChannelIndex(timerHardware->channel))) {
+        // the burst would write a channel that is not a motor, unless a later motor fills the gap the motors of
+        // this timer are sent on their own streams
+        dmaTimer->dmaBurstRef = NULL;
+        return;
     }
+    dmaTimer->dmaBurstRef = dmaTimer->dmaBurstStream;
+
+    // DBA is the offset of the first register written from CR1 in words, DBL the number of registers less one
+    TIM_DMAConfig(dmaTimer->timer,
+        TIM_DMABase_CCR1 + burst->firstChannel * (TIM_DMABase_CCR2 - TIM_DMABase_CCR1),
+        TIM_DMABurstLength_1Transfer + (burst->channelCount - 1) * (TIM_DMABurstLength_2Transfers - TIM_DMABurstLength_1Transfer));
+    dmaTimer->dmaBurstLength = dshotBurstLength(burst, pwmProtocolType == PWM_TYPE_PROSHOT1000 ? PROSHOT_DMA_BUFFER_SIZE : DSHOT_DMA_BUFFER_SIZE);
 }
+#endif
 
 void pwmDshotMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t motorIndex, motorPwmProtocolTypes_e pwmProtocolType, uint8_t output)
 {
@@ -103,6 +397,12 @@ void pwmDshotMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t m
 
     const uint8_t timerIndex = getTimerIndex(timer);
     const bool configureTimer = (timerIndex == dmaMotorTimerCount-1);
+#if defined(USE_DSHOT_DMAR) || defined(USE_DSHOT_TELEMETRY)
+    motor->timer = &dmaMotorTimers[timerIndex];
+#endif
+#ifdef USE_DSHOT_TELEMETRY
+    dmaMotorCount = MAX(dmaMotorCount, motorIndex + 1);
+#endif
 
     IOInit(motorIO, OWNER_MOTOR, RESOURCE_INDEX(motorIndex));
     IOConfigGPIOAF(motorIO, IO_CONFIG(GPIO_Mode_AF, GPIO_Speed_50MHz, GPIO_OType_PP, GPIO_PuPd_UP), timerHardware->alternateFunction);
@@ -120,6 +420,10 @@ void pwmDshotMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t m
         TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
         TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
         TIM_TimeBaseInit(timer, &TIM_TimeBaseStructure);
+#ifdef USE_DSHOT_TELEMETRY
+        dmaMotorTimers[timerIndex].outputPeriod = TIM_TimeBaseStructure.TIM_Period;
+        dshotTelemetryBitTicks = DSHOT_TELEMETRY_BIT_TICKS(TIM_TimeBaseStructure.TIM_Period + 1);
+#endif
     }
 
     TIM_OCStructInit(&TIM_OCInitStructure);
@@ -146,8 +450,18 @@ void pwmDshotMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t m
         TIM_CtrlPWMOutputs(timer, ENABLE);
         TIM_ARRPreloadConfig(timer, ENABLE);
         TIM_Cmd(timer, ENABLE);
+#ifdef USE_DSHOT_DMAR
+        if (useBurstDshot) {
+            pwmDshotBurstConfig(timerIndex, motorIndex);
+        }
+#endif
     }
 
+#ifdef USE_DSHOT_DMAR
+    // the channel stream is still set up, it carries the frames if the timer cannot burst
+    pwmDshotBurstAddMotor(motor->timer, timerHardware, pwmProtocolType);
+#endif
+
 #if defined(STM32F3)
     DMA_Channel_TypeDef *dmaRef = timerHardware->dmaRef;
 #elif defined(STM32F4)
@@ -191,6 +505,13 @@ void pwmDshotMotorHardwareConfig(const timerHardware_t *timerHardware, uint8_t m
 
     DMA_Init(dmaRef, &DMA_InitStructure);
     DMA_ITConfig(dmaRef, DMA_IT_TC, ENABLE);
+
+#ifdef USE_DSHOT_TELEMETRY
+    // the direction is switched on every frame, keep what it takes to set up the output again
+    motor->ocInitStruct = TIM_OCInitStructure;
+    motor->dmaInitStruct = DMA_InitStructure;
+    motor->hasTelemetry = useDshotTelemetry && !(output & TIMER_OUTPUT_N_CHANNEL);
+#endif
 }
 
 #endif
@@ -59,7 +59,7 @@ void pwmWriteDshotInt(uint8_t index, uint16_t value)
 
     uint16_t packet = prepareDshotPacket(motor, value);
 
-    uint8_t bufferSize = loadDmaBuffer(motor, packet);
+    uint8_t bufferSize = loadDmaBuffer(motor->dmaBuffer, 1, packet);
 
     if (DMA_SetCurrDataCounter(&motor->TimHandle, motor->timerHardware->channel, motor->dmaBuffer, bufferSize) != HAL_OK) {
         /* DMA set error */
@@ -61,8 +61,8 @@ uint16_t XN297_UnscramblePayload(uint8_t *data, int len, const uint8_t *rxAddr)
             crc = crc16_ccitt(crc, rxAddr[RX_TX_ADDR_LEN - 1 - ii]);
         }
     }
+    crc = crc16_ccitt_update(crc, data, len);
     for (int ii = 0; ii < len; ++ii) {
-        crc = crc16_ccitt(crc, data[ii]);
         data[ii] = bitReverse(data[ii] ^ xn297_data_scramble[ii]);
     }
     crc ^= xn297_crc_xorout[len];
@@ -72,16 +72,14 @@ uint16_t XN297_UnscramblePayload(uint8_t *data, int len, const uint8_t *rxAddr)
 uint8_t XN297_WritePayload(uint8_t *data, int len, const uint8_t *rxAddr)
 {
     uint8_t packet[NRF24L01_MAX_PAYLOAD_SIZE];
-    uint16_t crc = 0xb5d2;
     for (int ii = 0; ii < RX_TX_ADDR_LEN; ++ii) {
         packet[ii] = rxAddr[RX_TX_ADDR_LEN - 1 - ii];
-        crc = crc16_ccitt(crc, packet[ii]);
     }
     for (int ii = 0; ii < len; ++ii) {
         const uint8_t bOut = bitReverse(data[ii]);
         packet[ii + RX_TX_ADDR_LEN] = bOut ^ xn297_data_scramble[ii];
-        crc = crc16_ccitt(crc, packet[ii + RX_TX_ADDR_LEN]);
     }
+    uint16_t crc = crc16_ccitt_update(0xb5d2, packet, RX_TX_ADDR_LEN + len);
     crc ^= xn297_crc_xorout[len];
     packet[RX_TX_ADDR_LEN + len] = crc >> 8;
     packet[RX_TX_ADDR_LEN + len + 1] = crc & 0xff;
@@ -0,0 +1,420 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_SDCARD_SIM
+
+#include "common/time.h"
+#include "common/utils.h"
+
+#include "drivers/time.h"
+
+#include "sdcard.h"
+#include "sdcard_sim.h"
+
+#define SDCARD_BLOCK_SIZE 512
+
+// A class 10 card on a 21MHz SPI bus
+#define SDCARD_SIM_DEFAULT_READ_LATENCY_US          400
+#define SDCARD_SIM_DEFAULT_WRITE_TRANSFER_US        250
+#define SDCARD_SIM_DEFAULT_WRITE_BUSY_US            800
+#define SDCARD_SIM_DEFAULT_MULTI_WRITE_BUSY_US      100
+
+/*
+ * Same states as the SPI driver, the ones it only goes through while initialising the card are left out since the
+ * image is ready as soon as it is opened.
+ */
+typedef enum {
+    SDCARD_SIM_STATE_NOT_PRESENT = 0,
+    SDCARD_SIM_STATE_READY,
+    SDCARD_SIM_STATE_READING,
+    SDCARD_SIM_STATE_SENDING_WRITE,
+    SDCARD_SIM_STATE_WAITING_FOR_WRITE,
+    SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS,
+    SDCARD_SIM_STATE_STOPPING_MULTIPLE_BLOCK_WRITE
+} sdcardSimState_e;
+
+typedef struct sdcardSim_t {
+    struct {
+        uint8_t *buffer;
+        uint32_t blockIndex;
+
+        sdcard_operationCompleteCallback_c callback;
+        uint32_t callbackData;
+
+        timeUs_t startTime;
+    } pendingOperation;
+
+    FILE *image;
+    sdcardSimConfig_t config;
+
+    sdcardSimState_e state;
+    timeUs_t busyUntil;     // the current state ends at this time
+
+    uint32_t multiWriteNextBlock;
+    uint32_t multiWriteBlocksRemain;
+    uint32_t blocksSinceStall;
+
+    sdcardMetadata_t metadata;
+    sdcardSimStatistics_t statistics;
+
+    sdcard_profilerCallback_c profiler;
+} sdcardSim_t;
+
+static sdcardSim_t sdcardSim;
+
+static const sdcardSimConfig_t sdcardSimDefaultConfig = {
+    .readLatencyUs = SDCARD_SIM_DEFAULT_READ_LATENCY_US,
+    .writeTransferUs = SDCARD_SIM_DEFAULT_WRITE_TRANSFER_US,
+    .writeBusyUs = SDCARD_SIM_DEFAULT_WRITE_BUSY_US,
+    .multiWriteBusyUs = SDCARD_SIM_DEFAULT_MULTI_WRITE_BUSY_US,
+    .stallIntervalBlocks = 0,
+    .stallUs = 0,
+};
+
+/**
+ * Attach the image file at the given path as the card. Pass NULL for the config to get the timing of a typical card.
+ */
+bool sdcardSim_open(const char *imagePath, const sdcardSimConfig_t *config)
+{
+    sdcardSim_close();
+
+    sdcardSim.config = config ? *config : sdcardSimDefaultConfig;
+
+    sdcardSim.image = fopen(imagePath, "r+b");
+    if (!sdcardSim.image) {
+        return false;
+    }
+
+    fseek(sdcardSim.image, 0, SEEK_END);
+    const long imageSize = ftell(sdcardSim.image);
+
+    if (imageSize < SDCARD_BLOCK_SIZE) {
+        sdcardSim_close();
+        return false;
+    }
+
+    memset(&sdcardSim.metadata, 0, sizeof(sdcardSim.metadata));
+    sdcardSim.metadata.numBlocks = imageSize / SDCARD_BLOCK_SIZE;
+    memcpy(sdcardSim.metadata.productName, "SIMSD", sizeof(sdcardSim.metadata.productName));
+    sdcardSim.metadata.productionYear = 2017;
+    sdcardSim.metadata.productionMonth = 1;
+
+    sdcardSim.state = SDCARD_SIM_STATE_READY;
+    sdcardSim.multiWriteBlocksRemain = 0;
+    sdcardSim.blocksSinceStall = 0;
+    sdcardSim_resetStatistics();
+
+    return true;
+}
+
+void sdcardSim_close(void)
+{
+    if (sdcardSim.image) {
+        fclose(sdcardSim.image);
+        sdcardSim.image = NULL;
+    }
+    sdcardSim.state = SDCARD_SIM_STATE_NOT_PRESENT;
+}
+
+const sdcardSimStatistics_t *sdcardSim_getStatistics(void)
+{
+    return &sdcardSim.statistics;
+}
+
+void sdcardSim_resetStatistics(void)
+{
+    memset(&sdcardSim.statistics, 0, sizeof(sdcardSim.statistics));
+}
+
+static bool sdcardSim_transferBlock(uint32_t blockIndex, uint8_t *buffer, bool write)
+{
+    if (blockIndex >= sdcardSim.metadata.numBlocks || fseek(sdcardSim.image, (long)blockIndex * SDCARD_BLOCK_SIZE, SEEK_SET) != 0) {
+        return false;
+    }
+
+    if (write) {
+        return fwrite(buffer, SDCARD_BLOCK_SIZE, 1, sdcardSim.image) == 1;
+    } else {
+        return fread(buffer, SDCARD_BLOCK_SIZE, 1, sdcardSim.image) == 1;
+    }
+}
+
+/**
+ * How long the card stays busy programming the block that was just sent.
+ */
+static uint32_t sdcardSim_programTimeUs(void)
+{
+    uint32_t busyUs = sdcardSim.multiWriteBlocksRemain > 0 ? sdcardSim.config.multiWriteBusyUs : sdcardSim.config.writeBusyUs;
+
+    if (sdcardSim.config.stallIntervalBlocks && ++sdcardSim.blocksSinceStall >= sdcardSim.config.stallIntervalBlocks) {
+        sdcardSim.blocksSinceStall = 0;
+        sdcardSim.statistics.stalls++;
+        busyUs += sdcardSim.config.stallUs;
+    }
+
+    sdcardSim.statistics.busyUs += busyUs;
+
+    return busyUs;
+}
+
+static bool sdcardSim_isReady(void)
+{
+    return sdcardSim.state == SDCARD_SIM_STATE_READY || sdcardSim.state == SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS;
+}
+
+static sdcardOperationStatus_e sdcardSim_endWriteBlocks(void)
+{
+    sdcardSim.multiWriteBlocksRemain = 0;
+
+    // The card programs the last block again after the stop token
+    sdcardSim.state = SDCARD_SIM_STATE_STOPPING_MULTIPLE_BLOCK_WRITE;
+    sdcardSim.busyUntil = micros() + sdcardSim.config.multiWriteBusyUs;
+
+    if (sdcardSim.config.multiWriteBusyUs == 0) {
+        sdcardSim.state = SDCARD_SIM_STATE_READY;
+        return SDCARD_OPERATION_SUCCESS;
+    }
+
+    return SDCARD_OPERATION_IN_PROGRESS;
+}
+
+void sdcardInsertionDetectDeinit(void)
+{
+}
+
+void sdcardInsertionDetectInit(void)
+{
+}
+
+bool sdcard_isInserted(void)
+{
+    return sdcardSim.image != NULL;
+}
+
+bool sdcard_isFunctional(void)
+{
+    return sdcardSim.image != NULL;
+}
+
+bool sdcard_isInitialized(void)
+{
+    return sdcardSim.state >= SDCARD_SIM_STATE_READY;
+}
+
+/**
+ * SITL attaches SDCARD_SIM_IMAGE_FILENAME from the working directory, the unit tests open their image beforehand.
+ */
+void sdcard_init(bool useDMA)
+{
+    UNUSED(useDMA);
+
+#ifdef SDCARD_SIM_IMAGE_FILENAME
+    if (!sdcardSim.image) {
+        if (sdcardSim_open(SDCARD_SIM_IMAGE_FILENAME, NULL)) {
+            printf("[sdcard] attached '%s', %u blocks\n", SDCARD_SIM_IMAGE_FILENAME, (unsigned)sdcardSim.metadata.numBlocks);
+        } else {
+            fprintf(stderr, "[sdcard] failed to open '%s'\n", SDCARD_SIM_IMAGE_FILENAME);
+        }
+    }
+#endif
+}
+
+bool sdcard_poll(void)
+{
+    const timeUs_t now = micros();
+    bool success;
+
+    doMore:
+    switch (sdcardSim.state) {
+        case SDCARD_SIM_STATE_READING:
+            if (cmpTimeUs(now, sdcardSim.busyUntil) >= 0) {
+                success = sdcardSim_transferBlock(sdcardSim.pendingOperation.blockIndex, sdcardSim.pendingOperation.buffer, false);
+
+                sdcardSim.state = SDCARD_SIM_STATE_READY;
+                sdcardSim.statistics.blocksRead++;
+
+                if (sdcardSim.profiler) {
+                    sdcardSim.profiler(SDCARD_BLOCK_OPERATION_READ, sdcardSim.pendingOperation.blockIndex, now - sdcardSim.pendingOperation.startTime);
+                }
+
+                if (sdcardSim.pendingOperation.callback) {
+                    sdcardSim.pendingOperation.callback(
+                        SDCARD_BLOCK_OPERATION_READ,
+                        sdcardSim.pendingOperation.blockIndex,
+                        success ? sdcardSim.pendingOperation.buffer : NULL,
+                        sdcardSim.pendingOperation.callbackData
+                    );
+                }
+            }
+        break;
+        case SDCARD_SIM_STATE_SENDING_WRITE:
+            if (cmpTimeUs(now, sdcardSim.busyUntil) >= 0) {
+                success = sdcardSim_transferBlock(sdcardSim.pendingOperation.blockIndex, sdcardSim.pendingOperation.buffer, true);
+
+                // Like the SPI driver, the caller gets its buffer back as soon as it's sent and the card programs it afterwards
+                sdcardSim.state = SDCARD_SIM_STATE_WAITING_FOR_WRITE;
+                sdcardSim.busyUntil = now + sdcardSim_programTimeUs();
+                sdcardSim.statistics.blocksWritten++;
+
+                if (sdcardSim.pendingOperation.callback) {
+                    sdcardSim.pendingOperation.callback(
+                        SDCARD_BLOCK_OPERATION_WRITE,
+                        sdcardSim.pendingOperation.blockIndex,
+                        success ? sdcardSim.pendingOperation.buffer : NULL,
+                        sdcardSim.pendingOperation.callbackData
+                    );
+                }
+
+                goto doMore;
+            }
+        break;
+        case SDCARD_SIM_STATE_WAITING_FOR_WRITE:
+            if (cmpTimeUs(now, sdcardSim.busyUntil) >= 0) {
+                // Still more blocks left to write in a multi-block chain?
+                if (sdcardSim.multiWriteBlocksRemain > 1) {
+                    sdcardSim.multiWriteBlocksRemain--;
+                    sdcardSim.multiWriteNextBlock++;
+                    sdcardSim.state = SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS;
+                } else if (sdcardSim.multiWriteBlocksRemain == 1) {
+                    sdcardSim_endWriteBlocks();
+                } else {
+                    sdcardSim.state = SDCARD_SIM_STATE_READY;
+                }
+
+                if (sdcardSim.profiler) {
+                    sdcardSim.profiler(SDCARD_BLOCK_OPERATION_WRITE, sdcardSim.pendingOperation.blockIndex, now - sdcardSim.pendingOperation.startTime);
+                }
+            }
+        break;
+        case SDCARD_SIM_STATE_STOPPING_MULTIPLE_BLOCK_WRITE:
+            if (cmpTimeUs(now, sdcardSim.busyUntil) >= 0) {
+                sdcardSim.state = SDCARD_SIM_STATE_READY;
+            }
+        break;
+        case SDCARD_SIM_STATE_NOT_PRESENT:
+        case SDCARD_SIM_STATE_READY:
+        case SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS:
+        default:
+            ;
+    }
+
+    return sdcardSim_isReady();
+}
+
+sdcardOperationStatus_e sdcard_writeBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    doMore:
+    switch (sdcardSim.state) {
+        case SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS:
+            // Do we need to cancel the previous multi-block write?
+            if (blockIndex != sdcardSim.multiWriteNextBlock) {
+                if (sdcardSim_endWriteBlocks() == SDCARD_OPERATION_SUCCESS) {
+                    goto doMore;
+                } else {
+                    sdcardSim.statistics.busyRejects++;
+                    return SDCARD_OPERATION_BUSY;
+                }
+            }
+            sdcardSim.statistics.multiWriteBlocks++;
+        break;
+        case SDCARD_SIM_STATE_READY:
+        break;
+        case SDCARD_SIM_STATE_NOT_PRESENT:
+            return SDCARD_OPERATION_FAILURE;
+        default:
+            sdcardSim.statistics.busyRejects++;
+            return SDCARD_OPERATION_BUSY;
+    }
+
+    sdcardSim.pendingOperation.buffer = buffer;
+    sdcardSim.pendingOperation.blockIndex = blockIndex;
+    sdcardSim.pendingOperation.callback = callback;
+    sdcardSim.pendingOperation.callbackData = callbackData;
+    sdcardSim.pendingOperation.startTime = micros();
+
+    sdcardSim.state = SDCARD_SIM_STATE_SENDING_WRITE;
+    sdcardSim.busyUntil = sdcardSim.pendingOperation.startTime + sdcardSim.config.writeTransferUs;
+
+    return SDCARD_OPERATION_IN_PROGRESS;
+}
+
+sdcardOperationStatus_e sdcard_beginWriteBlocks(uint32_t blockIndex, uint32_t blockCount)
+{
+    if (sdcardSim.state != SDCARD_SIM_STATE_READY) {
+        if (sdcardSim.state == SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS) {
+            if (blockIndex == sdcardSim.multiWriteNextBlock) {
+                // Assume that the caller wants to continue the multi-block write they already have in progress!
+                return SDCARD_OPERATION_SUCCESS;
+            } else if (sdcardSim_endWriteBlocks() != SDCARD_OPERATION_SUCCESS) {
+                sdcardSim.statistics.busyRejects++;
+                return SDCARD_OPERATION_BUSY;
+            }
+        } else if (sdcardSim.state == SDCARD_SIM_STATE_NOT_PRESENT) {
+            return SDCARD_OPERATION_FAILURE;
+        } else {
+            sdcardSim.statistics.busyRejects++;
+            return SDCARD_OPERATION_BUSY;
+        }
+    }
+
+    sdcardSim.state = SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS;
+    sdcardSim.multiWriteBlocksRemain = blockCount;
+    sdcardSim.multiWriteNextBlock = blockIndex;
+    sdcardSim.statistics.multiWriteStarts++;
+
+    return SDCARD_OPERATION_SUCCESS;
+}
+
+bool sdcard_readBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (sdcardSim.state != SDCARD_SIM_STATE_READY) {
+        if (sdcardSim.state != SDCARD_SIM_STATE_WRITING_MULTIPLE_BLOCKS || sdcardSim_endWriteBlocks() != SDCARD_OPERATION_SUCCESS) {
+            sdcardSim.statistics.busyRejects++;
+            return false;
+        }
+    }
+
+    sdcardSim.pendingOperation.buffer = buffer;
+    sdcardSim.pendingOperation.blockIndex = blockIndex;
+    sdcardSim.pendingOperation.callback = callback;
+    sdcardSim.pendingOperation.callbackData = callbackData;
+    sdcardSim.pendingOperation.startTime = micros();
+
+    sdcardSim.state = SDCARD_SIM_STATE_READING;
+    sdcardSim.busyUntil = sdcardSim.pendingOperation.startTime + sdcardSim.config.readLatencyUs;
+
+    return true;
+}
+
+const sdcardMetadata_t* sdcard_getMetadata(void)
+{
+    return &sdcardSim.metadata;
+}
+
+void sdcard_setProfilerCallback(sdcard_profilerCallback_c callback)
+{
+    sdcardSim.profiler = callback;
+}
+
+#endif
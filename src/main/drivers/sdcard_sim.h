@@ -0,0 +1,52 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Host implementation of the sdcard_* block API (drivers/sdcard.h) on top of a disk image file, for SITL and the unit
+ * tests. The image must hold an MBR partitioned FAT16/FAT32 volume, as a real card would. Operations take simulated
+ * card time measured with micros(), so asyncfatfs sees the same in progress/busy answers as on the SPI driver.
+ */
+
+typedef struct sdcardSimConfig_s {
+    uint32_t readLatencyUs;         // from the read command to the block being in the caller's buffer
+    uint32_t writeTransferUs;       // clocking a block out to the card, the caller's buffer is held this long
+    uint32_t writeBusyUs;           // card programming a single block write
+    uint32_t multiWriteBusyUs;      // card programming a block of a pre-erased multi-block write
+    uint32_t stallIntervalBlocks;   // the card goes busy for stallUs after this many written blocks, 0 for never
+    uint32_t stallUs;               // wear levelling / garbage collection pause of a slow card
+} sdcardSimConfig_t;
+
+typedef struct sdcardSimStatistics_s {
+    uint32_t blocksRead;
+    uint32_t blocksWritten;
+    uint32_t multiWriteBlocks;      // blocks of blocksWritten sent inside a multi-block write
+    uint32_t multiWriteStarts;
+    uint32_t busyRejects;           // operations refused because the card was busy
+    uint32_t stalls;
+    uint32_t busyUs;                // time the card spent programming, stalls included
+} sdcardSimStatistics_t;
+
+bool sdcardSim_open(const char *imagePath, const sdcardSimConfig_t *config);
+void sdcardSim_close(void);
+
+const sdcardSimStatistics_t *sdcardSim_getStatistics(void);
+void sdcardSim_resetStatistics(void);
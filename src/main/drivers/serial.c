@@ -102,3 +102,46 @@ void serialEndWrite(serialPort_t *instance)
     if (instance->vTable->endWrite)
         instance->vTable->endWrite(instance);
 }
+
+/*
+ * For drivers that receive many bytes per interrupt (circular RX DMA with idle line detection, host sockets):
+ * hands the bytes between rxBufferTail and rxBufferHead to the port's rxCallback, in one go. rxBufferHead is
+ * where the hardware will write the next byte. Returns the number of bytes delivered.
+ */
+uint32_t serialRxDeliverFrame(serialPort_t *instance, uint32_t rxBufferHead)
+{
+    uint32_t rxBufferTail = instance->rxBufferTail;
+    uint32_t count = 0;
+
+    while (rxBufferTail != rxBufferHead) {
+        instance->rxCallback(instance->rxBuffer[rxBufferTail]);
+        if (++rxBufferTail >= instance->rxBufferSize) {
+            rxBufferTail = 0;
+        }
+        count++;
+    }
+    instance->rxBufferTail = rxBufferTail;
+
+    return count;
+}
+
+/*
+ * For circular RX DMA with idle line detection. `dmaRemaining` is the count of transfers the DMA has left before it
+ * wraps (NDTR on F4), it counts down from rxBufferSize and reloads. When the line goes idle everything received is
+ * handed over. The half and full buffer interrupts only hand over what is waiting once it is at least half the buffer:
+ * a frame shorter than that always reaches the callback in one go, so parsers that time the gaps between bytes
+ * (iBus) never see it split. The next of those interrupts is at most half a buffer away, so nothing is overwritten.
+ */
+uint32_t serialRxDeliverDma(serialPort_t *instance, uint32_t dmaRemaining, bool idle)
+{
+    const uint32_t rxBufferHead = (instance->rxBufferSize - dmaRemaining) % instance->rxBufferSize;
+
+    if (!idle) {
+        const uint32_t waiting = (rxBufferHead + instance->rxBufferSize - instance->rxBufferTail) % instance->rxBufferSize;
+        if (waiting < instance->rxBufferSize / 2) {
+            return 0;
+        }
+    }
+
+    return serialRxDeliverFrame(instance, rxBufferHead);
+}
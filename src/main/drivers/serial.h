@@ -125,3 +125,5 @@ uint32_t serialGetBaudRate(serialPort_t *instance);
 void serialWriteBufShim(void *instance, const uint8_t *data, int count);
 void serialBeginWrite(serialPort_t *instance);
 void serialEndWrite(serialPort_t *instance);
+uint32_t serialRxDeliverFrame(serialPort_t *instance, uint32_t rxBufferHead);
+uint32_t serialRxDeliverDma(serialPort_t *instance, uint32_t dmaRemaining, bool idle);
@@ -250,6 +250,10 @@ void tcpDataIn(tcpPort_t *instance, uint8_t* ch, int size)
             s->port.rxBufferHead++;
         }
     }
+    if (s->port.rxCallback) {
+        // like a UART with RX DMA and idle line detection, each received chunk is delivered as one frame
+        serialRxDeliverFrame(&s->port, s->port.rxBufferHead);
+    }
     pthread_mutex_unlock(&s->rxLock);
 //    printf("\n");
 }
@@ -141,6 +141,12 @@ void uartTryStartTxDMA(uartPort_t *s)
 static uint32_t uartTotalRxBytesWaiting(const serialPort_t *instance)
 {
     const uartPort_t *s = (const uartPort_t*)instance;
+
+    if (s->port.rxCallback) {
+        // everything received has been handed to the callback
+        return 0;
+    }
+
 #ifdef STM32F4
     if (s->rxDMAStream) {
         uint32_t rxDMAHead = s->rxDMAStream->NDTR;
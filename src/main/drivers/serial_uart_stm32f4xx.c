@@ -192,6 +192,40 @@ void dmaIRQHandler(dmaChannelDescriptor_t* descriptor)
     }
 }
 
+// Hands what the RX DMA has written since the last call to the port's rxCallback, see serialRxDeliverDma()
+static void uartDeliverRxDma(uartPort_t *s, bool idle)
+{
+    serialRxDeliverDma(&s->port, s->rxDMAStream->NDTR, idle);
+}
+
+// RX DMA half and full buffer interrupts, they only fire for ports with an rxCallback and keep a long burst from
+// being overwritten before the idle line interrupt
+static void rxDmaIRQHandler(dmaChannelDescriptor_t* descriptor)
+{
+    uartPort_t *s = &(((uartDevice_t*)(descriptor->userParam))->port);
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_HTIF))
+    {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_HTIF);
+    }
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TCIF))
+    {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TCIF);
+    }
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_TEIF))
+    {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_TEIF);
+    }
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_DMEIF))
+    {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_DMEIF);
+    }
+    if (DMA_GET_FLAG_STATUS(descriptor, DMA_IT_FEIF))
+    {
+        DMA_CLEAR_FLAG(descriptor, DMA_IT_FEIF);
+    }
+    uartDeliverRxDma(s, false);
+}
+
 // XXX Should serialUART be consolidated?
 
 uartPort_t *serialUART(UARTDevice_e device, uint32_t baudRate, portMode_e mode, portOptions_e options)
@@ -216,7 +250,10 @@ uartPort_t *serialUART(UARTDevice_e device, uint32_t baudRate, portMode_e mode,
     s->USARTx = hardware->reg;
 
     if (hardware->rxDMAStream) {
-        dmaInit(dmaGetIdentifier(hardware->rxDMAStream), OWNER_SERIAL_RX, RESOURCE_INDEX(device));
+        const dmaIdentifier_e identifier = dmaGetIdentifier(hardware->rxDMAStream);
+        dmaInit(identifier, OWNER_SERIAL_RX, RESOURCE_INDEX(device));
+        // same priority as the USART interrupt, the two never preempt each other delivering frames
+        dmaSetHandler(identifier, rxDmaIRQHandler, hardware->rxPriority, (uint32_t)uart);
         s->rxDMAChannel = hardware->DMAChannel;
         s->rxDMAStream = hardware->rxDMAStream;
         s->rxDMAPeripheralBaseAddr = (uint32_t)&s->USARTx->DR;
@@ -266,15 +303,14 @@ uartPort_t *serialUART(UARTDevice_e device, uint32_t baudRate, portMode_e mode,
         }
     }
 
-    if (!(s->rxDMAChannel)) {
-        NVIC_InitTypeDef NVIC_InitStructure;
+    // with RX DMA the USART interrupt is still used for the idle line and IRQ driven TX
+    NVIC_InitTypeDef NVIC_InitStructure;
 
-        NVIC_InitStructure.NVIC_IRQChannel = hardware->irqn;
-        NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_PRIORITY_BASE(hardware->rxPriority);
-        NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(hardware->rxPriority);
-        NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-        NVIC_Init(&NVIC_InitStructure);
-    }
+    NVIC_InitStructure.NVIC_IRQChannel = hardware->irqn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = NVIC_PRIORITY_BASE(hardware->rxPriority);
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = NVIC_PRIORITY_SUB(hardware->rxPriority);
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
 
     return s;
 }
@@ -290,6 +326,13 @@ void uartIrqHandler(uartPort_t *s)
         }
     }
 
+    // the line went idle after a frame, only enabled for RX DMA ports with an rxCallback
+    if (s->rxDMAStream && (USART_GetITStatus(s->USARTx, USART_IT_IDLE) == SET)) {
+        // reading SR (in USART_GetITStatus) followed by DR clears the flag
+        (void)s->USARTx->DR;
+        uartDeliverRxDma(s, true);
+    }
+
     if (!s->txDMAStream && (USART_GetITStatus(s->USARTx, USART_IT_TXE) == SET)) {
         if (s->port.txBufferTail != s->port.txBufferHead) {
             USART_SendData(s->USARTx, s->port.txBuffer[s->port.txBufferTail]);
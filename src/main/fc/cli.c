@@ -36,9 +36,11 @@ extern uint8_t __config_end;
 #ifdef USE_CLI
 
 #include "blackbox/blackbox.h"
+#include "blackbox/blackbox_io.h"
 
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/profiler.h"
 #include "build/version.h"
 
 #include "cms/cms.h"
@@ -88,6 +90,7 @@ extern uint8_t __config_end;
 #include "fc/fc_core.h"
 #include "fc/fc_msp.h"
 #include "fc/fc_msp_box.h"
+#include "fc/fc_rc.h"
 #include "fc/rc_adjustments.h"
 #include "fc/rc_controls.h"
 #include "fc/runtime_config.h"
@@ -3013,6 +3016,23 @@ static void cliStatus(char *cmdline)
     const int systemRate = getTaskDeltaTime(TASK_SYSTEM) == 0 ? 0 : (int)(1000000.0f / ((float)getTaskDeltaTime(TASK_SYSTEM)));
     cliPrintLinef("CPU:%d%%, cycle time: %d, GYRO rate: %d, RX rate: %d, System rate: %d",
             constrain(averageSystemLoadPercent, 0, 100), getTaskDeltaTime(TASK_GYROPID), gyroRate, rxRate, systemRate);
+    cliPrintLinef("RX frame interval: %d, RC latency: %d, RC jitter: %d", rxGetFrameIntervalUs(), rcGetLatencyUs(), rcGetJitterUs());
+#if defined(BLACKBOX) && defined(USE_BLACKBOX_DEFERRED)
+    if (blackboxConfig()->deferred) {
+        cliPrintLinef("Blackbox dropped frames: %d", blackboxGetDroppedFrames());
+    }
+#endif
+#ifdef BLACKBOX
+    if (blackboxGetDeviceDroppedBytes()) {
+        cliPrintLinef("Blackbox device dropped bytes: %d", blackboxGetDeviceDroppedBytes());
+    }
+#endif
+#ifdef USE_DSHOT_DMAR
+    if (useBurstDshot) {
+        // a timer without a free update stream sends its motors on their own streams
+        cliPrintLinef("DShot burst timers: %d of %d", pwmDshotBurstTimerCount(), pwmDshotTimerCount());
+    }
+#endif
 #if defined(OSD) || !defined(MINIMAL_CLI)
     /* Flag strings are present if OSD is compiled so may as well use them even with MINIMAL_CLI */
     cliPrint("Arming disable flags:");
@@ -3106,6 +3126,19 @@ static void cliTasks(char *cmdline)
         getCheckFuncInfo(&checkFuncInfo);
         cliPrintLinef("RX Check Function %19d %7d %25d", checkFuncInfo.maxExecutionTime, checkFuncInfo.averageExecutionTime, checkFuncInfo.totalExecutionTime / 1000);
         cliPrintLinef("Total (excluding SERIAL) %25d.%1d%% %4d.%1d%%", maxLoadSum/10, maxLoadSum%10, averageLoadSum/10, averageLoadSum%10);
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+        cliPrintLine("\r\nTask percentiles      exec/us  p50   p99 p99.9  latency/us  p50   p99 p99.9");
+        for (cfTaskId_e taskId = 0; taskId < TASK_COUNT; taskId++) {
+            cfTaskInfo_t taskInfo;
+            getTaskInfo(taskId, &taskInfo);
+            if (taskInfo.isEnabled) {
+                cliPrintLinef("%02d - (%15s) %9d %5d %5d %15d %5d %5d", taskId, taskInfo.taskName,
+                        taskInfo.executionTimePercentile[TASK_PERCENTILE_50], taskInfo.executionTimePercentile[TASK_PERCENTILE_99],
+                        taskInfo.executionTimePercentile[TASK_PERCENTILE_99_9], taskInfo.startLatencyPercentile[TASK_PERCENTILE_50],
+                        taskInfo.startLatencyPercentile[TASK_PERCENTILE_99], taskInfo.startLatencyPercentile[TASK_PERCENTILE_99_9]);
+            }
+        }
+#endif
     }
 
 #if defined(USE_CHIBIOS)
@@ -3120,6 +3153,42 @@ static void cliTasks(char *cmdline)
 }
 #endif
 
+#ifdef USE_PROFILER
+static void cliProfiler(char *cmdline)
+{
+    if (strncasecmp(cmdline, "reset", 5) == 0) {
+        profilerReset();
+        cliPrintLine("Profiler reset");
+        return;
+    }
+
+    if (!isEmpty(cmdline)) {
+        for (profilerScope_e scope = 0; scope < PROFILER_SCOPE_COUNT; scope++) {
+            if (strcasecmp(cmdline, profilerScopeName(scope)) == 0) {
+                const profilerScope_t *profilerScope = &profilerScopes[scope];
+                const uint32_t sampleCount = MIN(profilerScope->count, PROFILER_RING_SIZE);
+                cliPrintLinef("%s: %u samples, oldest first, ns", profilerScopeName(scope), sampleCount);
+                // oldest sample first
+                for (uint32_t i = 0; i < sampleCount; i++) {
+                    const uint32_t cycles = profilerScope->cycles[(profilerScope->count - sampleCount + i) & (PROFILER_RING_SIZE - 1)];
+                    cliPrintLinef("%u", profilerCyclesToNs(cycles));
+                }
+                return;
+            }
+        }
+        cliShowParseError();
+        return;
+    }
+
+    cliPrintLinef("Profiler scope       count  last/ns   avg/ns   max/ns (clock %uHz)", profilerClockHz());
+    for (profilerScope_e scope = 0; scope < PROFILER_SCOPE_COUNT; scope++) {
+        cliPrintLinef("%15s %10u %8u %8u %8u", profilerScopeName(scope), profilerScopes[scope].count,
+            profilerCyclesToNs(profilerScopeLatest(scope)), profilerCyclesToNs(profilerScopeAverage(scope)),
+            profilerCyclesToNs(profilerScopes[scope].maxCycles));
+    }
+}
+#endif
+
 static void cliVersion(char *cmdline)
 {
     UNUSED(cmdline);
@@ -3691,6 +3760,9 @@ const clicmd_t cmdTable[] = {
     CLI_COMMAND_DEF("play_sound", NULL, "[<index>]", cliPlaySound),
 #endif
     CLI_COMMAND_DEF("profile", "change profile", "[<index>]", cliProfile),
+#ifdef USE_PROFILER
+    CLI_COMMAND_DEF("profiler", "show hot path profile", "[<scope> | reset]", cliProfiler),
+#endif
     CLI_COMMAND_DEF("rateprofile", "change rate profile", "[<index>]", cliRateProfile),
 #if defined(USE_RESOURCE_MGMT)
     CLI_COMMAND_DEF("resource", "show/set resources", NULL, cliResource),
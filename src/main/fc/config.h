@@ -77,6 +77,9 @@ typedef struct systemConfig_s {
     uint8_t cpu_overclock;
 #endif
     uint8_t powerOnArmingGraceTime; // in seconds
+#ifdef USE_SCHEDULER_READY_QUEUE
+    uint8_t scheduler_ready_queue;
+#endif
     char boardIdentifier[sizeof(TARGET_BOARD_IDENTIFIER) + 1];
 } systemConfig_t;
 #endif
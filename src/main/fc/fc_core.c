@@ -22,6 +22,7 @@
 #include "platform.h"
 
 #include "build/debug.h"
+#include "build/profiler.h"
 
 #include "blackbox/blackbox.h"
 
@@ -79,6 +80,7 @@
 #include "flight/mixer.h"
 #include "flight/navigation.h"
 #include "flight/pid.h"
+#include "flight/rpm_filter.h"
 #include "flight/servos.h"
 
 
@@ -589,7 +591,9 @@ static void subTaskPidController(timeUs_t currentTimeUs)
     uint32_t startTime = 0;
     if (debugMode == DEBUG_PIDLOOP) {startTime = micros();}
     // PID - note this is function pointer set by setPIDController()
+    PROFILE_BEGIN(PROFILER_SCOPE_PID);
     pidController(currentPidProfile, &accelerometerConfig()->accelerometerTrims, currentTimeUs);
+    PROFILE_END(PROFILER_SCOPE_PID);
     DEBUG_SET(DEBUG_PIDLOOP, 1, micros() - startTime);
 }
 
@@ -639,7 +643,7 @@ static void subTaskMainSubprocesses(timeUs_t currentTimeUs)
         rcCommand[THROTTLE] += calculateThrottleAngleCorrection(throttleCorrectionConfig()->throttle_correction_value);
     }
 
-    processRcCommand();
+    processRcCommand(currentTimeUs);
 
 #ifdef GPS
     if (sensors(SENSOR_GPS)) {
@@ -650,12 +654,16 @@ static void subTaskMainSubprocesses(timeUs_t currentTimeUs)
 #endif
 
 #ifdef USE_SDCARD
+    PROFILE_BEGIN(PROFILER_SCOPE_AFATFS_POLL);
     afatfs_poll();
+    PROFILE_END(PROFILER_SCOPE_AFATFS_POLL);
 #endif
 
 #ifdef BLACKBOX
     if (!cliMode && blackboxConfig()->device) {
+        PROFILE_BEGIN(PROFILER_SCOPE_BLACKBOX);
         blackboxUpdate(currentTimeUs);
+        PROFILE_END(PROFILER_SCOPE_BLACKBOX);
     }
 #else
     UNUSED(currentTimeUs);
@@ -681,7 +689,9 @@ static void subTaskMotorUpdate(void)
         startTime = micros();
     }
 
+    PROFILE_BEGIN(PROFILER_SCOPE_MIXER);
     mixTable(currentPidProfile->vbatPidCompensation);
+    PROFILE_END(PROFILER_SCOPE_MIXER);
 
 #ifdef USE_SERVOS
     // motor outputs are used as sources for servo mixing, so motors must be calculated using mixTable() before servos.
@@ -690,7 +700,13 @@ static void subTaskMotorUpdate(void)
     }
 #endif
 
+    PROFILE_BEGIN(PROFILER_SCOPE_MOTOR_WRITE);
     writeMotors();
+    PROFILE_END(PROFILER_SCOPE_MOTOR_WRITE);
+
+#ifdef USE_RPM_FILTER
+    rpmFilterUpdate();
+#endif
 
     DEBUG_SET(DEBUG_PIDLOOP, 3, micros() - startTime);
 }
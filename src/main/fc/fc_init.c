@@ -23,6 +23,8 @@
 
 #include "blackbox/blackbox.h"
 
+#include "build/profiler.h"
+
 #include "common/axis.h"
 #include "common/color.h"
 #include "common/maths.h"
@@ -124,6 +126,7 @@
 #include "flight/mixer.h"
 #include "flight/navigation.h"
 #include "flight/pid.h"
+#include "flight/rpm_filter.h"
 #include "flight/servos.h"
 
 #include "io/rcsplit.h"
@@ -221,7 +224,7 @@ void spiPreInit(void)
 #ifdef USE_MAX7456
     spiPreInitCsOutPU(IO_TAG(MAX7456_SPI_CS_PIN)); // XXX 3.2 workaround for Kakute F4. See comment for spiPreInitCSOutPU.
 #endif
-#ifdef USE_SDCARD
+#if defined(USE_SDCARD) && defined(SDCARD_SPI_CS_PIN)
     spiPreInitCs(IO_TAG(SDCARD_SPI_CS_PIN));
 #endif
 #ifdef USE_BARO_SPI_BMP280
@@ -258,6 +261,10 @@ void init(void)
 
     systemInit();
 
+#ifdef USE_PROFILER
+    profilerInit();
+#endif
+
     // initialize IO (needed for all IO operations)
     IOInitGlobal();
 
@@ -543,6 +550,9 @@ void init(void)
     // so we are ready to call validateAndFixGyroConfig(), pidInit(), and setAccelerationFilter()
     validateAndFixGyroConfig();
     pidInit(currentPidProfile);
+#ifdef USE_RPM_FILTER
+    rpmFilterInit();
+#endif
     setAccelerationFilter(accelerometerConfig()->acc_lpf_hz);
 
 #ifdef USE_SERVOS
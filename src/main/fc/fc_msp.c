@@ -26,6 +26,7 @@
 
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/profiler.h"
 #include "build/version.h"
 
 #include "common/axis.h"
@@ -91,6 +92,7 @@
 #include "io/vtx_control.h"
 
 #include "msp/msp.h"
+#include "msp/msp_dataflash_stream.h"
 #include "msp/msp_protocol.h"
 #include "msp/msp_serial.h"
 
@@ -277,7 +279,7 @@ static void serializeDataflashSummaryReply(sbuf_t *dst)
 
     sbufWriteU8(dst, flags);
     sbufWriteU32(dst, geometry->sectors);
-    sbufWriteU32(dst, geometry->totalSize);
+    sbufWriteU32(dst, flashfsGetSize()); // The log index at the end of the chip isn't part of the volume
     sbufWriteU32(dst, flashfsGetOffset()); // Effectively the current number of bytes stored on the volume
 #else
     sbufWriteU8(dst, 0); // FlashFS is neither ready nor supported
@@ -1241,6 +1243,60 @@ static mspResult_e mspFcProcessOutCommandWithArg(uint8_t cmdMSP, sbuf_t *arg, sb
             serializeBoxReply(dst, page, &serializeBoxPermanentIdFn);
         }
         break;
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+    case MSP_TASK_STATISTICS:
+        {
+            const cfTaskId_e taskId = sbufBytesRemaining(arg) ? sbufReadU8(arg) : TASK_GYROPID;
+            if (taskId >= TASK_COUNT) {
+                return MSP_RESULT_ERROR;
+            }
+            cfTaskInfo_t taskInfo;
+            getTaskInfo(taskId, &taskInfo);
+            sbufWriteU8(dst, taskId);
+            sbufWriteU8(dst, taskInfo.isEnabled);
+            sbufWriteU8(dst, TASK_HISTOGRAM_BUCKET_COUNT);
+            for (int i = 0; i < TASK_PERCENTILE_COUNT; i++) {
+                sbufWriteU16(dst, MIN(taskInfo.executionTimePercentile[i], UINT16_MAX));
+            }
+            for (int i = 0; i < TASK_PERCENTILE_COUNT; i++) {
+                sbufWriteU16(dst, MIN(taskInfo.startLatencyPercentile[i], UINT16_MAX));
+            }
+            for (int i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+                sbufWriteU32(dst, taskInfo.executionTimeHistogram[i]);
+            }
+            for (int i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+                sbufWriteU32(dst, taskInfo.startLatencyHistogram[i]);
+            }
+        }
+        break;
+#endif
+#ifdef USE_PROFILER
+    case MSP_PROFILER:
+        if (sbufBytesRemaining(arg)) {
+            // ring buffer of one scope in cycles, oldest sample first
+            const profilerScope_e scope = sbufReadU8(arg);
+            if (scope >= PROFILER_SCOPE_COUNT) {
+                return MSP_RESULT_ERROR;
+            }
+            const profilerScope_t *profilerScope = &profilerScopes[scope];
+            const uint32_t sampleCount = MIN(profilerScope->count, PROFILER_RING_SIZE);
+            sbufWriteU8(dst, scope);
+            sbufWriteU8(dst, sampleCount);
+            for (uint32_t i = 0; i < sampleCount; i++) {
+                sbufWriteU32(dst, profilerScope->cycles[(profilerScope->count - sampleCount + i) & (PROFILER_RING_SIZE - 1)]);
+            }
+        } else {
+            sbufWriteU8(dst, PROFILER_SCOPE_COUNT);
+            sbufWriteU32(dst, profilerClockHz());
+            for (profilerScope_e scope = 0; scope < PROFILER_SCOPE_COUNT; scope++) {
+                sbufWriteU32(dst, profilerScopes[scope].count);
+                sbufWriteU32(dst, profilerScopeLatest(scope));
+                sbufWriteU32(dst, profilerScopeAverage(scope));
+                sbufWriteU32(dst, profilerScopes[scope].maxCycles);
+            }
+        }
+        break;
+#endif
     default:
         return MSP_RESULT_CMD_UNKNOWN;
     }
@@ -1272,6 +1328,31 @@ static void mspFcWpCommand(sbuf_t *dst, sbuf_t *src)
 #endif
 
 #ifdef USE_FLASHFS
+#define MSP_DATAFLASH_LOG_LIST_MAX_ENTRIES 8
+
+/*
+ * Up to MSP_DATAFLASH_LOG_LIST_MAX_ENTRIES index entries from the one asked for, a log is then downloaded with
+ * MSP_DATAFLASH_READ from its start offset.
+ */
+static void mspFcDataFlashLogListCommand(sbuf_t *dst, sbuf_t *src)
+{
+    const int logCount = flashfsGetLogCount();
+    const int firstIndex = sbufBytesRemaining(src) >= sizeof(uint16_t) ? sbufReadU16(src) : 0;
+
+    sbufWriteU16(dst, logCount);
+    sbufWriteU16(dst, firstIndex);
+    for (int i = firstIndex; i < logCount && i < firstIndex + MSP_DATAFLASH_LOG_LIST_MAX_ENTRIES; i++) {
+        flashfsLogEntry_t entry;
+        if (!flashfsGetLog(i, &entry)) {
+            break;
+        }
+        sbufWriteU32(dst, entry.start);
+        sbufWriteU32(dst, entry.length);
+        sbufWriteU32(dst, entry.timeMs);
+        sbufWriteU16(dst, entry.flags);
+    }
+}
+
 static void mspFcDataFlashReadCommand(sbuf_t *dst, sbuf_t *src)
 {
     const unsigned int dataSize = sbufBytesRemaining(src);
@@ -1292,6 +1373,62 @@ static void mspFcDataFlashReadCommand(sbuf_t *dst, sbuf_t *src)
 
     serializeDataflashReadReply(dst, readAddress, readLength, useLegacyFormat, allowCompression);
 }
+
+#define MSP_DATAFLASH_STREAM_PERIOD_US 250 // the serial task runs this often while streaming, each run reads a piece of a chunk
+
+static void mspFcDataFlashStreamStop(void)
+{
+    if (mspDataflashStreamPort()) {
+        mspDataflashStreamStop();
+        rescheduleTask(TASK_SERIAL, 1000000 / serialConfig()->serial_update_rate_hz);
+    }
+}
+
+static mspResult_e mspFcDataFlashStreamNext(serialPort_t *port, mspPacket_t *frame)
+{
+    if (port != mspDataflashStreamPort()) {
+        // Another port started a stream since
+        return MSP_RESULT_ERROR;
+    }
+    if (ARMING_FLAG(ARMED)) {
+        mspFcDataFlashStreamStop();
+        return MSP_RESULT_ERROR;
+    }
+
+    const mspResult_e result = mspDataflashStreamNext(port, frame);
+    if (result == MSP_RESULT_ERROR) {
+        rescheduleTask(TASK_SERIAL, 1000000 / serialConfig()->serial_update_rate_hz);
+    }
+    return result;
+}
+
+static void mspFcDataFlashStreamAttach(serialPort_t *port)
+{
+    // The port has just been drained, so this is about the size of its transmit buffer
+    mspDataflashStreamAttach(port, serialTxBytesFree(port));
+    mspSerialSetStream(port, mspFcDataFlashStreamNext);
+    rescheduleTask(TASK_SERIAL, MSP_DATAFLASH_STREAM_PERIOD_US);
+}
+
+static mspResult_e mspFcDataFlashStreamCommand(sbuf_t *dst, sbuf_t *src, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    if (ARMING_FLAG(ARMED)) {
+        return MSP_RESULT_ERROR;
+    }
+
+    serialPort_t *port = mspDataflashStreamPort();
+    if (port) {
+        mspSerialSetStream(port, NULL);
+        mspFcDataFlashStreamStop();
+    }
+
+    const mspResult_e result = mspDataflashStreamCommand(dst, src);
+    if (result == MSP_RESULT_ACK && mspDataflashStreamIsPending()) {
+        *mspPostProcessFn = mspFcDataFlashStreamAttach;
+    }
+
+    return result;
+}
 #endif
 
 #ifdef USE_OSD_SLAVE
@@ -1708,6 +1845,12 @@ static mspResult_e mspFcProcessInCommand(uint8_t cmdMSP, sbuf_t *src)
     case MSP_DATAFLASH_ERASE:
         flashfsEraseCompletely();
         break;
+
+    case MSP_DATAFLASH_LOG_ERASE:
+        if (ARMING_FLAG(ARMED) || !flashfsDeleteLog(sbufReadU16(src))) {
+            return MSP_RESULT_ERROR;
+        }
+        break;
 #endif
 
 #ifdef GPS
@@ -2150,6 +2293,13 @@ mspResult_e mspFcProcessCommand(mspPacket_t *cmd, mspPacket_t *reply, mspPostPro
     } else if (cmdMSP == MSP_DATAFLASH_READ) {
         mspFcDataFlashReadCommand(dst, src);
         ret = MSP_RESULT_ACK;
+    } else if (cmdMSP == MSP_DATAFLASH_LOG_LIST) {
+        mspFcDataFlashLogListCommand(dst, src);
+        ret = MSP_RESULT_ACK;
+    } else if (cmdMSP == MSP_DATAFLASH_STREAM) {
+        ret = mspFcDataFlashStreamCommand(dst, src, mspPostProcessFn);
+    } else if (cmdMSP == MSP_DATAFLASH_STREAM_ACK) {
+        ret = mspDataflashStreamAckCommand(src);
 #endif
     } else {
         ret = mspCommonProcessInCommand(cmdMSP, src);
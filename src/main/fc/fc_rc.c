@@ -179,15 +179,70 @@ static void checkForThrottleErrorResetState(uint16_t rxRefreshRate)
     }
 }
 
-void processRcCommand(void)
+#define RC_TIMING_AVERAGE_SHIFT 4    // 1/16 weight per frame for the latency and jitter averages
+
+static timeUs_t rcLastFrameTimeUs;
+static timeDelta_t rcFrameIntervalAvgUs;
+static timeDelta_t rcLatencyUs;
+static timeDelta_t rcJitterUs;
+
+// average age of an RC frame when its setpoint is first used by the pid loop
+timeDelta_t rcGetLatencyUs(void)
+{
+    return rcLatencyUs;
+}
+
+// average deviation of the RC frame interval from its mean
+timeDelta_t rcGetJitterUs(void)
+{
+    return rcJitterUs;
+}
+
+// false when the RX task ran without a new frame (50Hz update), otherwise frameAgeUs is how long ago it was received
+static bool updateRcFrameTiming(timeUs_t currentTimeUs, timeDelta_t *frameAgeUs)
+{
+    const timeUs_t frameTimeUs = rxGetFrameTimeUs();
+    if (frameTimeUs == rcLastFrameTimeUs) {
+        return false;
+    }
+    rcLastFrameTimeUs = frameTimeUs;
+
+    *frameAgeUs = MAX(cmpTimeUs(currentTimeUs, frameTimeUs), 0);
+    const timeDelta_t frameIntervalUs = rxGetFrameIntervalUs();
+
+    rcLatencyUs += (*frameAgeUs - rcLatencyUs) >> RC_TIMING_AVERAGE_SHIFT;
+    if (frameIntervalUs > 0) {
+        if (!rcFrameIntervalAvgUs) {
+            rcFrameIntervalAvgUs = frameIntervalUs;
+        }
+        rcFrameIntervalAvgUs += (frameIntervalUs - rcFrameIntervalAvgUs) >> RC_TIMING_AVERAGE_SHIFT;
+        rcJitterUs += (ABS(frameIntervalUs - rcFrameIntervalAvgUs) - rcJitterUs) >> RC_TIMING_AVERAGE_SHIFT;
+    }
+
+    if (debugMode == DEBUG_RX_TIMING) {
+        debug[0] = frameIntervalUs;
+        debug[1] = *frameAgeUs;
+        debug[2] = rcLatencyUs;
+        debug[3] = rcJitterUs;
+    }
+
+    return true;
+}
+
+void processRcCommand(timeUs_t currentTimeUs)
 {
     static float rcCommandInterp[4] = { 0, 0, 0, 0 };
     static float rcStepSize[4] = { 0, 0, 0, 0 };
     static int16_t rcInterpolationStepCount;
     static uint16_t currentRxRefreshRate;
+    timeDelta_t frameAgeUs = 0;
 
     if (isRXDataNew) {
-        currentRxRefreshRate = constrain(getTaskDeltaTime(TASK_RX),1000,20000);
+        if (updateRcFrameTiming(currentTimeUs, &frameAgeUs) || !currentRxRefreshRate) {
+            // the interval between receive ISR timestamps, the RX task period adds the scheduler jitter
+            const timeDelta_t frameIntervalUs = rxGetFrameIntervalUs();
+            currentRxRefreshRate = constrain(frameIntervalUs ? frameIntervalUs : rxGetRefreshRate(), 1000, 20000);
+        }
         if (isAntiGravityModeActive()) {
             checkForThrottleErrorResetState(currentRxRefreshRate);
         }
@@ -214,7 +269,8 @@ void processRcCommand(void)
         }
 
         if (isRXDataNew && rxRefreshRate > 0) {
-            rcInterpolationStepCount = rxRefreshRate / targetPidLooptime;
+            // end the ramp one refresh period after the frame was received, not after it was processed
+            rcInterpolationStepCount = MAX((int)(rxRefreshRate - MIN(frameAgeUs, rxRefreshRate)) / (int)targetPidLooptime, 1);
 
             for (int channel=ROLL; channel < interpolationChannels; channel++) {
                 rcStepSize[channel] = (rcCommand[channel] - rcCommandInterp[channel]) / (float)rcInterpolationStepCount;
@@ -16,7 +16,9 @@
  */
 #pragma once
 
-void processRcCommand(void);
+#include "common/time.h"
+
+void processRcCommand(timeUs_t currentTimeUs);
 float getSetpointRate(int axis);
 float getRcDeflection(int axis);
 float getRcDeflectionAbs(int axis);
@@ -24,3 +26,5 @@ float getThrottlePIDAttenuation(void);
 void updateRcCommands(void);
 void resetYawAxis(void);
 void generateThrottleCurve(void);
+timeDelta_t rcGetLatencyUs(void);
+timeDelta_t rcGetJitterUs(void);
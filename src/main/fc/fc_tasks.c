@@ -23,6 +23,8 @@
 
 #include "cms/cms.h"
 
+#include "blackbox/blackbox.h"
+
 #include "build/debug.h"
 
 #include "common/axis.h"
@@ -59,6 +61,7 @@
 
 #include "io/beeper.h"
 #include "io/dashboard.h"
+#include "io/flashfs.h"
 #include "io/gps.h"
 #include "io/ledstrip.h"
 #include "io/osd.h"
@@ -268,6 +271,9 @@ void taskCameraControl(uint32_t currentTime)
 void fcTasksInit(void)
 {
     schedulerInit();
+#ifdef USE_SCHEDULER_READY_QUEUE
+    schedulerSetReadyQueueMode(systemConfig()->scheduler_ready_queue);
+#endif
 
     if (sensors(SENSOR_GYRO)) {
 #ifdef BRAINFPV
@@ -297,6 +303,10 @@ void fcTasksInit(void)
     setTaskEnabled(TASK_BATTERY_ALERTS, (useBatteryVoltage || useBatteryCurrent) && useBatteryAlerts);
 
     setTaskEnabled(TASK_RX, true);
+#ifdef USE_SCHEDULER_READY_QUEUE
+    // receivers that signal their frames wake the RX task directly, rxUpdateCheck() then only runs as the 50Hz timeout
+    schedulerSetTaskSignalDriven(TASK_RX, rxRuntimeConfig.rcFrameSignalled);
+#endif
 
     setTaskEnabled(TASK_DISPATCH, dispatchIsEnabled());
 
@@ -373,6 +383,12 @@ void fcTasksInit(void)
 #ifdef USE_CAMERA_CONTROL
     setTaskEnabled(TASK_CAMCTRL, true);
 #endif
+#if defined(BLACKBOX) && defined(USE_BLACKBOX_DEFERRED)
+    setTaskEnabled(TASK_BLACKBOX, blackboxConfig()->device && blackboxConfig()->deferred);
+#endif
+#if defined(USE_FLASHFS) && defined(USE_SPI_DMA_QUEUE)
+    setTaskEnabled(TASK_FLASHFS, flashfsGetSize() > 0);
+#endif
 }
 #endif
 
@@ -633,5 +649,23 @@ cfTask_t cfTasks[TASK_COUNT] = {
         .staticPriority = TASK_PRIORITY_IDLE
     },
 #endif
+
+#if defined(BLACKBOX) && defined(USE_BLACKBOX_DEFERRED)
+    [TASK_BLACKBOX] = {
+        .taskName = "BLACKBOX",
+        .taskFunc = blackboxEncodeQueuedFrames,
+        .desiredPeriod = TASK_PERIOD_HZ(500),       // 500 Hz, drains all the frames queued since the last run
+        .staticPriority = TASK_PRIORITY_LOW,
+    },
+#endif
+
+#if defined(USE_FLASHFS) && defined(USE_SPI_DMA_QUEUE)
+    [TASK_FLASHFS] = {
+        .taskName = "FLASHFS",
+        .taskFunc = flashfsUpdate,
+        .desiredPeriod = TASK_PERIOD_HZ(2000),      // 2000 Hz, polls for the end of a page program, which takes about 0.8ms
+        .staticPriority = TASK_PRIORITY_LOW,
+    },
+#endif
 #endif
 };
@@ -32,6 +32,8 @@ typedef enum {
 #endif
 #ifdef BLACKBOX
     TABLE_BLACKBOX_DEVICE,
+    TABLE_BLACKBOX_ENCODING,
+    TABLE_BLACKBOX_MODE,
 #endif
     TABLE_CURRENT_METER,
     TABLE_VOLTAGE_METER,
@@ -73,6 +75,9 @@ typedef enum {
 #endif
 #ifdef USE_GYRO_OVERFLOW_CHECK
     TABLE_GYRO_OVERFLOW_CHECK,
+#endif
+#ifdef USE_GYRO_DATA_ANALYSE
+    TABLE_DYN_NOTCH_ANALYSER,
 #endif
     LOOKUP_TABLE_COUNT
 } lookupTableIndex_e;
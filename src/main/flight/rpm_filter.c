@@ -0,0 +1,183 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "platform.h"
+
+#ifdef USE_RPM_FILTER
+
+#include "build/debug.h"
+
+#include "common/axis.h"
+#include "common/filter.h"
+#include "common/maths.h"
+
+#include "config/parameter_group.h"
+#include "config/parameter_group_ids.h"
+
+#include "drivers/pwm_output.h"
+
+#include "flight/mixer.h"
+#include "flight/pid.h"
+#include "flight/rpm_filter.h"
+
+#include "sensors/gyro.h"
+
+#define RPM_FILTER_MIN_UPDATE_US    1000    // every notch gets new coefficients at least at 1kHz
+#define RPM_FILTER_NYQUIST_MARGIN   0.48f   // notches above this fraction of the gyro rate are bypassed
+
+PG_REGISTER_WITH_RESET_TEMPLATE(rpmFilterConfig_t, rpmFilterConfig, PG_RPM_FILTER_CONFIG, 0);
+
+PG_RESET_TEMPLATE(rpmFilterConfig_t, rpmFilterConfig,
+    .gyro_rpm_notch_harmonics = 3,
+    .gyro_rpm_notch_min = 100,
+    .gyro_rpm_notch_q = 500,
+    .rpm_notch_lpf = 150,
+);
+
+static bool rpmFilterEnabled = false;
+static uint8_t rpmMotorCount;
+static uint8_t rpmHarmonics;
+static float rpmNotchMinHz;
+static float rpmNotchMaxHz;
+static float rpmNotchQ;
+static uint32_t rpmNotchLooptimeUs;
+static float erpmToHz;
+
+// notch for harmonic h of motor m on an axis, all axes share the frequencies
+static biquadFilter_t rpmNotch[XYZ_AXIS_COUNT][MAX_SUPPORTED_MOTORS][RPM_FILTER_HARMONICS_MAX];
+
+static pt1Filter_t motorFrequencyLpf[MAX_SUPPORTED_MOTORS];
+static float motorFrequencyHz[MAX_SUPPORTED_MOTORS];
+
+static uint8_t rpmUpdatesPerLoop;
+static uint8_t rpmUpdateMotor;
+static uint8_t rpmUpdateHarmonic;
+
+void rpmFilterInit(void)
+{
+    rpmFilterEnabled = false;
+
+    const rpmFilterConfig_t *config = rpmFilterConfig();
+    if (!isDshotTelemetryActive() || config->gyro_rpm_notch_harmonics == 0 || !gyro.targetLooptime || !targetPidLooptime) {
+        return;
+    }
+
+    rpmMotorCount = MIN(getMotorCount(), MAX_SUPPORTED_MOTORS);
+    rpmHarmonics = MIN(config->gyro_rpm_notch_harmonics, RPM_FILTER_HARMONICS_MAX);
+    rpmNotchMinHz = config->gyro_rpm_notch_min;
+    rpmNotchMaxHz = RPM_FILTER_NYQUIST_MARGIN * 1e6f / gyro.targetLooptime;
+    rpmNotchQ = config->gyro_rpm_notch_q / 100.0f;
+    rpmNotchLooptimeUs = gyro.targetLooptime;
+    // the telemetry is eRPM / 100, a motor with n poles turns once every n / 2 electrical revolutions
+    erpmToHz = 100.0f / 60.0f / (motorConfig()->motorPoleCount / 2.0f);
+
+    for (int motor = 0; motor < rpmMotorCount; motor++) {
+        pt1FilterInit(&motorFrequencyLpf[motor], config->rpm_notch_lpf, targetPidLooptime * 1e-6f);
+        motorFrequencyHz[motor] = 0.0f;
+        for (int harmonic = 0; harmonic < rpmHarmonics; harmonic++) {
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                biquadFilterInit(&rpmNotch[axis][motor][harmonic], rpmNotchMinHz, rpmNotchLooptimeUs, rpmNotchQ, FILTER_NOTCH);
+            }
+        }
+    }
+
+    // spread the coefficient updates over the PID loops so each notch is still refreshed at RPM_FILTER_MIN_UPDATE_US
+    const int notchCount = rpmMotorCount * rpmHarmonics;
+    const int loopsPerUpdate = MAX(RPM_FILTER_MIN_UPDATE_US / targetPidLooptime, 1u);
+    rpmUpdatesPerLoop = MAX((notchCount + loopsPerUpdate - 1) / loopsPerUpdate, 1);
+    rpmUpdateMotor = 0;
+    rpmUpdateHarmonic = 0;
+
+    rpmFilterEnabled = rpmMotorCount > 0;
+}
+
+bool isRpmFilterEnabled(void)
+{
+    return rpmFilterEnabled;
+}
+
+float rpmFilterGetMotorFrequencyHz(int motorIndex)
+{
+    return motorFrequencyHz[motorIndex];
+}
+
+static void rpmNotchCopyCoefficients(biquadFilter_t *dst, const biquadFilter_t *src)
+{
+    dst->b0 = src->b0;
+    dst->b1 = src->b1;
+    dst->b2 = src->b2;
+    dst->a1 = src->a1;
+    dst->a2 = src->a2;
+}
+
+/*
+ * Called once per PID loop after the motors are written, when the answers to the previous frames have been read.
+ */
+void rpmFilterUpdate(void)
+{
+    if (!rpmFilterEnabled) {
+        return;
+    }
+
+    for (int motor = 0; motor < rpmMotorCount; motor++) {
+        motorFrequencyHz[motor] = pt1FilterApply(&motorFrequencyLpf[motor], getDshotTelemetry(motor) * erpmToHz);
+        if (motor < 4) {
+            DEBUG_SET(DEBUG_RPM_FILTER, motor, lrintf(motorFrequencyHz[motor]));
+        }
+    }
+
+    for (int i = 0; i < rpmUpdatesPerLoop; i++) {
+        biquadFilter_t *notchX = &rpmNotch[X][rpmUpdateMotor][rpmUpdateHarmonic];
+        const float frequencyHz = motorFrequencyHz[rpmUpdateMotor] * (rpmUpdateHarmonic + 1);
+        if (frequencyHz > rpmNotchMaxHz) {
+            // too close to nyquist to notch, pass the signal through until the motor slows down
+            notchX->b0 = 1.0f;
+            notchX->b1 = notchX->b2 = notchX->a1 = notchX->a2 = 0.0f;
+        } else {
+            biquadFilterUpdate(notchX, MAX(frequencyHz, rpmNotchMinHz), rpmNotchLooptimeUs, rpmNotchQ, FILTER_NOTCH);
+        }
+        rpmNotchCopyCoefficients(&rpmNotch[Y][rpmUpdateMotor][rpmUpdateHarmonic], notchX);
+        rpmNotchCopyCoefficients(&rpmNotch[Z][rpmUpdateMotor][rpmUpdateHarmonic], notchX);
+
+        if (++rpmUpdateHarmonic == rpmHarmonics) {
+            rpmUpdateHarmonic = 0;
+            if (++rpmUpdateMotor == rpmMotorCount) {
+                rpmUpdateMotor = 0;
+            }
+        }
+    }
+}
+
+float rpmFilterGyro(int axis, float value)
+{
+    if (!rpmFilterEnabled) {
+        return value;
+    }
+    for (int motor = 0; motor < rpmMotorCount; motor++) {
+        for (int harmonic = 0; harmonic < rpmHarmonics; harmonic++) {
+            // DF1 because the coefficients change while the filter runs
+            value = biquadFilterApplyDF1(&rpmNotch[axis][motor][harmonic], value);
+        }
+    }
+    return value;
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "config/parameter_group.h"
+
+#define RPM_FILTER_HARMONICS_MAX 3
+
+typedef struct rpmFilterConfig_s {
+    uint8_t  gyro_rpm_notch_harmonics;      // notches per motor on each gyro axis, 0 disables the filter
+    uint8_t  gyro_rpm_notch_min;            // Hz, lower notches are held here
+    uint16_t gyro_rpm_notch_q;              // notch Q * 100
+    uint8_t  rpm_notch_lpf;                 // Hz, smooths the motor frequencies from the ESC telemetry
+} rpmFilterConfig_t;
+
+PG_DECLARE(rpmFilterConfig_t, rpmFilterConfig);
+
+void rpmFilterInit(void);
+void rpmFilterUpdate(void);
+float rpmFilterGyro(int axis, float value);
+bool isRpmFilterEnabled(void);
+float rpmFilterGetMotorFrequencyHz(int motorIndex);
@@ -36,10 +36,13 @@
     #define ONLY_EXPOSE_FOR_TESTING static
 #endif
 
+// Targets with RAM to spare can have more, a larger cache lets the card take longer runs of sectors in one write
+#ifndef AFATFS_NUM_CACHE_SECTORS
 #define AFATFS_NUM_CACHE_SECTORS 8
+#endif
 
-// FAT filesystems are allowed to differ from these parameters, but we choose not to support those weird filesystems:
-#define AFATFS_SECTOR_SIZE  512
+// FAT filesystems are allowed to differ from these parameters, but we choose not to support those weird filesystems
+// (AFATFS_SECTOR_SIZE is in asyncfatfs.h):
 #define AFATFS_NUM_FATS     2
 
 #define AFATFS_MAX_OPEN_FILES 3
@@ -53,6 +56,14 @@
  */
 #define AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT 4
 
+/*
+ * How much space a contiguous file takes from the freefile with its first append, so logging doesn't have to update
+ * the FAT and directory while it runs. Whole superclusters the file didn't fill are given back when it is closed.
+ */
+#ifndef AFATFS_CONTIGUOUS_PREALLOCATE_SIZE
+#define AFATFS_CONTIGUOUS_PREALLOCATE_SIZE (16 * 1024 * 1024)
+#endif
+
 #define AFATFS_FILES_PER_DIRECTORY_SECTOR (AFATFS_SECTOR_SIZE / sizeof(fatDirectoryEntry_t))
 
 #define AFATFS_FAT32_FAT_ENTRIES_PER_SECTOR  (AFATFS_SECTOR_SIZE / sizeof(uint32_t))
@@ -239,6 +250,7 @@ typedef struct afatfsAppendSupercluster_t {
     uint32_t previousCluster;
     uint32_t fatRewriteStartCluster;
     uint32_t fatRewriteEndCluster;
+    uint32_t superclusterCount;
     afatfsAppendSuperclusterPhase_e phase;
 } afatfsAppendSupercluster_t;
 
@@ -305,8 +317,21 @@ typedef struct afatfsDeleteFile_t {
     afatfsCallback_t callback;
 } afatfsUnlinkFile_t;
 
+typedef enum {
+    AFATFS_CLOSE_FILE_INITIAL = 0,
+#ifdef AFATFS_USE_FREEFILE
+    AFATFS_CLOSE_FILE_TRIM_TERMINATE_CHAIN,
+    AFATFS_CLOSE_FILE_TRIM_LINK_FREEFILE,
+    AFATFS_CLOSE_FILE_TRIM_PREPEND_TO_FREEFILE,
+#endif
+    AFATFS_CLOSE_FILE_SAVE_DIRECTORY
+} afatfsCloseFilePhase_e;
+
 typedef struct afatfsCloseFile_t {
     afatfsCallback_t callback;
+    afatfsCloseFilePhase_e phase;
+    uint32_t trimStartCluster; // First cluster given back to the freefile
+    uint32_t trimCurrentCluster; // Used to mark progress
 } afatfsCloseFile_t;
 
 typedef enum {
@@ -441,6 +466,7 @@ typedef struct afatfs_t {
 
     int cacheDirtyEntries; // The number of cache entries in the AFATFS_CACHE_STATE_DIRTY state
     bool cacheFlushInProgress;
+    uint32_t lastFlushedSector; // Flushing the sector after this one continues the card's multi-block write
 
     afatfsFile_t openFiles[AFATFS_MAX_OPEN_FILES];
 
@@ -483,6 +509,10 @@ typedef struct afatfs_t {
 
     uint32_t rootDirectoryCluster; // Present on FAT32 and set to zero for FAT16
     uint32_t rootDirectorySectors; // Zero on FAT32, for FAT16 the number of sectors that the root directory occupies
+
+#ifdef AFATFS_STATISTICS
+    afatfsStatistics_t statistics;
+#endif
 } afatfs_t;
 
 static afatfs_t afatfs;
@@ -687,19 +717,32 @@ static void afatfs_cacheFlushSector(int cacheIndex)
 
     switch (sdcard_writeBlock(cacheDescriptor->sectorIndex, afatfs_cacheSectorGetMemory(cacheIndex), afatfs_sdcardWriteComplete, 0)) {
         case SDCARD_OPERATION_IN_PROGRESS:
+#ifdef AFATFS_STATISTICS
+            afatfs.statistics.sectorsWritten++;
+#endif
             // The card will call us back later when the buffer transmission finishes
             afatfs.cacheDirtyEntries--;
             cacheDescriptor->state = AFATFS_CACHE_STATE_WRITING;
             afatfs.cacheFlushInProgress = true;
+            afatfs.lastFlushedSector = cacheDescriptor->sectorIndex;
             break;
 
         case SDCARD_OPERATION_SUCCESS:
+#ifdef AFATFS_STATISTICS
+            afatfs.statistics.sectorsWritten++;
+#endif
             // Buffer is already transmitted
             afatfs.cacheDirtyEntries--;
             cacheDescriptor->state = AFATFS_CACHE_STATE_IN_SYNC;
+            afatfs.lastFlushedSector = cacheDescriptor->sectorIndex;
             break;
 
         case SDCARD_OPERATION_BUSY:
+#ifdef AFATFS_STATISTICS
+            afatfs.statistics.flushBusy++;
+#endif
+            break;
+
         case SDCARD_OPERATION_FAILURE:
         default:
             ;
@@ -809,16 +852,23 @@ static int afatfs_allocateCacheSector(uint32_t sectorIndex)
 bool afatfs_flush(void)
 {
     if (afatfs.cacheDirtyEntries > 0) {
-        // Flush the oldest flushable sector
+        /*
+         * Flush the sector which continues the last write if we have it, so that the card keeps going with its
+         * multi-block write, otherwise the oldest flushable sector
+         */
         uint32_t earliestSectorTime = 0xFFFFFFFF;
         int earliestSectorIndex = -1;
 
         for (int i = 0; i < AFATFS_NUM_CACHE_SECTORS; i++) {
-            if (afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_DIRTY && !afatfs.cacheDescriptor[i].locked
-                && (earliestSectorIndex == -1 || afatfs.cacheDescriptor[i].writeTimestamp < earliestSectorTime)
-            ) {
-                earliestSectorIndex = i;
-                earliestSectorTime = afatfs.cacheDescriptor[i].writeTimestamp;
+            if (afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_DIRTY && !afatfs.cacheDescriptor[i].locked) {
+                if (afatfs.cacheDescriptor[i].sectorIndex == afatfs.lastFlushedSector + 1) {
+                    earliestSectorIndex = i;
+                    break;
+                }
+                if (earliestSectorIndex == -1 || afatfs.cacheDescriptor[i].writeTimestamp < earliestSectorTime) {
+                    earliestSectorIndex = i;
+                    earliestSectorTime = afatfs.cacheDescriptor[i].writeTimestamp;
+                }
             }
         }
 
@@ -903,6 +953,9 @@ static afatfsOperationStatus_e afatfs_cacheSector(uint32_t physicalSectorIndex,
     int cacheSectorIndex = afatfs_allocateCacheSector(physicalSectorIndex);
 
     if (cacheSectorIndex == -1) {
+#ifdef AFATFS_STATISTICS
+        afatfs.statistics.cacheFull++;
+#endif
         // We don't have enough free cache to service this request right now, try again later
         return AFATFS_OPERATION_IN_PROGRESS;
     }
@@ -916,6 +969,9 @@ static afatfsOperationStatus_e afatfs_cacheSector(uint32_t physicalSectorIndex,
             if ((sectorFlags & AFATFS_CACHE_READ) != 0) {
                 if (sdcard_readBlock(physicalSectorIndex, afatfs_cacheSectorGetMemory(cacheSectorIndex), afatfs_sdcardReadComplete, 0)) {
                     afatfs.cacheDescriptor[cacheSectorIndex].state = AFATFS_CACHE_STATE_READING;
+#ifdef AFATFS_STATISTICS
+                    afatfs.statistics.cacheReads++;
+#endif
                 }
                 return AFATFS_OPERATION_IN_PROGRESS;
             }
@@ -953,6 +1009,10 @@ static afatfsOperationStatus_e afatfs_cacheSector(uint32_t physicalSectorIndex,
 
             *buffer = afatfs_cacheSectorGetMemory(cacheSectorIndex);
 
+#ifdef AFATFS_STATISTICS
+            afatfs.statistics.cacheRequests++;
+#endif
+
             return AFATFS_OPERATION_SUCCESS;
         break;
 
@@ -1646,7 +1706,7 @@ static afatfsOperationStatus_e afatfs_appendSuperclusterContinue(afatfsFile_t *f
 
             // We can go ahead and write to that space before the FAT and directory are updated
             file->cursorCluster = afatfs.freeFile.firstCluster;
-            file->physicalSize += afatfs_superClusterSize();
+            file->physicalSize += opState->superclusterCount * afatfs_superClusterSize();
 
             /* Remove the first supercluster from the freefile
              *
@@ -1656,13 +1716,13 @@ static afatfsOperationStatus_e afatfs_appendSuperclusterContinue(afatfsFile_t *f
              * Note that normally the freefile can't become empty because it is allocated as a non-integer number
              * of superclusters to avoid precisely this situation.
              */
-            afatfs.freeFile.firstCluster += afatfs_fatEntriesPerSector();
-            afatfs.freeFile.logicalSize -= afatfs_superClusterSize();
-            afatfs.freeFile.physicalSize -= afatfs_superClusterSize();
+            afatfs.freeFile.firstCluster += opState->superclusterCount * afatfs_fatEntriesPerSector();
+            afatfs.freeFile.logicalSize -= opState->superclusterCount * afatfs_superClusterSize();
+            afatfs.freeFile.physicalSize -= opState->superclusterCount * afatfs_superClusterSize();
 
-            // The new supercluster needs to have its clusters chained contiguously and marked with a terminator at the end
+            // The new superclusters need to have their clusters chained contiguously and marked with a terminator at the end
             opState->fatRewriteStartCluster = file->cursorCluster;
-            opState->fatRewriteEndCluster = opState->fatRewriteStartCluster + afatfs_fatEntriesPerSector();
+            opState->fatRewriteEndCluster = opState->fatRewriteStartCluster + opState->superclusterCount * afatfs_fatEntriesPerSector();
 
             if (opState->previousCluster == 0) {
                 // This is the new first cluster in the file so we need to update the directory entry
@@ -1710,7 +1770,7 @@ static afatfsOperationStatus_e afatfs_appendSuperclusterContinue(afatfsFile_t *f
 
 /**
  * Attempt to queue up an operation to append the first supercluster of the freefile to the given `file` (file's cursor
- * must be at end-of-file).
+ * must be at end-of-file). The first append to an empty file takes AFATFS_CONTIGUOUS_PREALLOCATE_SIZE at once.
  *
  * The new cluster number will be set into the file's cursorCluster.
  *
@@ -1742,6 +1802,14 @@ static afatfsOperationStatus_e afatfs_appendSupercluster(afatfsFilePtr_t file)
     file->operation.operation = AFATFS_FILE_OPERATION_APPEND_SUPERCLUSTER;
     opState->phase = AFATFS_APPEND_SUPERCLUSTER_PHASE_INIT;
     opState->previousCluster = file->cursorPreviousCluster;
+    opState->superclusterCount = 1;
+
+    if (opState->previousCluster == 0) {
+        const uint32_t preallocateCount = (AFATFS_CONTIGUOUS_PREALLOCATE_SIZE + superClusterSize - 1) / superClusterSize;
+
+        // The freefile keeps the part of a supercluster it always has on top
+        opState->superclusterCount = constrain(afatfs.freeFile.logicalSize / superClusterSize, 1, preallocateCount);
+    }
 
     return afatfs_appendSuperclusterContinue(file);
 }
@@ -1874,11 +1942,15 @@ static uint8_t* afatfs_fileLockCursorSectorForWrite(afatfsFilePtr_t file)
             cacheFlags |= AFATFS_CACHE_READ;
         }
 
-        // In contiguous append mode, we'll pre-erase the whole supercluster
+        // In contiguous append mode, we'll pre-erase everything the file has allocated past the cursor
         if ((file->mode & (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_CONTIGUOUS)) == (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_CONTIGUOUS)) {
             uint32_t cursorOffsetInSupercluster = file->cursorOffset & (afatfs_superClusterSize() - 1);
 
             eraseBlockCount = afatfs_fatEntriesPerSector() * afatfs.sectorsPerCluster - cursorOffsetInSupercluster / AFATFS_SECTOR_SIZE;
+
+            if (file->physicalSize > offsetOfStartOfSector) {
+                eraseBlockCount = MAX(eraseBlockCount, (file->physicalSize - offsetOfStartOfSector) / AFATFS_SECTOR_SIZE);
+            }
         } else {
             eraseBlockCount = 0;
         }
@@ -2794,11 +2866,101 @@ static afatfsFilePtr_t afatfs_createFile(afatfsFilePtr_t file, const char *name,
     return file;
 }
 
+#ifdef AFATFS_USE_FREEFILE
+
+/**
+ * Give the whole superclusters that a contiguous file didn't fill back to the freefile, which begins right after the
+ * file.
+ *
+ * Returns:
+ *     AFATFS_OPERATION_SUCCESS     - Nothing (more) to give back, the file can be closed
+ *     AFATFS_OPERATION_IN_PROGRESS - Call again later
+ */
+static afatfsOperationStatus_e afatfs_fcloseTrimContinue(afatfsFilePtr_t file)
+{
+    afatfsCloseFile_t *opState = &file->operation.state.closeFile;
+    afatfsOperationStatus_e status = AFATFS_OPERATION_SUCCESS;
+    uint32_t superclustersUsed, freeFileGrow;
+
+    doMore:
+
+    switch (opState->phase) {
+        case AFATFS_CLOSE_FILE_INITIAL:
+            opState->phase = AFATFS_CLOSE_FILE_SAVE_DIRECTORY;
+
+            if ((file->mode & AFATFS_FILE_MODE_CONTIGUOUS) != 0 && file->firstCluster != 0) {
+                // Keep at least one supercluster so the file still has its first cluster
+                superclustersUsed = MAX((file->logicalSize + afatfs_superClusterSize() - 1) / afatfs_superClusterSize(), 1u);
+
+                opState->trimStartCluster = file->firstCluster + superclustersUsed * afatfs_fatEntriesPerSector();
+                opState->trimCurrentCluster = opState->trimStartCluster;
+
+                if (opState->trimStartCluster < afatfs.freeFile.firstCluster) {
+                    opState->phase = AFATFS_CLOSE_FILE_TRIM_TERMINATE_CHAIN;
+                }
+            }
+            goto doMore;
+        break;
+        case AFATFS_CLOSE_FILE_TRIM_TERMINATE_CHAIN:
+            // End the file's chain first, if power is lost part way the clusters are only lost rather than cross-linked
+            status = afatfs_FATSetNextCluster(opState->trimStartCluster - 1, 0xFFFFFFFF);
+
+            if (status == AFATFS_OPERATION_SUCCESS) {
+                opState->phase = AFATFS_CLOSE_FILE_TRIM_LINK_FREEFILE;
+                goto doMore;
+            }
+        break;
+        case AFATFS_CLOSE_FILE_TRIM_LINK_FREEFILE:
+            // Chain the clusters on to the beginning of the freefile
+            status = afatfs_FATFillWithPattern(AFATFS_FAT_PATTERN_UNTERMINATED_CHAIN, &opState->trimCurrentCluster, afatfs.freeFile.firstCluster);
+
+            if (status == AFATFS_OPERATION_SUCCESS) {
+                opState->phase = AFATFS_CLOSE_FILE_TRIM_PREPEND_TO_FREEFILE;
+                goto doMore;
+            }
+        break;
+        case AFATFS_CLOSE_FILE_TRIM_PREPEND_TO_FREEFILE:
+            // Note, it's okay to run this code several times:
+            freeFileGrow = (afatfs.freeFile.firstCluster - opState->trimStartCluster) * afatfs_clusterSize();
+
+            afatfs.freeFile.firstCluster = opState->trimStartCluster;
+            afatfs.freeFile.logicalSize += freeFileGrow;
+            afatfs.freeFile.physicalSize += freeFileGrow;
+            file->physicalSize -= freeFileGrow;
+
+            status = afatfs_saveDirectoryEntry(&afatfs.freeFile, AFATFS_SAVE_DIRECTORY_NORMAL);
+            if (status == AFATFS_OPERATION_SUCCESS) {
+                opState->phase = AFATFS_CLOSE_FILE_SAVE_DIRECTORY;
+                goto doMore;
+            }
+        break;
+        case AFATFS_CLOSE_FILE_SAVE_DIRECTORY:
+            return AFATFS_OPERATION_SUCCESS;
+        break;
+    }
+
+    if (status == AFATFS_OPERATION_FAILURE) {
+        // The file still gets closed, it just keeps the clusters
+        opState->phase = AFATFS_CLOSE_FILE_SAVE_DIRECTORY;
+        return AFATFS_OPERATION_SUCCESS;
+    }
+
+    return status;
+}
+
+#endif
+
 static void afatfs_fcloseContinue(afatfsFilePtr_t file)
 {
     afatfsCacheBlockDescriptor_t *descriptor;
     afatfsCloseFile_t *opState = &file->operation.state.closeFile;
 
+#ifdef AFATFS_USE_FREEFILE
+    if (afatfs_fcloseTrimContinue(file) != AFATFS_OPERATION_SUCCESS) {
+        return;
+    }
+#endif
+
     /*
      * Directories don't update their parent directory entries over time, because their fileSize field in the directory
      * never changes (when we add the first cluster to the directory we save the directory entry at that point and it
@@ -2861,6 +3023,7 @@ bool afatfs_fclose(afatfsFilePtr_t file, afatfsCallback_t callback)
 
         file->operation.operation = AFATFS_FILE_OPERATION_CLOSE;
         file->operation.state.closeFile.callback = callback;
+        file->operation.state.closeFile.phase = AFATFS_CLOSE_FILE_INITIAL;
         afatfs_fcloseContinue(file);
         return true;
     }
@@ -3564,6 +3727,16 @@ afatfsError_e afatfs_getLastError(void)
     return afatfs.lastError;
 }
 
+#ifdef AFATFS_STATISTICS
+/**
+ * Counters for measuring the cache, they are cleared by afatfs_destroy().
+ */
+const afatfsStatistics_t *afatfs_getStatistics(void)
+{
+    return &afatfs.statistics;
+}
+#endif
+
 void afatfs_init(void)
 {
     afatfs.filesystemState = AFATFS_FILESYSTEM_STATE_INITIALIZATION;
@@ -22,6 +22,9 @@
 
 #include "fat_standard.h"
 
+// The only sector size supported, it is also the unit the cache is handed out and flushed in
+#define AFATFS_SECTOR_SIZE  512
+
 typedef struct afatfsFile_t *afatfsFilePtr_t;
 
 typedef enum {
@@ -57,6 +60,16 @@ typedef enum {
     AFATFS_SEEK_END
 } afatfsSeek_e;
 
+#ifdef AFATFS_STATISTICS
+typedef struct afatfsStatistics_t {
+    uint32_t cacheRequests;     // Sector requests that were served from the cache, including ones we had to read first
+    uint32_t cacheReads;        // Sectors read from the card to serve a request
+    uint32_t cacheFull;         // Requests turned away because no cache entry could be evicted
+    uint32_t sectorsWritten;    // Sectors handed to the card
+    uint32_t flushBusy;         // Flushes the card was too busy to accept
+} afatfsStatistics_t;
+#endif
+
 typedef void (*afatfsFileCallback_t)(afatfsFilePtr_t file);
 typedef void (*afatfsCallback_t)(void);
 
@@ -90,3 +103,7 @@ bool afatfs_isFull(void);
 
 afatfsFilesystemState_e afatfs_getFilesystemState(void);
 afatfsError_e afatfs_getLastError(void);
+
+#ifdef AFATFS_STATISTICS
+const afatfsStatistics_t *afatfs_getStatistics(void);
+#endif
@@ -25,14 +25,22 @@
  * Note that bits can only be set to 0 when writing, not back to 1 from 0. You must erase sectors in order
  * to bring bits back to 1 again.
  *
+ * The last sector of the chip holds an index of the logs on the volume, so that they can be listed and read back
+ * one by one. It isn't part of the volume, flashfsGetSize() doesn't count it.
+ *
  * In future, we can add support for multiple different flash chips by adding a flash device driver vtable
  * and make calls through that, at the moment flashfs just calls m25p16_* routines explicitly.
  */
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 
+#include "platform.h"
+
+#include "common/utils.h"
+
 #include "drivers/flash.h"
 #include "drivers/flash_m25p16.h"
 
@@ -47,11 +55,39 @@ static uint8_t flashWriteBuffer[FLASHFS_WRITE_BUFFER_SIZE];
  *
  * When the circular buffer is empty, head == tail
  */
-static uint8_t bufferHead = 0, bufferTail = 0;
+static uint16_t bufferHead = 0, bufferTail = 0;
 
 // The position of the buffer's tail in the overall flash address space:
 static uint32_t tailAddress = 0;
 
+#define FLASHFS_LOG_INDEX_MAGIC 0xB10C
+
+/*
+ * A slot of the log index. Slots are filled in order when logs are closed and an erased slot ends the list, so the
+ * index never has to be erased until the whole chip is.
+ */
+typedef struct flashfsLogRecord_s {
+    uint32_t start;
+    uint32_t length;
+    uint32_t timeMs;
+    uint16_t flagsInverted; // programming a bit to 0 sets a flag, so logs can be deleted without an erase
+    uint16_t magic;
+} flashfsLogRecord_t;
+
+static bool logIndexAvailable = false;
+static int logCount = 0;
+
+static bool logOpen = false;
+static uint32_t logStart;
+static uint32_t logTimeMs;
+
+// Data found at boot without a record, the record is written after boot rather than during it
+static bool recoveredLogPending = false;
+static uint32_t recoveredLogStart;
+static uint32_t recoveredLogLength;
+
+static void flashfsLogWriteRecovered(void);
+
 static void flashfsClearBuffer(void)
 {
     bufferTail = bufferHead = 0;
@@ -67,6 +103,11 @@ static void flashfsSetTailAddress(uint32_t address)
     tailAddress = address;
 }
 
+static bool flashfsLogIndexPresent(void)
+{
+    return m25p16_getGeometry()->sectors > 1;
+}
+
 void flashfsEraseCompletely(void)
 {
     m25p16_eraseCompletely();
@@ -74,6 +115,11 @@ void flashfsEraseCompletely(void)
     flashfsClearBuffer();
 
     flashfsSetTailAddress(0);
+
+    logIndexAvailable = flashfsLogIndexPresent();
+    logCount = 0;
+    logOpen = false;
+    recoveredLogPending = false;
 }
 
 /**
@@ -103,6 +149,21 @@ void flashfsEraseRange(uint32_t start, uint32_t end)
     }
 }
 
+/**
+ * Keep the page programs moving while nothing is being written, call regularly.
+ */
+void flashfsUpdate(timeUs_t currentTimeUs)
+{
+    UNUSED(currentTimeUs);
+
+    m25p16_service();
+    flashfsFlushAsync();
+
+    if (recoveredLogPending && flashfsBufferIsEmpty() && m25p16_isPageBufferFree()) {
+        flashfsLogWriteRecovered();
+    }
+}
+
 /**
  * Return true if the flash is not currently occupied with an operation.
  */
@@ -111,9 +172,22 @@ bool flashfsIsReady(void)
     return m25p16_isReady();
 }
 
+/**
+ * Bytes written to the flashfs that the flash never received, they read back as whatever the pages held before.
+ */
+uint32_t flashfsGetDroppedBytes(void)
+{
+    return m25p16_getDroppedBytes();
+}
+
 uint32_t flashfsGetSize(void)
 {
-    return m25p16_getGeometry()->totalSize;
+    const flashGeometry_t *geometry = m25p16_getGeometry();
+
+    if (flashfsLogIndexPresent()) {
+        return geometry->totalSize - geometry->sectorSize;
+    }
+    return geometry->totalSize;
 }
 
 static uint32_t flashfsTransmitBufferUsed(void)
@@ -149,7 +223,8 @@ const flashGeometry_t* flashfsGetGeometry(void)
  * Write the given buffers to flash sequentially at the current tail address, advancing the tail address after
  * each write.
  *
- * In synchronous mode, waits for the flash to become ready before writing so that every byte requested can be written.
+ * In synchronous mode, waits for the flash to become ready before writing so that every byte requested can be written,
+ * unless the flash times out.
  *
  * In asynchronous mode, if the flash is busy, then the write is aborted and the routine returns immediately.
  * In this case the returned number of bytes written will be less than the total amount requested.
@@ -174,7 +249,7 @@ static uint32_t flashfsWriteBuffers(uint8_t const **buffers, uint32_t *bufferSiz
         bytesTotal += bufferSizes[i];
     }
 
-    if (!sync && !m25p16_isReady()) {
+    if (!sync && !m25p16_isPageBufferFree()) {
         return 0;
     }
 
@@ -202,7 +277,21 @@ static uint32_t flashfsWriteBuffers(uint8_t const **buffers, uint32_t *bufferSiz
             break;
         }
 
-        m25p16_pageProgramBegin(tailAddress);
+        /*
+         * While the flash is busy with earlier pages, leave the end of a page in the buffer to be topped up, fewer
+         * and fuller page programs get more through the chip.
+         */
+        if (!sync && tailAddress % M25P16_PAGESIZE + bytesTotalThisIteration < M25P16_PAGESIZE && !m25p16_isReady()) {
+            break;
+        }
+
+        // If the flash doesn't come ready in time the data stays with the caller
+        if (sync && !m25p16_waitForPageBuffer()) {
+            break;
+        }
+        if (!m25p16_pageProgramBegin(tailAddress)) {
+            break;
+        }
 
         bytesRemainThisIteration = bytesTotalThisIteration;
 
@@ -237,10 +326,10 @@ static uint32_t flashfsWriteBuffers(uint8_t const **buffers, uint32_t *bufferSiz
         flashfsSetTailAddress(tailAddress + bytesTotalThisIteration);
 
         /*
-         * We'll have to wait for that write to complete before we can issue the next one, so if
+         * We'll have to wait for a page buffer to come free before we can issue the next one, so if
          * the user requested asynchronous writes, break now.
          */
-        if (!sync)
+        if (!sync && !m25p16_isPageBufferFree())
             break;
     }
 
@@ -337,17 +426,27 @@ void flashfsFlushSync(void)
     uint8_t const * buffers[2];
     uint32_t bufferSizes[2];
 
+    uint32_t bytesWritten;
+
     flashfsGetDirtyDataBuffers(buffers, bufferSizes);
-    flashfsWriteBuffers(buffers, bufferSizes, 2, true);
+    bytesWritten = flashfsWriteBuffers(buffers, bufferSizes, 2, true);
 
-    // We've written our entire buffer now:
-    flashfsClearBuffer();
+    if (flashfsIsEOF()) {
+        // There's nowhere left to write the rest
+        flashfsClearBuffer();
+    } else {
+        // Anything the flash timed out on stays in the buffer
+        flashfsAdvanceTailInBuffer(bytesWritten);
+    }
 }
 
 void flashfsSeekAbs(uint32_t offset)
 {
     flashfsFlushSync();
 
+    // Data the flash didn't take belongs before the new position
+    flashfsClearBuffer();
+
     flashfsSetTailAddress(offset);
 }
 
@@ -355,6 +454,8 @@ void flashfsSeekRel(int32_t offset)
 {
     flashfsFlushSync();
 
+    flashfsClearBuffer();
+
     flashfsSetTailAddress(tailAddress + offset);
 }
 
@@ -419,8 +520,14 @@ void flashfsWrite(const uint8_t *data, unsigned int len, bool sync)
         if (bufferSizes[0] + bufferSizes[1] + bufferSizes[2] > FLASHFS_WRITE_BUFFER_USABLE) {
             if (sync) {
                 // Write it through synchronously
-                flashfsWriteBuffers(buffers, bufferSizes, 3, true);
-                flashfsClearBuffer();
+                bytesWritten = flashfsWriteBuffers(buffers, bufferSizes, 3, true);
+
+                if (bufferSizes[0] == 0 && bufferSizes[1] == 0) {
+                    flashfsClearBuffer();
+                } else {
+                    // The flash timed out, keep what is left of the buffered data
+                    flashfsAdvanceTailInBuffer(bytesWritten);
+                }
             } else {
                 /*
                  * Silently drop the data the user asked to write (i.e. no-op) since we can't buffer it and they
@@ -482,9 +589,10 @@ int flashfsReadAbs(uint32_t address, uint8_t *buffer, unsigned int len)
 }
 
 /**
- * Find the offset of the start of the free space on the device (or the size of the device if it is full).
+ * Find the offset of the start of the free space on the device (or the size of the device if it is full), assuming
+ * there is no free space before the given offset.
  */
-int flashfsIdentifyStartOfFreeSpace(void)
+static int flashfsIdentifyStartOfFreeSpaceFrom(uint32_t offset)
 {
     /* Find the start of the free space on the device by examining the beginning of blocks with a binary search,
      * looking for ones that appear to be erased. We can achieve this with good accuracy because an erased block
@@ -511,7 +619,7 @@ int flashfsIdentifyStartOfFreeSpace(void)
         uint32_t ints[FREE_BLOCK_TEST_SIZE_INTS];
     } testBuffer;
 
-    int left = 0; // Smallest block index in the search region
+    int left = (offset + FREE_BLOCK_SIZE - 1) / FREE_BLOCK_SIZE; // Smallest block index in the search region
     int right = flashfsGetSize() / FREE_BLOCK_SIZE; // One past the largest block index in the search region
     int mid;
     int result = right;
@@ -550,6 +658,281 @@ int flashfsIdentifyStartOfFreeSpace(void)
     return result * FREE_BLOCK_SIZE;
 }
 
+/**
+ * Find the offset of the start of the free space on the device (or the size of the device if it is full).
+ */
+int flashfsIdentifyStartOfFreeSpace(void)
+{
+    return flashfsIdentifyStartOfFreeSpaceFrom(0);
+}
+
+static int flashfsLogIndexSlots(void)
+{
+    return m25p16_getGeometry()->sectorSize / sizeof(flashfsLogRecord_t);
+}
+
+static uint32_t flashfsLogRecordAddress(int index)
+{
+    return flashfsGetSize() + index * sizeof(flashfsLogRecord_t);
+}
+
+static bool flashfsReadLogRecord(int index, flashfsLogRecord_t *record)
+{
+    return m25p16_readBytes(flashfsLogRecordAddress(index), (uint8_t *)record, sizeof(*record)) == sizeof(*record);
+}
+
+static bool flashfsLogRecordIsErased(const flashfsLogRecord_t *record)
+{
+    const uint8_t *bytes = (const uint8_t *)record;
+    for (unsigned i = 0; i < sizeof(*record); i++) {
+        if (bytes[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool flashfsLogRecordIsDeleted(const flashfsLogRecord_t *record)
+{
+    return ~record->flagsInverted & FLASHFS_LOG_FLAG_DELETED;
+}
+
+// The index records are small and never cross a page, so each is a single program
+static bool flashfsProgramIndex(uint32_t address, const uint8_t *data, int length)
+{
+    return m25p16_pageProgram(address, data, length);
+}
+
+static bool flashfsAppendLog(uint32_t start, uint32_t length, uint32_t timeMs, uint16_t flags)
+{
+    if (!logIndexAvailable || logCount >= flashfsLogIndexSlots() || length == 0) {
+        return false;
+    }
+
+    const flashfsLogRecord_t record = {
+        .start = start,
+        .length = length,
+        .timeMs = timeMs,
+        .flagsInverted = ~flags,
+        .magic = FLASHFS_LOG_INDEX_MAGIC,
+    };
+    if (!flashfsProgramIndex(flashfsLogRecordAddress(logCount), (const uint8_t *)&record, sizeof(record))) {
+        return false;
+    }
+    logCount++;
+
+    return true;
+}
+
+/**
+ * Count the records in the index, the used slots all come before the first erased one.
+ */
+static void flashfsLogIndexInit(void)
+{
+    logIndexAvailable = false;
+    logCount = 0;
+    logOpen = false;
+    recoveredLogPending = false;
+
+    if (!flashfsLogIndexPresent()) {
+        return;
+    }
+
+    int left = 0;
+    int right = flashfsLogIndexSlots();
+    while (left < right) {
+        const int mid = (left + right) / 2;
+        flashfsLogRecord_t record;
+
+        if (!flashfsReadLogRecord(mid, &record)) {
+            return;
+        }
+        if (flashfsLogRecordIsErased(&record)) {
+            right = mid;
+        } else if (record.magic == FLASHFS_LOG_INDEX_MAGIC) {
+            left = mid + 1;
+        } else {
+            // Written before the volume had an index, leave it alone until the chip is erased
+            return;
+        }
+    }
+
+    logIndexAvailable = true;
+    logCount = left;
+}
+
+// Same test as the free space search, a few words of all 1 bits don't turn up in log data
+static bool flashfsLooksErasedAt(uint32_t offset)
+{
+    uint32_t probe[4];
+
+    if (offset + sizeof(probe) > flashfsGetSize()) {
+        return false;
+    }
+    return m25p16_readBytes(offset, (uint8_t *)probe, sizeof(probe)) == sizeof(probe)
+        && (probe[0] & probe[1] & probe[2] & probe[3]) == 0xFFFFFFFF;
+}
+
+/**
+ * Find the start of the free space from the index, which only has to check the end of the newest log unless the
+ * flash holds data the index doesn't know about.
+ */
+static uint32_t flashfsLogFindStartOfFreeSpace(void)
+{
+    if (!logIndexAvailable || logCount >= flashfsLogIndexSlots()) {
+        return flashfsIdentifyStartOfFreeSpace();
+    }
+
+    // Deleting the newest logs may have erased them, the free space starts somewhere after the newest one left
+    uint32_t searchFrom = 0;
+    bool newestIsLive = true;
+    for (int i = logCount - 1; i >= 0; i--) {
+        flashfsLogRecord_t record;
+        if (!flashfsReadLogRecord(i, &record)) {
+            return flashfsIdentifyStartOfFreeSpace();
+        }
+        if (!flashfsLogRecordIsDeleted(&record)) {
+            searchFrom = record.start + record.length;
+            break;
+        }
+        newestIsLive = false;
+    }
+
+    if (newestIsLive && flashfsLooksErasedAt(searchFrom)) {
+        return searchFrom;
+    }
+
+    return flashfsIdentifyStartOfFreeSpaceFrom(searchFrom);
+}
+
+// Deleting the newest logs gives back the sectors after the start of the oldest of them
+static uint32_t flashfsLogReclaimStart(uint32_t start)
+{
+    const uint32_t sectorSize = m25p16_getGeometry()->sectorSize;
+    return (start + sectorSize - 1) / sectorSize * sectorSize;
+}
+
+/**
+ * Add the record of the data flashfsInit() found without one, it goes before any log written since.
+ */
+static void flashfsLogWriteRecovered(void)
+{
+    if (recoveredLogPending) {
+        recoveredLogPending = false;
+        flashfsAppendLog(recoveredLogStart, recoveredLogLength, 0, FLASHFS_LOG_FLAG_RECOVERED);
+    }
+}
+
+/**
+ * Remember where the log about to be written starts, it is added to the index by flashfsLogEnd().
+ */
+void flashfsLogBegin(uint32_t timeMs)
+{
+    logStart = flashfsGetOffset();
+    logTimeMs = timeMs;
+    logOpen = true;
+}
+
+/**
+ * Add the log started by flashfsLogBegin() to the index, unless it isn't worth keeping. Only the first call after
+ * flashfsLogBegin() does anything.
+ */
+void flashfsLogEnd(bool retainLog)
+{
+    if (!logOpen) {
+        return;
+    }
+    logOpen = false;
+
+    flashfsLogWriteRecovered();
+
+    const uint32_t end = flashfsGetOffset();
+    if (retainLog && end > logStart) {
+        flashfsAppendLog(logStart, end - logStart, logTimeMs, 0);
+    }
+}
+
+int flashfsGetLogCount(void)
+{
+    return logCount + (recoveredLogPending ? 1 : 0);
+}
+
+bool flashfsGetLog(int index, flashfsLogEntry_t *entry)
+{
+    flashfsLogRecord_t record;
+
+    if (recoveredLogPending && index == logCount) {
+        entry->start = recoveredLogStart;
+        entry->length = recoveredLogLength;
+        entry->timeMs = 0;
+        entry->flags = FLASHFS_LOG_FLAG_RECOVERED;
+        return true;
+    }
+
+    if (index < 0 || index >= logCount || !flashfsReadLogRecord(index, &record)) {
+        return false;
+    }
+
+    entry->start = record.start;
+    entry->length = record.length;
+    entry->timeMs = record.timeMs;
+    entry->flags = ~record.flagsInverted;
+
+    return true;
+}
+
+/**
+ * Mark a log as deleted and clear its length and time, so nothing points at its space once that is reused. Sectors
+ * are shared with the neighbouring logs, so the space is only given back when nothing newer is left on the volume,
+ * the sectors past the start of the log are then erased and written again.
+ */
+bool flashfsDeleteLog(int index)
+{
+    flashfsLogRecord_t record;
+
+    if (logOpen) {
+        return false;
+    }
+
+    flashfsLogWriteRecovered();
+
+    if (index < 0 || index >= logCount || !flashfsReadLogRecord(index, &record)) {
+        return false;
+    }
+
+    if (flashfsLogRecordIsDeleted(&record)) {
+        // Its space was dealt with the first time, the cleared record doesn't say where it was anyway
+        return true;
+    }
+
+    // The start and the magic stay, the boot needs to know where the space was given back from
+    const flashfsLogRecord_t tombstone = {
+        .start = record.start,
+        .flagsInverted = record.flagsInverted & ~FLASHFS_LOG_FLAG_DELETED,
+    };
+    if (!flashfsProgramIndex(flashfsLogRecordAddress(index), (const uint8_t *)&tombstone,
+        offsetof(flashfsLogRecord_t, magic))) {
+        return false;
+    }
+
+    for (int i = index + 1; i < logCount; i++) {
+        flashfsLogRecord_t newer;
+        if (!flashfsReadLogRecord(i, &newer) || !flashfsLogRecordIsDeleted(&newer)) {
+            return true;
+        }
+    }
+
+    flashfsFlushSync();
+
+    const uint32_t reclaimStart = flashfsLogReclaimStart(record.start);
+    if (reclaimStart < tailAddress) {
+        flashfsEraseRange(reclaimStart, tailAddress);
+        flashfsSeekAbs(reclaimStart);
+    }
+
+    return true;
+}
+
 /**
  * Returns true if the file pointer is at the end of the device.
  */
@@ -565,7 +948,29 @@ void flashfsInit(void)
 {
     // If we have a flash chip present at all
     if (flashfsGetSize() > 0) {
+        flashfsLogIndexInit();
+
         // Start the file pointer off at the beginning of free space so caller can start writing immediately
-        flashfsSeekAbs(flashfsIdentifyStartOfFreeSpace());
+        const uint32_t freeStart = flashfsLogFindStartOfFreeSpace();
+        flashfsSeekAbs(freeStart);
+
+        // List what was written without being indexed, a log cut short by a power loss or one from older firmware
+        uint32_t indexedEnd = 0;
+        flashfsLogEntry_t newest;
+        if (flashfsGetLog(logCount - 1, &newest)) {
+            if (newest.flags & FLASHFS_LOG_FLAG_DELETED) {
+                // What is left of it up to the reclaimed sectors was deleted, not lost
+                indexedEnd = flashfsLogReclaimStart(newest.start);
+            } else {
+                indexedEnd = newest.start + newest.length;
+            }
+        }
+        if (logIndexAvailable && logCount < flashfsLogIndexSlots()
+            && freeStart > indexedEnd && !flashfsLooksErasedAt(indexedEnd)) {
+            // Listed straight away, but only written by flashfsUpdate() or the next log so the boot isn't held up
+            recoveredLogPending = true;
+            recoveredLogStart = indexedEnd;
+            recoveredLogLength = freeStart - indexedEnd;
+        }
     }
 }
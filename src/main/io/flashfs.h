@@ -17,11 +17,32 @@
 
 #pragma once
 
+#include "common/time.h"
+
+#ifdef USE_SPI_DMA_QUEUE
+// Room for two pages, which keeps filling while the flash programs the previous ones
+#define FLASHFS_WRITE_BUFFER_SIZE 512
+
+// Automatically trigger a flush when a page worth of data is in the buffer
+#define FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN 256
+#else
 #define FLASHFS_WRITE_BUFFER_SIZE 128
-#define FLASHFS_WRITE_BUFFER_USABLE (FLASHFS_WRITE_BUFFER_SIZE - 1)
 
 // Automatically trigger a flush when this much data is in the buffer
 #define FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN 64
+#endif
+
+#define FLASHFS_WRITE_BUFFER_USABLE (FLASHFS_WRITE_BUFFER_SIZE - 1)
+
+#define FLASHFS_LOG_FLAG_DELETED    (1 << 0)    // the length and time are cleared, the data stays until its space is reclaimed
+#define FLASHFS_LOG_FLAG_RECOVERED  (1 << 1)    // found on the flash at boot without an index entry, e.g. after a power loss
+
+typedef struct flashfsLogEntry_s {
+    uint32_t start;     // offset of the first byte of the log in the volume
+    uint32_t length;
+    uint32_t timeMs;    // time since power up the log was started at
+    uint16_t flags;     // FLASHFS_LOG_FLAG_*
+} flashfsLogEntry_t;
 
 void flashfsEraseCompletely(void);
 void flashfsEraseRange(uint32_t start, uint32_t end);
@@ -46,6 +67,14 @@ bool flashfsFlushAsync(void);
 void flashfsFlushSync(void);
 
 void flashfsInit(void);
+void flashfsUpdate(timeUs_t currentTimeUs);
 
 bool flashfsIsReady(void);
+uint32_t flashfsGetDroppedBytes(void);
 bool flashfsIsEOF(void);
+
+void flashfsLogBegin(uint32_t timeMs);
+void flashfsLogEnd(bool retainLog);
+int flashfsGetLogCount(void);
+bool flashfsGetLog(int index, flashfsLogEntry_t *entry);
+bool flashfsDeleteLog(int index);
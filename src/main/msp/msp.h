@@ -43,3 +43,5 @@ struct serialPort_s;
 typedef void (*mspPostProcessFnPtr)(struct serialPort_s *port); // msp post process function, used for gracefully handling reboots, etc.
 typedef mspResult_e (*mspProcessCommandFnPtr)(mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn);
 typedef void (*mspProcessReplyFnPtr)(mspPacket_t *cmd);
+// fills the next frame a port sends on its own, ACK when there is one, NO_REPLY when nothing is ready yet, ERROR when done
+typedef mspResult_e (*mspStreamFnPtr)(struct serialPort_s *port, mspPacket_t *frame);
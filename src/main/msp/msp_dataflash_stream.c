@@ -0,0 +1,212 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streaming download: MSP_DATAFLASH_STREAM names a range and the port then sends it as MSP_DATAFLASH_STREAM_DATA
+ * frames without waiting for a request per chunk. The host acknowledges what it got with MSP_DATAFLASH_STREAM_ACK,
+ * at most `window` chunks are sent past the last acknowledged address. A zero length frame ends the stream, a chunk
+ * with a bad CRC is fetched again by starting a new stream at its address.
+ *
+ * A chunk is read from the flash a piece at a time over several calls, so that the serial task never waits long
+ * for the flash and the other ports and tasks keep running while a large chunk is collected.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#ifdef USE_FLASHFS
+
+#include "common/crc.h"
+#include "common/maths.h"
+#include "common/streambuf.h"
+#include "common/utils.h"
+
+#include "io/flashfs.h"
+
+#include "msp/msp.h"
+#include "msp/msp_dataflash_stream.h"
+#include "msp/msp_protocol.h"
+
+#define MSP_DATAFLASH_STREAM_FRAME_INFO     (sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t)) // address, length, crc
+#define MSP_DATAFLASH_STREAM_FRAME_OVERHEAD (MSP_DATAFLASH_STREAM_FRAME_INFO + 8) // and the jumbo frame header and checksum
+#define MSP_DATAFLASH_STREAM_DATA_OFFSET    (sizeof(uint32_t) + sizeof(uint16_t))
+
+typedef struct mspDataflashStream_s {
+    struct serialPort_s *port;
+    uint32_t address;       // first byte of the chunk being read, or the next one
+    uint32_t endAddress;
+    uint32_t ackedAddress;  // the host has everything before this
+    uint16_t chunkSize;
+    uint16_t chunkLength;   // of the chunk being read
+    uint16_t chunkRead;     // bytes of it read so far, zero between chunks
+    uint8_t window;
+    bool endSent;
+} mspDataflashStream_t;
+
+static mspDataflashStream_t dataflashStream = { .endSent = true };
+static uint8_t dataflashStreamFrame[MSP_DATAFLASH_STREAM_FRAME_INFO + MSP_DATAFLASH_STREAM_CHUNK_MAX];
+
+void mspDataflashStreamStop(void)
+{
+    dataflashStream.port = NULL;
+    dataflashStream.endSent = true;
+}
+
+struct serialPort_s *mspDataflashStreamPort(void)
+{
+    return dataflashStream.port;
+}
+
+/*
+ * True after a stream command until mspDataflashStreamAttach() gives the stream its port.
+ */
+bool mspDataflashStreamIsPending(void)
+{
+    return !dataflashStream.port && !dataflashStream.endSent;
+}
+
+/*
+ * Fill the next frame of the stream on `port`. NO_REPLY while the window is full or the chunk is still being read,
+ * ERROR once the stream has ended or the port lost it to another one.
+ */
+mspResult_e mspDataflashStreamNext(struct serialPort_s *port, mspPacket_t *frame)
+{
+    mspDataflashStream_t *stream = &dataflashStream;
+
+    if (port != stream->port) {
+        return MSP_RESULT_ERROR;
+    }
+    if (stream->endSent) {
+        mspDataflashStreamStop();
+        return MSP_RESULT_ERROR;
+    }
+
+    if (stream->chunkRead == 0) {
+        if (stream->address < stream->endAddress && stream->address - stream->ackedAddress >= (uint32_t)stream->window * stream->chunkSize) {
+            return MSP_RESULT_NO_REPLY;
+        }
+        stream->chunkLength = MIN(stream->chunkSize, stream->endAddress - stream->address);
+    }
+
+    if (stream->chunkRead < stream->chunkLength) {
+        // Programming pages or erasing, try again later rather than wait for it
+        if (!flashfsIsReady()) {
+            return MSP_RESULT_NO_REPLY;
+        }
+
+        const uint16_t readLength = MIN(MSP_DATAFLASH_STREAM_READ_SIZE, stream->chunkLength - stream->chunkRead);
+        uint8_t *data = dataflashStreamFrame + MSP_DATAFLASH_STREAM_DATA_OFFSET + stream->chunkRead;
+        if (flashfsReadAbs(stream->address + stream->chunkRead, data, readLength) != readLength) {
+            mspDataflashStreamStop();
+            return MSP_RESULT_ERROR;
+        }
+        stream->chunkRead += readLength;
+
+        if (stream->chunkRead < stream->chunkLength) {
+            return MSP_RESULT_NO_REPLY;
+        }
+    }
+
+    const uint16_t length = stream->chunkLength;
+    sbuf_t *dst = &frame->buf;
+    dst->ptr = dataflashStreamFrame;
+    dst->end = ARRAYEND(dataflashStreamFrame);
+
+    sbufWriteU32(dst, stream->address);
+    sbufWriteU16(dst, length);
+    const uint8_t *data = sbufPtr(dst);
+    sbufAdvance(dst, length);
+    sbufWriteU16(dst, crc16_ccitt_update(0, data, length));
+    sbufSwitchToReader(dst, dataflashStreamFrame);
+
+    frame->cmd = MSP_DATAFLASH_STREAM_DATA;
+    frame->result = MSP_RESULT_ACK;
+    frame->direction = MSP_DIRECTION_REPLY;
+
+    stream->address += length;
+    stream->chunkRead = 0;
+    stream->endSent = length == 0;
+
+    return MSP_RESULT_ACK;
+}
+
+/*
+ * Give the stream to the port the command came from, `txBufferSize` is the free space of its drained transmit buffer.
+ */
+void mspDataflashStreamAttach(struct serialPort_s *port, uint32_t txBufferSize)
+{
+    mspDataflashStream_t *stream = &dataflashStream;
+
+    // Keep two frames in flight
+    const uint32_t chunkFit = txBufferSize / 2 > MSP_DATAFLASH_STREAM_FRAME_OVERHEAD ? txBufferSize / 2 - MSP_DATAFLASH_STREAM_FRAME_OVERHEAD : 0;
+    stream->chunkSize = MAX(MIN(stream->chunkSize, chunkFit), (uint32_t)MSP_DATAFLASH_STREAM_CHUNK_MIN);
+
+    stream->port = port;
+}
+
+mspResult_e mspDataflashStreamCommand(sbuf_t *dst, sbuf_t *src)
+{
+    mspDataflashStream_t *stream = &dataflashStream;
+
+    if (sbufBytesRemaining(src) < 8) {
+        return MSP_RESULT_ERROR;
+    }
+
+    const uint32_t flashfsSize = flashfsGetSize();
+    const uint32_t address = MIN(sbufReadU32(src), flashfsSize);
+    const uint32_t length = MIN(sbufReadU32(src), flashfsSize - address);
+    const uint16_t chunkSize = sbufBytesRemaining(src) >= 2 ? sbufReadU16(src) : MSP_DATAFLASH_STREAM_CHUNK_MAX;
+    const uint8_t window = sbufBytesRemaining(src) >= 1 ? sbufReadU8(src) : MSP_DATAFLASH_STREAM_WINDOW_DEFAULT;
+
+    mspDataflashStreamStop();
+
+    stream->address = address;
+    stream->ackedAddress = address;
+    stream->endAddress = address + length;
+    stream->chunkSize = constrain(chunkSize, MSP_DATAFLASH_STREAM_CHUNK_MIN, MSP_DATAFLASH_STREAM_CHUNK_MAX);
+    stream->chunkRead = 0;
+    stream->window = MAX(window, 1);
+    stream->endSent = length == 0;
+
+    sbufWriteU32(dst, stream->address);
+    sbufWriteU32(dst, length);
+    sbufWriteU16(dst, stream->chunkSize);   // the most a frame carries, the port may need them smaller
+    sbufWriteU8(dst, stream->window);
+
+    return MSP_RESULT_ACK;
+}
+
+mspResult_e mspDataflashStreamAckCommand(sbuf_t *src)
+{
+    mspDataflashStream_t *stream = &dataflashStream;
+
+    if (sbufBytesRemaining(src) < 4) {
+        return MSP_RESULT_ERROR;
+    }
+
+    const uint32_t address = sbufReadU32(src);
+    if (address > stream->ackedAddress && address <= stream->address) {
+        stream->ackedAddress = address;
+    }
+
+    // Replies would get in between the data frames, the next frames are the answer
+    return MSP_RESULT_NO_REPLY;
+}
+
+#endif
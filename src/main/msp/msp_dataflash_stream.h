@@ -0,0 +1,35 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "msp/msp.h"
+
+#define MSP_DATAFLASH_STREAM_CHUNK_MAX      1024    // two frames fit the USB VCP transmit buffer
+#define MSP_DATAFLASH_STREAM_CHUNK_MIN      64
+#define MSP_DATAFLASH_STREAM_READ_SIZE      256     // flash read per call, so the serial task is never held up long
+#define MSP_DATAFLASH_STREAM_WINDOW_DEFAULT 4
+
+struct serialPort_s;
+
+mspResult_e mspDataflashStreamCommand(sbuf_t *dst, sbuf_t *src);
+mspResult_e mspDataflashStreamAckCommand(sbuf_t *src);
+void mspDataflashStreamAttach(struct serialPort_s *port, uint32_t txBufferSize);
+void mspDataflashStreamStop(void);
+struct serialPort_s *mspDataflashStreamPort(void);
+bool mspDataflashStreamIsPending(void);
+mspResult_e mspDataflashStreamNext(struct serialPort_s *port, mspPacket_t *frame);
@@ -272,6 +272,9 @@
 #define MSP_GPS_CONFIG           132    //out message         GPS configuration
 #define MSP_COMPASS_CONFIG       133    //out message         Compass configuration
 #define MSP_ESC_SENSOR_DATA      134    //out message         Extra ESC data from 32-Bit ESCs (Temperature, RPM)
+#define MSP_DATAFLASH_LOG_LIST   135    //out message         Entries of the dataflash log index, starting at the index in the payload
+#define MSP_DATAFLASH_STREAM     136    //out message         Start (or stop, zero length) sending a dataflash range as MSP_DATAFLASH_STREAM_DATA frames
+#define MSP_DATAFLASH_STREAM_DATA 137   //out message         Chunk of a dataflash stream: address, length, data, CRC16-CCITT of the data
 
 #define MSP_SET_RAW_RC           200    //in message          8 rc chan
 #define MSP_SET_RAW_GPS          201    //in message          fix, numsat, lat, lon, alt, speed
@@ -298,6 +301,8 @@
 #define MSP_SET_MOTOR_CONFIG     222    //out message         Motor configuration (min/max throttle, etc)
 #define MSP_SET_GPS_CONFIG       223    //out message         GPS configuration
 #define MSP_SET_COMPASS_CONFIG   224    //out message         Compass configuration
+#define MSP_DATAFLASH_LOG_ERASE  225    //in message          Delete one dataflash log, index in the payload
+#define MSP_DATAFLASH_STREAM_ACK 226    //in message          Dataflash stream received up to the address in the payload, lets the stream go on
 
 // #define MSP_BIND                 240    //in message          no param
 // #define MSP_ALARMS               242
@@ -311,6 +316,8 @@
 
 // Additional commands that are not compatible with MultiWii
 #define MSP_STATUS_EX            150    //out message         cycletime, errors_count, CPU load, sensor present etc
+#define MSP_TASK_STATISTICS      151    //out message         Execution time and start latency histograms of a scheduler task, task id is in the payload
+#define MSP_PROFILER             152    //out message         Hot path profiler scope summary in cycles, or the sample ring of the scope index in the payload
 #define MSP_UID                  160    //out message         Unique device ID
 #define MSP_GPSSVINFO            164    //out message         get Signal Strength (only U-Blox)
 #define MSP_GPSSTATISTICS        166    //out message         get GPS debugging data
@@ -162,6 +162,12 @@ static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet)
     return sizeof(hdr) + len + 1; // header, data, and checksum
 }
 
+static uint32_t mspSerialFrameSize(mspPacket_t *packet)
+{
+    const int len = sbufBytesRemaining(&packet->buf);
+    return 5 + (len >= JUMBO_FRAME_SIZE_LIMIT ? 2 : 0) + len + 1; // header, data, and checksum
+}
+
 static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn)
 {
     static uint8_t outBuf[MSP_PORT_OUTBUF_SIZE];
@@ -193,6 +199,37 @@ static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspPr
 }
 
 
+#define MSP_STREAM_FRAMES_PER_PROCESS 4
+
+/*
+ * Send the frames of a stream while they fit the transmit buffer. The next frame is prepared as soon as one is
+ * queued, so reading it overlaps with the port sending the previous one.
+ */
+static void mspSerialProcessStream(mspPort_t *msp)
+{
+    for (int i = 0; i < MSP_STREAM_FRAMES_PER_PROCESS; i++) {
+        if (!msp->streamFrameReady) {
+            const mspResult_e status = msp->streamFn(msp->port, &msp->streamFrame);
+            if (status == MSP_RESULT_NO_REPLY) {
+                return;
+            }
+            if (status != MSP_RESULT_ACK) {
+                msp->streamFn = NULL;
+                return;
+            }
+            msp->streamFrameReady = true;
+        }
+
+        // Writing never waits for the port, the stream keeps its frames small enough to fit the transmit buffer
+        if (serialTxBytesFree(msp->port) < mspSerialFrameSize(&msp->streamFrame)) {
+            return;
+        }
+
+        mspSerialEncode(msp, &msp->streamFrame);
+        msp->streamFrameReady = false;
+    }
+}
+
 static void mspSerialProcessReceivedReply(mspPort_t *msp, mspProcessReplyFnPtr mspProcessReplyFn)
 {
     mspPacket_t reply = {
@@ -248,6 +285,8 @@ void mspSerialProcess(mspEvaluateNonMspData_e evaluateNonMspData, mspProcessComm
         if (mspPostProcessFn) {
             waitForSerialPortToFinishTransmitting(mspPort->port);
             mspPostProcessFn(mspPort->port);
+        } else if (mspPort->streamFn) {
+            mspSerialProcessStream(mspPort);
         }
     }
 }
@@ -324,3 +363,17 @@ uint32_t mspSerialTxBytesFree(void)
 
     return ret;
 }
+
+/*
+ * Have the MSP port on serialPort send the frames streamFn fills until it returns an error, NULL stops the stream.
+ */
+void mspSerialSetStream(serialPort_t *serialPort, mspStreamFnPtr streamFn)
+{
+    for (int portIndex = 0; portIndex < MAX_MSP_PORT_COUNT; portIndex++) {
+        mspPort_t * const mspPort = &mspPorts[portIndex];
+        if (mspPort->port == serialPort) {
+            mspPort->streamFn = streamFn;
+            mspPort->streamFrameReady = false;
+        }
+    }
+}
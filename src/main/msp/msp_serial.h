@@ -65,6 +65,9 @@ typedef struct mspPort_s {
     mspState_e c_state;
     mspPacketType_e packetType;
     uint8_t inBuf[MSP_PORT_INBUF_SIZE];
+    mspStreamFnPtr streamFn;    // frames sent without a request each, e.g. a dataflash download
+    mspPacket_t streamFrame;
+    bool streamFrameReady;
 } mspPort_t;
 
 void mspSerialInit(void);
@@ -74,3 +77,4 @@ void mspSerialAllocatePorts(void);
 void mspSerialReleasePortIfAllocated(struct serialPort_s *serialPort);
 int mspSerialPush(uint8_t cmd, uint8_t *data, int datalen, mspDirection_e direction);
 uint32_t mspSerialTxBytesFree(void);
+void mspSerialSetStream(struct serialPort_s *serialPort, mspStreamFnPtr streamFn);
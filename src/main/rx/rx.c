@@ -61,6 +61,8 @@
 #include "rx/rx_spi.h"
 #include "rx/targetcustomserial.h"
 
+#include "scheduler/scheduler.h"
+
 
 //#define DEBUG_RX_SIGNAL_LOSS
 
@@ -80,6 +82,8 @@ static uint32_t rxUpdateAt = 0;
 static uint32_t needRxSignalBefore = 0;
 static uint32_t needRxSignalMaxDelayUs;
 static uint32_t suspendRxSignalUntil = 0;
+static timeUs_t rxFrameTimeUs = 0;
+static timeDelta_t rxFrameIntervalUs = 0;
 static uint8_t  skipRxSamples = 0;
 
 static int16_t rcRaw[MAX_SUPPORTED_RC_CHANNEL_COUNT];     // interval [1000;2000]
@@ -288,6 +292,8 @@ void rxInit(void)
 {
     rxRuntimeConfig.rcReadRawFn = nullReadRawRC;
     rxRuntimeConfig.rcFrameStatusFn = nullFrameStatus;
+    rxRuntimeConfig.rcFrameTimeUsFn = NULL;
+    rxRuntimeConfig.rcFrameSignalled = false;
     rcSampleIndex = 0;
     needRxSignalMaxDelayUs = DELAY_10_HZ;
 
@@ -322,6 +328,8 @@ void rxInit(void)
             featureClear(FEATURE_RX_SERIAL);
             rxRuntimeConfig.rcReadRawFn = nullReadRawRC;
             rxRuntimeConfig.rcFrameStatusFn = nullFrameStatus;
+            rxRuntimeConfig.rcFrameTimeUsFn = NULL;
+            rxRuntimeConfig.rcFrameSignalled = false;
         }
     }
 #endif
@@ -340,6 +348,8 @@ void rxInit(void)
             featureClear(FEATURE_RX_SPI);
             rxRuntimeConfig.rcReadRawFn = nullReadRawRC;
             rxRuntimeConfig.rcFrameStatusFn = nullFrameStatus;
+            rxRuntimeConfig.rcFrameTimeUsFn = NULL;
+            rxRuntimeConfig.rcFrameSignalled = false;
         }
     }
 #endif
@@ -382,6 +392,14 @@ void resumeRxSignal(void)
     failsafeOnRxResume();
 }
 
+static void rxUpdateFrameTime(timeUs_t frameTimeUs)
+{
+    if (rxFrameTimeUs) {
+        rxFrameIntervalUs = cmpTimeUs(frameTimeUs, rxFrameTimeUs);
+    }
+    rxFrameTimeUs = frameTimeUs;
+}
+
 bool rxUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTime)
 {
     UNUSED(currentDeltaTime);
@@ -399,6 +417,7 @@ bool rxUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTime)
             rxSignalReceivedNotDataDriven = true;
             rxIsInFailsafeModeNotDataDriven = false;
             needRxSignalBefore = currentTimeUs + needRxSignalMaxDelayUs;
+            rxUpdateFrameTime(currentTimeUs);
             resetPPMDataReceivedState();
         }
     } else if (feature(FEATURE_RX_PARALLEL_PWM)) {
@@ -406,6 +425,7 @@ bool rxUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTime)
             rxSignalReceivedNotDataDriven = true;
             rxIsInFailsafeModeNotDataDriven = false;
             needRxSignalBefore = currentTimeUs + needRxSignalMaxDelayUs;
+            rxUpdateFrameTime(currentTimeUs);
         }
     } else
 #endif
@@ -417,6 +437,8 @@ bool rxUpdateCheck(timeUs_t currentTimeUs, timeDelta_t currentDeltaTime)
             rxIsInFailsafeMode = (frameStatus & RX_FRAME_FAILSAFE) != 0;
             rxSignalReceived = !rxIsInFailsafeMode;
             needRxSignalBefore = currentTimeUs + needRxSignalMaxDelayUs;
+            // drivers that timestamp in their receive ISR don't carry the task scheduling delay
+            rxUpdateFrameTime(rxRuntimeConfig.rcFrameTimeUsFn ? rxRuntimeConfig.rcFrameTimeUsFn() : currentTimeUs);
         }
     }
     return rxDataReceived || (currentTimeUs >= rxUpdateAt); // data driven or 50Hz
@@ -677,3 +699,22 @@ uint16_t rxGetRefreshRate(void)
 {
     return rxRuntimeConfig.rxRefreshRate;
 }
+
+timeUs_t rxGetFrameTimeUs(void)
+{
+    return rxFrameTimeUs;
+}
+
+// time between the last two frames, 0 until two frames have been received
+timeDelta_t rxGetFrameIntervalUs(void)
+{
+    return rxFrameIntervalUs;
+}
+
+// Called by receiver drivers from their receive ISR when a frame is complete, wakes up the RX task
+void rxSignalFrameComplete(void)
+{
+#ifdef USE_SCHEDULER_READY_QUEUE
+    schedulerSignalTask(TASK_RX);
+#endif
+}
@@ -120,6 +120,7 @@ typedef union {
 } sbusFrame_t;
 
 static sbusFrame_t sbusFrame;
+static timeUs_t sbusFrameDoneAt = 0;
 
 // Receive ISR callback
 static void sbusDataReceive(uint16_t c)
@@ -147,6 +148,8 @@ static void sbusDataReceive(uint16_t c)
             sbusFrameDone = false;
         } else {
             sbusFrameDone = true;
+            sbusFrameDoneAt = now;
+            rxSignalFrameComplete();
 #ifdef DEBUG_SBUS_PACKETS
         debug[2] = sbusFrameTime;
 #endif
@@ -217,6 +220,11 @@ static uint8_t sbusFrameStatus(void)
     return RX_FRAME_COMPLETE;
 }
 
+static timeUs_t sbusFrameTimeUs(void)
+{
+    return sbusFrameDoneAt;
+}
+
 static uint16_t sbusReadRawRC(const rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
 {
     UNUSED(rxRuntimeConfig);
@@ -236,6 +244,8 @@ bool sbusInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
 
     rxRuntimeConfig->rcReadRawFn = sbusReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = sbusFrameStatus;
+    rxRuntimeConfig->rcFrameTimeUsFn = sbusFrameTimeUs;
+    rxRuntimeConfig->rcFrameSignalled = true;
 
     const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
     if (!portConfig) {
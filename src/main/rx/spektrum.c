@@ -62,6 +62,7 @@
 static uint8_t spek_chan_shift;
 static uint8_t spek_chan_mask;
 static bool rcFrameComplete = false;
+static timeUs_t rcFrameCompleteAt = 0;
 static bool spekHiRes = false;
 static bool srxlEnabled = false;
 
@@ -103,6 +104,8 @@ static void spektrumDataReceive(uint16_t c)
             rcFrameComplete = false;
         } else {
             rcFrameComplete = true;
+            rcFrameCompleteAt = spekTime;
+            rxSignalFrameComplete();
         }
     }
 }
@@ -157,6 +160,11 @@ static uint8_t spektrumFrameStatus(void)
     return RX_FRAME_COMPLETE;
 }
 
+static timeUs_t spektrumFrameTimeUs(void)
+{
+    return rcFrameCompleteAt;
+}
+
 static uint16_t spektrumReadRawRC(const rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
 {
     uint16_t data;
@@ -335,6 +343,8 @@ bool spektrumInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig
 
     rxRuntimeConfig->rcReadRawFn = spektrumReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = spektrumFrameStatus;
+    rxRuntimeConfig->rcFrameTimeUsFn = spektrumFrameTimeUs;
+    rxRuntimeConfig->rcFrameSignalled = true;
 
     serialPort = openSerialPort(portConfig->identifier,
         FUNCTION_RX_SERIAL,
@@ -47,6 +47,7 @@
 #define SUMD_BAUDRATE 115200
 
 static bool sumdFrameDone = false;
+static timeUs_t sumdFrameDoneAt = 0;
 static uint16_t sumdChannels[SUMD_MAX_CHANNEL];
 static uint16_t crc;
 
@@ -101,6 +102,8 @@ static void sumdDataReceive(uint16_t c)
         if (sumdIndex == sumdChannelCount * 2 + 5) {
             sumdIndex = 0;
             sumdFrameDone = true;
+            sumdFrameDoneAt = sumdTime;
+            rxSignalFrameComplete();
         }
 }
 
@@ -152,6 +155,11 @@ static uint8_t sumdFrameStatus(void)
     return frameStatus;
 }
 
+static timeUs_t sumdFrameTimeUs(void)
+{
+    return sumdFrameDoneAt;
+}
+
 static uint16_t sumdReadRawRC(const rxRuntimeConfig_t *rxRuntimeConfig, uint8_t chan)
 {
     UNUSED(rxRuntimeConfig);
@@ -167,6 +175,8 @@ bool sumdInit(const rxConfig_t *rxConfig, rxRuntimeConfig_t *rxRuntimeConfig)
 
     rxRuntimeConfig->rcReadRawFn = sumdReadRawRC;
     rxRuntimeConfig->rcFrameStatusFn = sumdFrameStatus;
+    rxRuntimeConfig->rcFrameTimeUsFn = sumdFrameTimeUs;
+    rxRuntimeConfig->rcFrameSignalled = true;
 
     const serialPortConfig_t *portConfig = findSerialPortConfig(FUNCTION_RX_SERIAL);
     if (!portConfig) {
@@ -23,6 +23,9 @@
 
 #include "platform.h"
 
+#ifdef USE_SCHEDULER_READY_QUEUE
+#include "build/atomic.h"
+#endif
 #include "build/build_config.h"
 #include "build/debug.h"
 
@@ -69,11 +72,205 @@ STATIC_UNIT_TESTED int taskQueueSize = 0;
 
 STATIC_UNIT_TESTED cfTask_t* taskQueueArray[TASK_COUNT + 1]; // extra item for NULL pointer at end of queue
 
+#ifdef USE_SCHEDULER_READY_QUEUE
+/*
+ * Ready queue scheduler.
+ *
+ * Time driven tasks wait in a min-heap ordered by their next deadline (lastExecutedAt + desiredPeriod),
+ * so each scheduler pass only has to look at the top of the heap. Once due, a task moves to the ready
+ * set, which is a bitmask indexed by task id. Event driven tasks enter the ready set either by being
+ * signalled through schedulerSignalTask() or, for tasks whose producer cannot signal, by having their
+ * checkFunc polled on passes where no realtime task is ready. Signal driven tasks (schedulerSetTaskSignalDriven())
+ * are never polled: their checkFunc runs on the pass after a signal, and as a timeout once desiredPeriod has passed
+ * since they last ran.
+ *
+ * Ready tasks are dispatched in static priority order, which is resolved with one mask per
+ * priority level, so the per-pass cost does not depend on TASK_COUNT. A task that is not realtime only
+ * starts, and checkFuncs are only polled, when their average execution time fits before the next realtime
+ * deadline, so that a short low priority task can use a gap that a long high priority task can not.
+ * A ready task that has waited READY_QUEUE_STARVATION_PERIODS of its periods runs ahead of the other
+ * tasks that are not realtime and regardless of that guard, which bounds starvation under overload.
+ */
+STATIC_ASSERT(TASK_COUNT <= 32, scheduler_ready_queue_task_count);
+
+#define TASK_BIT(taskId) (1U << (taskId))
+#define TASK_NOT_IN_HEAP 0xFF
+#define READY_QUEUE_STARVATION_PERIODS 4
+
+static const uint8_t readyQueuePriorityLevels[] = {
+    TASK_PRIORITY_MAX,
+    TASK_PRIORITY_REALTIME,
+    TASK_PRIORITY_HIGH,
+    TASK_PRIORITY_MEDIUM_HIGH,
+    TASK_PRIORITY_MEDIUM,
+    TASK_PRIORITY_LOW,
+    TASK_PRIORITY_IDLE,
+};
+
+#define READY_QUEUE_PRIORITY_LEVEL_COUNT ARRAYLEN(readyQueuePriorityLevels)
+
+static bool readyQueueEnabled = false;
+static uint32_t readyQueuePriorityMask[READY_QUEUE_PRIORITY_LEVEL_COUNT];
+static uint32_t realtimeTaskMask;
+static uint32_t enabledTaskMask;
+static uint32_t eventTaskMask;
+static uint32_t signalDrivenTaskMask;
+STATIC_UNIT_TESTED uint32_t readyTaskMask;
+static volatile uint32_t signaledTaskMask;
+
+STATIC_UNIT_TESTED uint8_t taskHeap[TASK_COUNT];
+STATIC_UNIT_TESTED int taskHeapSize = 0;
+static uint8_t taskHeapIndex[TASK_COUNT];
+
+static inline cfTaskId_e taskIdOf(const cfTask_t *task)
+{
+    return (cfTaskId_e)(task - cfTasks);
+}
+
+static inline timeUs_t taskDeadline(uint8_t taskId)
+{
+    return cfTasks[taskId].lastExecutedAt + cfTasks[taskId].desiredPeriod;
+}
+
+static inline bool taskHeapLess(int a, int b)
+{
+    return cmpTimeUs(taskDeadline(taskHeap[a]), taskDeadline(taskHeap[b])) < 0;
+}
+
+static void taskHeapSwap(int a, int b)
+{
+    const uint8_t taskId = taskHeap[a];
+    taskHeap[a] = taskHeap[b];
+    taskHeap[b] = taskId;
+    taskHeapIndex[taskHeap[a]] = a;
+    taskHeapIndex[taskHeap[b]] = b;
+}
+
+static void taskHeapSiftUp(int index)
+{
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (!taskHeapLess(index, parent)) {
+            break;
+        }
+        taskHeapSwap(index, parent);
+        index = parent;
+    }
+}
+
+static void taskHeapSiftDown(int index)
+{
+    for (;;) {
+        const int left = 2 * index + 1;
+        const int right = left + 1;
+        int smallest = index;
+        if (left < taskHeapSize && taskHeapLess(left, smallest)) {
+            smallest = left;
+        }
+        if (right < taskHeapSize && taskHeapLess(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        taskHeapSwap(index, smallest);
+        index = smallest;
+    }
+}
+
+static void taskHeapInsert(cfTaskId_e taskId)
+{
+    if (taskHeapIndex[taskId] != TASK_NOT_IN_HEAP) {
+        return;
+    }
+    taskHeap[taskHeapSize] = taskId;
+    taskHeapIndex[taskId] = taskHeapSize;
+    taskHeapSiftUp(taskHeapSize++);
+}
+
+static void taskHeapRemove(cfTaskId_e taskId)
+{
+    const int index = taskHeapIndex[taskId];
+    if (index == TASK_NOT_IN_HEAP) {
+        return;
+    }
+    taskHeapSwap(index, --taskHeapSize);
+    taskHeapIndex[taskId] = TASK_NOT_IN_HEAP;
+    if (index < taskHeapSize) {
+        taskHeapSiftUp(index);
+        taskHeapSiftDown(index);
+    }
+}
+
+static void readyQueueAdd(cfTask_t *task)
+{
+    const cfTaskId_e taskId = taskIdOf(task);
+    enabledTaskMask |= TASK_BIT(taskId);
+    if (task->checkFunc) {
+        eventTaskMask |= TASK_BIT(taskId);
+    } else {
+        taskHeapInsert(taskId);
+    }
+}
+
+static void readyQueueRemove(cfTask_t *task)
+{
+    const cfTaskId_e taskId = taskIdOf(task);
+    taskHeapRemove(taskId);
+    enabledTaskMask &= ~TASK_BIT(taskId);
+    eventTaskMask &= ~TASK_BIT(taskId);
+    readyTaskMask &= ~TASK_BIT(taskId);
+}
+
+static void readyQueueUpdateDeadline(cfTask_t *task)
+{
+    const int index = taskHeapIndex[taskIdOf(task)];
+    if (index != TASK_NOT_IN_HEAP) {
+        taskHeapSiftUp(index);
+        taskHeapSiftDown(taskHeapIndex[taskIdOf(task)]);
+    }
+}
+
+static void readyQueueClear(void)
+{
+    taskHeapSize = 0;
+    memset(taskHeapIndex, TASK_NOT_IN_HEAP, sizeof(taskHeapIndex));
+    enabledTaskMask = 0;
+    eventTaskMask = 0;
+    readyTaskMask = 0;
+    signaledTaskMask = 0;
+}
+
+static void readyQueueInit(void)
+{
+    memset(readyQueuePriorityMask, 0, sizeof(readyQueuePriorityMask));
+    realtimeTaskMask = 0;
+    for (int taskId = 0; taskId < TASK_COUNT; taskId++) {
+        unsigned level = 0;
+        while (level < READY_QUEUE_PRIORITY_LEVEL_COUNT - 1 && cfTasks[taskId].staticPriority < readyQueuePriorityLevels[level]) {
+            level++;
+        }
+        readyQueuePriorityMask[level] |= TASK_BIT(taskId);
+        if (cfTasks[taskId].staticPriority >= TASK_PRIORITY_REALTIME) {
+            realtimeTaskMask |= TASK_BIT(taskId);
+        }
+    }
+
+    readyQueueClear();
+    for (int ii = 0; ii < taskQueueSize; ++ii) {
+        readyQueueAdd(taskQueueArray[ii]);
+    }
+}
+#endif
+
 void queueClear(void)
 {
     memset(taskQueueArray, 0, sizeof(taskQueueArray));
     taskQueuePos = 0;
     taskQueueSize = 0;
+#ifdef USE_SCHEDULER_READY_QUEUE
+    readyQueueClear();
+#endif
 }
 
 bool queueContains(cfTask_t *task)
@@ -96,6 +293,11 @@ bool queueAdd(cfTask_t *task)
             memmove(&taskQueueArray[ii+1], &taskQueueArray[ii], sizeof(task) * (taskQueueSize - ii));
             taskQueueArray[ii] = task;
             ++taskQueueSize;
+#ifdef USE_SCHEDULER_READY_QUEUE
+            if (readyQueueEnabled) {
+                readyQueueAdd(task);
+            }
+#endif
             return true;
         }
     }
@@ -108,6 +310,11 @@ bool queueRemove(cfTask_t *task)
         if (taskQueueArray[ii] == task) {
             memmove(&taskQueueArray[ii], &taskQueueArray[ii+1], sizeof(task) * (taskQueueSize - ii));
             --taskQueueSize;
+#ifdef USE_SCHEDULER_READY_QUEUE
+            if (readyQueueEnabled) {
+                readyQueueRemove(task);
+            }
+#endif
             return true;
         }
     }
@@ -178,6 +385,45 @@ void getCheckFuncInfo(cfCheckFuncInfo_t *checkFuncInfo)
     checkFuncInfo->averageExecutionTime = checkFuncMovingSumExecutionTime / MOVING_SUM_COUNT;
 }
 
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+static const uint16_t taskPercentilePermille[TASK_PERCENTILE_COUNT] = { 500, 990, 999 };
+
+static uint8_t taskHistogramBucket(uint32_t value)
+{
+    return value ? MIN(32 - __builtin_clz(value), TASK_HISTOGRAM_BUCKET_COUNT - 1) : 0;
+}
+
+static void taskHistogramsUpdate(cfTask_t *task, timeDelta_t startLatency, timeUs_t executionTime)
+{
+    task->executionTimeHistogram[taskHistogramBucket(executionTime)]++;
+    task->startLatencyHistogram[taskHistogramBucket(MAX(startLatency, 0))]++;
+}
+
+/*
+ * Returns the upper bound of the bucket that contains the given percentile (in 0.1% steps), or 0 if the histogram is empty.
+ */
+timeUs_t taskHistogramPercentile(const uint32_t *histogram, uint16_t permille)
+{
+    uint32_t total = 0;
+    for (int ii = 0; ii < TASK_HISTOGRAM_BUCKET_COUNT; ii++) {
+        total += histogram[ii];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const uint32_t threshold = ((uint64_t)total * permille + 999) / 1000;
+    uint32_t cumulative = 0;
+    for (int ii = 0; ii < TASK_HISTOGRAM_BUCKET_COUNT; ii++) {
+        cumulative += histogram[ii];
+        if (cumulative >= threshold) {
+            return (1 << ii) - 1;
+        }
+    }
+    return (1 << (TASK_HISTOGRAM_BUCKET_COUNT - 1)) - 1;
+}
+#endif
+
 void getTaskInfo(cfTaskId_e taskId, cfTaskInfo_t * taskInfo)
 {
     taskInfo->taskName = cfTasks[taskId].taskName;
@@ -189,18 +435,33 @@ void getTaskInfo(cfTaskId_e taskId, cfTaskInfo_t * taskInfo)
     taskInfo->totalExecutionTime = cfTasks[taskId].totalExecutionTime;
     taskInfo->averageExecutionTime = cfTasks[taskId].movingSumExecutionTime / MOVING_SUM_COUNT;
     taskInfo->latestDeltaTime = cfTasks[taskId].taskLatestDeltaTime;
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+    taskInfo->executionTimeHistogram = cfTasks[taskId].executionTimeHistogram;
+    taskInfo->startLatencyHistogram = cfTasks[taskId].startLatencyHistogram;
+    for (int ii = 0; ii < TASK_PERCENTILE_COUNT; ii++) {
+        taskInfo->executionTimePercentile[ii] = taskHistogramPercentile(taskInfo->executionTimeHistogram, taskPercentilePermille[ii]);
+        taskInfo->startLatencyPercentile[ii] = taskHistogramPercentile(taskInfo->startLatencyHistogram, taskPercentilePermille[ii]);
+    }
+#endif
 }
 #endif
 
 void rescheduleTask(cfTaskId_e taskId, uint32_t newPeriodMicros)
 {
+    cfTask_t *task;
     if (taskId == TASK_SELF) {
-        cfTask_t *task = currentTask;
-        task->desiredPeriod = MAX(SCHEDULER_DELAY_LIMIT, (timeDelta_t)newPeriodMicros);  // Limit delay to 100us (10 kHz) to prevent scheduler clogging
+        task = currentTask;
     } else if (taskId < TASK_COUNT) {
-        cfTask_t *task = &cfTasks[taskId];
-        task->desiredPeriod = MAX(SCHEDULER_DELAY_LIMIT, (timeDelta_t)newPeriodMicros);  // Limit delay to 100us (10 kHz) to prevent scheduler clogging
+        task = &cfTasks[taskId];
+    } else {
+        return;
+    }
+    task->desiredPeriod = MAX(SCHEDULER_DELAY_LIMIT, (timeDelta_t)newPeriodMicros);  // Limit delay to 100us (10 kHz) to prevent scheduler clogging
+#ifdef USE_SCHEDULER_READY_QUEUE
+    if (readyQueueEnabled) {
+        readyQueueUpdateDeadline(task);
     }
+#endif
 }
 
 void setTaskEnabled(cfTaskId_e taskId, bool enabled)
@@ -240,10 +501,18 @@ void schedulerResetTaskStatistics(cfTaskId_e taskId)
         currentTask->movingSumExecutionTime = 0;
         currentTask->totalExecutionTime = 0;
         currentTask->maxExecutionTime = 0;
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+        memset(currentTask->executionTimeHistogram, 0, sizeof(currentTask->executionTimeHistogram));
+        memset(currentTask->startLatencyHistogram, 0, sizeof(currentTask->startLatencyHistogram));
+#endif
     } else if (taskId < TASK_COUNT) {
         cfTasks[taskId].movingSumExecutionTime = 0;
         cfTasks[taskId].totalExecutionTime = 0;
         cfTasks[taskId].maxExecutionTime = 0;
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+        memset(cfTasks[taskId].executionTimeHistogram, 0, sizeof(cfTasks[taskId].executionTimeHistogram));
+        memset(cfTasks[taskId].startLatencyHistogram, 0, sizeof(cfTasks[taskId].startLatencyHistogram));
+#endif
     }
 #endif
 }
@@ -255,11 +524,265 @@ void schedulerInit(void)
     queueAdd(&cfTasks[TASK_SYSTEM]);
 }
 
+static void schedulerExecuteTask(cfTask_t *selectedTask, timeUs_t currentTimeUs)
+{
+    currentTask = selectedTask;
+
+    if (selectedTask) {
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+        // event driven tasks are due when signalled, time driven tasks one period after their last execution
+        const timeUs_t taskDueAt = selectedTask->checkFunc ? selectedTask->lastSignaledAt : selectedTask->lastExecutedAt + selectedTask->desiredPeriod;
+        const bool hasExecutedBefore = selectedTask->lastExecutedAt != 0;
+#endif
+        // Found a task that should be run
+        selectedTask->taskLatestDeltaTime = currentTimeUs - selectedTask->lastExecutedAt;
+        selectedTask->lastExecutedAt = currentTimeUs;
+        selectedTask->dynamicPriority = 0;
+
+        // Execute task
+#ifdef SKIP_TASK_STATISTICS
+        selectedTask->taskFunc(currentTimeUs);
+#else
+        if (calculateTaskStatistics) {
+            const timeUs_t currentTimeBeforeTaskCall = micros();
+            selectedTask->taskFunc(currentTimeBeforeTaskCall);
+            const timeUs_t taskExecutionTime = micros() - currentTimeBeforeTaskCall;
+            selectedTask->movingSumExecutionTime += taskExecutionTime - selectedTask->movingSumExecutionTime / MOVING_SUM_COUNT;
+            selectedTask->totalExecutionTime += taskExecutionTime;   // time consumed by scheduler + task
+            selectedTask->maxExecutionTime = MAX(selectedTask->maxExecutionTime, taskExecutionTime);
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+            if (hasExecutedBefore) {
+                taskHistogramsUpdate(selectedTask, cmpTimeUs(currentTimeBeforeTaskCall, taskDueAt), taskExecutionTime);
+            }
+#endif
+        } else {
+            selectedTask->taskFunc(currentTimeUs);
+        }
+
+#endif
+#if defined(SCHEDULER_DEBUG)
+        DEBUG_SET(DEBUG_SCHEDULER, 2, micros() - currentTimeUs - taskExecutionTime); // time spent in scheduler
+    } else {
+        DEBUG_SET(DEBUG_SCHEDULER, 2, micros() - currentTimeUs);
+#endif
+    }
+
+#if defined(USE_CHIBIOS)
+    else {
+#ifdef BRAINFPV
+        extern bool brainfpv_settings_updated;
+        if (brainfpv_settings_updated) {
+            brainFPVUpdateSettings();
+            brainfpv_settings_updated = false;
+        }
+#endif
+        // wait for gyro if no tasks are ready
+        if (selectedTask == NULL) {
+            chBSemWaitTimeout(&gyroSem, MS2ST(2));
+        }
+    }
+#endif
+}
+
+#ifdef USE_SCHEDULER_READY_QUEUE
+void schedulerSetReadyQueueMode(bool enabled)
+{
+    if (enabled && !readyQueueEnabled) {
+        readyQueueInit();
+    }
+    readyQueueEnabled = enabled;
+}
+
+/*
+ * Marks an event driven task as ready, it will be considered on the next scheduler pass.
+ * Safe to call from interrupt context.
+ */
+void schedulerSignalTask(cfTaskId_e taskId)
+{
+    if (taskId < TASK_COUNT) {
+        ATOMIC_OR(&signaledTaskMask, TASK_BIT(taskId));
+    }
+}
+
+/*
+ * For event driven tasks whose producer always signals, stops polling the checkFunc on idle passes.
+ */
+void schedulerSetTaskSignalDriven(cfTaskId_e taskId, bool signalDriven)
+{
+    if (taskId < TASK_COUNT) {
+        if (signalDriven) {
+            signalDrivenTaskMask |= TASK_BIT(taskId);
+        } else {
+            signalDrivenTaskMask &= ~TASK_BIT(taskId);
+        }
+    }
+}
+
+static inline timeUs_t taskDueAt(const cfTask_t *task)
+{
+    // event driven tasks are due when signalled, time driven tasks one period after their last execution
+    return task->checkFunc ? task->lastSignaledAt : task->lastExecutedAt + task->desiredPeriod;
+}
+
+static inline timeDelta_t taskExpectedExecutionTime(const cfTask_t *task)
+{
+#ifdef SKIP_TASK_STATISTICS
+    UNUSED(task);
+    return 0;
+#else
+    return task->movingSumExecutionTime / MOVING_SUM_COUNT;
+#endif
+}
+
+// Time left until the earliest realtime deadline, 0 if a realtime task is ready to run
+static timeDelta_t readyQueueTimeToRealtime(timeUs_t currentTimeUs)
+{
+    if (readyTaskMask & realtimeTaskMask) {
+        return 0;
+    }
+    timeDelta_t timeToRealtime = INT32_MAX;
+    for (uint32_t pending = realtimeTaskMask & enabledTaskMask & ~eventTaskMask; pending; pending &= pending - 1) {
+        timeToRealtime = MIN(timeToRealtime, cmpTimeUs(taskDeadline(__builtin_ctz(pending)), currentTimeUs));
+    }
+    return timeToRealtime;
+}
+
+// The ready task, other than a realtime one, that has waited the most periods past READY_QUEUE_STARVATION_PERIODS
+static cfTask_t *readyQueueStarvedTask(timeUs_t currentTimeUs)
+{
+    cfTask_t *starvedTask = NULL;
+    for (uint32_t pending = readyTaskMask & ~realtimeTaskMask; pending; pending &= pending - 1) {
+        cfTask_t *task = &cfTasks[__builtin_ctz(pending)];
+        const timeDelta_t lateBy = cmpTimeUs(currentTimeUs, taskDueAt(task));
+        task->taskAgeCycles = 1 + MAX(lateBy, 0) / task->desiredPeriod;
+        if (task->taskAgeCycles > READY_QUEUE_STARVATION_PERIODS && (!starvedTask || task->taskAgeCycles > starvedTask->taskAgeCycles)) {
+            starvedTask = task;
+        }
+    }
+    return starvedTask;
+}
+
+static void readyQueueScheduler(timeUs_t currentTimeUs)
+{
+    // Move all time driven tasks whose deadline has passed to the ready set
+    while (taskHeapSize > 0 && cmpTimeUs(currentTimeUs, taskDeadline(taskHeap[0])) >= 0) {
+        const cfTaskId_e taskId = taskHeap[0];
+        taskHeapRemove(taskId);
+        readyTaskMask |= TASK_BIT(taskId);
+    }
+
+    const uint32_t signaledTasks = ATOMIC_AND(&signaledTaskMask, 0);
+    const uint32_t readiedTasks = signaledTasks & eventTaskMask & ~signalDrivenTaskMask;
+    if (readiedTasks) {
+        for (uint32_t pending = readiedTasks; pending; pending &= pending - 1) {
+            cfTasks[__builtin_ctz(pending)].lastSignaledAt = currentTimeUs;
+        }
+        readyTaskMask |= readiedTasks;
+    }
+
+    // Signal driven tasks check their event on the pass right after the signal, or after they ran if they were
+    // already waiting to run, so that the event they were signalled for is not left for the timeout
+    const uint32_t deferredTasks = signaledTasks & signalDrivenTaskMask & readyTaskMask;
+    if (deferredTasks) {
+        ATOMIC_OR(&signaledTaskMask, deferredTasks);
+    }
+    uint32_t checkTaskMask = signaledTasks & eventTaskMask & signalDrivenTaskMask;
+
+    // Poll event driven tasks that can not signal, and signal driven tasks that timed out,
+    // but only if the checkFuncs are expected to finish before the next realtime deadline
+    timeDelta_t timeToRealtime = readyQueueTimeToRealtime(currentTimeUs);
+#ifdef SKIP_TASK_STATISTICS
+    const timeDelta_t checkFuncExpectedExecutionTime = 0;
+#else
+    const timeDelta_t checkFuncExpectedExecutionTime = checkFuncMovingSumExecutionTime / MOVING_SUM_COUNT;
+#endif
+    if (checkFuncExpectedExecutionTime < timeToRealtime) {
+        checkTaskMask |= eventTaskMask & ~signalDrivenTaskMask;
+        for (uint32_t pending = eventTaskMask & signalDrivenTaskMask; pending; pending &= pending - 1) {
+            const uint8_t taskId = __builtin_ctz(pending);
+            if (cmpTimeUs(currentTimeUs, taskDeadline(taskId)) >= 0) {
+                checkTaskMask |= TASK_BIT(taskId);
+            }
+        }
+    }
+
+    checkTaskMask &= ~readyTaskMask;
+    for (uint32_t pending = checkTaskMask; pending; pending &= pending - 1) {
+        cfTask_t *task = &cfTasks[__builtin_ctz(pending)];
+        const timeUs_t currentTimeBeforeCheckFuncCall = micros();
+        if (task->checkFunc(currentTimeBeforeCheckFuncCall, currentTimeBeforeCheckFuncCall - task->lastExecutedAt)) {
+#ifndef SKIP_TASK_STATISTICS
+            if (calculateTaskStatistics) {
+                const uint32_t checkFuncExecutionTime = micros() - currentTimeBeforeCheckFuncCall;
+                checkFuncMovingSumExecutionTime += checkFuncExecutionTime - checkFuncMovingSumExecutionTime / MOVING_SUM_COUNT;
+                checkFuncTotalExecutionTime += checkFuncExecutionTime;
+                checkFuncMaxExecutionTime = MAX(checkFuncMaxExecutionTime, checkFuncExecutionTime);
+            }
+#endif
+            task->lastSignaledAt = currentTimeBeforeCheckFuncCall;
+            readyTaskMask |= TASK_BIT(taskIdOf(task));
+        }
+    }
+
+    if (checkTaskMask) {
+        // the checkFuncs took some of the time left
+        timeToRealtime = readyQueueTimeToRealtime(micros());
+    }
+
+    const uint16_t waitingTasks = __builtin_popcount(readyTaskMask);
+    totalWaitingTasksSamples++;
+    totalWaitingTasks += waitingTasks;
+
+    // Realtime tasks go first, then a starved task, then the ready task with the highest static priority
+    // that is expected to finish before the next realtime deadline
+    cfTask_t *selectedTask = NULL;
+    if (timeToRealtime > 0) {
+        selectedTask = readyQueueStarvedTask(currentTimeUs);
+    }
+    for (unsigned level = 0; !selectedTask && readyTaskMask && level < READY_QUEUE_PRIORITY_LEVEL_COUNT; level++) {
+        for (uint32_t pending = readyTaskMask & readyQueuePriorityMask[level]; pending; pending &= pending - 1) {
+            cfTask_t *task = &cfTasks[__builtin_ctz(pending)];
+            if ((realtimeTaskMask & TASK_BIT(taskIdOf(task))) || taskExpectedExecutionTime(task) < timeToRealtime) {
+                selectedTask = task;
+                break;
+            }
+        }
+    }
+
+    if (selectedTask) {
+        const cfTaskId_e taskId = taskIdOf(selectedTask);
+        readyTaskMask &= ~TASK_BIT(taskId);
+        taskHeapRemove(taskId);
+        selectedTask->taskAgeCycles = 1;
+    }
+
+    schedulerExecuteTask(selectedTask, currentTimeUs);
+
+    // Time driven tasks wait for their next deadline, unless the task disabled itself
+    if (selectedTask && (enabledTaskMask & ~eventTaskMask & TASK_BIT(taskIdOf(selectedTask)))) {
+        taskHeapInsert(taskIdOf(selectedTask));
+    }
+
+#ifdef UNIT_TEST
+    const uint16_t selectedTaskDynamicPriority = selectedTask ? selectedTask->staticPriority : 0;
+    const bool outsideRealtimeGuardInterval = timeToRealtime > 0;
+#endif
+    GET_SCHEDULER_LOCALS();
+}
+#endif
+
 void scheduler(void)
 {
     // Cache currentTime
     const timeUs_t currentTimeUs = micros();
 
+#ifdef USE_SCHEDULER_READY_QUEUE
+    if (readyQueueEnabled) {
+        readyQueueScheduler(currentTimeUs);
+        return;
+    }
+#endif
+
     // Check for realtime tasks
     bool outsideRealtimeGuardInterval = true;
     for (const cfTask_t *task = queueFirst(); task != NULL && task->staticPriority >= TASK_PRIORITY_REALTIME; task = queueNext()) {
@@ -333,52 +856,7 @@ void scheduler(void)
     totalWaitingTasksSamples++;
     totalWaitingTasks += waitingTasks;
 
-    currentTask = selectedTask;
-
-    if (selectedTask) {
-        // Found a task that should be run
-        selectedTask->taskLatestDeltaTime = currentTimeUs - selectedTask->lastExecutedAt;
-        selectedTask->lastExecutedAt = currentTimeUs;
-        selectedTask->dynamicPriority = 0;
-
-        // Execute task
-#ifdef SKIP_TASK_STATISTICS
-        selectedTask->taskFunc(currentTimeUs);
-#else
-        if (calculateTaskStatistics) {
-            const timeUs_t currentTimeBeforeTaskCall = micros();
-            selectedTask->taskFunc(currentTimeBeforeTaskCall);
-            const timeUs_t taskExecutionTime = micros() - currentTimeBeforeTaskCall;
-            selectedTask->movingSumExecutionTime += taskExecutionTime - selectedTask->movingSumExecutionTime / MOVING_SUM_COUNT;
-            selectedTask->totalExecutionTime += taskExecutionTime;   // time consumed by scheduler + task
-            selectedTask->maxExecutionTime = MAX(selectedTask->maxExecutionTime, taskExecutionTime);
-        } else {
-            selectedTask->taskFunc(currentTimeUs);
-        }
-
-#endif
-#if defined(SCHEDULER_DEBUG)
-        DEBUG_SET(DEBUG_SCHEDULER, 2, micros() - currentTimeUs - taskExecutionTime); // time spent in scheduler
-    } else {
-        DEBUG_SET(DEBUG_SCHEDULER, 2, micros() - currentTimeUs);
-#endif
-    }
-
-#if defined(USE_CHIBIOS)
-    else {
-#ifdef BRAINFPV
-        extern bool brainfpv_settings_updated;
-        if (brainfpv_settings_updated) {
-            brainFPVUpdateSettings();
-            brainfpv_settings_updated = false;
-        }
-#endif
-        // wait for gyro if no tasks are ready
-        if (selectedTask == NULL) {
-            chBSemWaitTimeout(&gyroSem, MS2ST(2));
-        }
-    }
-#endif
+    schedulerExecuteTask(selectedTask, currentTimeUs);
 
     GET_SCHEDULER_LOCALS();
 }
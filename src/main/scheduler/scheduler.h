@@ -35,6 +35,18 @@ typedef struct {
     timeUs_t     averageExecutionTime;
 } cfCheckFuncInfo_t;
 
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+// Bucket 0 counts 0us, bucket n counts [2^(n-1), 2^n) us, the last bucket also collects everything above
+#define TASK_HISTOGRAM_BUCKET_COUNT 16
+
+typedef enum {
+    TASK_PERCENTILE_50 = 0,
+    TASK_PERCENTILE_99,
+    TASK_PERCENTILE_99_9,
+    TASK_PERCENTILE_COUNT
+} cfTaskPercentile_e;
+#endif
+
 typedef struct {
     const char * taskName;
     const char * subTaskName;
@@ -45,6 +57,12 @@ typedef struct {
     timeUs_t     maxExecutionTime;
     timeUs_t     totalExecutionTime;
     timeUs_t     averageExecutionTime;
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+    timeUs_t     executionTimePercentile[TASK_PERCENTILE_COUNT];
+    timeUs_t     startLatencyPercentile[TASK_PERCENTILE_COUNT];
+    const uint32_t *executionTimeHistogram;
+    const uint32_t *startLatencyHistogram;
+#endif
 } cfTaskInfo_t;
 
 typedef enum {
@@ -118,6 +136,14 @@ typedef enum {
     TASK_RCSPLIT,
 #endif
 
+#if defined(BLACKBOX) && defined(USE_BLACKBOX_DEFERRED)
+    TASK_BLACKBOX,
+#endif
+
+#if defined(USE_FLASHFS) && defined(USE_SPI_DMA_QUEUE)
+    TASK_FLASHFS,
+#endif
+
     /* Count of real tasks */
     TASK_COUNT,
 
@@ -147,6 +173,10 @@ typedef struct {
     timeUs_t movingSumExecutionTime;  // moving sum over 32 samples
     timeUs_t maxExecutionTime;
     timeUs_t totalExecutionTime;    // total time consumed by task since boot
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+    uint32_t executionTimeHistogram[TASK_HISTOGRAM_BUCKET_COUNT];
+    uint32_t startLatencyHistogram[TASK_HISTOGRAM_BUCKET_COUNT];  // actual start time minus due time
+#endif
 #endif
 } cfTask_t;
 
@@ -160,6 +190,14 @@ void setTaskEnabled(cfTaskId_e taskId, bool newEnabledState);
 timeDelta_t getTaskDeltaTime(cfTaskId_e taskId);
 void schedulerSetCalulateTaskStatistics(bool calculateTaskStatistics);
 void schedulerResetTaskStatistics(cfTaskId_e taskId);
+#ifdef USE_TASK_STATISTICS_HISTOGRAMS
+timeUs_t taskHistogramPercentile(const uint32_t *histogram, uint16_t permille);
+#endif
+#ifdef USE_SCHEDULER_READY_QUEUE
+void schedulerSetReadyQueueMode(bool enabled);
+void schedulerSignalTask(cfTaskId_e taskId);
+void schedulerSetTaskSignalDriven(cfTaskId_e taskId, bool signalDriven);
+#endif
 
 void schedulerInit(void);
 void scheduler(void);
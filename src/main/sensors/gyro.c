@@ -23,7 +23,10 @@
 
 #include "platform.h"
 
+#include "blackbox/blackbox.h"
+
 #include "build/debug.h"
+#include "build/profiler.h"
 
 #include "common/axis.h"
 #include "common/maths.h"
@@ -57,6 +60,8 @@
 
 #include "fc/runtime_config.h"
 
+#include "flight/rpm_filter.h"
+
 #include "io/beeper.h"
 #include "io/statusindicator.h"
 
@@ -124,8 +129,16 @@ typedef struct gyroSensor_s {
     biquadFilter_t notchFilter1[XYZ_AXIS_COUNT];
     filterApplyFnPtr notchFilter2ApplyFn;
     biquadFilter_t notchFilter2[XYZ_AXIS_COUNT];
+#ifdef USE_GYRO_DATA_ANALYSE
     filterApplyFnPtr notchFilterDynApplyFn;
-    biquadFilter_t notchFilterDyn[XYZ_AXIS_COUNT];
+    uint8_t notchFilterDynCount;
+    biquadFilter_t notchFilterDyn[XYZ_AXIS_COUNT][DYN_NOTCH_COUNT_MAX];
+#endif
+#ifdef USE_GYRO_FILTER_BANK
+    // static notches and biquad/PT1 soft LPF for all axes, used when gyro debugging is off
+    filterBank_t filterBank;
+    filterApplyFnPtr filterBankLpfApplyFn; // soft LPF types the bank can't hold
+#endif
     timeUs_t overflowTimeUs;
     bool overflowDetected;
 } gyroSensor_t;
@@ -155,7 +168,7 @@ static void gyroInitSensorFilters(gyroSensor_t *gyroSensor);
 #define GYRO_CHECK_OVERFLOW_DEFAULT  false
 #endif
 
-PG_REGISTER_WITH_RESET_TEMPLATE(gyroConfig_t, gyroConfig, PG_GYRO_CONFIG, 1);
+PG_REGISTER_WITH_RESET_TEMPLATE(gyroConfig_t, gyroConfig, PG_GYRO_CONFIG, 4);
 
 PG_RESET_TEMPLATE(gyroConfig_t, gyroConfig,
     .gyro_align = ALIGN_DEFAULT,
@@ -171,7 +184,10 @@ PG_RESET_TEMPLATE(gyroConfig_t, gyroConfig,
     .gyro_soft_notch_cutoff_1 = 300,
     .gyro_soft_notch_hz_2 = 200,
     .gyro_soft_notch_cutoff_2 = 100,
-    .checkOverflow = GYRO_OVERFLOW_CHECK_ALL_AXES
+    .checkOverflow = GYRO_OVERFLOW_CHECK_ALL_AXES,
+    .dyn_notch_analyser = DYN_NOTCH_ANALYSER_FFT,
+    .dyn_notch_count = 1,
+    .gyro_sample_ring = false
 );
 
 
@@ -407,6 +423,12 @@ static bool gyroInitSensor(gyroSensor_t *gyroSensor)
     gyroInitSensorFilters(gyroSensor);
 #ifdef USE_GYRO_DATA_ANALYSE
     gyroDataAnalyseInit(gyro.targetLooptime);
+#endif
+#ifdef USE_GYRO_SAMPLE_RING
+    if (gyroConfig()->gyro_sample_ring) {
+        // falls back to reading in the gyro task if the gyro has no usable data ready interrupt
+        mpuGyroSampleRingEnable(&gyroSensor->gyroDev);
+    }
 #endif
     return true;
 }
@@ -532,15 +554,54 @@ static void gyroInitFilterNotch2(gyroSensor_t *gyroSensor, uint16_t notchHz, uin
 static void gyroInitFilterDynamicNotch(gyroSensor_t *gyroSensor)
 {
     gyroSensor->notchFilterDynApplyFn = nullFilterApply;
+    gyroSensor->notchFilterDynCount = 0;
 
     if (isDynamicFilterActive()) {
         gyroSensor->notchFilterDynApplyFn = (filterApplyFnPtr)biquadFilterApplyDF1; // must be this function, not DF2
+        gyroSensor->notchFilterDynCount = constrain(gyroConfig()->dyn_notch_count, 1, DYN_NOTCH_COUNT_MAX);
         const float notchQ = filterGetNotchQ(400, 390); //just any init value
         for (int axis = 0; axis < 3; axis++) {
-            biquadFilterInit(&gyroSensor->notchFilterDyn[axis], 400, gyro.targetLooptime, notchQ, FILTER_NOTCH);
+            for (int i = 0; i < DYN_NOTCH_COUNT_MAX; i++) {
+                biquadFilterInit(&gyroSensor->notchFilterDyn[axis][i], 400, gyro.targetLooptime, notchQ, FILTER_NOTCH);
+            }
         }
     }
 }
+
+static float gyroApplyDynamicNotches(gyroSensor_t *gyroSensor, int axis, float gyroADCf)
+{
+    for (int i = 0; i < gyroSensor->notchFilterDynCount; i++) {
+        gyroADCf = gyroSensor->notchFilterDynApplyFn(&gyroSensor->notchFilterDyn[axis][i], gyroADCf);
+    }
+    return gyroADCf;
+}
+#endif
+
+#ifdef USE_GYRO_FILTER_BANK
+// Mirrors the per axis filters set up above into a filter bank, in the same order as they are applied
+static void gyroInitFilterBank(gyroSensor_t *gyroSensor)
+{
+    filterBank_t *bank = &gyroSensor->filterBank;
+    filterBankInit(bank);
+
+    const uint16_t notchHz1 = calculateNyquistAdjustedNotchHz(gyroConfig()->gyro_soft_notch_hz_1, gyroConfig()->gyro_soft_notch_cutoff_1);
+    if (notchHz1 != 0 && gyroConfig()->gyro_soft_notch_cutoff_1 != 0) {
+        filterBankAddBiquad(bank, notchHz1, gyro.targetLooptime, filterGetNotchQ(notchHz1, gyroConfig()->gyro_soft_notch_cutoff_1), FILTER_NOTCH);
+    }
+    const uint16_t notchHz2 = calculateNyquistAdjustedNotchHz(gyroConfig()->gyro_soft_notch_hz_2, gyroConfig()->gyro_soft_notch_cutoff_2);
+    if (notchHz2 != 0 && gyroConfig()->gyro_soft_notch_cutoff_2 != 0) {
+        filterBankAddBiquad(bank, notchHz2, gyro.targetLooptime, filterGetNotchQ(notchHz2, gyroConfig()->gyro_soft_notch_cutoff_2), FILTER_NOTCH);
+    }
+
+    gyroSensor->filterBankLpfApplyFn = nullFilterApply;
+    if (gyroSensor->softLpfFilterApplyFn == (filterApplyFnPtr)biquadFilterApply) {
+        filterBankAddBiquad(bank, gyroConfig()->gyro_soft_lpf_hz, gyro.targetLooptime, 1.0f / sqrtf(2.0f), FILTER_LPF);
+    } else if (gyroSensor->softLpfFilterApplyFn == (filterApplyFnPtr)pt1FilterApply) {
+        filterBankAddPt1(bank, gyroConfig()->gyro_soft_lpf_hz, (float)gyro.targetLooptime * 0.000001f);
+    } else {
+        gyroSensor->filterBankLpfApplyFn = gyroSensor->softLpfFilterApplyFn;
+    }
+}
 #endif
 
 static void gyroInitSensorFilters(gyroSensor_t *gyroSensor)
@@ -554,6 +615,9 @@ static void gyroInitSensorFilters(gyroSensor_t *gyroSensor)
 #ifdef USE_GYRO_DATA_ANALYSE
     gyroInitFilterDynamicNotch(gyroSensor);
 #endif
+#ifdef USE_GYRO_FILTER_BANK
+    gyroInitFilterBank(gyroSensor);
+#endif
 }
 
 void gyroInitFilters(void)
@@ -705,12 +769,12 @@ static void checkForOverflow(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
 }
 #endif // (FLASH_SIZE > 128)
 
-void gyroUpdateSensor(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
+static void gyroUpdateSensorSample(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
 {
-    if (!gyroSensor->gyroDev.readFn(&gyroSensor->gyroDev)) {
-        return;
-    }
-    gyroSensor->gyroDev.dataReady = false;
+#ifdef USE_BLACKBOX_GYRO_RAW
+    // every sample as the gyro reported it, for spectra that aren't aliased by the blackbox rate
+    blackboxGyroRawSample(gyroSensor->gyroDev.gyroADCRaw, currentTimeUs);
+#endif
 
     if (isGyroSensorCalibrationComplete(gyroSensor)) {
         // move 16-bit gyro data into 32-bit variables to avoid overflows in calculations
@@ -750,16 +814,37 @@ void gyroUpdateSensor(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
         checkForOverflow(gyroSensor, currentTimeUs);
     }
 #endif
+    PROFILE_BEGIN(PROFILER_SCOPE_GYRO_FILTERS);
     if (gyroDebugMode == DEBUG_NONE) {
+#ifdef USE_GYRO_FILTER_BANK
+        float gyroADCfBank[XYZ_AXIS_COUNT];
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            gyroADCfBank[axis] = (float)gyroSensor->gyroDev.gyroADC[axis] * gyroSensor->gyroDev.scale;
+#ifdef USE_RPM_FILTER
+            gyroADCfBank[axis] = rpmFilterGyro(axis, gyroADCfBank[axis]);
+#endif
+#ifdef USE_GYRO_DATA_ANALYSE
+            gyroADCfBank[axis] = gyroApplyDynamicNotches(gyroSensor, axis, gyroADCfBank[axis]);
+#endif
+        }
+        filterBankApply(&gyroSensor->filterBank, gyroADCfBank);
+#endif
         for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
             // NOTE: this branch optimized for when there is no gyro debugging, ensure it is kept in step with non-optimized branch
+#ifdef USE_GYRO_FILTER_BANK
+            const float gyroADCf = gyroSensor->filterBankLpfApplyFn(gyroSensor->softLpfFilterPtr[axis], gyroADCfBank[axis]);
+#else
             float gyroADCf = (float)gyroSensor->gyroDev.gyroADC[axis] * gyroSensor->gyroDev.scale;
+#ifdef USE_RPM_FILTER
+            gyroADCf = rpmFilterGyro(axis, gyroADCf);
+#endif
 #ifdef USE_GYRO_DATA_ANALYSE
-            gyroADCf = gyroSensor->notchFilterDynApplyFn(&gyroSensor->notchFilterDyn[axis], gyroADCf);
+            gyroADCf = gyroApplyDynamicNotches(gyroSensor, axis, gyroADCf);
 #endif
             gyroADCf = gyroSensor->notchFilter1ApplyFn(&gyroSensor->notchFilter1[axis], gyroADCf);
             gyroADCf = gyroSensor->notchFilter2ApplyFn(&gyroSensor->notchFilter2[axis], gyroADCf);
             gyroADCf = gyroSensor->softLpfFilterApplyFn(gyroSensor->softLpfFilterPtr[axis], gyroADCf);
+#endif
             gyro.gyroADCf[axis] = gyroADCf;
             if (
 // Fix to make F1 fit into flash in 3.2
@@ -782,13 +867,17 @@ void gyroUpdateSensor(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
             // DEBUG_GYRO_NOTCH records the unfiltered gyro output
             DEBUG_SET(DEBUG_GYRO_NOTCH, axis, lrintf(gyroADCf));
 
+#ifdef USE_RPM_FILTER
+            gyroADCf = rpmFilterGyro(axis, gyroADCf);
+#endif
+
 #ifdef USE_GYRO_DATA_ANALYSE
             // Apply Dynamic Notch filtering
             if (isDynamicFilterActive()) {
                 if (axis == 0) {
                     DEBUG_SET(DEBUG_FFT, 0, lrintf(gyroADCf)); // store raw data
                 }
-                gyroADCf = gyroSensor->notchFilterDynApplyFn(&gyroSensor->notchFilterDyn[axis], gyroADCf);
+                gyroADCf = gyroApplyDynamicNotches(gyroSensor, axis, gyroADCf);
                 if (axis == 0) {
                     DEBUG_SET(DEBUG_FFT, 1, lrintf(gyroADCf)); // store data after dynamic notch
                 }
@@ -818,6 +907,7 @@ void gyroUpdateSensor(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
             }
         }
     }
+    PROFILE_END(PROFILER_SCOPE_GYRO_FILTERS);
 
 #if defined(USE_BRAINFPV_SPECTROGRAPH)
     if (spec_data_processed) {
@@ -840,6 +930,31 @@ void gyroUpdateSensor(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
 #endif /* defined(USE_BRAINFPV_SPECTROGRAPH) */
 }
 
+void gyroUpdateSensor(gyroSensor_t *gyroSensor, timeUs_t currentTimeUs)
+{
+#ifdef USE_GYRO_SAMPLE_RING
+    if (gyroSensor->gyroDev.sampleRingActive) {
+        // filter every sample queued by the data ready interrupt since the last update, oldest first
+        gyroSample_t sample;
+        while (gyroSampleRingPop(&gyroSensor->gyroDev.sampleRing, &sample)) {
+            gyroSensor->gyroDev.gyroADCRaw[X] = sample.adcRaw[X];
+            gyroSensor->gyroDev.gyroADCRaw[Y] = sample.adcRaw[Y];
+            gyroSensor->gyroDev.gyroADCRaw[Z] = sample.adcRaw[Z];
+            gyroUpdateSensorSample(gyroSensor, sample.timeUs);
+        }
+        gyroSensor->gyroDev.dataReady = false;
+        UNUSED(currentTimeUs);
+        return;
+    }
+#endif
+    if (!gyroSensor->gyroDev.readFn(&gyroSensor->gyroDev)) {
+        return;
+    }
+    gyroSensor->gyroDev.dataReady = false;
+
+    gyroUpdateSensorSample(gyroSensor, currentTimeUs);
+}
+
 void gyroUpdate(timeUs_t currentTimeUs)
 {
     gyroUpdateSensor(&gyroSensor1, currentTimeUs);
@@ -857,6 +972,12 @@ int16_t gyroGetTemperature(void)
     return gyroSensor1.gyroDev.temperature;
 }
 
+// degrees per second per LSB of gyroADCRaw
+float gyroRawScale(void)
+{
+    return gyroSensor1.gyroDev.scale;
+}
+
 int16_t gyroRateDps(int axis)
 {
     return lrintf(gyro.gyroADCf[axis] / gyroSensor1.gyroDev.scale);
@@ -70,6 +70,9 @@ typedef struct gyroConfig_s {
     uint16_t gyro_soft_notch_hz_2;
     uint16_t gyro_soft_notch_cutoff_2;
     gyroOverflowCheck_e checkOverflow;
+    uint8_t  dyn_notch_analyser;               // dynNotchAnalyser_e
+    uint8_t  dyn_notch_count;                  // notches per axis, 1 follows the weighted mean of the spectrum
+    bool     gyro_sample_ring;                 // read the gyro in its data ready interrupt and filter every queued sample
 } gyroConfig_t;
 
 PG_DECLARE(gyroConfig_t, gyroConfig);
@@ -88,5 +91,6 @@ bool isFirstArmingGyroCalibrationRunning(void);
 bool isGyroCalibrationComplete(void);
 void gyroReadTemperature(void);
 int16_t gyroGetTemperature(void);
+float gyroRawScale(void);
 int16_t gyroRateDps(int axis);
 bool gyroOverflowDetected(void);
@@ -26,6 +26,7 @@
 
 #include "common/filter.h"
 #include "common/maths.h"
+#include "common/sdft.h"
 #include "common/time.h"
 #include "common/utils.h"
 
@@ -54,12 +55,16 @@
 #define FFT_BPF_HZ                    200  // use a bandpass on gyro data to ignore extreme low and extreme high frequencies
 #define DYN_NOTCH_WIDTH               100  // just an orientation and start value
 #define DYN_NOTCH_CHANGERATE           60  // lower cut does not improve the performance much, higher cut makes it worse...
+#define SDFT_SAMPLING_RATE           2000  // the sliding DFT window spans half the time of the FFT one, so its estimate lags less
+#define SDFT_DYN_NOTCH_CHANGERATE     120  // estimates from the shorter window need less smoothing
 #define DYN_NOTCH_MIN_CUTOFF          120  // don't cut too deep into low frequencies
 #define DYN_NOTCH_MAX_CUTOFF          200  // don't go above this cutoff (better filtering with "constant" delay at higher center frequencies)
+#define DYN_NOTCH_PEAK_MIN_RATIO     0.2f  // with multiple notches, ignore peaks smaller than this fraction of the largest one
 
 #define BIQUAD_Q 1.0f / sqrtf(2.0f)         // quality factor - butterworth
 
 static uint16_t samplingFrequency;          // gyro rate
+static uint16_t analyseRate;                // rate of the samples in the analysed window
 static uint8_t fftBinCount;
 static float fftResolution;                 // hz per bin
 static float gyroData[3][FFT_WINDOW_SIZE];  // gyro data used for frequency analysis
@@ -68,8 +73,10 @@ static arm_rfft_fast_instance_f32 fftInstance;
 static float fftData[FFT_WINDOW_SIZE];
 static float rfftData[FFT_WINDOW_SIZE];
 static gyroFftData_t fftResult[3];
-static uint16_t fftMaxFreq = 0;             // nyquist rate
+static uint16_t fftMaxFreq = 0;             // highest frequency analysed
 static uint16_t fftIdx = 0;                 // use a circular buffer for the last FFT_WINDOW_SIZE samples
+static uint8_t dynNotchCount;
+static uint8_t peakMinBin;                  // lowest bin considered by the peak detection
 
 
 // accumulator for oversampled data => no aliasing and less noise
@@ -81,7 +88,15 @@ static int fftSamplingScale;
 static biquadFilter_t fftGyroFilter[3];
 
 // filter for smoothing frequency estimation
-static biquadFilter_t fftFreqFilter[3];
+static biquadFilter_t fftFreqFilter[3][DYN_NOTCH_COUNT_MAX];
+
+// sliding DFT analyser, see DYN_NOTCH_ANALYSER_SDFT
+STATIC_ASSERT(SDFT_SAMPLE_SIZE == FFT_WINDOW_SIZE, sdft_window_matches_fft_window);
+static bool sdftActive;
+static sdft_t sdft[XYZ_AXIS_COUNT];
+static uint8_t sdftPendingAxisMask;         // axes with samples not yet used for a frequency estimate
+static uint8_t sdftAxis;
+static uint8_t sdftStartBin;
 
 // Hanning window, see https://en.wikipedia.org/wiki/Window_function#Hann_.28Hanning.29_window
 static float hanningWindow[FFT_WINDOW_SIZE];
@@ -104,29 +119,56 @@ void initGyroData(void)
 
 static inline int fftFreqToBin(int freq)
 {
-    return ((FFT_WINDOW_SIZE / 2 - 1) * freq) / (fftMaxFreq);
+    return ((FFT_WINDOW_SIZE / 2 - 1) * freq) / (analyseRate / 2);
 }
 
 void gyroDataAnalyseInit(uint32_t targetLooptimeUs)
 {
     // initialise even if FEATURE_DYNAMIC_FILTER not set, since it may be set later
     samplingFrequency = 1000000 / targetLooptimeUs;
-    fftSamplingScale = samplingFrequency / FFT_SAMPLING_RATE;
+    sdftActive = gyroConfig()->dyn_notch_analyser == DYN_NOTCH_ANALYSER_SDFT;
+    if (sdftActive) {
+        // the sliding DFT costs the same per sample whatever its rate, so fill its window faster
+        fftSamplingScale = MAX(samplingFrequency / SDFT_SAMPLING_RATE, 1);
+        analyseRate = samplingFrequency / fftSamplingScale;
+    } else {
+        fftSamplingScale = samplingFrequency / FFT_SAMPLING_RATE;
+        analyseRate = FFT_SAMPLING_RATE;
+    }
     fftMaxFreq = FFT_SAMPLING_RATE / 2;
     fftBinCount = fftFreqToBin(fftMaxFreq) + 1;
-    fftResolution = FFT_SAMPLING_RATE / FFT_WINDOW_SIZE;
+    fftResolution = (float)analyseRate / FFT_WINDOW_SIZE;
     arm_rfft_fast_init_f32(&fftInstance, FFT_WINDOW_SIZE);
 
     initGyroData();
     initHanning();
 
+    dynNotchCount = constrain(gyroConfig()->dyn_notch_count, 1, DYN_NOTCH_COUNT_MAX);
+    peakMinBin = fftFreqToBin(FFT_MIN_FREQ);
+
+    sdftStartBin = MAX(peakMinBin, 1);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        sdftInit(&sdft[axis], sdftStartBin, fftBinCount - 1);
+    }
+    sdftPendingAxisMask = 0;
+    sdftAxis = 0;
+
     // recalculation of filters takes 4 calls per axis => each filter gets updated every 3 * 4 = 12 calls
     // at 4khz gyro loop rate this means 4khz / 4 / 3 = 333Hz => update every 3ms
     float looptime = targetLooptimeUs * 4 * 3;
+    uint16_t changeRate = DYN_NOTCH_CHANGERATE;
+    if (sdftActive) {
+        // one axis is estimated per call, but each axis at most once per analysed sample. The estimates
+        // come often enough and from a short enough window to need less smoothing
+        looptime = MAX(targetLooptimeUs * 3, 1000000 / analyseRate);
+        changeRate = SDFT_DYN_NOTCH_CHANGERATE;
+    }
     for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-        fftResult[axis].centerFreq = 200; // any init value
-        biquadFilterInitLPF(&fftFreqFilter[axis], DYN_NOTCH_CHANGERATE, looptime);
-        biquadFilterInit(&fftGyroFilter[axis], FFT_BPF_HZ, 1000000 / FFT_SAMPLING_RATE, BIQUAD_Q, FILTER_BPF);
+        for (int i = 0; i < DYN_NOTCH_COUNT_MAX; i++) {
+            fftResult[axis].centerFreq[i] = 200; // any init value
+            biquadFilterInitLPF(&fftFreqFilter[axis][i], changeRate, looptime);
+        }
+        biquadFilterInit(&fftGyroFilter[axis], FFT_BPF_HZ, 1000000 / analyseRate, BIQUAD_Q, FILTER_BPF);
     }
 }
 
@@ -141,10 +183,201 @@ bool isDynamicFilterActive(void)
     return feature(FEATURE_DYNAMIC_FILTER);
 }
 
+/*
+ * Estimate the centre frequency of the given axis as the weighted mean of the spectrum, binData[0]
+ * holds bin firstBin
+ */
+static void gyroDataAnalyseCalculateMeanFreq(int axis, const float *binData, int firstBin)
+{
+    float fftSum = 0;
+    float fftWeightedSum = 0;
+
+    fftResult[axis].maxVal = 0;
+    // iterate over fft data and calculate weighted indexes
+    float squaredData;
+    for (int i = firstBin; i < fftBinCount; i++) {
+        squaredData = binData[i - firstBin] * binData[i - firstBin];  //more weight on higher peaks
+        fftResult[axis].maxVal = MAX(fftResult[axis].maxVal, squaredData);
+        fftSum += squaredData;
+        fftWeightedSum += squaredData * (i + 1); // calculate weighted index starting at 1, not 0
+    }
+
+    // get weighted center of relevant frequency range (this way we have a better resolution than 31.25Hz)
+    if (fftSum > 0) {
+        // idx was shifted by 1 to start at 1, not 0
+        float fftMeanIndex = (fftWeightedSum / fftSum) - 1;
+        // the index points at the center frequency of each bin so index 0 is actually 16.125Hz
+        // fftMeanIndex += 0.5;
+
+        // don't go below the minimal cutoff frequency + 10 and don't jump around too much
+        float centerFreq;
+        centerFreq = constrain(fftMeanIndex * fftResolution, DYN_NOTCH_MIN_CUTOFF + 10, fftMaxFreq);
+        centerFreq = biquadFilterApply(&fftFreqFilter[axis][0], centerFreq);
+        centerFreq = constrain(centerFreq, DYN_NOTCH_MIN_CUTOFF + 10, fftMaxFreq);
+        fftResult[axis].centerFreq[0] = centerFreq;
+        if (axis == 0) {
+            DEBUG_SET(DEBUG_FFT, 3, lrintf(fftMeanIndex * 100));
+        }
+    }
+}
+
+/*
+ * Find the dynNotchCount largest local maxima of the spectrum, largest first, with their position interpolated
+ * between bins. Peaks smaller than DYN_NOTCH_PEAK_MIN_RATIO of the largest one are dropped.
+ */
+STATIC_UNIT_TESTED int gyroDataAnalyseFindPeaks(const float *binData, int firstBin, float *peakVal, float *peakIndex)
+{
+    int peakCount = 0;
+    const int lastBin = fftBinCount - 1;
+
+    for (int i = MAX(firstBin, peakMinBin); i <= lastBin; i++) {
+        const float val = binData[i - firstBin];
+        const float left = (i > firstBin) ? binData[i - 1 - firstBin] : 0;
+        const float right = (i < lastBin) ? binData[i + 1 - firstBin] : 0;
+        if (val <= left || val < right) {
+            continue;
+        }
+
+        // interpolate the peak position with a parabola through the neighbouring bins
+        float index = i;
+        const float denominator = left - 2 * val + right;
+        if (i > firstBin && i < lastBin && denominator < 0) {
+            index += 0.5f * (left - right) / denominator;
+        }
+
+        // insert into the list of largest peaks, which is sorted by magnitude
+        int slot = peakCount;
+        while (slot > 0 && peakVal[slot - 1] < val) {
+            if (slot < dynNotchCount) {
+                peakVal[slot] = peakVal[slot - 1];
+                peakIndex[slot] = peakIndex[slot - 1];
+            }
+            slot--;
+        }
+        if (slot < dynNotchCount) {
+            peakVal[slot] = val;
+            peakIndex[slot] = index;
+            peakCount = MIN(peakCount + 1, dynNotchCount);
+        }
+    }
+
+    while (peakCount > 1 && peakVal[peakCount - 1] < peakVal[0] * DYN_NOTCH_PEAK_MIN_RATIO) {
+        peakCount--;
+    }
+    return peakCount;
+}
+
+/*
+ * Pair peaks and notches that are closest in frequency first, so that a notch keeps following the same peak
+ * when other peaks appear, disappear or change in size. Notches without a peak stay where they are.
+ */
+STATIC_UNIT_TESTED void gyroDataAnalyseAssignPeaks(int axis, const float *peakFreq, int peakCount)
+{
+    uint8_t freePeakMask = BIT(peakCount) - 1;
+    uint8_t freeNotchMask = BIT(dynNotchCount) - 1;
+    while (freePeakMask) {
+        int peak = 0;
+        int notch = 0;
+        float distance = INFINITY;
+        for (int i = 0; i < peakCount; i++) {
+            for (int j = 0; j < dynNotchCount; j++) {
+                const float pairDistance = fabsf(peakFreq[i] - fftResult[axis].centerFreq[j]);
+                if ((freePeakMask & BIT(i)) && (freeNotchMask & BIT(j)) && pairDistance < distance) {
+                    peak = i;
+                    notch = j;
+                    distance = pairDistance;
+                }
+            }
+        }
+        freePeakMask &= ~BIT(peak);
+        freeNotchMask &= ~BIT(notch);
+
+        float centerFreq;
+        centerFreq = constrain(peakFreq[peak], DYN_NOTCH_MIN_CUTOFF + 10, fftMaxFreq);
+        centerFreq = biquadFilterApply(&fftFreqFilter[axis][notch], centerFreq);
+        centerFreq = constrain(centerFreq, DYN_NOTCH_MIN_CUTOFF + 10, fftMaxFreq);
+        fftResult[axis].centerFreq[notch] = centerFreq;
+    }
+}
+
+/*
+ * Give each of the dynNotchCount largest peaks of the spectrum its own notch. The weighted mean of the
+ * spectrum lands between peaks when there is more than one of them.
+ */
+static void gyroDataAnalyseCalculatePeakFreqs(int axis, const float *binData, int firstBin)
+{
+    float peakVal[DYN_NOTCH_COUNT_MAX];
+    float peakIndex[DYN_NOTCH_COUNT_MAX];
+    const int peakCount = gyroDataAnalyseFindPeaks(binData, firstBin, peakVal, peakIndex);
+
+    fftResult[axis].maxVal = peakCount > 0 ? peakVal[0] * peakVal[0] : 0;
+    float peakFreq[DYN_NOTCH_COUNT_MAX];
+    for (int i = 0; i < peakCount; i++) {
+        peakFreq[i] = peakIndex[i] * fftResolution;
+    }
+    gyroDataAnalyseAssignPeaks(axis, peakFreq, peakCount);
+    if (axis == 0 && peakCount > 0) {
+        DEBUG_SET(DEBUG_FFT, 3, lrintf(peakIndex[0] * 100));
+    }
+}
+
+static void gyroDataAnalyseCalculateCenterFreq(int axis, const float *binData, int firstBin)
+{
+    if (dynNotchCount > 1) {
+        gyroDataAnalyseCalculatePeakFreqs(axis, binData, firstBin);
+    } else {
+        gyroDataAnalyseCalculateMeanFreq(axis, binData, firstBin);
+    }
+}
+
+static void gyroDataAnalyseUpdateNotch(biquadFilter_t *notchFilterDyn, uint16_t centerFreq)
+{
+    float cutoffFreq = constrain(centerFreq - DYN_NOTCH_WIDTH, DYN_NOTCH_MIN_CUTOFF, DYN_NOTCH_MAX_CUTOFF);
+    float notchQ = filterGetNotchQApprox(centerFreq, cutoffFreq);
+    biquadFilterUpdate(notchFilterDyn, centerFreq, gyro.targetLooptime, notchQ, FILTER_NOTCH);
+}
+
+/*
+ * Sliding DFT analyser: the spectrum is already up to date, so estimate the frequency of one axis
+ * with new samples and retune its notch
+ */
+static void gyroDataAnalyseSdftUpdate(biquadFilter_t notchFilterDyn[][DYN_NOTCH_COUNT_MAX])
+{
+    if (!sdftPendingAxisMask) {
+        return;
+    }
+
+    uint32_t startTime = 0;
+    if (debugMode == (DEBUG_FFT_TIME))
+        startTime = micros();
+
+    // round robin over the pending axes so that none of them starves when samples arrive faster than 3 calls
+    while (!(sdftPendingAxisMask & BIT(sdftAxis))) {
+        sdftAxis = (sdftAxis + 1) % XYZ_AXIS_COUNT;
+    }
+    const int axis = sdftAxis;
+    sdftPendingAxisMask &= ~BIT(axis);
+    sdftAxis = (sdftAxis + 1) % XYZ_AXIS_COUNT;
+
+    // the weighted mean squares the bin data again, so pass the magnitude rather than its square
+    float binData[SDFT_BIN_COUNT];
+    sdftWindowedSquaredMagnitude(&sdft[axis], binData);
+    for (int i = 0; i <= sdft[axis].endBin - sdftStartBin; i++) {
+        binData[i] = sqrtf(binData[i]);
+    }
+    gyroDataAnalyseCalculateCenterFreq(axis, binData, sdftStartBin);
+    for (int i = 0; i < dynNotchCount; i++) {
+        gyroDataAnalyseUpdateNotch(&notchFilterDyn[axis][i], fftResult[axis].centerFreq[i]);
+    }
+
+    DEBUG_SET(DEBUG_FFT_FREQ, axis, fftResult[axis].centerFreq[0]);
+    DEBUG_SET(DEBUG_FFT_TIME, 1, micros() - startTime);
+}
+
 /*
  * Collect gyro data, to be analysed in gyroDataAnalyseUpdate function
  */
-void gyroDataAnalyse(const gyroDev_t *gyroDev, biquadFilter_t *notchFilterDyn)
+void gyroDataAnalyse(const gyroDev_t *gyroDev, biquadFilter_t notchFilterDyn[][DYN_NOTCH_COUNT_MAX])
 {
     if (!isDynamicFilterActive()) {
         return;
@@ -156,7 +389,7 @@ void gyroDataAnalyse(const gyroDev_t *gyroDev, biquadFilter_t *notchFilterDyn)
     }
     fftAccCount++;
 
-    // this runs at 1kHz
+    // this runs at analyseRate, 1kHz for the FFT
     if (fftAccCount == fftSamplingScale) {
         fftAccCount = 0;
 
@@ -165,12 +398,21 @@ void gyroDataAnalyse(const gyroDev_t *gyroDev, biquadFilter_t *notchFilterDyn)
             float sample = fftAcc[axis] / fftSamplingScale;
             sample = biquadFilterApply(&fftGyroFilter[axis], sample);
             gyroData[axis][fftIdx] = sample;
+            if (sdftActive) {
+                sdftPush(&sdft[axis], sample);
+            }
             if (axis == 0)
                 DEBUG_SET(DEBUG_FFT, 2, lrintf(sample * gyroDev->scale));
             fftAcc[axis] = 0;
         }
 
         fftIdx = (fftIdx + 1) % FFT_WINDOW_SIZE;
+        sdftPendingAxisMask = BIT(XYZ_AXIS_COUNT) - 1;
+    }
+
+    if (sdftActive) {
+        gyroDataAnalyseSdftUpdate(notchFilterDyn);
+        return;
     }
 
     // calculate FFT and update filters
@@ -197,7 +439,7 @@ typedef enum {
 /*
  * Analyse last gyro data from the last FFT_WINDOW_SIZE milliseconds
  */
-void gyroDataAnalyseUpdate(biquadFilter_t *notchFilterDyn)
+void gyroDataAnalyseUpdate(biquadFilter_t notchFilterDyn[][DYN_NOTCH_COUNT_MAX])
 {
     static int axis = 0;
     static int step = 0;
@@ -255,48 +497,18 @@ void gyroDataAnalyseUpdate(biquadFilter_t *notchFilterDyn)
         case STEP_CALC_FREQUENCIES:
         {
             // 13us
-            float fftSum = 0;
-            float fftWeightedSum = 0;
-
-            fftResult[axis].maxVal = 0;
-            // iterate over fft data and calculate weighted indexes
-            float squaredData;
-            for (int i = 0; i < fftBinCount; i++) {
-                squaredData = fftData[i] * fftData[i];  //more weight on higher peaks
-                fftResult[axis].maxVal = MAX(fftResult[axis].maxVal, squaredData);
-                fftSum += squaredData;
-                fftWeightedSum += squaredData * (i + 1); // calculate weighted index starting at 1, not 0
-            }
-
-            // get weighted center of relevant frequency range (this way we have a better resolution than 31.25Hz)
-            if (fftSum > 0) {
-                // idx was shifted by 1 to start at 1, not 0
-                float fftMeanIndex = (fftWeightedSum / fftSum) - 1;
-                // the index points at the center frequency of each bin so index 0 is actually 16.125Hz
-                // fftMeanIndex += 0.5;
-
-                // don't go below the minimal cutoff frequency + 10 and don't jump around too much
-                float centerFreq;
-                centerFreq = constrain(fftMeanIndex * fftResolution, DYN_NOTCH_MIN_CUTOFF + 10, fftMaxFreq);
-                centerFreq = biquadFilterApply(&fftFreqFilter[axis], centerFreq);
-                centerFreq = constrain(centerFreq, DYN_NOTCH_MIN_CUTOFF + 10, fftMaxFreq);
-                fftResult[axis].centerFreq = centerFreq;
-                if (axis == 0) {
-                    DEBUG_SET(DEBUG_FFT, 3, lrintf(fftMeanIndex * 100));
-                }
-            }
-
-            DEBUG_SET(DEBUG_FFT_FREQ, axis, fftResult[axis].centerFreq);
+            gyroDataAnalyseCalculateCenterFreq(axis, fftData, 0);
+            DEBUG_SET(DEBUG_FFT_FREQ, axis, fftResult[axis].centerFreq[0]);
             DEBUG_SET(DEBUG_FFT_TIME, 1, micros() - startTime);
             break;
         }
         case STEP_UPDATE_FILTERS:
         {
-            // 7us
+            // 7us per notch
             // calculate new filter coefficients
-            float cutoffFreq = constrain(fftResult[axis].centerFreq - DYN_NOTCH_WIDTH, DYN_NOTCH_MIN_CUTOFF, DYN_NOTCH_MAX_CUTOFF);
-            float notchQ = filterGetNotchQApprox(fftResult[axis].centerFreq, cutoffFreq);
-            biquadFilterUpdate(&notchFilterDyn[axis], fftResult[axis].centerFreq, gyro.targetLooptime, notchQ, FILTER_NOTCH);
+            for (int i = 0; i < dynNotchCount; i++) {
+                gyroDataAnalyseUpdateNotch(&notchFilterDyn[axis][i], fftResult[axis].centerFreq[i]);
+            }
             DEBUG_SET(DEBUG_FFT_TIME, 1, micros() - startTime);
 
             axis = (axis + 1) % 3;
@@ -21,14 +21,21 @@
 #include "common/filter.h"
 
 #define GYRO_FFT_BIN_COUNT      16 // FFT_WINDOW_SIZE / 2
+#define DYN_NOTCH_COUNT_MAX     3  // notches per axis, each following one spectral peak
+
+typedef enum {
+    DYN_NOTCH_ANALYSER_FFT = 0,     // windowed FFT, one step of the calculation per gyro cycle
+    DYN_NOTCH_ANALYSER_SDFT         // sliding DFT, spectrum updated with every analysed sample
+} dynNotchAnalyser_e;
+
 typedef struct gyroFftData_s {
     float maxVal;
-    uint16_t centerFreq;
+    uint16_t centerFreq[DYN_NOTCH_COUNT_MAX];  // each notch follows the peak nearest to it
 } gyroFftData_t;
 
 void gyroDataAnalyseInit(uint32_t targetLooptime);
 const gyroFftData_t *gyroFftData(int axis);
 struct gyroDev_s;
-void gyroDataAnalyse(const struct gyroDev_s *gyroDev, biquadFilter_t *notchFilterDyn);
-void gyroDataAnalyseUpdate(biquadFilter_t *notchFilterDyn);
+void gyroDataAnalyse(const struct gyroDev_s *gyroDev, biquadFilter_t notchFilterDyn[][DYN_NOTCH_COUNT_MAX]);
+void gyroDataAnalyseUpdate(biquadFilter_t notchFilterDyn[][DYN_NOTCH_COUNT_MAX]);
 bool isDynamicFilterActive(void);
@@ -219,6 +219,11 @@
 #define SPI3_SCK_PIN            PC10
 #define SPI3_MISO_PIN           PC11
 #define SPI3_MOSI_PIN           PC12
+#if !defined(OMNIBUSF4SD)
+// OSD, flash and baro share SPI3, DMA1 stream 0 is used by the LED strip on OMNIBUSF4SD
+#define SPI3_TX_DMA_STREAM      DMA1_Stream5
+#define SPI3_RX_DMA_STREAM      DMA1_Stream0
+#endif
 
 #define USE_I2C
 #define USE_I2C_DEVICE_2
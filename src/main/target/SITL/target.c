@@ -416,6 +416,10 @@ bool isMotorProtocolDshot(void)
     return false;
 }
 
+void pwmStartMotorUpdate(uint8_t motorCount) {
+    UNUSED(motorCount);
+}
+
 void pwmWriteMotor(uint8_t index, float value) {
     motorsPwm[index] = value - idlePulse;
 }
@@ -511,7 +515,10 @@ void FLASH_Lock(void) {
 }
 
 FLASH_Status FLASH_ErasePage(uintptr_t Page_Address) {
-    UNUSED(Page_Address);
+    // erased flash reads as 0xFF, the config journal relies on it to find its end
+    if ((Page_Address >= (uintptr_t)eepromData) && (Page_Address < (uintptr_t)ARRAYEND(eepromData))) {
+        memset((void*)Page_Address, 0xFF, MIN((uintptr_t)0x400, (uintptr_t)ARRAYEND(eepromData) - Page_Address));
+    }
 //    printf("[FLASH_ErasePage]%x\n", Page_Address);
     return FLASH_COMPLETE;
 }
@@ -49,6 +49,8 @@
 
 #define USE_FAKE_LED
 
+#define USE_PROFILER
+
 #define ACC
 #define USE_FAKE_ACC
 
@@ -61,6 +63,11 @@
 #define BARO
 #define USE_FAKE_BARO
 
+// sdcard_* on top of a FAT image file in the working directory, see drivers/sdcard_sim.c
+#define USE_SDCARD
+#define USE_SDCARD_SIM
+#define SDCARD_SIM_IMAGE_FILENAME "sdcard.img"
+
 #define USABLE_TIMER_CHANNEL_COUNT 0
 
 #define USE_UART1
@@ -5,4 +5,7 @@ TARGET_SRC = \
             drivers/accgyro/accgyro_fake.c \
             drivers/barometer/barometer_fake.c \
             drivers/compass/compass_fake.c \
-            drivers/serial_tcp.c
+            drivers/serial_tcp.c \
+            drivers/sdcard_sim.c \
+            io/asyncfatfs/asyncfatfs.c \
+            io/asyncfatfs/fat_standard.c
@@ -33,6 +33,10 @@
 #undef USE_ESC_SENSOR
 #endif
 
+#ifndef BLACKBOX
+#undef USE_BLACKBOX_GYRO_RAW
+#endif
+
 // XXX Followup implicit dependencies among DASHBOARD, display_xxx and USE_I2C.
 // XXX This should eventually be cleaned up.
 #ifndef USE_I2C
@@ -50,6 +50,11 @@
 #define I2C3_OVERCLOCK true
 #define TELEMETRY_IBUS
 #define USE_GYRO_DATA_ANALYSE
+#define USE_SPI_DMA_QUEUE
+#define USE_DSHOT_DMAR
+#define USE_DSHOT_TELEMETRY
+#define USE_RPM_FILTER
+#define USE_BLACKBOX_DEFERRED
 #endif
 
 #ifdef STM32F7
@@ -59,9 +64,17 @@
 #define I2C4_OVERCLOCK true
 #define TELEMETRY_IBUS
 #define USE_GYRO_DATA_ANALYSE
+#define USE_BLACKBOX_DEFERRED
 #endif
 
 #if defined(STM32F4) || defined(STM32F7)
+#define USE_SCHEDULER_READY_QUEUE
+#define USE_TASK_STATISTICS_HISTOGRAMS
+#define USE_GYRO_FILTER_BANK
+#define USE_GYRO_SAMPLE_RING
+#define USE_BLACKBOX_GYRO_RAW
+#define USE_CRC_SLICE_BY_4
+#define AFATFS_NUM_CACHE_SECTORS        16
 #define TASK_GYROPID_DESIRED_PERIOD     125
 #define SCHEDULER_DELAY_LIMIT           10
 #else
@@ -650,7 +650,7 @@ extern "C" {
     void applyAltHold(void) {}
     void resetYawAxis(void) {}
     int16_t calculateThrottleAngleCorrection(uint8_t) { return 0; }
-    void processRcCommand(void) {}
+    void processRcCommand(timeUs_t) {}
     void updateGpsStateForHomeAndHoldMode(void) {}
     void blackboxUpdate(timeUs_t) {}
     void transponderUpdate(timeUs_t) {}
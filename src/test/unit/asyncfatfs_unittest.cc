@@ -0,0 +1,567 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/maths.h"
+    #include "common/time.h"
+    #include "common/utils.h"
+
+    #include "drivers/sdcard.h"
+    #include "drivers/sdcard_sim.h"
+
+    #include "io/asyncfatfs/asyncfatfs.h"
+    #include "io/asyncfatfs/fat_standard.h"
+
+    uint32_t afatfs_superClusterSize(void);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define SECTOR_SIZE             512
+#define IMAGE_SECTORS           (1024 * 1024)   // 512MB, sparse on the host
+#define PARTITION_START         2048
+#define RESERVED_SECTORS        32
+#define SECTORS_PER_CLUSTER     8
+
+#define POLL_LIMIT              1000000
+
+#define PREALLOCATE_SIZE        (16 * 1024 * 1024)  // AFATFS_CONTIGUOUS_PREALLOCATE_SIZE
+#define FAT_START_SECTOR        (PARTITION_START + RESERVED_SECTORS)
+
+static timeUs_t simTimeUs;
+static char imagePath[64];
+
+static afatfsFilePtr_t testFile;
+static bool testFileClosed;
+
+static void writeImageSector(FILE *image, uint32_t sectorIndex, const uint8_t *sector)
+{
+    fseek(image, (long)sectorIndex * SECTOR_SIZE, SEEK_SET);
+    fwrite(sector, SECTOR_SIZE, 1, image);
+}
+
+static void readImageSector(FILE *image, uint32_t sectorIndex, uint8_t *sector)
+{
+    fseek(image, (long)sectorIndex * SECTOR_SIZE, SEEK_SET);
+    ASSERT_EQ(1u, fread(sector, SECTOR_SIZE, 1, image));
+}
+
+static uint32_t imageFatSectors(void)
+{
+    const uint32_t partitionSectors = IMAGE_SECTORS - PARTITION_START;
+    return ((partitionSectors - RESERVED_SECTORS) / SECTORS_PER_CLUSTER + FAT_SMALLEST_LEGAL_CLUSTER_NUMBER) * sizeof(uint32_t) / SECTOR_SIZE + 1;
+}
+
+static uint32_t imageRootDirectorySector(void)
+{
+    return FAT_START_SECTOR + 2 * imageFatSectors();
+}
+
+static uint32_t readImageFatEntry(FILE *image, uint32_t cluster)
+{
+    uint32_t entry = 0;
+    fseek(image, (long)FAT_START_SECTOR * SECTOR_SIZE + cluster * sizeof(uint32_t), SEEK_SET);
+    EXPECT_EQ(1u, fread(&entry, sizeof(entry), 1, image));
+    return entry & 0x0FFFFFFF;
+}
+
+// Entry of the root directory with the given 8.3 name as it is stored, e.g. "LOG00001BFL"
+static bool findImageDirectoryEntry(FILE *image, const char *name, fatDirectoryEntry_t *entry)
+{
+    uint8_t sector[SECTOR_SIZE];
+    for (int i = 0; i < SECTORS_PER_CLUSTER; i++) {
+        readImageSector(image, imageRootDirectorySector() + i, sector);
+        for (unsigned j = 0; j < SECTOR_SIZE / sizeof(fatDirectoryEntry_t); j++) {
+            memcpy(entry, sector + j * sizeof(fatDirectoryEntry_t), sizeof(fatDirectoryEntry_t));
+            if (memcmp(entry->filename, name, FAT_FILENAME_LENGTH) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// An empty FAT32 volume in the first partition, what a card fresh out of the box holds
+static void formatImage(FILE *image)
+{
+    uint8_t sector[SECTOR_SIZE];
+    const uint32_t partitionSectors = IMAGE_SECTORS - PARTITION_START;
+    const uint32_t fatSectors = imageFatSectors();
+
+    memset(sector, 0, sizeof(sector));
+    mbrPartitionEntry_t *partition = (mbrPartitionEntry_t *)(sector + 446);
+    partition->type = MBR_PARTITION_TYPE_FAT32_LBA;
+    partition->lbaBegin = PARTITION_START;
+    partition->numSectors = partitionSectors;
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+    writeImageSector(image, 0, sector);
+
+    memset(sector, 0, sizeof(sector));
+    fatVolumeID_t *volume = (fatVolumeID_t *)sector;
+    volume->jmpBoot[0] = 0xEB;
+    volume->jmpBoot[1] = 0x58;
+    volume->jmpBoot[2] = 0x90;
+    memcpy(volume->oemName, "MSWIN4.1", sizeof(volume->oemName));
+    volume->bytesPerSector = SECTOR_SIZE;
+    volume->sectorsPerCluster = SECTORS_PER_CLUSTER;
+    volume->reservedSectorCount = RESERVED_SECTORS;
+    volume->numFATs = 2;
+    volume->media = 0xF8;
+    volume->totalSectors32 = partitionSectors;
+    volume->fatDescriptor.fat32.FATSize32 = fatSectors;
+    volume->fatDescriptor.fat32.rootCluster = FAT_SMALLEST_LEGAL_CLUSTER_NUMBER;
+    volume->fatDescriptor.fat32.fsInfo = 1;
+    volume->fatDescriptor.fat32.backupBootSector = 6;
+    volume->fatDescriptor.fat32.bootSignature = 0x29;
+    memcpy(volume->fatDescriptor.fat32.volumeLabel, "NO NAME    ", sizeof(volume->fatDescriptor.fat32.volumeLabel));
+    memcpy(volume->fatDescriptor.fat32.fileSystemType, "FAT32   ", sizeof(volume->fatDescriptor.fat32.fileSystemType));
+    sector[510] = FAT_VOLUME_ID_SIGNATURE_1;
+    sector[511] = FAT_VOLUME_ID_SIGNATURE_2;
+    writeImageSector(image, PARTITION_START, sector);
+
+    // Both FATs start with the two reserved entries and the single cluster chain of the root directory
+    memset(sector, 0, sizeof(sector));
+    uint32_t *fat = (uint32_t *)sector;
+    fat[0] = 0x0FFFFFF8;
+    fat[1] = 0x0FFFFFFF;
+    fat[2] = 0x0FFFFFFF;
+    writeImageSector(image, FAT_START_SECTOR, sector);
+    writeImageSector(image, FAT_START_SECTOR + fatSectors, sector);
+
+    // The root directory cluster and the rest of the volume read back as zeros
+    memset(sector, 0, sizeof(sector));
+    writeImageSector(image, IMAGE_SECTORS - 1, sector);
+}
+
+static void pollFilesystem(timeUs_t stepUs)
+{
+    simTimeUs += stepUs;
+    afatfs_poll();
+}
+
+static void initFilesystem(void)
+{
+    afatfs_init();
+    for (int i = 0; i < POLL_LIMIT && afatfs_getFilesystemState() == AFATFS_FILESYSTEM_STATE_INITIALIZATION; i++) {
+        pollFilesystem(100);
+    }
+    ASSERT_EQ(AFATFS_FILESYSTEM_STATE_READY, afatfs_getFilesystemState());
+}
+
+static void destroyFilesystem(void)
+{
+    for (int i = 0; i < POLL_LIMIT && !afatfs_destroy(false); i++) {
+        simTimeUs += 100;
+    }
+}
+
+static void mountImage(const sdcardSimConfig_t *config)
+{
+    strcpy(imagePath, "/tmp/afatfs_unittest_XXXXXX");
+    const int fd = mkstemp(imagePath);
+    ASSERT_NE(-1, fd);
+    FILE *image = fdopen(fd, "w+b");
+    formatImage(image);
+    fclose(image);
+
+    ASSERT_TRUE(sdcardSim_open(imagePath, config));
+    EXPECT_EQ((uint32_t)IMAGE_SECTORS, sdcard_getMetadata()->numBlocks);
+
+    initFilesystem();
+}
+
+static void unmountImage(void)
+{
+    destroyFilesystem();
+    sdcard_setProfilerCallback(NULL);
+    sdcardSim_close();
+    unlink(imagePath);
+}
+
+static void testFileOpened(afatfsFilePtr_t file)
+{
+    testFile = file;
+}
+
+static void testFileClosedCallback(void)
+{
+    testFileClosed = true;
+}
+
+static afatfsFilePtr_t openTestFile(const char *filename, const char *mode)
+{
+    testFile = NULL;
+    EXPECT_TRUE(afatfs_fopen(filename, mode, testFileOpened));
+    for (int i = 0; i < POLL_LIMIT && !testFile; i++) {
+        pollFilesystem(100);
+    }
+    return testFile;
+}
+
+static void closeTestFile(afatfsFilePtr_t file)
+{
+    testFileClosed = false;
+    EXPECT_TRUE(afatfs_fclose(file, testFileClosedCallback));
+    for (int i = 0; i < POLL_LIMIT && !testFileClosed; i++) {
+        pollFilesystem(100);
+    }
+    EXPECT_TRUE(testFileClosed);
+}
+
+static uint8_t testByte(uint32_t offset)
+{
+    return (uint8_t)((offset * 7) ^ (offset >> 9));
+}
+
+// Appends `length` bytes of the test pattern to `file` which holds `offset` bytes, in odd sized writes
+static void writeTestFile(afatfsFilePtr_t file, uint32_t offset, uint32_t length)
+{
+    uint8_t chunk[97];
+    uint32_t written = 0;
+    for (int i = 0; i < POLL_LIMIT && written < length; i++) {
+        const uint32_t chunkLength = MIN(sizeof(chunk), length - written);
+        for (uint32_t j = 0; j < chunkLength; j++) {
+            chunk[j] = testByte(offset + written + j);
+        }
+        written += afatfs_fwrite(file, chunk, chunkLength);
+        pollFilesystem(125);
+    }
+    ASSERT_EQ(length, written);
+}
+
+static void flushFilesystem(void)
+{
+    for (int i = 0; i < POLL_LIMIT && !afatfs_flush(); i++) {
+        pollFilesystem(100);
+    }
+}
+
+// Blocks the card has written, in order
+static struct {
+    uint32_t blocks[64];
+    uint32_t count;
+    uint32_t fatWrites;
+    uint32_t directoryWrites;
+} cardWrites;
+
+static void recordCardWrite(sdcardBlockOperation_e operation, uint32_t blockIndex, uint32_t duration)
+{
+    UNUSED(duration);
+
+    if (operation != SDCARD_BLOCK_OPERATION_WRITE) {
+        return;
+    }
+    if (cardWrites.count < ARRAYLEN(cardWrites.blocks)) {
+        cardWrites.blocks[cardWrites.count] = blockIndex;
+    }
+    cardWrites.count++;
+    if (blockIndex >= FAT_START_SECTOR && blockIndex < imageRootDirectorySector()) {
+        cardWrites.fatWrites++;
+    } else if (blockIndex >= imageRootDirectorySector() && blockIndex < imageRootDirectorySector() + SECTORS_PER_CLUSTER) {
+        cardWrites.directoryWrites++;
+    }
+}
+
+static void recordCardWrites(void)
+{
+    memset(&cardWrites, 0, sizeof(cardWrites));
+    sdcard_setProfilerCallback(recordCardWrite);
+}
+
+TEST(AsyncFatFsTest, TestWriteReadBack)
+{
+    mountImage(NULL);
+
+    afatfsFilePtr_t file = openTestFile("LOG00001.BFL", "as");
+    ASSERT_TRUE(file != NULL);
+
+    // Odd sized writes so they straddle the sector and cluster boundaries
+    const uint32_t fileSize = 1024 * 1024 + 123;
+    uint8_t chunk[97];
+    uint32_t written = 0;
+    for (int i = 0; i < POLL_LIMIT && written < fileSize; i++) {
+        const uint32_t length = MIN(sizeof(chunk), fileSize - written);
+        for (uint32_t j = 0; j < length; j++) {
+            chunk[j] = testByte(written + j);
+        }
+        written += afatfs_fwrite(file, chunk, length);
+        pollFilesystem(125);
+    }
+    ASSERT_EQ(fileSize, written);
+    closeTestFile(file);
+
+    // Mount the image again so the file is read back from the card and not from the cache
+    destroyFilesystem();
+    initFilesystem();
+
+    file = openTestFile("LOG00001.BFL", "r");
+    ASSERT_TRUE(file != NULL);
+
+    uint32_t readBack = 0;
+    for (int i = 0; i < POLL_LIMIT && !afatfs_feof(file); i++) {
+        const uint32_t length = afatfs_fread(file, chunk, sizeof(chunk));
+        for (uint32_t j = 0; j < length; j++) {
+            ASSERT_EQ(testByte(readBack + j), chunk[j]) << "at offset " << readBack + j;
+        }
+        readBack += length;
+        pollFilesystem(125);
+    }
+    EXPECT_EQ(fileSize, readBack);
+    closeTestFile(file);
+
+    EXPECT_LT(0u, sdcardSim_getStatistics()->multiWriteBlocks);
+
+    unmountImage();
+}
+
+TEST(AsyncFatFsTest, TestContiguousFilePreallocatedAndTrimmed)
+{
+    mountImage(NULL);
+    const uint32_t superclusterSize = afatfs_superClusterSize();
+    const uint32_t freeSpaceAtStart = afatfs_getContiguousFreeSpace();
+
+    afatfsFilePtr_t file = openTestFile("LOG00003.BFL", "as");
+    ASSERT_TRUE(file != NULL);
+
+    // The first append takes the whole preallocation from the freefile
+    writeTestFile(file, 0, 1000);
+    flushFilesystem();
+    EXPECT_EQ(freeSpaceAtStart - PREALLOCATE_SIZE, afatfs_getContiguousFreeSpace());
+
+    // Logging into it doesn't touch the FAT or the directory
+    recordCardWrites();
+    const uint32_t fileSize = 6 * superclusterSize + 1000;
+    writeTestFile(file, 1000, fileSize - 1000);
+    flushFilesystem();
+    EXPECT_LT(6 * superclusterSize / SECTOR_SIZE, cardWrites.count);
+    EXPECT_EQ(0u, cardWrites.fatWrites);
+    EXPECT_EQ(0u, cardWrites.directoryWrites);
+
+    // Closing gives the 25 superclusters the file didn't reach back
+    closeTestFile(file);
+    const uint32_t superclustersUsed = 7;
+    EXPECT_EQ(freeSpaceAtStart - superclustersUsed * superclusterSize, afatfs_getContiguousFreeSpace());
+
+    destroyFilesystem();
+    sdcardSim_close();
+
+    FILE *image = fopen(imagePath, "rb");
+    ASSERT_TRUE(image != NULL);
+    fatDirectoryEntry_t logEntry, freeFileEntry;
+    ASSERT_TRUE(findImageDirectoryEntry(image, "LOG00003BFL", &logEntry));
+    ASSERT_TRUE(findImageDirectoryEntry(image, "FREESPACE  ", &freeFileEntry));
+
+    const uint32_t firstCluster = logEntry.firstClusterHigh << 16 | logEntry.firstClusterLow;
+    const uint32_t trimStartCluster = firstCluster + superclustersUsed * superclusterSize / (SECTORS_PER_CLUSTER * SECTOR_SIZE);
+    EXPECT_EQ(fileSize, logEntry.fileSize);
+
+    // The file's chain ends where it was trimmed and the clusters after it start the freefile's chain
+    EXPECT_EQ(trimStartCluster - 1, readImageFatEntry(image, trimStartCluster - 2));
+    EXPECT_LE(0x0FFFFFF8u, readImageFatEntry(image, trimStartCluster - 1));
+    EXPECT_EQ(trimStartCluster + 1, readImageFatEntry(image, trimStartCluster));
+    EXPECT_EQ(trimStartCluster, (uint32_t)(freeFileEntry.firstClusterHigh << 16 | freeFileEntry.firstClusterLow));
+    EXPECT_EQ(freeSpaceAtStart - superclustersUsed * superclusterSize, freeFileEntry.fileSize);
+    fclose(image);
+
+    // The trimmed freefile is what the next mount finds
+    ASSERT_TRUE(sdcardSim_open(imagePath, NULL));
+    initFilesystem();
+    EXPECT_EQ(freeSpaceAtStart - superclustersUsed * superclusterSize, afatfs_getContiguousFreeSpace());
+
+    file = openTestFile("LOG00003.BFL", "r");
+    ASSERT_TRUE(file != NULL);
+    uint8_t chunk[SECTOR_SIZE];
+    uint32_t readBack = 0;
+    for (int i = 0; i < POLL_LIMIT && !afatfs_feof(file); i++) {
+        const uint32_t length = afatfs_fread(file, chunk, sizeof(chunk));
+        for (uint32_t j = 0; j < length; j++) {
+            ASSERT_EQ(testByte(readBack + j), chunk[j]) << "at offset " << readBack + j;
+        }
+        readBack += length;
+        pollFilesystem(125);
+    }
+    EXPECT_EQ(fileSize, readBack);
+    closeTestFile(file);
+
+    unmountImage();
+}
+
+TEST(AsyncFatFsTest, TestFlushContinuesTheLastWrite)
+{
+    // A card that takes long enough over each block for dirty sectors to queue up behind it
+    const sdcardSimConfig_t slowCard = { 100, 100, 5000, 5000, 0, 0 };
+    mountImage(&slowCard);
+
+    afatfsFilePtr_t logFile = openTestFile("LOG00004.BFL", "as");
+    ASSERT_TRUE(logFile != NULL);
+    afatfsFilePtr_t otherFile = openTestFile("OTHER.TXT", "a");
+    ASSERT_TRUE(otherFile != NULL);
+    writeTestFile(logFile, 0, SECTOR_SIZE);
+    writeTestFile(otherFile, 0, SECTOR_SIZE);
+    flushFilesystem();
+
+    recordCardWrites();
+    uint8_t sector[SECTOR_SIZE];
+    memset(sector, 0x55, sizeof(sector));
+
+    // The card takes the next log sector, then the other file gets a sector before the log gets its following one
+    ASSERT_EQ((uint32_t)SECTOR_SIZE, afatfs_fwrite(logFile, sector, SECTOR_SIZE));
+    pollFilesystem(10);
+    ASSERT_EQ((uint32_t)SECTOR_SIZE, afatfs_fwrite(otherFile, sector, SECTOR_SIZE));
+    ASSERT_EQ((uint32_t)SECTOR_SIZE, afatfs_fwrite(logFile, sector, SECTOR_SIZE));
+    flushFilesystem();
+
+    // The older sector of the other file waits, so the card's multi-block write of the log goes on
+    ASSERT_EQ(3u, cardWrites.count);
+    EXPECT_EQ(cardWrites.blocks[0] + 1, cardWrites.blocks[1]);
+    EXPECT_NE(cardWrites.blocks[1] + 1, cardWrites.blocks[2]);
+
+    closeTestFile(otherFile);
+    closeTestFile(logFile);
+    unmountImage();
+}
+
+#define BENCH_LOOPTIME_US       250     // a 4kHz PID loop, asyncfatfs is polled once per loop
+#define BENCH_LOG_EVERY         2       // logging at 2kHz
+#define BENCH_DURATION_US       (30 * 1000 * 1000)
+#define BENCH_I_FRAME_INTERVAL  32
+#define BENCH_I_FRAME_BYTES     120
+#define BENCH_P_FRAME_BYTES     40
+#define BENCH_HEADER_BYTES      2048
+#define BENCH_HEADER_CHUNK      64
+
+typedef struct benchCard_s {
+    const char *name;
+    sdcardSimConfig_t config;
+} benchCard_t;
+
+static const benchCard_t benchCards[] = {
+    // readLatencyUs, writeTransferUs, writeBusyUs, multiWriteBusyUs, stallIntervalBlocks, stallUs
+    { "fast",       { 300, 250, 400,  50,  0,    0      } },
+    { "class 10",   { 400, 250, 800,  100, 2048, 40000  } },
+    { "slow",       { 800, 250, 2000, 400, 512,  150000 } },
+};
+
+/*
+ * Logs frames of the size blackbox writes at 2kHz through afatfs_fwrite() the way blackbox_io.c does, dropping what
+ * doesn't fit in the cache, and reports how the card and the cache kept up.
+ */
+static void benchmarkBlackboxLogging(const benchCard_t *card)
+{
+    mountImage(&card->config);
+
+    afatfsFilePtr_t file = openTestFile("LOG00002.BFL", "as");
+    ASSERT_TRUE(file != NULL);
+
+    uint8_t frame[BENCH_I_FRAME_BYTES];
+    uint32_t loggedBytes = 0;
+
+    // Like blackbox's header, only written when afatfs has room for it, which covers the cluster allocation at the start
+    for (int i = 0; i < POLL_LIMIT && loggedBytes < BENCH_HEADER_BYTES; i++) {
+        if (afatfs_getFreeBufferSpace() >= BENCH_HEADER_CHUNK) {
+            for (uint32_t j = 0; j < BENCH_HEADER_CHUNK; j++) {
+                frame[j] = testByte(loggedBytes + j);
+            }
+            loggedBytes += afatfs_fwrite(file, frame, BENCH_HEADER_CHUNK);
+        }
+        pollFilesystem(BENCH_LOOPTIME_US);
+    }
+    ASSERT_EQ((uint32_t)BENCH_HEADER_BYTES, loggedBytes);
+
+    sdcardSim_resetStatistics();
+    const afatfsStatistics_t statisticsStart = *afatfs_getStatistics();
+    const timeUs_t startTimeUs = simTimeUs;
+    const uint32_t headerBytes = loggedBytes;
+    uint32_t droppedBytes = 0;
+    uint32_t droppedFrames = 0;
+    uint32_t stallPeriods = 0;
+    bool stalled = false;
+
+    for (uint32_t loop = 0; loop < BENCH_DURATION_US / BENCH_LOOPTIME_US; loop++) {
+        pollFilesystem(BENCH_LOOPTIME_US);
+
+        if (loop % BENCH_LOG_EVERY == 0) {
+            const uint32_t frameIndex = loop / BENCH_LOG_EVERY;
+            const uint32_t frameBytes = frameIndex % BENCH_I_FRAME_INTERVAL == 0 ? BENCH_I_FRAME_BYTES : BENCH_P_FRAME_BYTES;
+            for (uint32_t i = 0; i < frameBytes; i++) {
+                frame[i] = testByte(loggedBytes + i);
+            }
+
+            const uint32_t written = afatfs_fwrite(file, frame, frameBytes);
+            loggedBytes += written;
+            if (written < frameBytes) {
+                droppedBytes += frameBytes - written;
+                droppedFrames++;
+                stallPeriods += stalled ? 0 : 1;
+                stalled = true;
+            } else {
+                stalled = false;
+            }
+        }
+    }
+
+    const timeUs_t elapsedUs = simTimeUs - startTimeUs;
+    const afatfsStatistics_t *statistics = afatfs_getStatistics();
+    const uint32_t cacheRequests = statistics->cacheRequests - statisticsStart.cacheRequests;
+    const uint32_t cacheReads = statistics->cacheReads - statisticsStart.cacheReads;
+    const uint32_t cacheFull = statistics->cacheFull - statisticsStart.cacheFull;
+    const sdcardSimStatistics_t *cardStatistics = sdcardSim_getStatistics();
+
+    printf("[ BENCH    ] %s card: %.1f kB/s logged, %u frames dropped (%u bytes) in %u stalls, cache hits %.2f%% of %u, "
+        "cache full %u, card busy %.1f%% with %u stalls, %u of %u blocks in multi-block writes, %u busy rejects\n",
+        card->name, (double)(loggedBytes - headerBytes) * 1000 / elapsedUs, droppedFrames, droppedBytes, stallPeriods,
+        cacheRequests ? 100.0 * (cacheRequests - cacheReads) / cacheRequests : 0.0, cacheRequests, cacheFull,
+        100.0 * cardStatistics->busyUs / elapsedUs, cardStatistics->stalls,
+        cardStatistics->multiWriteBlocks, cardStatistics->blocksWritten, cardStatistics->busyRejects);
+
+    if (card->config.stallIntervalBlocks == 0) {
+        // A card without long pauses keeps up with the log
+        EXPECT_EQ(0u, droppedBytes);
+    }
+
+    closeTestFile(file);
+    unmountImage();
+}
+
+TEST(AsyncFatFsTest, BenchmarkBlackboxLogging)
+{
+    for (unsigned i = 0; i < ARRAYLEN(benchCards); i++) {
+        benchmarkBlackboxLogging(&benchCards[i]);
+    }
+}
+
+// STUBS
+
+extern "C" {
+
+timeUs_t micros(void)
+{
+    return simTimeUs;
+}
+
+}
@@ -0,0 +1,688 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blackbox/blackbox_fielddefs.h"
+
+#include "blackbox_decoder.h"
+
+#define BLACKBOX_DECODER_MAX_LINE 1024
+
+static const char blackboxDecoderFrameChars[BLACKBOX_DECODER_FRAME_COUNT] = { 'I', 'P', 'S', 'G', 'H' };
+
+static int32_t signExtend(uint32_t value, int bits)
+{
+    const uint32_t signBit = 1U << (bits - 1);
+    value &= (1U << bits) - 1;
+    return (int32_t)((value ^ signBit) - signBit);
+}
+
+void blackboxDecoderStreamInit(blackboxDecoderStream_t *stream, const uint8_t *data, int length)
+{
+    stream->pos = data;
+    stream->end = data + length;
+    stream->error = false;
+    stream->bitBuffer = 0;
+    stream->bitCount = 0;
+}
+
+uint8_t blackboxDecoderReadByte(blackboxDecoderStream_t *stream)
+{
+    if (stream->pos >= stream->end) {
+        stream->error = true;
+        return 0;
+    }
+    return *stream->pos++;
+}
+
+uint32_t blackboxDecoderReadUnsignedVB(blackboxDecoderStream_t *stream)
+{
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const uint8_t b = blackboxDecoderReadByte(stream);
+        result |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80) || stream->error) {
+            return result;
+        }
+    }
+    // a 32 bit value never needs more than 5 bytes
+    stream->error = true;
+    return 0;
+}
+
+int32_t blackboxDecoderReadSignedVB(blackboxDecoderStream_t *stream)
+{
+    const uint32_t value = blackboxDecoderReadUnsignedVB(stream);
+    // ZigZag decode
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+int32_t blackboxDecoderReadNeg14Bit(blackboxDecoderStream_t *stream)
+{
+    return -signExtend(blackboxDecoderReadUnsignedVB(stream), 14);
+}
+
+static int32_t readTag2_3S32Bytes(blackboxDecoderStream_t *stream, uint8_t selector)
+{
+    uint32_t value = 0;
+    const int byteCount = (selector & 0x03) + 1;
+    for (int i = 0; i < byteCount; i++) {
+        value |= (uint32_t)blackboxDecoderReadByte(stream) << (i * 8);
+    }
+    return byteCount == 4 ? (int32_t)value : signExtend(value, byteCount * 8);
+}
+
+void blackboxDecoderReadTag2_3S32(blackboxDecoderStream_t *stream, int32_t *values)
+{
+    uint8_t lead = blackboxDecoderReadByte(stream);
+    uint8_t b;
+
+    switch (lead >> 6) {
+    case 0:
+        // 2 bits per field  ss11 2233
+        values[0] = signExtend(lead >> 4, 2);
+        values[1] = signExtend(lead >> 2, 2);
+        values[2] = signExtend(lead, 2);
+        break;
+    case 1:
+        // 4 bits per field  ss00 1111 2222 3333
+        values[0] = signExtend(lead, 4);
+        b = blackboxDecoderReadByte(stream);
+        values[1] = signExtend(b >> 4, 4);
+        values[2] = signExtend(b, 4);
+        break;
+    case 2:
+        // 6 bits per field  ss11 1111 0022 2222 0033 3333
+        values[0] = signExtend(lead, 6);
+        values[1] = signExtend(blackboxDecoderReadByte(stream), 6);
+        values[2] = signExtend(blackboxDecoderReadByte(stream), 6);
+        break;
+    case 3:
+        // byte counts of the fields in the low bits of the lead, first field lowest
+        for (int i = 0; i < 3; i++, lead >>= 2) {
+            values[i] = readTag2_3S32Bytes(stream, lead);
+        }
+        break;
+    }
+}
+
+void blackboxDecoderReadTag2_3SVariable(blackboxDecoderStream_t *stream, int32_t *values)
+{
+    const uint8_t lead = *stream->pos;
+    uint8_t b1, b2;
+
+    switch (stream->pos < stream->end ? lead >> 6 : 0) {
+    case 1:
+        // 554 bits per field  ss11 1112 2222 3333
+        blackboxDecoderReadByte(stream);
+        b1 = blackboxDecoderReadByte(stream);
+        values[0] = signExtend(lead >> 1, 5);
+        values[1] = signExtend(((lead & 0x01) << 4) | (b1 >> 4), 5);
+        values[2] = signExtend(b1, 4);
+        break;
+    case 2:
+        // 877 bits per field  ss11 1111 1122 2222 2333 3333
+        blackboxDecoderReadByte(stream);
+        b1 = blackboxDecoderReadByte(stream);
+        b2 = blackboxDecoderReadByte(stream);
+        values[0] = signExtend(((lead & 0x3F) << 2) | (b1 >> 6), 8);
+        values[1] = signExtend(((b1 & 0x3F) << 1) | (b2 >> 7), 7);
+        values[2] = signExtend(b2, 7);
+        break;
+    default:
+        // the 2 and 32 bit layouts are the same as in Tag2_3S32
+        blackboxDecoderReadTag2_3S32(stream, values);
+        break;
+    }
+}
+
+void blackboxDecoderReadTag8_4S16(blackboxDecoderStream_t *stream, int32_t *values)
+{
+    uint8_t selector = blackboxDecoderReadByte(stream);
+    // the low nibble of the last byte read, when it still holds the start of the next field
+    bool nibbleWaiting = false;
+    uint8_t buffer = 0;
+    uint8_t b1, b2;
+
+    for (int i = 0; i < 4; i++, selector >>= 2) {
+        switch (selector & 0x03) {
+        case 0:
+            values[i] = 0;
+            break;
+        case 1:
+            // 4 bits, high nibble first
+            if (!nibbleWaiting) {
+                buffer = blackboxDecoderReadByte(stream);
+                values[i] = signExtend(buffer >> 4, 4);
+                nibbleWaiting = true;
+            } else {
+                values[i] = signExtend(buffer, 4);
+                nibbleWaiting = false;
+            }
+            break;
+        case 2:
+            // 8 bits
+            if (!nibbleWaiting) {
+                values[i] = signExtend(blackboxDecoderReadByte(stream), 8);
+            } else {
+                b1 = buffer << 4;
+                buffer = blackboxDecoderReadByte(stream);
+                values[i] = signExtend(b1 | (buffer >> 4), 8);
+            }
+            break;
+        case 3:
+            // 16 bits, high byte first
+            if (!nibbleWaiting) {
+                b1 = blackboxDecoderReadByte(stream);
+                b2 = blackboxDecoderReadByte(stream);
+                values[i] = signExtend((b1 << 8) | b2, 16);
+            } else {
+                b1 = blackboxDecoderReadByte(stream);
+                b2 = blackboxDecoderReadByte(stream);
+                values[i] = signExtend(((buffer & 0x0F) << 12) | (b1 << 4) | (b2 >> 4), 16);
+                buffer = b2;
+            }
+            break;
+        }
+    }
+}
+
+void blackboxDecoderReadTag8_8SVB(blackboxDecoderStream_t *stream, int32_t *values, int valueCount)
+{
+    if (valueCount == 1) {
+        // a single field is written without the header
+        values[0] = blackboxDecoderReadSignedVB(stream);
+        return;
+    }
+
+    uint8_t header = blackboxDecoderReadByte(stream);
+    for (int i = 0; i < valueCount; i++, header >>= 1) {
+        values[i] = (header & 0x01) ? blackboxDecoderReadSignedVB(stream) : 0;
+    }
+}
+
+static uint32_t readBits(blackboxDecoderStream_t *stream, int count)
+{
+    uint32_t bits = 0;
+    while (count-- > 0) {
+        if (stream->bitCount == 0) {
+            stream->bitBuffer = blackboxDecoderReadByte(stream);
+            stream->bitCount = 8;
+        }
+        stream->bitCount--;
+        bits = (bits << 1) | ((stream->bitBuffer >> stream->bitCount) & 0x01);
+    }
+    return bits;
+}
+
+int32_t blackboxDecoderReadRice(blackboxDecoderStream_t *stream, blackboxRiceState_t *state)
+{
+    const int k = blackboxRiceParameter(state);
+    uint32_t quotient = 0;
+    while (quotient < BLACKBOX_RICE_ESCAPE && readBits(stream, 1) && !stream->error) {
+        quotient++;
+    }
+
+    uint32_t zigzag;
+    if (quotient == BLACKBOX_RICE_ESCAPE) {
+        zigzag = readBits(stream, 32);
+    } else {
+        zigzag = (quotient << k) | readBits(stream, k);
+    }
+    blackboxRiceStateUpdate(state, zigzag);
+
+    return (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+}
+
+// Skips the padding after the last Rice coded field
+void blackboxDecoderAlignBits(blackboxDecoderStream_t *stream)
+{
+    stream->bitCount = 0;
+}
+
+void blackboxDecoderInit(blackboxDecoder_t *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->iterationStep = 1;
+    decoder->motor0Index = -1;
+    decoder->timeIndex = -1;
+    decoder->gpsCoordIndex = -1;
+    for (int i = 0; i < BLACKBOX_DECODER_MAX_FIELDS; i++) {
+        blackboxRiceStateInit(&decoder->riceState[i]);
+    }
+}
+
+int blackboxDecoderFieldIndex(const blackboxDecoderFrameDef_t *frameDef, const char *name)
+{
+    for (int i = 0; i < frameDef->fieldCount; i++) {
+        if (strcmp(frameDef->name[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int frameTypeFromChar(char frameChar)
+{
+    for (int i = 0; i < BLACKBOX_DECODER_FRAME_COUNT; i++) {
+        if (blackboxDecoderFrameChars[i] == frameChar) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Parses a comma separated list of integers, returns the number of them
+static int parseIntList(const char *s, int32_t *values, int maxCount)
+{
+    int count = 0;
+    while (*s && count < maxCount) {
+        char *end;
+        values[count++] = strtol(s, &end, 10);
+        if (*end != ',') {
+            break;
+        }
+        s = end + 1;
+    }
+    return count;
+}
+
+static bool parseFieldHeader(blackboxDecoder_t *decoder, char frameChar, const char *key, const char *value)
+{
+    const int frameType = frameTypeFromChar(frameChar);
+    if (frameType < 0) {
+        return false;
+    }
+    blackboxDecoderFrameDef_t *def = &decoder->frameDef[frameType];
+
+    if (strcmp(key, "name") == 0) {
+        def->fieldCount = 0;
+        while (*value && def->fieldCount < BLACKBOX_DECODER_MAX_FIELDS) {
+            const char *comma = strchr(value, ',');
+            const int length = comma ? comma - value : (int)strlen(value);
+            const int copyLength = length < BLACKBOX_DECODER_MAX_NAME - 1 ? length : BLACKBOX_DECODER_MAX_NAME - 1;
+            memcpy(def->name[def->fieldCount], value, copyLength);
+            def->name[def->fieldCount][copyLength] = '\0';
+            def->fieldCount++;
+            value += length + (comma ? 1 : 0);
+        }
+        if (frameType == BLACKBOX_DECODER_FRAME_I) {
+            decoder->motor0Index = blackboxDecoderFieldIndex(def, "motor[0]");
+            decoder->timeIndex = blackboxDecoderFieldIndex(def, "time");
+        } else if (frameType == BLACKBOX_DECODER_FRAME_G) {
+            decoder->gpsCoordIndex = blackboxDecoderFieldIndex(def, "GPS_coord[0]");
+        }
+        return true;
+    }
+
+    int32_t list[BLACKBOX_DECODER_MAX_FIELDS];
+    const int count = parseIntList(value, list, BLACKBOX_DECODER_MAX_FIELDS);
+    uint8_t *target;
+    if (strcmp(key, "signed") == 0) {
+        target = def->isSigned;
+    } else if (strcmp(key, "predictor") == 0) {
+        target = def->predictor;
+    } else if (strcmp(key, "encoding") == 0) {
+        target = def->encoding;
+    } else {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        target[i] = list[i];
+    }
+
+    if (frameType == BLACKBOX_DECODER_FRAME_P) {
+        // P frames only have predictor and encoding lines, they share the names and signedness of the I frame
+        const blackboxDecoderFrameDef_t *intraDef = &decoder->frameDef[BLACKBOX_DECODER_FRAME_I];
+        def->fieldCount = intraDef->fieldCount;
+        memcpy(def->name, intraDef->name, sizeof(def->name));
+        memcpy(def->isSigned, intraDef->isSigned, sizeof(def->isSigned));
+    }
+    return true;
+}
+
+/*
+ * Takes a header line without the leading "H " and the trailing newline. Returns false for lines that are not used
+ * by the decoder.
+ */
+bool blackboxDecoderParseHeaderLine(blackboxDecoder_t *decoder, const char *line)
+{
+    const char *colon = strchr(line, ':');
+    if (!colon) {
+        return false;
+    }
+    const char *value = colon + 1;
+
+    char key[32];
+    const int keyLength = colon - line;
+    if (keyLength >= (int)sizeof(key)) {
+        return false;
+    }
+    memcpy(key, line, keyLength);
+    key[keyLength] = '\0';
+
+    if (strncmp(key, "Field ", 6) == 0 && keyLength > 8 && key[7] == ' ') {
+        return parseFieldHeader(decoder, key[6], key + 8, value);
+    }
+
+    int32_t list[2];
+    if (strcmp(key, "minthrottle") == 0) {
+        decoder->minthrottle = strtol(value, NULL, 10);
+    } else if (strcmp(key, "vbatref") == 0) {
+        decoder->vbatref = strtol(value, NULL, 10);
+    } else if (strcmp(key, "P encoding") == 0) {
+        decoder->pEncoding = strtol(value, NULL, 10);
+    } else if (strcmp(key, "gyro_raw") == 0) {
+        // samples per block and sample interval, the scale that follows is left to the analysis
+        parseIntList(value, list, 2);
+        decoder->gyroRawBlockSamples = list[0];
+        decoder->gyroRawLooptime = list[1];
+    } else if (strcmp(key, "motorOutput") == 0) {
+        parseIntList(value, list, 2);
+        decoder->minmotor = list[0];
+    } else if (strcmp(key, "P interval") == 0) {
+        // "num/denom", num of every denom main frames are logged
+        const char *slash = strchr(value, '/');
+        const int32_t num = strtol(value, NULL, 10);
+        const int32_t denom = slash ? strtol(slash + 1, NULL, 10) : 1;
+        decoder->iterationStep = num > 0 && denom >= num ? denom / num : 1;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Reads the "H " lines at the start of the stream. Returns the number of lines read.
+ */
+int blackboxDecoderReadHeader(blackboxDecoder_t *decoder, blackboxDecoderStream_t *stream)
+{
+    int lineCount = 0;
+    char line[BLACKBOX_DECODER_MAX_LINE];
+
+    while (stream->end - stream->pos >= 2 && stream->pos[0] == 'H' && stream->pos[1] == ' ') {
+        stream->pos += 2;
+        int length = 0;
+        while (stream->pos < stream->end && *stream->pos != '\n') {
+            if (length < BLACKBOX_DECODER_MAX_LINE - 1) {
+                line[length++] = *stream->pos;
+            }
+            stream->pos++;
+        }
+        line[length] = '\0';
+        if (stream->pos < stream->end) {
+            stream->pos++;
+        }
+        blackboxDecoderParseHeaderLine(decoder, line);
+        lineCount++;
+    }
+    return lineCount;
+}
+
+static int32_t applyPrediction(blackboxDecoder_t *decoder, int frameType, int fieldIndex, int32_t value, const int32_t *current)
+{
+    const blackboxDecoderFrameDef_t *def = &decoder->frameDef[frameType];
+    const int32_t *previous = decoder->mainHistory[0];
+    const int32_t *previous2 = decoder->mainHistory[1];
+
+    switch (def->predictor[fieldIndex]) {
+    case FLIGHT_LOG_FIELD_PREDICTOR_0:
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_PREVIOUS:
+        value += previous[fieldIndex];
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_STRAIGHT_LINE:
+        value += (uint32_t)2 * previous[fieldIndex] - previous2[fieldIndex];
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_AVERAGE_2:
+        if (def->isSigned[fieldIndex]) {
+            value += (previous[fieldIndex] + previous2[fieldIndex]) / 2;
+        } else {
+            value += ((uint32_t)previous[fieldIndex] + (uint32_t)previous2[fieldIndex]) / 2;
+        }
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_MINTHROTTLE:
+        value += decoder->minthrottle;
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_MOTOR_0:
+        if (decoder->motor0Index >= 0 && decoder->motor0Index < fieldIndex) {
+            value += current[decoder->motor0Index];
+        }
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_INC:
+        value += previous[fieldIndex] + decoder->iterationStep;
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_HOME_COORD:
+        if (decoder->gpsCoordIndex >= 0 && fieldIndex >= decoder->gpsCoordIndex && fieldIndex - decoder->gpsCoordIndex < 2) {
+            value += decoder->gpsHome[fieldIndex - decoder->gpsCoordIndex];
+        }
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_1500:
+        value += 1500;
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_VBATREF:
+        value += decoder->vbatref;
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_LAST_MAIN_FRAME_TIME:
+        if (decoder->timeIndex >= 0) {
+            value += previous[decoder->timeIndex];
+        }
+        break;
+    case FLIGHT_LOG_FIELD_PREDICTOR_MINMOTOR:
+        value += decoder->minmotor;
+        break;
+    }
+    return value;
+}
+
+static void decodeFields(blackboxDecoder_t *decoder, blackboxDecoderStream_t *stream, int frameType, int32_t *values)
+{
+    const blackboxDecoderFrameDef_t *def = &decoder->frameDef[frameType];
+    int32_t raw[8];
+
+    for (int i = 0; i < def->fieldCount && !stream->error; ) {
+        const uint8_t encoding = def->encoding[i];
+        int groupCount = 1;
+
+        if (encoding != FLIGHT_LOG_FIELD_ENCODING_ADAPTIVE_RICE) {
+            blackboxDecoderAlignBits(stream);
+        }
+
+        switch (encoding) {
+        case FLIGHT_LOG_FIELD_ENCODING_SIGNED_VB:
+            raw[0] = blackboxDecoderReadSignedVB(stream);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_UNSIGNED_VB:
+            raw[0] = blackboxDecoderReadUnsignedVB(stream);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_NEG_14BIT:
+            raw[0] = blackboxDecoderReadNeg14Bit(stream);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG8_4S16:
+            blackboxDecoderReadTag8_4S16(stream, raw);
+            groupCount = 4;
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG2_3S32:
+            blackboxDecoderReadTag2_3S32(stream, raw);
+            groupCount = 3;
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG2_3SVARIABLE:
+            blackboxDecoderReadTag2_3SVariable(stream, raw);
+            groupCount = 3;
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_TAG8_8SVB:
+            // the group is made of up to 8 consecutive fields with this encoding
+            while (groupCount < 8 && i + groupCount < def->fieldCount && def->encoding[i + groupCount] == encoding) {
+                groupCount++;
+            }
+            blackboxDecoderReadTag8_8SVB(stream, raw, groupCount);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_ADAPTIVE_RICE:
+            raw[0] = blackboxDecoderReadRice(stream, &decoder->riceState[i]);
+            break;
+        case FLIGHT_LOG_FIELD_ENCODING_NULL:
+            raw[0] = 0;
+            break;
+        default:
+            stream->error = true;
+            return;
+        }
+
+        for (int j = 0; j < groupCount && i < def->fieldCount; j++, i++) {
+            values[i] = applyPrediction(decoder, frameType, i, raw[j], values);
+        }
+    }
+    blackboxDecoderAlignBits(stream);
+}
+
+static void readEvent(blackboxDecoderStream_t *stream, int32_t *values, int *valueCount)
+{
+    const uint8_t event = blackboxDecoderReadByte(stream);
+    int count = 0;
+
+    values[count++] = event;
+    switch (event) {
+    case FLIGHT_LOG_EVENT_SYNC_BEEP:
+        values[count++] = blackboxDecoderReadUnsignedVB(stream);
+        break;
+    case FLIGHT_LOG_EVENT_FLIGHTMODE:
+    case FLIGHT_LOG_EVENT_LOGGING_RESUME:
+        values[count++] = blackboxDecoderReadUnsignedVB(stream);
+        values[count++] = blackboxDecoderReadUnsignedVB(stream);
+        break;
+    case FLIGHT_LOG_EVENT_INFLIGHT_ADJUSTMENT:
+        values[count] = blackboxDecoderReadByte(stream);
+        if (values[count++] & FLIGHT_LOG_EVENT_INFLIGHT_ADJUSTMENT_FUNCTION_FLOAT_VALUE_FLAG) {
+            // the bits of the float, least significant byte first
+            uint32_t bits = 0;
+            for (int i = 0; i < 4; i++) {
+                bits |= (uint32_t)blackboxDecoderReadByte(stream) << (i * 8);
+            }
+            values[count++] = bits;
+        } else {
+            values[count++] = blackboxDecoderReadSignedVB(stream);
+        }
+        break;
+    case FLIGHT_LOG_EVENT_LOG_END:
+        // "End of log" and its terminator
+        while (blackboxDecoderReadByte(stream) != 0 && !stream->error) {
+        }
+        break;
+    default:
+        // the length of an unknown event is unknown too
+        stream->error = true;
+        break;
+    }
+    *valueCount = count;
+}
+
+/*
+ * Decodes the next frame into values, which must have room for BLACKBOX_DECODER_MAX_FIELDS. Returns the frame type
+ * character, or 0 at the end of the data or when the stream is corrupt. The values of event frames are the event
+ * type followed by its data.
+ */
+static uint32_t readUnsignedLE(blackboxDecoderStream_t *stream, int size)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value |= (uint32_t)blackboxDecoderReadByte(stream) << (i * 8);
+    }
+    return value;
+}
+
+// The samples go to decoder->gyroRaw, the values are the time of the first one, the samples dropped and the count
+static void readGyroRawBlock(blackboxDecoder_t *decoder, blackboxDecoderStream_t *stream, int32_t *values, int *valueCount)
+{
+    const int sampleCount = blackboxDecoderReadByte(stream);
+    values[2] = sampleCount;
+    values[1] = readUnsignedLE(stream, 2);
+    values[0] = readUnsignedLE(stream, 4);
+    if (sampleCount > BLACKBOX_GYRO_RAW_BLOCK_SAMPLES) {
+        stream->error = true;
+        return;
+    }
+    for (int i = 0; i < sampleCount; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            decoder->gyroRaw[i][axis] = (int16_t)readUnsignedLE(stream, 2);
+        }
+    }
+    decoder->gyroRawSampleCount = sampleCount;
+    *valueCount = 3;
+}
+
+char blackboxDecoderReadFrame(blackboxDecoder_t *decoder, blackboxDecoderStream_t *stream, int32_t *values, int *valueCount)
+{
+    *valueCount = 0;
+    if (stream->error || stream->pos >= stream->end) {
+        return 0;
+    }
+
+    const char frameChar = blackboxDecoderReadByte(stream);
+    if (frameChar == 'E') {
+        readEvent(stream, values, valueCount);
+        return stream->error ? 0 : frameChar;
+    }
+    if (frameChar == 'R') {
+        readGyroRawBlock(decoder, stream, values, valueCount);
+        return stream->error ? 0 : frameChar;
+    }
+
+    const int frameType = frameTypeFromChar(frameChar);
+    if (frameType < 0 || decoder->frameDef[frameType].fieldCount == 0) {
+        stream->error = true;
+        return 0;
+    }
+    if (frameType == BLACKBOX_DECODER_FRAME_P && !decoder->mainHistoryValid) {
+        // no I frame to predict from
+        stream->error = true;
+        return 0;
+    }
+
+    memset(values, 0, sizeof(int32_t) * BLACKBOX_DECODER_MAX_FIELDS);
+    decodeFields(decoder, stream, frameType, values);
+    if (stream->error) {
+        return 0;
+    }
+    *valueCount = decoder->frameDef[frameType].fieldCount;
+
+    switch (frameType) {
+    case BLACKBOX_DECODER_FRAME_I:
+        memcpy(decoder->mainHistory[0], values, sizeof(decoder->mainHistory[0]));
+        memcpy(decoder->mainHistory[1], values, sizeof(decoder->mainHistory[1]));
+        decoder->mainHistoryValid = true;
+        // the Rice coding of the P frames starts over after every I frame
+        for (int i = 0; i < BLACKBOX_DECODER_MAX_FIELDS; i++) {
+            blackboxRiceStateInit(&decoder->riceState[i]);
+        }
+        break;
+    case BLACKBOX_DECODER_FRAME_P:
+        memcpy(decoder->mainHistory[1], decoder->mainHistory[0], sizeof(decoder->mainHistory[1]));
+        memcpy(decoder->mainHistory[0], values, sizeof(decoder->mainHistory[0]));
+        break;
+    case BLACKBOX_DECODER_FRAME_H:
+        decoder->gpsHome[0] = values[0];
+        decoder->gpsHome[1] = *valueCount > 1 ? values[1] : 0;
+        break;
+    default:
+        break;
+    }
+    return frameChar;
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "blackbox/blackbox_encoding.h"
+#include "blackbox/blackbox_fielddefs.h"
+
+/*
+ * Decoder for the logs written by blackbox.c. It is part of the unit tests, the firmware never links it.
+ * The field layout is taken from the "H Field" header lines, as a log viewer would do.
+ */
+
+#define BLACKBOX_DECODER_MAX_FIELDS     64
+#define BLACKBOX_DECODER_MAX_NAME       24
+
+typedef enum {
+    BLACKBOX_DECODER_FRAME_I = 0,
+    BLACKBOX_DECODER_FRAME_P,
+    BLACKBOX_DECODER_FRAME_S,
+    BLACKBOX_DECODER_FRAME_G,
+    BLACKBOX_DECODER_FRAME_H,
+    BLACKBOX_DECODER_FRAME_COUNT
+} blackboxDecoderFrameType_e;
+
+typedef struct blackboxDecoderStream_s {
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool error;     // ran past the end or found something that is not a valid encoding
+    uint8_t bitBuffer;
+    uint8_t bitCount;   // bits of bitBuffer not read yet
+} blackboxDecoderStream_t;
+
+typedef struct blackboxDecoderFrameDef_s {
+    int fieldCount;
+    char name[BLACKBOX_DECODER_MAX_FIELDS][BLACKBOX_DECODER_MAX_NAME];
+    uint8_t isSigned[BLACKBOX_DECODER_MAX_FIELDS];
+    uint8_t predictor[BLACKBOX_DECODER_MAX_FIELDS];
+    uint8_t encoding[BLACKBOX_DECODER_MAX_FIELDS];
+} blackboxDecoderFrameDef_t;
+
+typedef struct blackboxDecoder_s {
+    blackboxDecoderFrameDef_t frameDef[BLACKBOX_DECODER_FRAME_COUNT];
+
+    // [0] is the last main frame, [1] the one before it
+    int32_t mainHistory[2][BLACKBOX_DECODER_MAX_FIELDS];
+    bool mainHistoryValid;
+    int32_t gpsHome[2];
+
+    // fields other fields are predicted from, -1 when the log doesn't have them
+    int motor0Index;
+    int timeIndex;
+    int gpsCoordIndex;
+
+    // from the system information headers
+    int32_t minthrottle;
+    int32_t minmotor;
+    int32_t vbatref;
+    int32_t iterationStep;  // loop iterations between two logged main frames
+    int32_t pEncoding;      // blackboxEncoding_e
+
+    blackboxRiceState_t riceState[BLACKBOX_DECODER_MAX_FIELDS];
+
+    // gyro raw capture, from the "gyro_raw" header and the last R frame
+    int32_t gyroRawBlockSamples;
+    int32_t gyroRawLooptime;
+    int16_t gyroRaw[BLACKBOX_GYRO_RAW_BLOCK_SAMPLES][3];
+    int gyroRawSampleCount;
+} blackboxDecoder_t;
+
+void blackboxDecoderStreamInit(blackboxDecoderStream_t *stream, const uint8_t *data, int length);
+
+uint8_t blackboxDecoderReadByte(blackboxDecoderStream_t *stream);
+uint32_t blackboxDecoderReadUnsignedVB(blackboxDecoderStream_t *stream);
+int32_t blackboxDecoderReadSignedVB(blackboxDecoderStream_t *stream);
+int32_t blackboxDecoderReadNeg14Bit(blackboxDecoderStream_t *stream);
+void blackboxDecoderReadTag2_3S32(blackboxDecoderStream_t *stream, int32_t *values);
+void blackboxDecoderReadTag2_3SVariable(blackboxDecoderStream_t *stream, int32_t *values);
+void blackboxDecoderReadTag8_4S16(blackboxDecoderStream_t *stream, int32_t *values);
+void blackboxDecoderReadTag8_8SVB(blackboxDecoderStream_t *stream, int32_t *values, int valueCount);
+int32_t blackboxDecoderReadRice(blackboxDecoderStream_t *stream, blackboxRiceState_t *state);
+void blackboxDecoderAlignBits(blackboxDecoderStream_t *stream);
+
+void blackboxDecoderInit(blackboxDecoder_t *decoder);
+bool blackboxDecoderParseHeaderLine(blackboxDecoder_t *decoder, const char *line);
+int blackboxDecoderReadHeader(blackboxDecoder_t *decoder, blackboxDecoderStream_t *stream);
+char blackboxDecoderReadFrame(blackboxDecoder_t *decoder, blackboxDecoderStream_t *stream, int32_t *values, int *valueCount);
+int blackboxDecoderFieldIndex(const blackboxDecoderFrameDef_t *frameDef, const char *name);
@@ -16,6 +16,10 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
 
 extern "C" {
     #include "platform.h"
@@ -29,6 +33,8 @@ extern "C" {
 
     #include "drivers/serial.h"
     #include "io/serial.h"
+
+    #include "blackbox_decoder.h"
 }
 
 #include "unittest_macros.h"
@@ -39,7 +45,7 @@ static serialPort_t *blackboxPort;
 static int serialWritePos = 0;
 static int serialReadPos = 0;
 static int serialReadEnd = 0;
-#define SERIAL_BUFFER_SIZE 256
+#define SERIAL_BUFFER_SIZE 1024
 static uint8_t serialReadBuffer[SERIAL_BUFFER_SIZE];
 static uint8_t serialWriteBuffer[SERIAL_BUFFER_SIZE];
 
@@ -240,6 +246,289 @@ TEST(BlackboxTest, TestWriteTag2_3SVariable_BITS887)
     EXPECT_EQ(0, buf[3]); // ensure next byte has not been written
     buf += 3;
 }
+
+#define BENCHMARK_FRAMES 20000
+
+// deltas between consecutive frames of a flight, as the P frame predictors leave them
+static void benchmarkDeltas(int32_t *values, int count, int frame, int scale)
+{
+    static uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        const int noise = (int)((seed >> 16) % 7) - 3;
+        values[i] = lrintf(scale * sinf(frame * 0.01f + i) * sinf(frame * 0.0007f)) + noise;
+    }
+}
+
+typedef void (*benchmarkWriteFn)(int32_t *values, int count);
+typedef void (*benchmarkReadFn)(blackboxDecoderStream_t *stream, int32_t *values, int count);
+
+static void benchmarkWriteTag8_4S16(int32_t *values, int count) { UNUSED(count); blackboxWriteTag8_4S16(values); }
+static void benchmarkWriteTag2_3S32(int32_t *values, int count) { UNUSED(count); blackboxWriteTag2_3S32(values); }
+static void benchmarkWriteTag8_8SVB(int32_t *values, int count) { blackboxWriteTag8_8SVB(values, count); }
+
+static void benchmarkReadTag8_4S16(blackboxDecoderStream_t *stream, int32_t *values, int count) { UNUSED(count); blackboxDecoderReadTag8_4S16(stream, values); }
+static void benchmarkReadTag2_3S32(blackboxDecoderStream_t *stream, int32_t *values, int count) { UNUSED(count); blackboxDecoderReadTag2_3S32(stream, values); }
+static void benchmarkReadTag8_8SVB(blackboxDecoderStream_t *stream, int32_t *values, int count) { blackboxDecoderReadTag8_8SVB(stream, values, count); }
+
+static blackboxRiceState_t benchmarkWriteRiceStates[8];
+static blackboxRiceState_t benchmarkReadRiceStates[8];
+
+static void benchmarkWriteRice(int32_t *values, int count)
+{
+    for (int i = 0; i < count; i++) {
+        blackboxWriteRice(&benchmarkWriteRiceStates[i], values[i]);
+    }
+    blackboxFlushBits();
+}
+
+static void benchmarkReadRice(blackboxDecoderStream_t *stream, int32_t *values, int count)
+{
+    for (int i = 0; i < count; i++) {
+        values[i] = blackboxDecoderReadRice(stream, &benchmarkReadRiceStates[i]);
+    }
+    blackboxDecoderAlignBits(stream);
+}
+
+static void benchmarkResetRice(void)
+{
+    for (int i = 0; i < 8; i++) {
+        blackboxRiceStateInit(&benchmarkWriteRiceStates[i]);
+        blackboxRiceStateInit(&benchmarkReadRiceStates[i]);
+    }
+}
+
+/*
+ * Encodes every frame, decodes it back and checks it is unchanged, then times the encoder alone. The sizes and times
+ * are printed rather than checked so the numbers of an encoder change can be compared with the ones before it.
+ */
+static void benchmarkEncoding(const char *name, benchmarkWriteFn writeFn, benchmarkReadFn readFn, int count, int scale)
+{
+    int32_t values[8];
+    int32_t decoded[8];
+    uint32_t totalBytes = 0;
+
+    for (int frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+        serialTestResetBuffers();
+        benchmarkDeltas(values, count, frame, scale);
+        writeFn(values, count);
+        totalBytes += serialWritePos;
+
+        blackboxDecoderStream_t stream;
+        blackboxDecoderStreamInit(&stream, serialWriteBuffer, serialWritePos);
+        readFn(&stream, decoded, count);
+        EXPECT_FALSE(stream.error);
+        EXPECT_EQ(serialWriteBuffer + serialWritePos, stream.pos);
+        for (int i = 0; i < count; i++) {
+            ASSERT_EQ(values[i], decoded[i]) << name << " frame " << frame << " field " << i;
+        }
+    }
+
+    serialTestResetBuffers();
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+        if (serialWritePos > SERIAL_BUFFER_SIZE - 64) {
+            serialWritePos = 0;
+        }
+        values[0] = frame & 0xff;
+        values[1] = -(frame & 0x3f);
+        values[2] = (frame * 3) & 0x7fff;
+        values[3] = 1;
+        writeFn(values, count);
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    printf("[ BENCH    ] %s: %.2f bytes/frame, %.1f ns/frame\n", name,
+        (double)totalBytes / BENCHMARK_FRAMES, (double)elapsed / BENCHMARK_FRAMES);
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripTag8_4S16)
+{
+    // the accelerometer and rcCommand fields
+    benchmarkEncoding("Tag8_4S16", benchmarkWriteTag8_4S16, benchmarkReadTag8_4S16, 4, 300);
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripTag2_3S32)
+{
+    // the PID I terms and the gyro of the slow changing axes
+    benchmarkEncoding("Tag2_3S32", benchmarkWriteTag2_3S32, benchmarkReadTag2_3S32, 3, 40);
+    benchmarkEncoding("Tag2_3S32 large", benchmarkWriteTag2_3S32, benchmarkReadTag2_3S32, 3, 100000);
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripTag8_8SVB)
+{
+    // the PID D terms and the motors
+    benchmarkEncoding("Tag8_8SVB", benchmarkWriteTag8_8SVB, benchmarkReadTag8_8SVB, 8, 100);
+    benchmarkEncoding("Tag8_8SVB single", benchmarkWriteTag8_8SVB, benchmarkReadTag8_8SVB, 1, 100);
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripRice)
+{
+    // the same fields as the tag encodings above, each with its own Rice parameter
+    benchmarkResetRice();
+    benchmarkEncoding("Rice 4 fields", benchmarkWriteRice, benchmarkReadRice, 4, 300);
+    benchmarkResetRice();
+    benchmarkEncoding("Rice 3 fields", benchmarkWriteRice, benchmarkReadRice, 3, 40);
+    benchmarkResetRice();
+    benchmarkEncoding("Rice 3 fields large", benchmarkWriteRice, benchmarkReadRice, 3, 100000);
+    benchmarkResetRice();
+    benchmarkEncoding("Rice 8 fields", benchmarkWriteRice, benchmarkReadRice, 8, 100);
+}
+
+TEST(BlackboxEncodingTest, TestRiceParameterAdapts)
+{
+    blackboxRiceState_t state;
+    blackboxRiceStateInit(&state);
+    EXPECT_EQ(2, blackboxRiceParameter(&state));
+
+    // small values bring k down to 0
+    for (int i = 0; i < 64; i++) {
+        blackboxRiceStateUpdate(&state, 0);
+    }
+    EXPECT_EQ(0, blackboxRiceParameter(&state));
+
+    // values around 1000 need 10 bits
+    for (int i = 0; i < 64; i++) {
+        blackboxRiceStateUpdate(&state, 1000);
+    }
+    EXPECT_EQ(10, blackboxRiceParameter(&state));
+
+    // and it stays within the limit
+    for (int i = 0; i < 64; i++) {
+        blackboxRiceStateUpdate(&state, UINT32_MAX);
+    }
+    EXPECT_EQ(BLACKBOX_RICE_MAX_K, blackboxRiceParameter(&state));
+}
+
+TEST(BlackboxEncodingTest, TestWriteRice)
+{
+    serialTestResetBuffers();
+    blackboxRiceState_t state;
+
+    // k = 2: 5 zigzags to 10, 10 >> 2 is two one bits and a zero, then 10 & 3 in two bits: 1101 0000
+    blackboxRiceStateInit(&state);
+    blackboxWriteRice(&state, 5);
+    blackboxFlushBits();
+    EXPECT_EQ(1, serialWritePos);
+    EXPECT_EQ(0xD0, serialWriteBuffer[0]);
+
+    // the escape, 24 one bits and the 32 bit value
+    blackboxRiceStateInit(&state);
+    blackboxWriteRice(&state, INT32_MIN);
+    blackboxFlushBits();
+    EXPECT_EQ(8, serialWritePos);
+    EXPECT_EQ(0xFF, serialWriteBuffer[1]);
+    EXPECT_EQ(0xFF, serialWriteBuffer[3]);
+    EXPECT_EQ(0xFF, serialWriteBuffer[4]);
+    EXPECT_EQ(0xFF, serialWriteBuffer[7]);
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripRiceLimits)
+{
+    static const int32_t values[] = {
+        0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 100, -100, 1000, INT32_MAX, INT32_MIN, 3, 0, -70000, 70000, 1 << 24, 0, 0, 5
+    };
+    blackboxRiceState_t writeState;
+    blackboxRiceState_t readState;
+
+    serialTestResetBuffers();
+    blackboxRiceStateInit(&writeState);
+    for (unsigned i = 0; i < ARRAYLEN(values); i++) {
+        blackboxWriteRice(&writeState, values[i]);
+    }
+    blackboxFlushBits();
+    // the next value starts on a byte
+    blackboxWriteUnsignedVB(42);
+
+    blackboxDecoderStream_t stream;
+    blackboxDecoderStreamInit(&stream, serialWriteBuffer, serialWritePos);
+    blackboxRiceStateInit(&readState);
+    for (unsigned i = 0; i < ARRAYLEN(values); i++) {
+        EXPECT_EQ(values[i], blackboxDecoderReadRice(&stream, &readState)) << "value " << i;
+    }
+    blackboxDecoderAlignBits(&stream);
+    EXPECT_EQ(42, blackboxDecoderReadUnsignedVB(&stream));
+    EXPECT_FALSE(stream.error);
+    EXPECT_EQ(serialWriteBuffer + serialWritePos, stream.pos);
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripTag8_4S16Limits)
+{
+    // every width of every field, so the nibble alignment of the following fields is exercised too
+    static const int32_t widths[] = { 0, 7, -8, 127, -128, 32767, -32768 };
+    const int widthCount = ARRAYLEN(widths);
+    int32_t values[4];
+    int32_t decoded[4];
+
+    for (int a = 0; a < widthCount; a++) {
+        for (int b = 0; b < widthCount; b++) {
+            for (int c = 0; c < widthCount; c++) {
+                for (int d = 0; d < widthCount; d++) {
+                    serialTestResetBuffers();
+                    values[0] = widths[a];
+                    values[1] = widths[b];
+                    values[2] = widths[c];
+                    values[3] = widths[d];
+                    blackboxWriteTag8_4S16(values);
+
+                    blackboxDecoderStream_t stream;
+                    blackboxDecoderStreamInit(&stream, serialWriteBuffer, serialWritePos);
+                    blackboxDecoderReadTag8_4S16(&stream, decoded);
+                    EXPECT_EQ(serialWriteBuffer + serialWritePos, stream.pos);
+                    EXPECT_EQ(0, memcmp(values, decoded, sizeof(values)));
+                }
+            }
+        }
+    }
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripVB)
+{
+    static const int32_t signedValues[] = { 0, 1, -1, 63, -64, 64, 8191, -8192, 1 << 20, INT32_MAX, INT32_MIN };
+    static const uint32_t unsignedValues[] = { 0, 127, 128, 16383, 16384, UINT32_MAX };
+
+    serialTestResetBuffers();
+    for (unsigned i = 0; i < ARRAYLEN(signedValues); i++) {
+        blackboxWriteSignedVB(signedValues[i]);
+    }
+    for (unsigned i = 0; i < ARRAYLEN(unsignedValues); i++) {
+        blackboxWriteUnsignedVB(unsignedValues[i]);
+    }
+
+    blackboxDecoderStream_t stream;
+    blackboxDecoderStreamInit(&stream, serialWriteBuffer, serialWritePos);
+    for (unsigned i = 0; i < ARRAYLEN(signedValues); i++) {
+        EXPECT_EQ(signedValues[i], blackboxDecoderReadSignedVB(&stream));
+    }
+    for (unsigned i = 0; i < ARRAYLEN(unsignedValues); i++) {
+        EXPECT_EQ(unsignedValues[i], blackboxDecoderReadUnsignedVB(&stream));
+    }
+    EXPECT_FALSE(stream.error);
+    EXPECT_EQ(0, blackboxDecoderReadUnsignedVB(&stream));
+    EXPECT_TRUE(stream.error);
+}
+
+TEST(BlackboxEncodingTest, TestRoundTripTag2_3SVariable)
+{
+    static const int32_t fields[][3] = {
+        { 1, -2, 0 }, { 15, -16, 7 }, { 127, -64, 63 }, { 128, 0, 0 }, { -100000, 40000, 1 }, { INT32_MAX, INT32_MIN, -1 }
+    };
+    int32_t values[3];
+    int32_t decoded[3];
+
+    for (unsigned i = 0; i < ARRAYLEN(fields); i++) {
+        serialTestResetBuffers();
+        memcpy(values, fields[i], sizeof(values));
+        blackboxWriteTag2_3SVariable(values);
+
+        blackboxDecoderStream_t stream;
+        blackboxDecoderStreamInit(&stream, serialWriteBuffer, serialWritePos);
+        blackboxDecoderReadTag2_3SVariable(&stream, decoded);
+        EXPECT_EQ(serialWriteBuffer + serialWritePos, stream.pos);
+        EXPECT_EQ(0, memcmp(values, decoded, sizeof(values)));
+    }
+}
+
 // STUBS
 extern "C" {
 PG_REGISTER(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 0);
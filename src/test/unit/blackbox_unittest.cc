@@ -16,11 +16,17 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
 
 extern "C" {
     #include "platform.h"
 
     #include "blackbox/blackbox.h"
+    #include "build/debug.h"
+    #include "common/maths.h"
     #include "common/utils.h"
 
     #include "config/parameter_group.h"
@@ -32,20 +38,29 @@ extern "C" {
 
     #include "flight/failsafe.h"
     #include "flight/mixer.h"
+    #include "flight/pid.h"
+    #include "flight/servos.h"
 
     #include "fc/rc_controls.h"
     #include "fc/rc_modes.h"
+    #include "fc/runtime_config.h"
 
     #include "io/gps.h"
     #include "io/serial.h"
 
     #include "rx/rx.h"
 
+    #include "sensors/acceleration.h"
+    #include "sensors/barometer.h"
     #include "sensors/battery.h"
+    #include "sensors/compass.h"
     #include "sensors/gyro.h"
 
+    #include "blackbox_decoder.h"
+
     extern int16_t blackboxIInterval;
     extern int16_t blackboxPInterval;
+    extern uint32_t rcModeActivationMask;
 }
 
 #include "unittest_macros.h"
@@ -53,6 +68,17 @@ extern "C" {
 
 gyroDev_t gyroDev;
 
+#define LOG_BUFFER_SIZE (256 * 1024)
+static uint8_t logBuffer[LOG_BUFFER_SIZE];
+static int logLength;
+static serialPort_t testSerialPort;
+// the tx buffer of the serial port, none unless a test sets its size
+static int testTxBufferSize;
+static int testTxBuffered;
+static uint32_t testMillis;
+static uint16_t testVbat;
+static int32_t testAmperage;
+
 TEST(BlackboxTest, TestInitIntervals)
 {
     blackboxConfigMutable()->p_denom = 32;
@@ -343,6 +369,453 @@ TEST(BlackboxTest, Test_CalculateRates)
     EXPECT_EQ(1, blackboxGetRateDenom());
 }
 
+#define FLIGHT_ITERATIONS 5000
+#define FLIGHT_START_US 1000000
+#define FLIGHT_MODE_ITERATIONS 700          // the flight mode flags change this often
+#define STALL_START_ITERATION 1350          // in deferred mode the encoder doesn't run from here...
+#define STALL_END_ITERATION 1450            // ...to here, across a flight mode change
+#define SYNC_BEEP_ITERATION 1360            // an event logged while frames are queued
+
+// A deterministic flight: slow stick and attitude movements with sensor noise on top
+static int32_t flightValue(int iteration, int channel, int amplitude)
+{
+    const uint32_t hash = (uint32_t)iteration * 2654435761U + (uint32_t)channel * 40503U;
+    const int noise = (int)((hash >> 28) & 0x0f) - 8;
+    return lrintf(amplitude * sinf(iteration * 0.002f + channel) * sinf(iteration * 0.0003f + 1)) + noise;
+}
+
+static timeUs_t flightTimeUs(int iteration)
+{
+    // 1kHz with a little jitter, so the straight line time prediction is not always exact
+    return FLIGHT_START_US + iteration * 1000 + (iteration % 3);
+}
+
+static void loadFlightState(int iteration)
+{
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        axisPID_P[axis] = flightValue(iteration, axis, 200);
+        axisPID_I[axis] = flightValue(iteration, 3 + axis, 50);
+        axisPID_D[axis] = flightValue(iteration, 6 + axis, 300);
+        gyro.gyroADCf[axis] = flightValue(iteration, 9 + axis, 800);
+        acc.accSmooth[axis] = 2048 * (axis == Z) + flightValue(iteration, 12 + axis, 100);
+        mag.magADC[axis] = flightValue(iteration, 15 + axis, 20);
+    }
+    for (int i = 0; i < 3; i++) {
+        rcCommand[i] = flightValue(iteration, 18 + i, 500) / 4;
+    }
+    rcCommand[THROTTLE] = 1300 + flightValue(iteration, 21, 300) / 8;
+    for (int i = 0; i < DEBUG16_VALUE_COUNT; i++) {
+        debug[i] = flightValue(iteration, 22 + i, 1000);
+    }
+    for (int i = 0; i < 4; i++) {
+        motor[i] = 1400 + flightValue(iteration, 26 + i, 400);
+    }
+    testVbat = 168 - iteration / 1000;
+    testAmperage = 1500 + flightValue(iteration, 30, 500);
+    baro.BaroAlt = 100 + flightValue(iteration, 31, 50);
+    rssi = 900 + flightValue(iteration, 32, 50);
+    rcModeActivationMask = (iteration / FLIGHT_MODE_ITERATIONS) & 0x03;
+}
+
+/*
+ * Logs a flight to a serial port, decodes the captured log and checks every field of every main frame against the
+ * flight state it was taken from. The log size and the encode and decode times are printed so encoder changes can be
+ * compared.
+ *
+ * In deferred mode the encoder is stalled for a while, so the snapshot ring overflows and frames are dropped.
+ */
+static void testEncodeDecodeRoundTrip(blackboxEncoding_e encoding, bool deferred, const char *name)
+{
+    gyro.targetLooptime = 1000;
+    targetPidLooptime = 1000;
+    blackboxConfigMutable()->p_denom = 32;
+    blackboxConfigMutable()->device = BLACKBOX_DEVICE_SERIAL;
+    blackboxConfigMutable()->record_acc = 1;
+    blackboxConfigMutable()->encoding = encoding;
+    blackboxConfigMutable()->mode = BLACKBOX_MODE_NORMAL;
+    blackboxConfigMutable()->deferred = deferred;
+    motorConfigMutable()->minthrottle = 1070;
+    batteryConfigMutable()->voltageMeterSource = VOLTAGE_METER_ADC;
+    batteryConfigMutable()->currentMeterSource = CURRENT_METER_ADC;
+    rxConfigMutable()->rssi_channel = 8;
+    debugMode = DEBUG_GYRO;
+    motorOutputLow = 1000;
+    motorOutputHigh = 2000;
+    logLength = 0;
+    testMillis = 0;
+
+    blackboxInit();
+    ENABLE_ARMING_FLAG(ARMED);
+
+    // the header goes out in chunks, one per update
+    int iteration = 0;
+    int firstFrameLength = 0;
+    while (firstFrameLength == 0 && iteration < 1000) {
+        const int previousLength = logLength;
+        testMillis += 10;
+        loadFlightState(iteration);
+        blackboxUpdate(flightTimeUs(iteration));
+        if (deferred) {
+            blackboxEncodeQueuedFrames(flightTimeUs(iteration));
+        }
+        if (logLength > previousLength && logBuffer[previousLength] == 'I') {
+            firstFrameLength = previousLength;
+        }
+        iteration++;
+    }
+    ASSERT_GT(firstFrameLength, 0);
+    const int headerLength = firstFrameLength;
+    const int firstLoggedIteration = iteration - 1;
+
+    const auto encodeStart = std::chrono::steady_clock::now();
+    for (; iteration < FLIGHT_ITERATIONS; iteration++) {
+        loadFlightState(iteration);
+        blackboxUpdate(flightTimeUs(iteration));
+        if (iteration == SYNC_BEEP_ITERATION) {
+            const int lengthBeforeEvent = logLength;
+            flightLogEvent_syncBeep_t syncBeep = { .time = flightTimeUs(iteration) };
+            blackboxLogEvent(FLIGHT_LOG_EVENT_SYNC_BEEP, (flightLogEventData_t *)&syncBeep);
+            if (deferred) {
+                // the PID loop only queues the event, the encoder writes it
+                EXPECT_EQ(lengthBeforeEvent, logLength);
+            }
+        }
+        if (deferred && (iteration < STALL_START_ITERATION || iteration >= STALL_END_ITERATION)) {
+            blackboxEncodeQueuedFrames(flightTimeUs(iteration));
+        }
+    }
+    const auto encodeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - encodeStart).count();
+    const int timedIterations = FLIGHT_ITERATIONS - firstLoggedIteration - 1;
+    const int loggedIterations = FLIGHT_ITERATIONS - firstLoggedIteration;
+    const int droppedFrames = blackboxGetDroppedFrames();
+
+    blackboxFinish();
+    DISABLE_ARMING_FLAG(ARMED);
+    ASSERT_LT(logLength, LOG_BUFFER_SIZE);
+
+    static blackboxDecoder_t decoder;
+    blackboxDecoderStream_t stream;
+    int32_t values[BLACKBOX_DECODER_MAX_FIELDS];
+    int valueCount;
+
+    // decode the log twice, once for the time alone and once checking every value
+    int decodedFrames = 0;
+    std::chrono::steady_clock::time_point decodeStart;
+    for (int pass = 0; pass < 2; pass++) {
+        blackboxDecoderInit(&decoder);
+        blackboxDecoderStreamInit(&stream, logBuffer, logLength);
+        EXPECT_LT(10, blackboxDecoderReadHeader(&decoder, &stream));
+        EXPECT_EQ(logBuffer + headerLength, stream.pos);
+
+        // no system information headers in the unit test build, so give the decoder the values the encoder used
+        EXPECT_TRUE(blackboxDecoderParseHeaderLine(&decoder, "minthrottle:1070"));
+        EXPECT_TRUE(blackboxDecoderParseHeaderLine(&decoder, "motorOutput:1000,2000"));
+        EXPECT_TRUE(blackboxDecoderParseHeaderLine(&decoder, "vbatref:168"));
+
+        if (pass == 0) {
+            decodeStart = std::chrono::steady_clock::now();
+            while (blackboxDecoderReadFrame(&decoder, &stream, values, &valueCount) != 0) {
+                decodedFrames++;
+            }
+        }
+    }
+    const auto decodeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decodeStart).count();
+
+    const blackboxDecoderFrameDef_t *frameDef = &decoder.frameDef[BLACKBOX_DECODER_FRAME_I];
+    const int timeIndex = blackboxDecoderFieldIndex(frameDef, "time");
+    const int iterationIndex = blackboxDecoderFieldIndex(frameDef, "loopIteration");
+    ASSERT_EQ(0, iterationIndex);
+    ASSERT_EQ(1, timeIndex);
+    EXPECT_EQ(3, blackboxDecoderFieldIndex(frameDef, "axisP[1]"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "axisD[2]"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "vbatLatest"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "amperageLatest"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "magADC[0]"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "BaroAlt"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "rssi"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "accSmooth[2]"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "debug[3]"));
+    ASSERT_LE(0, blackboxDecoderFieldIndex(frameDef, "motor[3]"));
+    EXPECT_EQ(-1, blackboxDecoderFieldIndex(frameDef, "servo[5]"));
+
+    const blackboxDecoderFrameDef_t *interframeDef = &decoder.frameDef[BLACKBOX_DECODER_FRAME_P];
+    const int gyroIndex = blackboxDecoderFieldIndex(frameDef, "gyroADC[0]");
+    EXPECT_EQ(FLIGHT_LOG_FIELD_ENCODING_NULL, interframeDef->encoding[iterationIndex]);
+    if (encoding == BLACKBOX_ENCODING_VB) {
+        EXPECT_EQ(FLIGHT_LOG_FIELD_ENCODING_SIGNED_VB, interframeDef->encoding[gyroIndex]);
+    } else {
+        EXPECT_EQ(FLIGHT_LOG_FIELD_ENCODING_ADAPTIVE_RICE, interframeDef->encoding[gyroIndex]);
+    }
+    if (encoding == BLACKBOX_ENCODING_RICE_LINEAR) {
+        EXPECT_EQ(FLIGHT_LOG_FIELD_PREDICTOR_STRAIGHT_LINE, interframeDef->predictor[gyroIndex]);
+    } else {
+        EXPECT_EQ(FLIGHT_LOG_FIELD_PREDICTOR_AVERAGE_2, interframeDef->predictor[gyroIndex]);
+    }
+
+    const int flightModeIndex = blackboxDecoderFieldIndex(&decoder.frameDef[BLACKBOX_DECODER_FRAME_S], "flightModeFlags");
+    ASSERT_LE(0, flightModeIndex);
+
+    int frameCount[BLACKBOX_DECODER_FRAME_COUNT] = { 0 };
+    int mainFrameBytes = 0;
+    int previousFrameIteration = -1;
+    int syncBeepCount = 0;
+    int gapCount = 0;
+    // flight mode flags of an S frame or event, they must match the main frame that follows
+    int32_t pendingFlightModeFlags = -1;
+    bool logEnded = false;
+    char frameChar;
+
+    const uint8_t *frameStart = stream.pos;
+    while ((frameChar = blackboxDecoderReadFrame(&decoder, &stream, values, &valueCount)) != 0) {
+        if (frameChar == 'E') {
+            logEnded = values[0] == FLIGHT_LOG_EVENT_LOG_END;
+            if (values[0] == FLIGHT_LOG_EVENT_SYNC_BEEP) {
+                // written after the frame of its iteration and before the next one, whatever was queued
+                EXPECT_EQ(flightTimeUs(SYNC_BEEP_ITERATION), (timeUs_t)values[1]);
+                EXPECT_EQ(SYNC_BEEP_ITERATION, previousFrameIteration);
+                syncBeepCount++;
+            } else if (values[0] == FLIGHT_LOG_EVENT_FLIGHTMODE) {
+                pendingFlightModeFlags = values[1];
+            }
+            frameStart = stream.pos;
+            continue;
+        }
+        if (frameChar == 'I' || frameChar == 'P') {
+            mainFrameBytes += stream.pos - frameStart;
+            ++frameCount[frameChar == 'I' ? BLACKBOX_DECODER_FRAME_I : BLACKBOX_DECODER_FRAME_P];
+
+            // the iterations the frame was logged in, as counted by the test and by the log
+            const int flightIteration = (values[timeIndex] - FLIGHT_START_US) / 1000;
+            ASSERT_EQ(flightTimeUs(flightIteration), (timeUs_t)values[timeIndex]);
+            ASSERT_EQ(flightIteration - firstLoggedIteration, values[iterationIndex]);
+
+            if (previousFrameIteration >= 0 && flightIteration != previousFrameIteration + 1) {
+                // the P frame chain was broken by dropped frames, it restarts with an I frame
+                EXPECT_EQ('I', frameChar) << "first frame after the gap, iteration " << flightIteration;
+                gapCount++;
+            }
+            previousFrameIteration = flightIteration;
+
+            loadFlightState(flightIteration);
+            if (pendingFlightModeFlags >= 0) {
+                EXPECT_EQ((int32_t)rcModeActivationMask, pendingFlightModeFlags) << "iteration " << flightIteration;
+                pendingFlightModeFlags = -1;
+            }
+            const struct {
+                const char *name;
+                int32_t value;
+            } expected[] = {
+                { "axisP[0]", (int32_t)axisPID_P[0] }, { "axisP[1]", (int32_t)axisPID_P[1] }, { "axisP[2]", (int32_t)axisPID_P[2] },
+                { "axisI[0]", (int32_t)axisPID_I[0] }, { "axisI[1]", (int32_t)axisPID_I[1] }, { "axisI[2]", (int32_t)axisPID_I[2] },
+                { "axisD[0]", (int32_t)axisPID_D[0] }, { "axisD[1]", (int32_t)axisPID_D[1] }, { "axisD[2]", (int32_t)axisPID_D[2] },
+                { "rcCommand[0]", (int32_t)rcCommand[0] }, { "rcCommand[1]", (int32_t)rcCommand[1] },
+                { "rcCommand[2]", (int32_t)rcCommand[2] }, { "rcCommand[3]", (int32_t)rcCommand[3] },
+                { "vbatLatest", testVbat }, { "amperageLatest", testAmperage },
+                { "magADC[0]", mag.magADC[0] }, { "magADC[1]", mag.magADC[1] }, { "magADC[2]", mag.magADC[2] },
+                { "BaroAlt", baro.BaroAlt }, { "rssi", rssi },
+                { "gyroADC[0]", (int32_t)lrintf(gyro.gyroADCf[0]) }, { "gyroADC[1]", (int32_t)lrintf(gyro.gyroADCf[1]) },
+                { "gyroADC[2]", (int32_t)lrintf(gyro.gyroADCf[2]) },
+                { "accSmooth[0]", acc.accSmooth[0] }, { "accSmooth[1]", acc.accSmooth[1] }, { "accSmooth[2]", acc.accSmooth[2] },
+                { "debug[0]", debug[0] }, { "debug[1]", debug[1] }, { "debug[2]", debug[2] }, { "debug[3]", debug[3] },
+                { "motor[0]", (int32_t)motor[0] }, { "motor[1]", (int32_t)motor[1] },
+                { "motor[2]", (int32_t)motor[2] }, { "motor[3]", (int32_t)motor[3] },
+            };
+            for (unsigned i = 0; i < ARRAYLEN(expected); i++) {
+                const int index = blackboxDecoderFieldIndex(frameDef, expected[i].name);
+                ASSERT_EQ(expected[i].value, values[index]) << frameChar << " frame of iteration " << flightIteration << " " << expected[i].name;
+            }
+        } else if (frameChar == 'S') {
+            ++frameCount[BLACKBOX_DECODER_FRAME_S];
+            pendingFlightModeFlags = values[flightModeIndex];
+        }
+        frameStart = stream.pos;
+    }
+
+    EXPECT_FALSE(stream.error);
+    EXPECT_EQ(logBuffer + logLength, stream.pos);
+    EXPECT_TRUE(logEnded);
+    EXPECT_EQ(1, syncBeepCount);
+    // every iteration is either logged or counted as dropped
+    EXPECT_EQ(loggedIterations, frameCount[BLACKBOX_DECODER_FRAME_I] + frameCount[BLACKBOX_DECODER_FRAME_P] + droppedFrames);
+    if (deferred) {
+        // the ring fills up while the encoder is stalled and the rest of the stall is dropped
+        EXPECT_LT(0, droppedFrames);
+        EXPECT_GT(STALL_END_ITERATION - STALL_START_ITERATION, droppedFrames);
+        EXPECT_EQ(1, gapCount);
+    } else {
+        // an I frame every 32 iterations and a P frame in all the others
+        EXPECT_EQ(0, droppedFrames);
+        EXPECT_EQ(0, gapCount);
+        EXPECT_EQ((loggedIterations + 31) / 32, frameCount[BLACKBOX_DECODER_FRAME_I]);
+    }
+    EXPECT_LE(FLIGHT_ITERATIONS / FLIGHT_MODE_ITERATIONS, frameCount[BLACKBOX_DECODER_FRAME_S]);
+
+    const int mainFrames = frameCount[BLACKBOX_DECODER_FRAME_I] + frameCount[BLACKBOX_DECODER_FRAME_P];
+    printf("[ BENCH    ] %s: header %d bytes, %d main frames: %.2f bytes/frame, encode %.1f ns/frame, decode %.1f ns/frame\n",
+        name, headerLength, mainFrames, (double)mainFrameBytes / mainFrames,
+        (double)encodeNs / timedIterations, (double)decodeNs / decodedFrames);
+}
+
+TEST(BlackboxTest, TestEncodeDecodeRoundTrip)
+{
+    testEncodeDecodeRoundTrip(BLACKBOX_ENCODING_VB, false, "VB");
+}
+
+TEST(BlackboxTest, TestEncodeDecodeRoundTripRice)
+{
+    testEncodeDecodeRoundTrip(BLACKBOX_ENCODING_RICE, false, "RICE");
+    testEncodeDecodeRoundTrip(BLACKBOX_ENCODING_RICE_LINEAR, false, "RICE_LINEAR");
+}
+
+TEST(BlackboxTest, TestEncodeDecodeRoundTripDeferred)
+{
+    testEncodeDecodeRoundTrip(BLACKBOX_ENCODING_VB, true, "VB deferred");
+    blackboxConfigMutable()->deferred = 0;
+}
+
+#define GYRO_RAW_LOOPTIME_US    125
+#define GYRO_RAW_ITERATIONS     2000
+#define GYRO_RAW_DROP_ITERATION 1000
+#define GYRO_RAW_TX_BYTES_PER_ITERATION 100     // 1Mbaud drains 100 bytes per 1kHz PID loop
+
+static void gyroRawTestSample(uint32_t sampleIndex, int16_t *adcRaw)
+{
+    adcRaw[0] = (int16_t)(sampleIndex * 37);
+    adcRaw[1] = (int16_t)(5 - sampleIndex * 11);
+    adcRaw[2] = (int16_t)(sampleIndex ^ 0x5a5a);
+}
+
+static uint32_t gyroRawFeedSamples(uint32_t sampleIndex, int count)
+{
+    for (int i = 0; i < count; i++, sampleIndex++) {
+        int16_t adcRaw[3];
+        gyroRawTestSample(sampleIndex, adcRaw);
+        blackboxGyroRawSample(adcRaw, sampleIndex * GYRO_RAW_LOOPTIME_US);
+    }
+    return sampleIndex;
+}
+
+/*
+ * Captures the raw gyro samples to a serial port with the given tx buffer, 0 for a port without one such as the USB VCP.
+ * The blocks are sized to fit the buffer, blockSamples is the number of samples expected in them.
+ */
+static void testGyroRawCapture(int txBufferSize, int blockSamples)
+{
+    testTxBufferSize = txBufferSize;
+    testTxBuffered = 0;
+    testSerialPort.txBufferSize = txBufferSize;
+    gyro.targetLooptime = GYRO_RAW_LOOPTIME_US;
+    targetPidLooptime = 1000;
+    blackboxConfigMutable()->p_denom = 32;
+    blackboxConfigMutable()->device = BLACKBOX_DEVICE_SERIAL;
+    blackboxConfigMutable()->mode = BLACKBOX_MODE_GYRO_RAW;
+    logLength = 0;
+    testMillis = 0;
+
+    blackboxInit();
+    ENABLE_ARMING_FLAG(ARMED);
+
+    // 8 gyro samples per PID loop, the samples before the log is running are ignored
+    const int samplesPerIteration = targetPidLooptime / GYRO_RAW_LOOPTIME_US;
+    uint32_t sampleIndex = 0;
+    for (int iteration = 0; iteration < GYRO_RAW_ITERATIONS; iteration++) {
+        testMillis += 10;
+        if (iteration == GYRO_RAW_DROP_ITERATION) {
+            // the logger misses its turn, the gyro fills both blocks and loses what doesn't fit
+            sampleIndex = gyroRawFeedSamples(sampleIndex, 3 * blockSamples);
+        }
+        sampleIndex = gyroRawFeedSamples(sampleIndex, samplesPerIteration);
+        testTxBuffered = MAX(testTxBuffered - GYRO_RAW_TX_BYTES_PER_ITERATION, 0);
+        blackboxUpdate(sampleIndex * GYRO_RAW_LOOPTIME_US);
+    }
+    // the last block is written short
+    sampleIndex = gyroRawFeedSamples(sampleIndex, 5);
+    blackboxFinish();
+    DISABLE_ARMING_FLAG(ARMED);
+    ASSERT_LT(logLength, LOG_BUFFER_SIZE);
+
+    static blackboxDecoder_t decoder;
+    blackboxDecoderStream_t stream;
+    int32_t values[BLACKBOX_DECODER_MAX_FIELDS];
+    int valueCount;
+
+    blackboxDecoderInit(&decoder);
+    blackboxDecoderStreamInit(&stream, logBuffer, logLength);
+    EXPECT_LT(10, blackboxDecoderReadHeader(&decoder, &stream));
+    char gyroRawHeader[64];
+    snprintf(gyroRawHeader, sizeof(gyroRawHeader), "gyro_raw:%d,125,0x3d7a0000", blockSamples);
+    EXPECT_TRUE(blackboxDecoderParseHeaderLine(&decoder, gyroRawHeader));
+    EXPECT_EQ(blockSamples, decoder.gyroRawBlockSamples);
+    EXPECT_EQ(GYRO_RAW_LOOPTIME_US, decoder.gyroRawLooptime);
+
+    int blockCount = 0;
+    int shortBlockCount = 0;
+    uint32_t decodedSamples = 0;
+    uint32_t droppedSamples = 0;
+    uint32_t expectedIndex = 0;
+    bool logEnded = false;
+    char frameChar;
+    while ((frameChar = blackboxDecoderReadFrame(&decoder, &stream, values, &valueCount)) != 0) {
+        if (frameChar == 'E') {
+            logEnded = values[0] == FLIGHT_LOG_EVENT_LOG_END;
+            continue;
+        }
+        // nothing but the raw samples in this mode
+        ASSERT_EQ('R', frameChar);
+        ASSERT_EQ(3, valueCount);
+
+        const uint32_t firstIndex = values[0] / GYRO_RAW_LOOPTIME_US;
+        if (blockCount == 0) {
+            EXPECT_EQ(0, values[1]);
+        } else {
+            // the samples follow on from the previous block, less the ones that were dropped
+            ASSERT_EQ(expectedIndex + values[1], firstIndex) << "block " << blockCount;
+        }
+        ASSERT_GE(blockSamples, values[2]);
+        for (int i = 0; i < values[2]; i++) {
+            int16_t expected[3];
+            gyroRawTestSample(firstIndex + i, expected);
+            for (int axis = 0; axis < 3; axis++) {
+                ASSERT_EQ(expected[axis], decoder.gyroRaw[i][axis]) << "sample " << firstIndex + i << " axis " << axis;
+            }
+        }
+        shortBlockCount += values[2] < blockSamples;
+        decodedSamples += values[2];
+        droppedSamples += values[1];
+        expectedIndex = firstIndex + values[2];
+        blockCount++;
+    }
+
+    EXPECT_FALSE(stream.error);
+    EXPECT_EQ(logBuffer + logLength, stream.pos);
+    EXPECT_TRUE(logEnded);
+    EXPECT_GE(1, shortBlockCount);
+    // every sample from the first one logged on is either in the log or counted as dropped
+    EXPECT_EQ(sampleIndex, expectedIndex);
+    EXPECT_LT((uint32_t)(GYRO_RAW_ITERATIONS - 100) * samplesPerIteration, decodedSamples);
+    // the block being filled when the logger stalled had some room left, and the samples of the next iteration come
+    // in before the logger gets to the blocks
+    EXPECT_EQ(blackboxGetGyroRawDroppedSamples(), droppedSamples);
+    EXPECT_LE((uint32_t)(blockSamples + samplesPerIteration), droppedSamples);
+    EXPECT_GT((uint32_t)(2 * blockSamples + samplesPerIteration), droppedSamples);
+
+    blackboxConfigMutable()->mode = BLACKBOX_MODE_NORMAL;
+    testTxBufferSize = 0;
+    testSerialPort.txBufferSize = 0;
+}
+
+TEST(BlackboxTest, TestGyroRawCapture)
+{
+    testGyroRawCapture(0, BLACKBOX_GYRO_RAW_BLOCK_SAMPLES);
+}
+
+TEST(BlackboxTest, TestGyroRawCaptureSmallBuffers)
+{
+    // UART_TX_BUFFER_SIZE, the blocks take half of the 255 usable bytes
+    testGyroRawCapture(256, 19);
+    // the size of FLASHFS_WRITE_BUFFER_SIZE
+    testGyroRawCapture(128, 9);
+}
 
 // STUBS
 extern "C" {
@@ -367,29 +840,58 @@ gyro_t gyro;
 
 float motorOutputHigh, motorOutputLow;
 float motor_disarmed[MAX_SUPPORTED_MOTORS];
-struct pidProfile_s;
-struct pidProfile_s *currentPidProfile;
+float motor[MAX_SUPPORTED_MOTORS];
+int16_t servo[MAX_SUPPORTED_SERVOS];
+float axisPID_P[3], axisPID_I[3], axisPID_D[3];
+float rcCommand[4];
+int16_t debug[DEBUG16_VALUE_COUNT];
+acc_t acc;
+mag_t mag;
+baro_t baro;
+uint16_t rssi;
+static pidProfile_t testPidProfile = { .pid = { { 40, 40, 30 }, { 58, 50, 35 }, { 70, 45, 20 } } };
+struct pidProfile_s *currentPidProfile = &testPidProfile;
 uint32_t targetPidLooptime;
 
 uint32_t rcModeActivationMask;
 
 void mspSerialAllocatePorts(void) {}
 uint32_t getArmingBeepTimeMicros(void) {return 0;}
-uint16_t getBatteryVoltageLatest(void) {return 0;}
+uint16_t getBatteryVoltageLatest(void) {return testVbat;}
+int32_t getAmperageLatest(void) {return testAmperage;}
 uint8_t getMotorCount(void) {return 4;}
 bool areMotorsRunning(void) { return false; }
 bool IS_RC_MODE_ACTIVE(boxId_e) {return false;}
 bool isModeActivationConditionPresent(boxId_e) {return false;}
-uint32_t millis(void) {return 0;}
-bool sensors(uint32_t) {return false;}
-void serialWrite(serialPort_t *, uint8_t) {}
-uint32_t serialTxBytesFree(const serialPort_t *) {return 0;}
-bool isSerialTransmitBufferEmpty(const serialPort_t *) {return false;}
+uint32_t millis(void) {return testMillis;}
+timeUs_t micros(void) {return testMillis * 1000;}
+bool sensors(uint32_t) {return true;}
+void serialWrite(serialPort_t *, uint8_t ch)
+{
+    if (logLength < LOG_BUFFER_SIZE) {
+        logBuffer[logLength] = ch;
+    }
+    logLength++;
+    if (testTxBufferSize) {
+        // a byte more than the free space overwrites the oldest one in the ring
+        EXPECT_GT(testTxBufferSize - 1, testTxBuffered);
+        testTxBuffered++;
+    }
+}
+void serialWriteBuf(serialPort_t *instance, const uint8_t *data, int count)
+{
+    while (count--) {
+        serialWrite(instance, *data++);
+    }
+}
+uint32_t serialTxBytesFree(const serialPort_t *) {return testTxBufferSize ? testTxBufferSize - 1 - testTxBuffered : 1024;}
+bool isSerialTransmitBufferEmpty(const serialPort_t *) {return true;}
 bool feature(uint32_t) {return false;}
 void mspSerialReleasePortIfAllocated(serialPort_t *) {}
-serialPortConfig_t *findSerialPortConfig(serialPortFunction_e ) {return NULL;}
+static serialPortConfig_t testPortConfig = { .functionMask = FUNCTION_BLACKBOX, .identifier = SERIAL_PORT_USART1, .blackbox_baudrateIndex = BAUD_1000000 };
+serialPortConfig_t *findSerialPortConfig(serialPortFunction_e ) {return &testPortConfig;}
 serialPort_t *findSharedSerialPort(uint16_t , serialPortFunction_e ) {return NULL;}
-serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, uint32_t, portMode_e, portOptions_e) {return NULL;}
+serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, uint32_t, portMode_e, portOptions_e) {return &testSerialPort;}
 void closeSerialPort(serialPort_t *) {}
 portSharing_e determinePortSharing(const serialPortConfig_t *, serialPortFunction_e ) {return PORTSHARING_UNUSED;}
 failsafePhase_e failsafePhase(void) {return FAILSAFE_IDLE;}
@@ -22,6 +22,8 @@
 
 #include <math.h>
 
+#include <chrono>
+
 extern "C" {
     #include "common/filter.h"
 }
@@ -198,3 +200,112 @@ TEST(FilterUnittest, TestSlewFilter)
     slewFilterApply(&filter, 200.0f);
     EXPECT_EQ(200, filter.state);
 }
+
+static float filterBankTestInput(int axis, int sample)
+{
+    // gyro like signal: a slow stick movement plus motor noise, with a different phase per axis
+    return 200.0f * sinf(0.01f * sample + axis) + 40.0f * sinf(0.9f * sample + 2 * axis) + 10.0f * axis;
+}
+
+TEST(FilterUnittest, TestFilterBankMatchesPerAxisFilters)
+{
+    const uint32_t looptime = 125;
+    biquadFilter_t notch1[3], notch2[3], lpf[3];
+    pt1Filter_t pt1[3] = {}; // pt1FilterInit() does not reset the state
+    for (int axis = 0; axis < 3; axis++) {
+        biquadFilterInit(&notch1[axis], 260, looptime, filterGetNotchQ(260, 160), FILTER_NOTCH);
+        biquadFilterInit(&notch2[axis], 400, looptime, filterGetNotchQ(400, 300), FILTER_NOTCH);
+        biquadFilterInitLPF(&lpf[axis], 100, looptime);
+        pt1FilterInit(&pt1[axis], 90, looptime * 0.000001f);
+    }
+
+    filterBank_t bank;
+    filterBankInit(&bank);
+    EXPECT_EQ(0, filterBankAddBiquad(&bank, 260, looptime, filterGetNotchQ(260, 160), FILTER_NOTCH));
+    EXPECT_EQ(1, filterBankAddBiquad(&bank, 400, looptime, filterGetNotchQ(400, 300), FILTER_NOTCH));
+    EXPECT_EQ(2, filterBankAddBiquad(&bank, 100, looptime, 1.0f / sqrtf(2.0f), FILTER_LPF));
+    EXPECT_EQ(3, filterBankAddPt1(&bank, 90, looptime * 0.000001f));
+    EXPECT_EQ(-1, filterBankAddPt1(&bank, 90, looptime * 0.000001f));
+    EXPECT_EQ(FILTER_BANK_MAX_STAGES, bank.stageCount);
+
+    for (int sample = 0; sample < 2000; sample++) {
+        float values[3];
+        float expected[3];
+        for (int axis = 0; axis < 3; axis++) {
+            values[axis] = filterBankTestInput(axis, sample);
+            expected[axis] = biquadFilterApply(&notch1[axis], values[axis]);
+            expected[axis] = biquadFilterApply(&notch2[axis], expected[axis]);
+            expected[axis] = biquadFilterApply(&lpf[axis], expected[axis]);
+            expected[axis] = pt1FilterApply(&pt1[axis], expected[axis]);
+        }
+        filterBankApply(&bank, values);
+        for (int axis = 0; axis < 3; axis++) {
+            EXPECT_NEAR(expected[axis], values[axis], 1e-3f);
+        }
+    }
+}
+
+TEST(FilterUnittest, TestFilterBankEmpty)
+{
+    filterBank_t bank;
+    filterBankInit(&bank);
+
+    float values[3] = {1.0f, -2.0f, 3.0f};
+    filterBankApply(&bank, values);
+    EXPECT_FLOAT_EQ(1.0f, values[0]);
+    EXPECT_FLOAT_EQ(-2.0f, values[1]);
+    EXPECT_FLOAT_EQ(3.0f, values[2]);
+}
+
+#define FILTER_BENCHMARK_SAMPLES 200000
+
+TEST(FilterUnittest, TestFilterBankBenchmark)
+{
+    // compares the gyro filter chain (two notches and a biquad LPF) applied per axis through
+    // function pointers, as gyroUpdateSensor() does, against a single filter bank call
+    const uint32_t looptime = 125;
+    filterApplyFnPtr applyFn = (filterApplyFnPtr)biquadFilterApply;
+    biquadFilter_t notch1[3], notch2[3], lpf[3];
+    filterBank_t bank;
+    filterBankInit(&bank);
+    for (int axis = 0; axis < 3; axis++) {
+        biquadFilterInit(&notch1[axis], 260, looptime, filterGetNotchQ(260, 160), FILTER_NOTCH);
+        biquadFilterInit(&notch2[axis], 400, looptime, filterGetNotchQ(400, 300), FILTER_NOTCH);
+        biquadFilterInitLPF(&lpf[axis], 100, looptime);
+    }
+    filterBankAddBiquad(&bank, 260, looptime, filterGetNotchQ(260, 160), FILTER_NOTCH);
+    filterBankAddBiquad(&bank, 400, looptime, filterGetNotchQ(400, 300), FILTER_NOTCH);
+    filterBankAddBiquad(&bank, 100, looptime, 1.0f / sqrtf(2.0f), FILTER_LPF);
+
+    static float input[FILTER_BENCHMARK_SAMPLES][3];
+    for (int sample = 0; sample < FILTER_BENCHMARK_SAMPLES; sample++) {
+        for (int axis = 0; axis < 3; axis++) {
+            input[sample][axis] = filterBankTestInput(axis, sample);
+        }
+    }
+
+    volatile float sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int sample = 0; sample < FILTER_BENCHMARK_SAMPLES; sample++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float value = applyFn(&notch1[axis], input[sample][axis]);
+            value = applyFn(&notch2[axis], value);
+            value = applyFn(&lpf[axis], value);
+            sink = value;
+        }
+    }
+    const double perAxisNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / FILTER_BENCHMARK_SAMPLES;
+
+    start = std::chrono::steady_clock::now();
+    for (int sample = 0; sample < FILTER_BENCHMARK_SAMPLES; sample++) {
+        float values[3] = { input[sample][0], input[sample][1], input[sample][2] };
+        filterBankApply(&bank, values);
+        sink = values[2];
+    }
+    const double bankNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / FILTER_BENCHMARK_SAMPLES;
+    (void)sink;
+
+    printf("gyro filter chain, 3 stages x 3 axes: per axis %6.1f ns/sample, filter bank %6.1f ns/sample\n", perAxisNs, bankNs);
+    EXPECT_GT(perAxisNs, 0);
+    EXPECT_GT(bankNs, 0);
+}
@@ -0,0 +1,382 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/debug.h"
+
+    #include "common/axis.h"
+    #include "common/filter.h"
+    #include "common/maths.h"
+    #include "common/sdft.h"
+    #include "common/utils.h"
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "drivers/accgyro/accgyro.h"
+
+    #include "sensors/gyro.h"
+    #include "sensors/gyroanalyse.h"
+
+    PG_REGISTER(gyroConfig_t, gyroConfig, PG_GYRO_CONFIG, 0);
+
+    int gyroDataAnalyseFindPeaks(const float *binData, int firstBin, float *peakVal, float *peakIndex);
+    void gyroDataAnalyseAssignPeaks(int axis, const float *peakFreq, int peakCount);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define ANALYSE_RATE            1000
+#define WINDOW                  SDFT_SAMPLE_SIZE
+#define BIN_COUNT               SDFT_BIN_COUNT
+#define RESOLUTION              ((float)ANALYSE_RATE / WINDOW)
+#define SDFT_ANALYSE_RATE       2000
+
+static float directDftWindowedSquaredMagnitude(const float *history, int bin)
+{
+    // history[0] is the newest sample, Hann window over the sample lag
+    float re = 0;
+    float im = 0;
+    for (int m = 0; m < WINDOW; m++) {
+        const float w = 0.5f - 0.5f * cosf(2 * M_PIf * m / WINDOW);
+        re += w * history[m] * cosf(2 * M_PIf * bin * m / WINDOW);
+        im += w * history[m] * sinf(2 * M_PIf * bin * m / WINDOW);
+    }
+    return re * re + im * im;
+}
+
+TEST(SdftUnittest, TestSdftMatchesWindowedDft)
+{
+    sdft_t sdft;
+    sdftInit(&sdft, 1, BIN_COUNT - 1);
+    EXPECT_EQ(1, sdft.startBin);
+    EXPECT_EQ(BIN_COUNT - 1, sdft.endBin);
+
+    float history[WINDOW] = {};
+    srand(1);
+    for (int sample = 0; sample < 500; sample++) {
+        const float value = 100.0f * sinf(0.7f * sample) + (rand() % 200 - 100);
+        memmove(&history[1], &history[0], sizeof(float) * (WINDOW - 1));
+        history[0] = value;
+        sdftPush(&sdft, value);
+    }
+
+    float output[BIN_COUNT];
+    sdftWindowedSquaredMagnitude(&sdft, output);
+    for (int bin = 1; bin < BIN_COUNT; bin++) {
+        const float expected = directDftWindowedSquaredMagnitude(history, bin);
+        // the damping factor makes the sliding DFT slightly lossy
+        EXPECT_NEAR(expected, output[bin - 1], 0.02f * expected + 1.0f);
+    }
+}
+
+TEST(SdftUnittest, TestSdftPeakBin)
+{
+    sdft_t sdft;
+    sdftInit(&sdft, 0, BIN_COUNT);
+    // clamped so that the Hann window has a neighbour bin either side
+    EXPECT_EQ(1, sdft.startBin);
+    EXPECT_EQ(BIN_COUNT - 1, sdft.endBin);
+
+    for (int sample = 0; sample < 100; sample++) {
+        sdftPush(&sdft, sinf(2 * M_PIf * 250 * sample / ANALYSE_RATE));
+    }
+    float output[BIN_COUNT];
+    sdftWindowedSquaredMagnitude(&sdft, output);
+    int peakBin = 0;
+    for (int bin = sdft.startBin; bin <= sdft.endBin; bin++) {
+        if (output[bin - sdft.startBin] > output[peakBin - sdft.startBin] || peakBin == 0) {
+            peakBin = bin;
+        }
+    }
+    EXPECT_EQ(250 / RESOLUTION, peakBin);
+}
+
+static void initPeakAnalyser(int notchCount)
+{
+    gyroConfigMutable()->dyn_notch_analyser = DYN_NOTCH_ANALYSER_FFT;
+    gyroConfigMutable()->dyn_notch_count = notchCount;
+    gyroDataAnalyseInit(125);
+}
+
+TEST(GyroAnalyseUnittest, TestFindPeaksInterpolation)
+{
+    initPeakAnalyser(DYN_NOTCH_COUNT_MAX);
+
+    // samples of a parabola with its vertex between bins 8 and 9
+    float binData[GYRO_FFT_BIN_COUNT] = {};
+    for (int bin = 7; bin <= 9; bin++) {
+        binData[bin] = 10 - (bin - 8.3f) * (bin - 8.3f);
+    }
+    float peakVal[DYN_NOTCH_COUNT_MAX];
+    float peakIndex[DYN_NOTCH_COUNT_MAX];
+    EXPECT_EQ(1, gyroDataAnalyseFindPeaks(binData, 0, peakVal, peakIndex));
+    EXPECT_FLOAT_EQ(binData[8], peakVal[0]);
+    EXPECT_NEAR(8.3f, peakIndex[0], 1e-4f);
+
+    // no interpolation on the last bin, there is no neighbour to the right
+    memset(binData, 0, sizeof(binData));
+    binData[GYRO_FFT_BIN_COUNT - 2] = 1;
+    binData[GYRO_FFT_BIN_COUNT - 1] = 2;
+    EXPECT_EQ(1, gyroDataAnalyseFindPeaks(binData, 0, peakVal, peakIndex));
+    EXPECT_FLOAT_EQ(GYRO_FFT_BIN_COUNT - 1, peakIndex[0]);
+
+    // with the spectrum starting at firstBin
+    memset(binData, 0, sizeof(binData));
+    binData[4 - 3] = 1;
+    binData[5 - 3] = 3;
+    binData[6 - 3] = 1;
+    EXPECT_EQ(1, gyroDataAnalyseFindPeaks(binData, 3, peakVal, peakIndex));
+    EXPECT_FLOAT_EQ(5, peakIndex[0]);
+}
+
+TEST(GyroAnalyseUnittest, TestFindPeaksOrderAndThreshold)
+{
+    initPeakAnalyser(DYN_NOTCH_COUNT_MAX);
+
+    float binData[GYRO_FFT_BIN_COUNT] = {};
+    binData[1] = 100;   // below FFT_MIN_FREQ, not a peak
+    binData[4] = 12;
+    binData[6] = 20;
+    binData[9] = 50;
+    binData[12] = 11;
+    binData[14] = 30;
+    float peakVal[DYN_NOTCH_COUNT_MAX];
+    float peakIndex[DYN_NOTCH_COUNT_MAX];
+    // the largest three, largest first
+    EXPECT_EQ(3, gyroDataAnalyseFindPeaks(binData, 0, peakVal, peakIndex));
+    EXPECT_FLOAT_EQ(50, peakVal[0]);
+    EXPECT_FLOAT_EQ(30, peakVal[1]);
+    EXPECT_FLOAT_EQ(20, peakVal[2]);
+    EXPECT_FLOAT_EQ(9, peakIndex[0]);
+    EXPECT_FLOAT_EQ(14, peakIndex[1]);
+    EXPECT_FLOAT_EQ(6, peakIndex[2]);
+
+    // peaks under 20% of the largest one are dropped
+    binData[9] = 120;
+    EXPECT_EQ(2, gyroDataAnalyseFindPeaks(binData, 0, peakVal, peakIndex));
+    EXPECT_FLOAT_EQ(9, peakIndex[0]);
+    EXPECT_FLOAT_EQ(14, peakIndex[1]);
+    binData[9] = 200;
+    EXPECT_EQ(1, gyroDataAnalyseFindPeaks(binData, 0, peakVal, peakIndex));
+
+    // a flat spectrum has no peaks
+    memset(binData, 0, sizeof(binData));
+    EXPECT_EQ(0, gyroDataAnalyseFindPeaks(binData, 0, peakVal, peakIndex));
+}
+
+static void assignPeaksUntilSettled(const float *peakFreq, int peakCount)
+{
+    // long enough for the frequency smoothing filters to settle
+    for (int i = 0; i < 200; i++) {
+        gyroDataAnalyseAssignPeaks(FD_ROLL, peakFreq, peakCount);
+    }
+}
+
+static int notchAt(uint16_t freq)
+{
+    for (int i = 0; i < DYN_NOTCH_COUNT_MAX; i++) {
+        if (gyroFftData(FD_ROLL)->centerFreq[i] == freq) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+TEST(GyroAnalyseUnittest, TestPeaksFollowNearestNotch)
+{
+    initPeakAnalyser(DYN_NOTCH_COUNT_MAX);
+    const uint16_t *centerFreq = gyroFftData(FD_ROLL)->centerFreq;
+
+    const float threePeaks[] = { 160, 250, 400 };
+    assignPeaksUntilSettled(threePeaks, 3);
+    const int notch160 = notchAt(160);
+    const int notch250 = notchAt(250);
+    const int notch400 = notchAt(400);
+    ASSERT_GE(notch160, 0);
+    ASSERT_GE(notch250, 0);
+    ASSERT_GE(notch400, 0);
+
+    // the peaks changing places in size doesn't move the notches
+    const float swappedPeaks[] = { 400, 160, 250 };
+    gyroDataAnalyseAssignPeaks(FD_ROLL, swappedPeaks, 3);
+    EXPECT_EQ(160, centerFreq[notch160]);
+    EXPECT_EQ(250, centerFreq[notch250]);
+    EXPECT_EQ(400, centerFreq[notch400]);
+
+    // when peaks disappear the notches without a peak stay where they are
+    const float onePeak[] = { 400 };
+    assignPeaksUntilSettled(onePeak, 1);
+    EXPECT_EQ(160, centerFreq[notch160]);
+    EXPECT_EQ(250, centerFreq[notch250]);
+    EXPECT_EQ(400, centerFreq[notch400]);
+
+    // a new peak takes the nearest free notch, even when it is larger than the peak next to it
+    const float newPeak[] = { 330, 400 };
+    assignPeaksUntilSettled(newPeak, 2);
+    EXPECT_EQ(160, centerFreq[notch160]);
+    EXPECT_EQ(330, centerFreq[notch250]);
+    EXPECT_EQ(400, centerFreq[notch400]);
+}
+
+typedef struct analyser_s {
+    int gyroRate;
+    gyroDev_t gyroDev;
+    biquadFilter_t notch[XYZ_AXIS_COUNT][DYN_NOTCH_COUNT_MAX];
+    int axisUpdateCount[XYZ_AXIS_COUNT];
+} analyser_t;
+
+static void analyserInit(analyser_t *analyser, dynNotchAnalyser_e type, int gyroRate)
+{
+    memset(analyser, 0, sizeof(*analyser));
+    analyser->gyroRate = gyroRate;
+    gyroConfigMutable()->dyn_notch_analyser = type;
+    gyroConfigMutable()->dyn_notch_count = 1;
+    gyro.targetLooptime = 1000000 / gyroRate;
+    gyroDataAnalyseInit(gyro.targetLooptime);
+}
+
+// one gyro cycle of the real analyser, an axis counts as updated when gyroDataAnalyse() retuned its notch
+static void analyserGyroCycle(analyser_t *analyser, const float *gyroSample)
+{
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        analyser->gyroDev.gyroADC[axis] = lrintf(gyroSample[axis]);
+        analyser->notch[axis][0].b0 = 0;
+    }
+    gyroDataAnalyse(&analyser->gyroDev, analyser->notch);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        if (analyser->notch[axis][0].b0 != 0) {
+            analyser->axisUpdateCount[axis]++;
+        }
+    }
+}
+
+typedef struct chirpResult_s {
+    float meanLagMs;
+    float meanAbsErrorHz;
+    float nsPerGyroCycle;
+    float updateIntervalMs;
+} chirpResult_t;
+
+#define CHIRP_START_HZ      150.0f
+#define CHIRP_END_HZ        400.0f
+#define CHIRP_SECONDS       1.0f
+#define CHIRP_SETTLE_SECONDS 0.1f
+
+static chirpResult_t runChirp(dynNotchAnalyser_e type, int gyroRate)
+{
+    static analyser_t analyser;
+    analyserInit(&analyser, type, gyroRate);
+
+    const float chirpRate = (CHIRP_END_HZ - CHIRP_START_HZ) / CHIRP_SECONDS;
+    const int cycles = CHIRP_SECONDS * gyroRate;
+    float phase = 0;
+    double lagSum = 0;
+    double errorSum = 0;
+    int count = 0;
+    std::chrono::steady_clock::duration analyseTime = std::chrono::steady_clock::duration::zero();
+
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        const float t = (float)cycle / gyroRate;
+        const float freq = CHIRP_START_HZ + chirpRate * t;
+        phase += 2 * M_PIf * freq / gyroRate;
+        const float gyroSample[XYZ_AXIS_COUNT] = { 100 * sinf(phase), 80 * sinf(phase + 1), 60 * sinf(phase + 2) };
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        analyserGyroCycle(&analyser, gyroSample);
+        analyseTime += std::chrono::steady_clock::now() - start;
+
+        if (t >= CHIRP_SETTLE_SECONDS) {
+            // the estimate lags the true frequency by (true - estimate) / chirp rate
+            const float error = freq - gyroFftData(FD_ROLL)->centerFreq[0];
+            lagSum += error / chirpRate;
+            errorSum += fabsf(error);
+            count++;
+        }
+    }
+
+    chirpResult_t result;
+    result.meanLagMs = lagSum / count * 1000;
+    result.meanAbsErrorHz = errorSum / count;
+    result.nsPerGyroCycle = std::chrono::duration<double, std::nano>(analyseTime).count() / cycles;
+    result.updateIntervalMs = CHIRP_SECONDS * 1000 / analyser.axisUpdateCount[FD_ROLL];
+    return result;
+}
+
+TEST(SdftUnittest, TestChirpTracking)
+{
+    static const int gyroRates[] = { 8000, 4000, 2000, 1000 };
+
+    printf("chirp %.0f-%.0fHz over %.1fs, roll axis:\n", CHIRP_START_HZ, CHIRP_END_HZ, CHIRP_SECONDS);
+    for (unsigned i = 0; i < ARRAYLEN(gyroRates); i++) {
+        const chirpResult_t fftResult = runChirp(DYN_NOTCH_ANALYSER_FFT, gyroRates[i]);
+        const chirpResult_t sdftResult = runChirp(DYN_NOTCH_ANALYSER_SDFT, gyroRates[i]);
+
+        printf("  %4dHz gyro,  FFT: update every %4.1f ms, lag %5.1f ms, mean error %5.1f Hz, %6.1f ns/gyro cycle\n",
+            gyroRates[i], fftResult.updateIntervalMs, fftResult.meanLagMs, fftResult.meanAbsErrorHz, fftResult.nsPerGyroCycle);
+        printf("  %4dHz gyro, SDFT: update every %4.1f ms, lag %5.1f ms, mean error %5.1f Hz, %6.1f ns/gyro cycle\n",
+            gyroRates[i], sdftResult.updateIntervalMs, sdftResult.meanLagMs, sdftResult.meanAbsErrorHz, sdftResult.nsPerGyroCycle);
+
+        // the sliding DFT retunes each notch at least once per analysed sample at 8kHz
+        const int sdftAnalyseRate = std::min(gyroRates[i], SDFT_ANALYSE_RATE);
+        EXPECT_LE(sdftResult.updateIntervalMs, std::max(1000.0f / sdftAnalyseRate, 3000.0f / gyroRates[i]) + 0.01f);
+        EXPECT_LT(sdftResult.updateIntervalMs, fftResult.updateIntervalMs);
+        // the 32 sample window dominates the lag, the sliding DFT fills it twice as fast from 2kHz gyro up.
+        // At 1kHz the FFT path runs its 60Hz frequency smoothing filter at 83Hz and only the constrain keeps it bounded
+        EXPECT_LE(sdftResult.meanAbsErrorHz, fftResult.meanAbsErrorHz + 0.1f);
+        EXPECT_LT(sdftResult.meanLagMs, 0.65f * fftResult.meanLagMs);
+    }
+}
+
+// STUBS
+
+extern "C" {
+    int16_t debug[DEBUG16_VALUE_COUNT];
+    uint8_t debugMode;
+    gyro_t gyro;
+
+    uint32_t micros(void) { return 0; }
+    bool feature(uint32_t) { return true; }
+
+    // C version of arm_bitreversal2.S, which only builds for ARM
+    void arm_bitreversal_32(uint32_t *pSrc, const uint16_t bitRevLen, const uint16_t *pBitRevTable)
+    {
+        for (int i = 0; i < bitRevLen; i += 2) {
+            const uint32_t a = pBitRevTable[i] >> 2;
+            const uint32_t b = pBitRevTable[i + 1] >> 2;
+            uint32_t tmp = pSrc[a];
+            pSrc[a] = pSrc[b];
+            pSrc[b] = tmp;
+            tmp = pSrc[a + 1];
+            pSrc[a + 1] = pSrc[b + 1];
+            pSrc[b + 1] = tmp;
+        }
+    }
+}
@@ -0,0 +1,316 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/utils.h"
+
+    #include "config/config_eeprom.h"
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "drivers/system.h"
+
+    void initEEPROM(void);
+
+    typedef struct testProfile_s {
+        uint8_t pid[10][3];
+        int16_t rates[3][4];
+        uint8_t filler[240];
+    } testProfile_t;
+
+    typedef struct testSystemConfig_s {
+        uint8_t profileIndex;
+        uint16_t looptime;
+        uint8_t name[16];
+    } testSystemConfig_t;
+
+    typedef struct testSmallConfig_s {
+        uint32_t value;
+    } testSmallConfig_t;
+
+    PG_DECLARE_ARRAY(testProfile_t, 3, testProfiles);
+    PG_DECLARE(testSystemConfig_t, testSystemConfig);
+    PG_DECLARE(testSmallConfig_t, testSmallConfig);
+    PG_DECLARE(testSmallConfig_t, testOtherConfig);
+
+    // PGN 10 and 138 share a slot of the config index
+    PG_REGISTER_ARRAY(testProfile_t, 3, testProfiles, PG_RESERVED_FOR_TESTING_1, 0);
+    PG_REGISTER(testSystemConfig_t, testSystemConfig, 10, 1);
+    PG_REGISTER(testSmallConfig_t, testSmallConfig, 138, 0);
+    PG_REGISTER(testSmallConfig_t, testOtherConfig, PG_RESERVED_FOR_TESTING_2, 0);
+
+    uint8_t eepromData[EEPROM_SIZE];
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TEST_FLASH_PAGE_SIZE 0x400  // FLASH_PAGE_SIZE of config_streamer.c in unit tests
+
+static struct {
+    uint32_t erasedBytes;
+    uint32_t programmedWords;
+    int programBudget;      // words programmed before the power goes, -1 for no limit
+    int failures;
+} flash;
+
+void FLASH_Unlock(void) {}
+void FLASH_Lock(void) {}
+
+FLASH_Status FLASH_ErasePage(uintptr_t Page_Address)
+{
+    if (flash.programBudget == 0) {
+        return FLASH_ERROR_PG;
+    }
+    EXPECT_EQ(0u, (Page_Address - (uintptr_t)eepromData) % TEST_FLASH_PAGE_SIZE);
+    memset((void *)Page_Address, 0xFF, TEST_FLASH_PAGE_SIZE);
+    flash.erasedBytes += TEST_FLASH_PAGE_SIZE;
+    return FLASH_COMPLETE;
+}
+
+FLASH_Status FLASH_ProgramWord(uintptr_t addr, uint32_t Data)
+{
+    if (flash.programBudget == 0) {
+        return FLASH_ERROR_PG;
+    }
+    if (flash.programBudget > 0) {
+        flash.programBudget--;
+    }
+    uint32_t *word = (uint32_t *)addr;
+    // NOR flash, only an erased word can be programmed
+    EXPECT_EQ(0xFFFFFFFF, *word);
+    EXPECT_GE(addr, (uintptr_t)eepromData);
+    EXPECT_LE(addr + sizeof(Data), (uintptr_t)ARRAYEND(eepromData));
+    *word = Data;
+    flash.programmedWords++;
+    return FLASH_COMPLETE;
+}
+
+void failureMode(failureMode_e mode)
+{
+    UNUSED(mode);
+    flash.failures++;
+}
+
+static void resetFlash(void)
+{
+    // a new chip, the config region holds something that is not a config
+    memset(eepromData, 0, sizeof(eepromData));
+    memset(&flash, 0, sizeof(flash));
+    flash.programBudget = -1;
+    pgResetAll();
+    initEEPROM();
+}
+
+static void resetFlashStatistics(void)
+{
+    flash.erasedBytes = 0;
+    flash.programmedWords = 0;
+}
+
+// RAM content lost by a reset, the load must bring everything back
+static void scramblePgs(void)
+{
+    PG_FOREACH(reg) {
+        memset(reg->address, 0x5A, pgSize(reg));
+    }
+}
+
+TEST(ConfigEepromTest, TestFirstSaveAndLoad)
+{
+    resetFlash();
+    EXPECT_FALSE(isEEPROMContentValid());
+
+    testProfilesMutable(1)->pid[2][0] = 45;
+    testSystemConfigMutable()->looptime = 125;
+    writeConfigToEEPROM();
+
+    EXPECT_EQ(0, flash.failures);
+    EXPECT_EQ((uint32_t)EEPROM_SIZE, flash.erasedBytes);
+    EXPECT_TRUE(isEEPROMContentValid());
+    EXPECT_GT(getEEPROMConfigSize(), 3 * sizeof(testProfile_t));
+
+    scramblePgs();
+    EXPECT_TRUE(loadEEPROM());
+    EXPECT_EQ(45, testProfiles(1)->pid[2][0]);
+    EXPECT_EQ(0, testProfiles(0)->pid[2][0]);
+    EXPECT_EQ(125, testSystemConfig()->looptime);
+    EXPECT_EQ(0u, testSmallConfig()->value);
+}
+
+TEST(ConfigEepromTest, TestSaveAppendsChangedPgsOnly)
+{
+    resetFlash();
+    writeConfigToEEPROM();
+    const uint16_t sizeAfterFirstSave = getEEPROMConfigSize();
+
+    resetFlashStatistics();
+    testSmallConfigMutable()->value = 0x12345678;
+    writeConfigToEEPROM();
+
+    // one commit holding the small PG: commit header, record header, 4 bytes of PG and the CRC, padded to a word
+    EXPECT_EQ(0u, flash.erasedBytes);
+    EXPECT_EQ(4u, flash.programmedWords);
+    EXPECT_EQ(sizeAfterFirstSave + 16, getEEPROMConfigSize());
+
+    // nothing changed, nothing written
+    resetFlashStatistics();
+    writeConfigToEEPROM();
+    EXPECT_EQ(0u, flash.programmedWords);
+
+    testOtherConfigMutable()->value = 7;
+    testSmallConfigMutable()->value = 0x87654321;
+    writeConfigToEEPROM();
+
+    scramblePgs();
+    loadEEPROM();
+    EXPECT_EQ(0x87654321, testSmallConfig()->value);
+    EXPECT_EQ(7u, testOtherConfig()->value);
+    EXPECT_EQ(0, testProfiles(2)->pid[0][0]);
+    EXPECT_EQ(0, flash.failures);
+}
+
+TEST(ConfigEepromTest, TestCompactionWhenFull)
+{
+    resetFlash();
+    writeConfigToEEPROM();
+
+    int appends = 0;
+    uint32_t value = 0;
+    resetFlashStatistics();
+    while (flash.erasedBytes == 0) {
+        testProfilesMutable(0)->pid[0][0] = ++value;
+        writeConfigToEEPROM();
+        appends++;
+    }
+    // the profile array is about 1kB, so the 16kB region takes a dozen or so of them
+    EXPECT_GT(appends, 10);
+    EXPECT_EQ((uint32_t)EEPROM_SIZE, flash.erasedBytes);
+    EXPECT_LT(getEEPROMConfigSize(), 2 * 3 * sizeof(testProfile_t));
+
+    scramblePgs();
+    loadEEPROM();
+    EXPECT_EQ((uint8_t)value, testProfiles(0)->pid[0][0]);
+    EXPECT_EQ(0, flash.failures);
+}
+
+TEST(ConfigEepromTest, TestTornCommitIsIgnored)
+{
+    resetFlash();
+    testSmallConfigMutable()->value = 1;
+    writeConfigToEEPROM();
+    testOtherConfigMutable()->value = 2;
+    writeConfigToEEPROM();
+    const uint16_t sizeBeforeTornSave = getEEPROMConfigSize();
+
+    // power goes half way through programming the commit
+    testSmallConfigMutable()->value = 3;
+    testProfilesMutable(2)->rates[1][1] = 300;
+    flash.programBudget = 20;
+    writeConfigToEEPROM();
+    EXPECT_GT(flash.failures, 0);
+
+    // reboot, the commits before the torn one are used
+    flash.programBudget = -1;
+    flash.failures = 0;
+    scramblePgs();
+    EXPECT_TRUE(isEEPROMContentValid());
+    EXPECT_EQ(sizeBeforeTornSave, getEEPROMConfigSize());
+    loadEEPROM();
+    EXPECT_EQ(1u, testSmallConfig()->value);
+    EXPECT_EQ(2u, testOtherConfig()->value);
+    EXPECT_EQ(0, testProfiles(2)->rates[1][1]);
+
+    // nothing can be appended after the torn commit, the next save compacts
+    resetFlashStatistics();
+    testSmallConfigMutable()->value = 3;
+    writeConfigToEEPROM();
+    EXPECT_EQ((uint32_t)EEPROM_SIZE, flash.erasedBytes);
+    EXPECT_EQ(0, flash.failures);
+
+    scramblePgs();
+    loadEEPROM();
+    EXPECT_EQ(3u, testSmallConfig()->value);
+    EXPECT_EQ(2u, testOtherConfig()->value);
+}
+
+TEST(ConfigEepromTest, TestCorruptHeaderIsInvalid)
+{
+    resetFlash();
+    writeConfigToEEPROM();
+    EXPECT_TRUE(isEEPROMContentValid());
+
+    eepromData[0] = EEPROM_CONF_VERSION - 1;
+    EXPECT_FALSE(isEEPROMContentValid());
+
+    // the config resets to defaults and the next save rewrites the region
+    testSmallConfigMutable()->value = 5;
+    loadEEPROM();
+    EXPECT_EQ(0u, testSmallConfig()->value);
+    resetFlashStatistics();
+    writeConfigToEEPROM();
+    EXPECT_EQ((uint32_t)EEPROM_SIZE, flash.erasedBytes);
+    EXPECT_TRUE(isEEPROMContentValid());
+}
+
+// STM32F405 datasheet, typical at 2.7-3.6V with x32 parallelism
+#define F4_SECTOR_16K_ERASE_US  250000
+#define F4_WORD_PROGRAM_US      16
+
+static void printFlashCost(const char *name, uint32_t erasedBytes, uint32_t programmedWords)
+{
+    const uint32_t us = erasedBytes * (F4_SECTOR_16K_ERASE_US / 16) / 1024 + programmedWords * F4_WORD_PROGRAM_US;
+    printf("[ BENCH    ] %-36s %6u bytes erased, %5u words programmed, ~%7.1f ms on F4\n",
+        name, erasedBytes, programmedWords, us / 1000.0);
+}
+
+TEST(ConfigEepromTest, BenchmarkSave)
+{
+    resetFlash();
+
+    // what every save cost before: erase the sector and write all the PGs
+    writeConfigToEEPROM();
+    printFlashCost("full rewrite", flash.erasedBytes, flash.programmedWords);
+
+    resetFlashStatistics();
+    testProfilesMutable(0)->pid[0][0] = 50;
+    writeConfigToEEPROM();
+    printFlashCost("PID tweak", flash.erasedBytes, flash.programmedWords);
+    EXPECT_EQ(0u, flash.erasedBytes);
+
+    // a session of tweaks, compactions included
+    resetFlashStatistics();
+    const int saves = 200;
+    for (int ii = 0; ii < saves; ii++) {
+        if (ii % 10 == 0) {
+            testProfilesMutable(ii % 3)->rates[0][0] = ii;
+        } else {
+            testSmallConfigMutable()->value = ii;
+        }
+        writeConfigToEEPROM();
+    }
+    printFlashCost("200 mixed saves, per save", flash.erasedBytes / saves, flash.programmedWords / saves);
+    EXPECT_LT(flash.erasedBytes, saves * EEPROM_SIZE / 20u);
+    EXPECT_EQ(0, flash.failures);
+}
@@ -0,0 +1,230 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/streambuf.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// the bit serial implementations the lookup tables replaced
+static uint16_t referenceCrc16Ccitt(uint16_t crc, unsigned char a)
+{
+    crc ^= (uint16_t)a << 8;
+    for (int ii = 0; ii < 8; ++ii) {
+        if (crc & 0x8000) {
+            crc = (crc << 1) ^ 0x1021;
+        } else {
+            crc = crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint16_t referenceCrc16CcittUpdate(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    for (uint32_t ii = 0; ii < length; ii++) {
+        crc = referenceCrc16Ccitt(crc, data[ii]);
+    }
+    return crc;
+}
+
+static uint8_t referenceCrc8DvbS2(uint8_t crc, unsigned char a)
+{
+    crc ^= a;
+    for (int ii = 0; ii < 8; ++ii) {
+        if (crc & 0x80) {
+            crc = (crc << 1) ^ 0xD5;
+        } else {
+            crc = crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t referenceCrc8DvbS2Update(uint8_t crc, const uint8_t *data, uint32_t length)
+{
+    for (uint32_t ii = 0; ii < length; ii++) {
+        crc = referenceCrc8DvbS2(crc, data[ii]);
+    }
+    return crc;
+}
+
+static void fillRandom(uint8_t *data, int length, unsigned seed)
+{
+    srand(seed);
+    for (int ii = 0; ii < length; ii++) {
+        data[ii] = rand() & 0xFF;
+    }
+}
+
+TEST(CrcTest, TestCheckValues)
+{
+    const char *check = "123456789";
+
+    // CRC-16/XMODEM and CRC-8/DVB-S2 check values
+    EXPECT_EQ(0x31C3, crc16_ccitt_update(0, check, strlen(check)));
+    EXPECT_EQ(0xBC, crc8_dvb_s2_update(0, check, strlen(check)));
+    EXPECT_EQ(0x1234, crc16_ccitt_update(0x1234, check, 0));
+    EXPECT_EQ(0x12, crc8_dvb_s2_update(0x12, check, 0));
+}
+
+TEST(CrcTest, TestCrc16CcittAllStatesAndBytes)
+{
+    int mismatches = 0;
+    for (uint32_t crc = 0; crc <= 0xFFFF; crc++) {
+        for (uint32_t a = 0; a <= 0xFF; a++) {
+            if (crc16_ccitt(crc, a) != referenceCrc16Ccitt(crc, a)) {
+                mismatches++;
+            }
+        }
+    }
+    EXPECT_EQ(0, mismatches);
+}
+
+TEST(CrcTest, TestCrc8DvbS2AllStatesAndBytes)
+{
+    for (uint32_t crc = 0; crc <= 0xFF; crc++) {
+        for (uint32_t a = 0; a <= 0xFF; a++) {
+            EXPECT_EQ(referenceCrc8DvbS2(crc, a), crc8_dvb_s2(crc, a));
+        }
+    }
+}
+
+TEST(CrcTest, TestCrc16CcittUpdate)
+{
+    uint8_t data[256 + 4];
+    fillRandom(data, sizeof(data), 1);
+
+    // every 4 byte slice of every start state, then every length at every alignment
+    for (uint32_t crc = 0; crc <= 0xFFFF; crc++) {
+        ASSERT_EQ(referenceCrc16CcittUpdate(crc, data, 4), crc16_ccitt_update(crc, data, 4));
+    }
+    for (int offset = 0; offset < 4; offset++) {
+        for (int length = 0; length <= 256; length++) {
+            const uint16_t crc = length * 0x0101 + offset;
+            ASSERT_EQ(referenceCrc16CcittUpdate(crc, data + offset, length), crc16_ccitt_update(crc, data + offset, length));
+        }
+    }
+}
+
+TEST(CrcTest, TestCrc8DvbS2Update)
+{
+    uint8_t data[256 + 4];
+    fillRandom(data, sizeof(data), 2);
+
+    for (uint32_t crc = 0; crc <= 0xFF; crc++) {
+        for (uint32_t a = 0; a <= 0xFF; a++) {
+            const uint8_t slice[4] = { (uint8_t)a, (uint8_t)~a, (uint8_t)(a * 3), (uint8_t)(a + crc) };
+            ASSERT_EQ(referenceCrc8DvbS2Update(crc, slice, 4), crc8_dvb_s2_update(crc, slice, 4));
+        }
+    }
+    for (int offset = 0; offset < 4; offset++) {
+        for (int length = 0; length <= 256; length++) {
+            const uint8_t crc = length + offset;
+            ASSERT_EQ(referenceCrc8DvbS2Update(crc, data + offset, length), crc8_dvb_s2_update(crc, data + offset, length));
+        }
+    }
+}
+
+TEST(CrcTest, TestCrc8DvbS2SbufAppend)
+{
+    uint8_t frame[64];
+    fillRandom(frame, 26, 3);
+
+    sbuf_t buf;
+    buf.ptr = frame + 26;
+    buf.end = frame + sizeof(frame);
+    crc8_dvb_s2_sbuf_append(&buf, frame + 2);
+
+    EXPECT_EQ(frame + 27, buf.ptr);
+    EXPECT_EQ(referenceCrc8DvbS2Update(0, frame + 2, 24), frame[26]);
+}
+
+static uint64_t nanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static volatile uint32_t benchmarkSink;
+
+#define BENCHMARK_BYTES (2 * 1024 * 1024)
+
+static void benchmarkCrc(const char *name, int length)
+{
+    static uint8_t data[4096];
+    fillRandom(data, length, 4);
+    const int passes = BENCHMARK_BYTES / length;
+
+    uint64_t start = nanos();
+    uint16_t crc16 = 0;
+    for (int ii = 0; ii < passes; ii++) {
+        crc16 = referenceCrc16CcittUpdate(crc16, data, length);
+    }
+    const uint64_t crc16ReferenceNs = nanos() - start;
+    start = nanos();
+    uint16_t crc16Table = 0;
+    for (int ii = 0; ii < passes; ii++) {
+        crc16Table = crc16_ccitt_update(crc16Table, data, length);
+    }
+    const uint64_t crc16TableNs = nanos() - start;
+
+    start = nanos();
+    uint8_t crc8 = 0;
+    for (int ii = 0; ii < passes; ii++) {
+        crc8 = referenceCrc8DvbS2Update(crc8, data, length);
+    }
+    const uint64_t crc8ReferenceNs = nanos() - start;
+    start = nanos();
+    uint8_t crc8Table = 0;
+    for (int ii = 0; ii < passes; ii++) {
+        crc8Table = crc8_dvb_s2_update(crc8Table, data, length);
+    }
+    const uint64_t crc8TableNs = nanos() - start;
+
+    EXPECT_EQ(crc16, crc16Table);
+    EXPECT_EQ(crc8, crc8Table);
+    benchmarkSink = crc16 ^ crc8;
+
+    const double bytes = (double)passes * length;
+    printf("[ BENCH    ] %-20s CRC16 %7.1f -> %7.1f MB/s (%.1fx), CRC8 %7.1f -> %7.1f MB/s (%.1fx)\n", name,
+        bytes * 1000 / crc16ReferenceNs, bytes * 1000 / crc16TableNs, (double)crc16ReferenceNs / crc16TableNs,
+        bytes * 1000 / crc8ReferenceNs, bytes * 1000 / crc8TableNs, (double)crc8ReferenceNs / crc8TableNs);
+}
+
+TEST(CrcTest, BenchmarkCrc)
+{
+    // CRSF RC channels frame, type and payload
+    benchmarkCrc("CRSF frame 24B", 24);
+    // MSP reply
+    benchmarkCrc("MSP frame 64B", 64);
+    // config image checked by isEEPROMContentValid()
+    benchmarkCrc("EEPROM image 4kB", 4096);
+}
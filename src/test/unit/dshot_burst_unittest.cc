@@ -0,0 +1,121 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/utils.h"
+
+    #include "drivers/dshot_burst.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define BIT_COUNT 18
+
+// what the DShot encoders do, one word per bit at the given stride
+static uint8_t loadBits(uint32_t *buffer, int stride, uint32_t value)
+{
+    for (int i = 0; i < BIT_COUNT; i++) {
+        buffer[i * stride] = value;
+    }
+    return BIT_COUNT;
+}
+
+TEST(DshotBurstUnittest, TestFullTimer)
+{
+    dshotBurst_t burst;
+    memset(&burst, 0, sizeof(burst));
+
+    // motors are added in output order, not channel order, a gap is only refused if no later motor fills it
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 2));
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 3));
+    EXPECT_FALSE(dshotBurstAddChannel(&burst, 0));
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 1));
+
+    EXPECT_EQ(0, burst.firstChannel);
+    EXPECT_EQ(4, burst.channelCount);
+    EXPECT_EQ(3, dshotBurstBufferOffset(&burst, 3));
+    EXPECT_EQ(4 * BIT_COUNT, dshotBurstLength(&burst, BIT_COUNT));
+}
+
+TEST(DshotBurstUnittest, TestRunLeavesOtherChannels)
+{
+    dshotBurst_t burst;
+    memset(&burst, 0, sizeof(burst));
+
+    // CH1 free for something else, the burst starts at CCR2
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 2));
+    EXPECT_EQ(2, burst.firstChannel);
+    EXPECT_EQ(1, burst.channelCount);
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 1));
+    EXPECT_EQ(1, burst.firstChannel);
+    EXPECT_EQ(2, burst.channelCount);
+
+    EXPECT_EQ(0, dshotBurstBufferOffset(&burst, 1));
+    EXPECT_EQ(1, dshotBurstBufferOffset(&burst, 2));
+    EXPECT_EQ(2 * BIT_COUNT, dshotBurstLength(&burst, BIT_COUNT));
+}
+
+TEST(DshotBurstUnittest, TestGapIsRefused)
+{
+    dshotBurst_t burst;
+    memset(&burst, 0, sizeof(burst));
+
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 0));
+    // CH2 would be written with the motor frames
+    EXPECT_FALSE(dshotBurstAddChannel(&burst, 2));
+
+    memset(&burst, 0, sizeof(burst));
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 3));
+    EXPECT_FALSE(dshotBurstAddChannel(&burst, 0));
+
+    memset(&burst, 0, sizeof(burst));
+    EXPECT_FALSE(dshotBurstAddChannel(&burst, DSHOT_BURST_MAX_CHANNELS));
+    EXPECT_FALSE(dshotBurstAddChannel(&burst, 0));
+}
+
+TEST(DshotBurstUnittest, TestInterleavedBuffer)
+{
+    dshotBurst_t burst;
+    memset(&burst, 0, sizeof(burst));
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 1));
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 2));
+    EXPECT_TRUE(dshotBurstAddChannel(&burst, 3));
+
+    uint32_t buffer[BIT_COUNT * DSHOT_BURST_MAX_CHANNELS];
+    memset(buffer, 0, sizeof(buffer));
+    uint16_t length = 0;
+    for (uint8_t channel = 1; channel <= 3; channel++) {
+        const uint8_t bitCount = loadBits(&buffer[dshotBurstBufferOffset(&burst, channel)], burst.channelCount, 100 + channel);
+        length = dshotBurstLength(&burst, bitCount);
+    }
+
+    // each update writes CCR2, CCR3 and CCR4 in turn, and nothing past the burst
+    EXPECT_EQ(3 * BIT_COUNT, length);
+    for (int i = 0; i < length; i++) {
+        EXPECT_EQ(101u + i % 3, buffer[i]);
+    }
+    for (unsigned i = length; i < ARRAYLEN(buffer); i++) {
+        EXPECT_EQ(0u, buffer[i]);
+    }
+}
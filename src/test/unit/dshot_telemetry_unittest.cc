@@ -0,0 +1,153 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "drivers/dshot_telemetry.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define BIT_TICKS 16
+
+static const uint8_t gcrEncode[16] = {
+    0x19, 0x1b, 0x12, 0x13, 0x1d, 0x15, 0x16, 0x17, 0x1a, 0x09, 0x0a, 0x0b, 0x1e, 0x0d, 0x0e, 0x0f
+};
+
+// the 16 bit answer for a 12 bit shift and base, with the checksum an ESC appends
+static uint32_t answerValue(uint32_t value12)
+{
+    const uint32_t csum = ~(value12 ^ (value12 >> 4) ^ (value12 >> 8)) & 0xf;
+    return (value12 << 4) | csum;
+}
+
+static uint32_t gcrValue(uint32_t value16)
+{
+    uint32_t gcr = 0;
+    for (int i = 3; i >= 0; i--) {
+        gcr = (gcr << 5) | gcrEncode[(value16 >> (i * 4)) & 0xf];
+    }
+    return gcr;
+}
+
+// edge times of the answer as the input capture sees them, a 1 bit is a level change
+static int answerEdges(uint32_t value16, uint32_t *edges, uint32_t startTicks, const int *jitter = NULL)
+{
+    const uint32_t frame = (1 << 20) | gcrValue(value16);
+    int count = 0;
+    for (int bit = 20; bit >= 0; bit--) {
+        if (frame & (1 << bit)) {
+            const int offset = jitter ? jitter[count % 4] : 0;
+            edges[count] = (startTicks + (20 - bit) * BIT_TICKS + offset) & 0xffff;
+            count++;
+        }
+    }
+    return count;
+}
+
+TEST(DshotTelemetryUnittest, TestBitTicks)
+{
+    // DShot timers count 20 ticks per frame bit, 75 on an F446
+    EXPECT_EQ(16, DSHOT_TELEMETRY_BIT_TICKS(20));
+    EXPECT_EQ(60, DSHOT_TELEMETRY_BIT_TICKS(75));
+}
+
+TEST(DshotTelemetryUnittest, TestDecodeValue)
+{
+    // 100us period, 6000 * 100 eRPM
+    EXPECT_EQ(6000, dshotDecodeTelemetryValue(gcrValue(answerValue(100))));
+    // base 500 shifted by 2, a 2000us period
+    EXPECT_EQ(300, dshotDecodeTelemetryValue(gcrValue(answerValue((2 << 9) | 500))));
+    // the longest period means the motor is stopped
+    EXPECT_EQ(0, dshotDecodeTelemetryValue(gcrValue(answerValue(0x0fff))));
+    // a zero period can't be turned into an eRPM
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryValue(gcrValue(answerValue(0))));
+}
+
+TEST(DshotTelemetryUnittest, TestDecodeValueRejectsBadFrames)
+{
+    // wrong checksum
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryValue(gcrValue(answerValue(100) ^ 0x1)));
+    // quintets that are not GCR codes
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryValue(0));
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryValue(gcrValue(answerValue(100)) & ~0x1f));
+}
+
+TEST(DshotTelemetryUnittest, TestDecodePacket)
+{
+    uint32_t edges[32];
+    for (uint32_t period = 20; period < 0x1ff; period += 7) {
+        const int count = answerEdges(answerValue(period), edges, 1000);
+        EXPECT_EQ((600000 + period / 2) / period, dshotDecodeTelemetryPacket(edges, count, BIT_TICKS));
+    }
+    const int count = answerEdges(answerValue(0x0fff), edges, 1000);
+    EXPECT_EQ(0, dshotDecodeTelemetryPacket(edges, count, BIT_TICKS));
+}
+
+TEST(DshotTelemetryUnittest, TestDecodePacketTimerWrap)
+{
+    uint32_t edges[32];
+    const int count = answerEdges(answerValue(250), edges, 0xfff0);
+    EXPECT_LT(edges[count - 1], edges[0]);
+    EXPECT_EQ(2400, dshotDecodeTelemetryPacket(edges, count, BIT_TICKS));
+}
+
+TEST(DshotTelemetryUnittest, TestDecodePacketJitter)
+{
+    // edges up to a quarter bit early or late still fall on the right bit
+    const int jitter[4] = { 3, -4, 0, 4 };
+    uint32_t edges[32];
+    const int count = answerEdges(answerValue(333), edges, 500, jitter);
+    EXPECT_EQ(1802, dshotDecodeTelemetryPacket(edges, count, BIT_TICKS));
+}
+
+TEST(DshotTelemetryUnittest, TestDecodePacketTrailingEdge)
+{
+    // the ESC lets the line go back to idle after the last bit, that edge must not add a bit
+    uint32_t edges[32];
+    int count = answerEdges(answerValue(100), edges, 0);
+    edges[count] = edges[count - 1] + 5 * BIT_TICKS;
+    count++;
+    EXPECT_EQ(6000, dshotDecodeTelemetryPacket(edges, count, BIT_TICKS));
+}
+
+TEST(DshotTelemetryUnittest, TestDecodePacketRejectsNoise)
+{
+    uint32_t edges[32] = { 0 };
+    // nothing captured, the ESC doesn't answer
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryPacket(edges, 0, BIT_TICKS));
+    edges[0] = 100;
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryPacket(edges, 1, BIT_TICKS));
+
+    // a glitch between two edges
+    int count = answerEdges(answerValue(100), edges, 0);
+    for (int i = count; i > 2; i--) {
+        edges[i] = edges[i - 1];
+    }
+    edges[2] = edges[1] + 2;
+    count++;
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryPacket(edges, count, BIT_TICKS));
+
+    // the answer is cut short by the next frame
+    count = answerEdges(answerValue(100), edges, 0);
+    EXPECT_EQ(DSHOT_TELEMETRY_INVALID, dshotDecodeTelemetryPacket(edges, count / 2, BIT_TICKS));
+}
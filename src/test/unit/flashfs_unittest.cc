@@ -0,0 +1,660 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/maths.h"
+
+    #include "drivers/bus_spi.h"
+    #include "drivers/bus_spi_queue.h"
+    #include "drivers/flash.h"
+    #include "drivers/flash_m25p16.h"
+    #include "drivers/io.h"
+
+    #include "io/flashfs.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TEST_FLASH_SIZE (2 * 1024 * 1024)   // an M25P16
+#define TEST_SECTOR_SIZE 0x10000
+#define TEST_PAGE_PROGRAM_ATTEMPTS 3        // PAGE_PROGRAM_ATTEMPTS of flash_m25p16.c
+
+#define CMD_RDID            0x9F
+#define CMD_READ_BYTES      0x03
+#define CMD_READ_STATUS     0x05
+#define CMD_WRITE_ENABLE    0x06
+#define CMD_PAGE_PROGRAM    0x02
+#define CMD_SECTOR_ERASE    0xD8
+#define CMD_BULK_ERASE      0xC7
+
+// the chip on the other end of the bus, it only sees the chip select and the bytes clocked through it
+static struct {
+    uint8_t memory[TEST_FLASH_SIZE];
+    bool selected;
+    int byteIndex;
+    uint8_t command;
+    uint32_t address;
+    bool writeEnabled;
+    int busyStatusReads;    // status reads left that report the write in progress
+    int pagePrograms;
+} chip;
+
+static uint8_t expected[TEST_FLASH_SIZE];
+
+static SPI_TypeDef testSpi;
+static int csPin;
+
+static spiJob_t *jobs[8];
+static int jobCount;
+static bool backgroundDma;          // the queued jobs run while the driver waits, like DMA does
+static int refuseJobs;              // spiJobQueue() calls to fail
+static int failPagePrograms;        // page program jobs to abort half way
+static int failPageProgramEvery;    // or abort every n-th page program job
+static int pageProgramJobs;
+static int failedJobs;
+static uint32_t testMillis;
+
+static uint8_t chipExchange(uint8_t in)
+{
+    const int index = chip.byteIndex++;
+
+    if (index == 0) {
+        chip.command = in;
+        chip.address = 0;
+        if (in != CMD_READ_STATUS) {
+            EXPECT_EQ(0, chip.busyStatusReads) << "command 0x" << std::hex << (int)in << " sent while the chip is busy";
+        }
+        return 0xFF;
+    }
+
+    switch (chip.command) {
+    case CMD_RDID: {
+        static const uint8_t id[3] = { 0x20, 0x20, 0x15 };
+        return index <= 3 ? id[index - 1] : 0;
+    }
+    case CMD_READ_STATUS:
+        return (chip.busyStatusReads > 0 ? 0x01 : 0) | (chip.writeEnabled ? 0x02 : 0);
+    case CMD_READ_BYTES:
+    case CMD_PAGE_PROGRAM:
+    case CMD_SECTOR_ERASE:
+        if (index <= 3) {
+            chip.address = (chip.address << 8) | in;
+            return 0xFF;
+        }
+        if (chip.command == CMD_READ_BYTES) {
+            return chip.memory[(chip.address + index - 4) % TEST_FLASH_SIZE];
+        }
+        if (chip.command == CMD_PAGE_PROGRAM && chip.writeEnabled) {
+            // the address wraps within the page, programming can only clear bits
+            const uint32_t address = (chip.address & ~0xFF) | ((chip.address + index - 4) & 0xFF);
+            chip.memory[address] &= in;
+        }
+        return 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+static void chipDeselect(void)
+{
+    if (!chip.selected) {
+        return;
+    }
+    chip.selected = false;
+
+    if (chip.byteIndex == 0) {
+        return;
+    }
+    switch (chip.command) {
+    case CMD_READ_STATUS:
+        if (chip.busyStatusReads > 0) {
+            chip.busyStatusReads--;
+        }
+        break;
+    case CMD_WRITE_ENABLE:
+        chip.writeEnabled = true;
+        break;
+    case CMD_PAGE_PROGRAM:
+        if (chip.writeEnabled) {
+            chip.pagePrograms++;
+            chip.busyStatusReads = 2;
+        }
+        chip.writeEnabled = false;
+        break;
+    case CMD_SECTOR_ERASE:
+        if (chip.writeEnabled) {
+            memset(chip.memory + chip.address / TEST_SECTOR_SIZE * TEST_SECTOR_SIZE, 0xFF, TEST_SECTOR_SIZE);
+            chip.busyStatusReads = 3;
+        }
+        chip.writeEnabled = false;
+        break;
+    case CMD_BULK_ERASE:
+        if (chip.writeEnabled) {
+            memset(chip.memory, 0xFF, sizeof(chip.memory));
+            chip.busyStatusReads = 3;
+        }
+        chip.writeEnabled = false;
+        break;
+    }
+}
+
+static void chipTransfer(const uint8_t *txData, uint8_t *rxData, int length)
+{
+    EXPECT_TRUE(chip.selected);
+    for (int i = 0; i < length; i++) {
+        const uint8_t in = chipExchange(txData ? txData[i] : 0xFF);
+        if (rxData) {
+            rxData[i] = in;
+        }
+    }
+}
+
+static void runJob(spiJob_t *job)
+{
+    job->state = SPI_JOB_BUSY;
+    chip.selected = true;
+    chip.byteIndex = 0;
+
+    if (job->txData && job->length > 0 && job->txData[0] == CMD_PAGE_PROGRAM) {
+        pageProgramJobs++;
+        const bool failEvery = failPageProgramEvery > 0 && pageProgramJobs % failPageProgramEvery == 0;
+        if (failPagePrograms > 0 || failEvery) {
+            if (failPagePrograms > 0) {
+                failPagePrograms--;
+            }
+            // the DMA gives up half way, the chip still gets what was clocked out
+            chipTransfer(job->txData, job->rxData, job->length / 2);
+            chipDeselect();
+            failedJobs++;
+            job->state = SPI_JOB_ERROR;
+            return;
+        }
+    }
+
+    chipTransfer(job->txData, job->rxData, job->length);
+    if (!job->holdCs) {
+        chipDeselect();
+    }
+    job->state = SPI_JOB_DONE;
+}
+
+static void runJobs(void)
+{
+    // a job may be queued again as soon as it is done, so take the queue first
+    spiJob_t *running[8];
+    const int count = jobCount;
+    memcpy(running, jobs, sizeof(running));
+    jobCount = 0;
+
+    for (int i = 0; i < count; i++) {
+        runJob(running[i]);
+    }
+}
+
+// run the bus and the filesystem until the flash has everything
+static void drain(void)
+{
+    for (int i = 0; i < 10000; i++) {
+        runJobs();
+        flashfsFlushAsync();
+        if (flashfsGetWriteBufferFreeSpace() == flashfsGetWriteBufferSize() && m25p16_isReady() && jobCount == 0) {
+            return;
+        }
+    }
+    FAIL() << "the flash never went idle";
+}
+
+static void initFlash(void)
+{
+    backgroundDma = true;
+    refuseJobs = 0;
+    failPagePrograms = 0;
+    failPageProgramEvery = 0;
+    failedJobs = 0;
+
+    static const flashConfig_t flashConfig = { .csTag = 1, .spiDevice = 1 };
+    EXPECT_TRUE(m25p16_init(&flashConfig));
+    EXPECT_EQ((uint32_t)TEST_FLASH_SIZE, m25p16_getGeometry()->totalSize);
+
+    // whatever the previous test left behind
+    drain();
+    flashfsSeekAbs(0);
+
+    flashfsEraseCompletely();
+    drain();
+    memset(expected, 0xFF, sizeof(expected));
+    chip.pagePrograms = 0;
+}
+
+static uint8_t patternByte(uint32_t offset)
+{
+    return (offset * 7 + offset / 251) & 0xFF;
+}
+
+// async writes in odd sized chunks, only as fast as the buffer takes them
+static void writePattern(uint32_t length)
+{
+    const uint32_t chunk = 37;
+    uint8_t data[chunk];
+
+    for (uint32_t offset = 0; offset < length; ) {
+        const uint32_t start = flashfsGetOffset();
+        const uint32_t size = MIN(chunk, length - offset);
+        for (int i = 0; flashfsGetWriteBufferFreeSpace() < size; i++) {
+            ASSERT_LT(i, 1000) << "the buffer never drained";
+            runJobs();
+            flashfsUpdate(0);
+        }
+        for (uint32_t i = 0; i < size; i++) {
+            data[i] = patternByte(start + i);
+            expected[start + i] = data[i];
+        }
+        flashfsWrite(data, size, false);
+        EXPECT_EQ(start + size, flashfsGetOffset());
+        offset += size;
+    }
+}
+
+static void expectFlashContents(uint32_t start, uint32_t length)
+{
+    for (uint32_t i = start; i < start + length; i++) {
+        ASSERT_EQ(expected[i], chip.memory[i]) << "at offset " << i;
+    }
+}
+
+TEST(FlashfsUnittest, TestWritesReachTheFlash)
+{
+    initFlash();
+
+    writePattern(5000);
+    flashfsFlushSync();
+    drain();
+
+    expectFlashContents(0, 6000);
+    EXPECT_EQ(5000u, flashfsGetOffset());
+    // the pages are filled up while the flash is busy, not programmed as they trickle in
+    EXPECT_LE(chip.pagePrograms, 5000 / 256 + 3);
+}
+
+TEST(FlashfsUnittest, TestRefusedAndFailedJobsKeepTheData)
+{
+    initFlash();
+    failPageProgramEvery = 4;
+
+    const uint32_t length = 6000;
+    const uint32_t chunk = 100;
+    for (uint32_t written = 0; written < length; written += chunk) {
+        // the queue turns down the next job now and then, whichever it is
+        refuseJobs = (written / chunk) % 3 == 0 ? 1 : 0;
+        writePattern(chunk);
+    }
+    refuseJobs = 0;
+    flashfsFlushSync();
+    drain();
+
+    EXPECT_GT(failedJobs, 3);
+    expectFlashContents(0, length + 256);
+    EXPECT_EQ(0u, flashfsGetDroppedBytes());
+}
+
+TEST(FlashfsUnittest, TestBusThatKeepsFailingDoesNotStopLogging)
+{
+    initFlash();
+    failPagePrograms = TEST_PAGE_PROGRAM_ATTEMPTS;
+
+    writePattern(1000);
+    flashfsFlushSync();
+    drain();
+
+    // the first page is given up on and counted, the ones after it are written
+    EXPECT_EQ(TEST_PAGE_PROGRAM_ATTEMPTS, failedJobs);
+    EXPECT_EQ(256u, flashfsGetDroppedBytes());
+    expectFlashContents(256, 1000 - 256);
+}
+
+TEST(FlashfsUnittest, TestPageProgramBeginDoesNotWait)
+{
+    initFlash();
+    backgroundDma = false;
+
+    // both page buffers taken while the bus is stalled
+    const uint8_t data[4] = { 0x12, 0x34, 0x56, 0x78 };
+    const uint32_t elsewhere = 0x10000;
+    for (int page = 0; page < 2; page++) {
+        ASSERT_TRUE(m25p16_pageProgramBegin(elsewhere + page * 256));
+        m25p16_pageProgramContinue(data, sizeof(data));
+        m25p16_pageProgramFinish();
+        memcpy(expected + elsewhere + page * 256, data, sizeof(data));
+    }
+
+    const uint32_t millisBefore = testMillis;
+    EXPECT_FALSE(m25p16_pageProgramBegin(elsewhere + 512));
+
+    // flashfs keeps the data in its buffer instead of waiting for the flash
+    writePattern(300);
+    EXPECT_EQ(millisBefore, testMillis);
+    EXPECT_EQ(300u, flashfsGetWriteBufferSize() - flashfsGetWriteBufferFreeSpace());
+
+    backgroundDma = true;
+    flashfsFlushSync();
+    drain();
+
+    expectFlashContents(0, 600);
+    expectFlashContents(elsewhere, 1024);
+}
+
+TEST(FlashfsUnittest, TestFlushSyncKeepsDataWhenTheFlashTimesOut)
+{
+    initFlash();
+    backgroundDma = false;
+
+    // two pages go to the page buffers, the rest stays in the flashfs buffer
+    writePattern(600);
+    EXPECT_EQ(88u, flashfsGetWriteBufferSize() - flashfsGetWriteBufferFreeSpace());
+
+    flashfsFlushSync();
+    EXPECT_EQ(88u, flashfsGetWriteBufferSize() - flashfsGetWriteBufferFreeSpace());
+    EXPECT_EQ(600u, flashfsGetOffset());
+
+    backgroundDma = true;
+    flashfsFlushSync();
+    EXPECT_EQ(flashfsGetWriteBufferSize(), flashfsGetWriteBufferFreeSpace());
+    drain();
+
+    expectFlashContents(0, 1024);
+}
+
+static void reboot(void)
+{
+    drain();
+    flashfsInit();
+}
+
+static void expectLog(int index, uint32_t start, uint32_t length, uint32_t timeMs, uint16_t flags)
+{
+    flashfsLogEntry_t entry;
+    ASSERT_TRUE(flashfsGetLog(index, &entry)) << "log " << index;
+    EXPECT_EQ(start, entry.start) << "log " << index;
+    EXPECT_EQ(length, entry.length) << "log " << index;
+    EXPECT_EQ(timeMs, entry.timeMs) << "log " << index;
+    EXPECT_EQ(flags, entry.flags) << "log " << index;
+}
+
+static void writeLog(uint32_t timeMs, uint32_t length)
+{
+    flashfsLogBegin(timeMs);
+    writePattern(length);
+    flashfsLogEnd(true);
+    drain();
+}
+
+TEST(FlashfsUnittest, TestFreeSpaceSearchWithoutIndex)
+{
+    // written by firmware that didn't keep an index, the free space starts at the next 2kB block
+    const uint32_t lengths[] = { 1, 2047, 2048, 2049, 5000, 100000, 1000000 };
+    for (unsigned i = 0; i < ARRAYLEN(lengths); i++) {
+        initFlash();
+        for (uint32_t offset = 0; offset < lengths[i]; offset++) {
+            chip.memory[offset] = patternByte(offset);
+        }
+        const uint32_t freeStart = (lengths[i] + 2047) / 2048 * 2048;
+
+        flashfsInit();
+        EXPECT_EQ(freeStart, flashfsGetOffset()) << lengths[i] << " bytes written";
+        EXPECT_EQ(freeStart, (uint32_t)flashfsIdentifyStartOfFreeSpace());
+        EXPECT_EQ(1, flashfsGetLogCount());
+        expectLog(0, 0, freeStart, 0, FLASHFS_LOG_FLAG_RECOVERED);
+    }
+}
+
+TEST(FlashfsUnittest, TestRecoveredLogIsWrittenAfterBoot)
+{
+    initFlash();
+    for (uint32_t offset = 0; offset < 5000; offset++) {
+        chip.memory[offset] = patternByte(offset);
+    }
+
+    // listed straight away, but the boot doesn't wait for the flash
+    flashfsInit();
+    EXPECT_EQ(0, chip.pagePrograms);
+    EXPECT_EQ(1, flashfsGetLogCount());
+    expectLog(0, 0, 6144, 0, FLASHFS_LOG_FLAG_RECOVERED);
+
+    flashfsUpdate(0);
+    drain();
+    EXPECT_EQ(1, chip.pagePrograms);
+    EXPECT_EQ(1, flashfsGetLogCount());
+
+    reboot();
+    EXPECT_EQ(1, chip.pagePrograms);
+    EXPECT_EQ(1, flashfsGetLogCount());
+    expectLog(0, 0, 6144, 0, FLASHFS_LOG_FLAG_RECOVERED);
+    EXPECT_EQ(6144u, flashfsGetOffset());
+}
+
+TEST(FlashfsUnittest, TestUnterminatedLogIsRecovered)
+{
+    initFlash();
+    writeLog(1000, 3000);
+    expectLog(0, 0, 3000, 1000, 0);
+
+    // the power goes before the second log is closed
+    flashfsLogBegin(5000);
+    writePattern(2000);
+    flashfsFlushSync();
+    drain();
+
+    const int pageProgramsBeforeBoot = chip.pagePrograms;
+    reboot();
+    EXPECT_EQ(pageProgramsBeforeBoot, chip.pagePrograms);
+    EXPECT_EQ(2, flashfsGetLogCount());
+    expectLog(0, 0, 3000, 1000, 0);
+    expectLog(1, 3000, 6144 - 3000, 0, FLASHFS_LOG_FLAG_RECOVERED);
+    EXPECT_EQ(6144u, flashfsGetOffset());
+
+    // no update ran, closing the next log writes the recovered record first
+    writeLog(9000, 500);
+    EXPECT_EQ(3, flashfsGetLogCount());
+
+    reboot();
+    EXPECT_EQ(3, flashfsGetLogCount());
+    expectLog(1, 3000, 6144 - 3000, 0, FLASHFS_LOG_FLAG_RECOVERED);
+    expectLog(2, 6144, 500, 9000, 0);
+    EXPECT_EQ(6644u, flashfsGetOffset());
+    expectFlashContents(0, 7000);
+}
+
+TEST(FlashfsUnittest, TestDeleteLog)
+{
+    initFlash();
+    for (int i = 0; i < 3; i++) {
+        writeLog(1000 * (i + 1), 70000);
+    }
+    EXPECT_EQ(210000u, flashfsGetOffset());
+
+    EXPECT_FALSE(flashfsDeleteLog(3));
+    flashfsLogBegin(0);
+    EXPECT_FALSE(flashfsDeleteLog(1));
+    flashfsLogEnd(false);
+
+    // an older log only has its entry cleared, its sectors are shared with the logs either side
+    EXPECT_TRUE(flashfsDeleteLog(1));
+    EXPECT_EQ(3, flashfsGetLogCount());
+    expectLog(1, 70000, 0, 0, FLASHFS_LOG_FLAG_DELETED);
+    expectLog(2, 140000, 70000, 3000, 0);
+    EXPECT_EQ(210000u, flashfsGetOffset());
+    expectFlashContents(0, 210000);
+
+    // with nothing newer left the sectors after the start of the newest one are reclaimed
+    EXPECT_TRUE(flashfsDeleteLog(2));
+    expectLog(2, 140000, 0, 0, FLASHFS_LOG_FLAG_DELETED);
+    const uint32_t reclaimStart = 3 * TEST_SECTOR_SIZE;
+    EXPECT_EQ(reclaimStart, flashfsGetOffset());
+    memset(expected + reclaimStart, 0xFF, 210000 - reclaimStart);
+    expectFlashContents(0, 4 * TEST_SECTOR_SIZE);
+
+    // deleting again does nothing more
+    EXPECT_TRUE(flashfsDeleteLog(2));
+    EXPECT_EQ(reclaimStart, flashfsGetOffset());
+
+    reboot();
+    EXPECT_EQ(3, flashfsGetLogCount());
+    expectLog(0, 0, 70000, 1000, 0);
+    expectLog(1, 70000, 0, 0, FLASHFS_LOG_FLAG_DELETED);
+    expectLog(2, 140000, 0, 0, FLASHFS_LOG_FLAG_DELETED);
+    EXPECT_EQ(reclaimStart, flashfsGetOffset());
+
+    // the power goes while the reclaimed space is written again, the deleted data before it isn't recovered
+    flashfsLogBegin(4000);
+    writePattern(1000);
+    flashfsFlushSync();
+    reboot();
+    EXPECT_EQ(4, flashfsGetLogCount());
+    expectLog(3, reclaimStart, 2048, 0, FLASHFS_LOG_FLAG_RECOVERED);
+
+    writeLog(5000, 1000);
+    EXPECT_EQ(5, flashfsGetLogCount());
+    expectLog(4, reclaimStart + 2048, 1000, 5000, 0);
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t millis(void)
+{
+    if (backgroundDma) {
+        runJobs();
+    }
+    return testMillis++;
+}
+
+void delay(timeMs_t ms)
+{
+    UNUSED(ms);
+}
+
+IO_t IOGetByTag(ioTag_t tag)
+{
+    return tag ? (IO_t)&csPin : IO_NONE;
+}
+
+void IOInit(IO_t io, resourceOwner_e owner, uint8_t index)
+{
+    UNUSED(io);
+    UNUSED(owner);
+    UNUSED(index);
+}
+
+void IOConfigGPIO(IO_t io, ioConfig_t cfg)
+{
+    UNUSED(io);
+    UNUSED(cfg);
+}
+
+void IOLo(IO_t io)
+{
+    EXPECT_EQ((IO_t)&csPin, io);
+    chip.selected = true;
+    chip.byteIndex = 0;
+}
+
+void IOHi(IO_t io)
+{
+    EXPECT_EQ((IO_t)&csPin, io);
+    chipDeselect();
+}
+
+SPI_TypeDef *spiInstanceByDevice(SPIDevice device)
+{
+    EXPECT_EQ(SPIDEV_1, device);
+    return &testSpi;
+}
+
+void spiBusSetInstance(busDevice_t *bus, SPI_TypeDef *instance)
+{
+    bus->busdev_u.spi.instance = instance;
+}
+
+void spiSetDivisor(SPI_TypeDef *instance, uint16_t divisor)
+{
+    UNUSED(instance);
+    UNUSED(divisor);
+}
+
+uint8_t spiBusTransactionBegin(SPI_TypeDef *instance)
+{
+    UNUSED(instance);
+    return 0;
+}
+
+void spiBusTransactionEnd(uint8_t basepri)
+{
+    UNUSED(basepri);
+}
+
+uint8_t spiTransferByte(SPI_TypeDef *instance, uint8_t data)
+{
+    UNUSED(instance);
+    uint8_t in;
+    chipTransfer(&data, &in, 1);
+    return in;
+}
+
+bool spiTransfer(SPI_TypeDef *instance, const uint8_t *txData, uint8_t *rxData, int len)
+{
+    UNUSED(instance);
+    chipTransfer(txData, rxData, len);
+    return true;
+}
+
+bool spiJobQueue(spiJob_t *job)
+{
+    if (refuseJobs > 0) {
+        refuseJobs--;
+        return false;
+    }
+    if (spiIsJobBusy(job)) {
+        return false;
+    }
+    EXPECT_LT(jobCount, (int)ARRAYLEN(jobs));
+    job->state = SPI_JOB_QUEUED;
+    jobs[jobCount++] = job;
+    return true;
+}
+
+bool spiBusHasJobDma(SPI_TypeDef *instance)
+{
+    UNUSED(instance);
+    return true;
+}
+
+bool spiWaitJobsComplete(SPI_TypeDef *instance)
+{
+    UNUSED(instance);
+    runJobs();
+    return true;
+}
+
+}
@@ -0,0 +1,146 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <thread>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "drivers/gyro_sample_ring.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static void pushSample(gyroSampleRing_t *ring, int value)
+{
+    const int16_t adcRaw[XYZ_AXIS_COUNT] = { (int16_t)value, (int16_t)(value + 1), (int16_t)(value + 2) };
+    gyroSampleRingPush(ring, adcRaw, value * 125);
+}
+
+TEST(GyroSampleRingUnittest, TestEmpty)
+{
+    gyroSampleRing_t ring;
+    gyroSampleRingInit(&ring);
+
+    gyroSample_t sample;
+    EXPECT_FALSE(gyroSampleRingPop(&ring, &sample));
+    EXPECT_EQ(0, gyroSampleRingCount(&ring));
+}
+
+TEST(GyroSampleRingUnittest, TestPushPopOrder)
+{
+    gyroSampleRing_t ring;
+    gyroSampleRingInit(&ring);
+
+    pushSample(&ring, 10);
+    pushSample(&ring, 20);
+    pushSample(&ring, 30);
+    EXPECT_EQ(3, gyroSampleRingCount(&ring));
+
+    gyroSample_t sample;
+    for (int value = 10; value <= 30; value += 10) {
+        EXPECT_TRUE(gyroSampleRingPop(&ring, &sample));
+        EXPECT_EQ(value, sample.adcRaw[X]);
+        EXPECT_EQ(value + 1, sample.adcRaw[Y]);
+        EXPECT_EQ(value + 2, sample.adcRaw[Z]);
+        EXPECT_EQ((timeUs_t)value * 125, sample.timeUs);
+    }
+    EXPECT_FALSE(gyroSampleRingPop(&ring, &sample));
+}
+
+TEST(GyroSampleRingUnittest, TestFullDropsNewest)
+{
+    gyroSampleRing_t ring;
+    gyroSampleRingInit(&ring);
+
+    // one slot is kept free to tell a full ring from an empty one
+    for (int i = 0; i < GYRO_SAMPLE_RING_SIZE - 1; i++) {
+        pushSample(&ring, i);
+    }
+    EXPECT_EQ(GYRO_SAMPLE_RING_SIZE - 1, gyroSampleRingCount(&ring));
+    EXPECT_EQ(0, ring.overruns);
+
+    const int16_t adcRaw[XYZ_AXIS_COUNT] = { 1000, 1000, 1000 };
+    EXPECT_FALSE(gyroSampleRingPush(&ring, adcRaw, 0));
+    EXPECT_EQ(1, ring.overruns);
+
+    gyroSample_t sample;
+    for (int i = 0; i < GYRO_SAMPLE_RING_SIZE - 1; i++) {
+        EXPECT_TRUE(gyroSampleRingPop(&ring, &sample));
+        EXPECT_EQ(i, sample.adcRaw[X]);
+    }
+    EXPECT_FALSE(gyroSampleRingPop(&ring, &sample));
+}
+
+TEST(GyroSampleRingUnittest, TestWraparound)
+{
+    gyroSampleRing_t ring;
+    gyroSampleRingInit(&ring);
+
+    gyroSample_t sample;
+    for (int i = 0; i < GYRO_SAMPLE_RING_SIZE * 5; i++) {
+        pushSample(&ring, i);
+        pushSample(&ring, i + 100);
+        EXPECT_TRUE(gyroSampleRingPop(&ring, &sample));
+        EXPECT_EQ(i, sample.adcRaw[X]);
+        EXPECT_TRUE(gyroSampleRingPop(&ring, &sample));
+        EXPECT_EQ(i + 100, sample.adcRaw[X]);
+    }
+    EXPECT_EQ(0, gyroSampleRingCount(&ring));
+    EXPECT_EQ(0, ring.overruns);
+}
+
+TEST(GyroSampleRingUnittest, TestConcurrentProducer)
+{
+    // a producer thread stands in for the data ready interrupt, every sample must arrive intact and in order
+    static gyroSampleRing_t ring;
+    gyroSampleRingInit(&ring);
+    const int sampleCount = 200000;
+
+    std::thread producer([&]() {
+        for (int i = 0; i < sampleCount; i++) {
+            const int16_t adcRaw[XYZ_AXIS_COUNT] = { (int16_t)i, (int16_t)~i, (int16_t)(i >> 16) };
+            while (!gyroSampleRingPush(&ring, adcRaw, i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    bool intact = true;
+    gyroSample_t sample;
+    while (expected < sampleCount) {
+        if (!gyroSampleRingPop(&ring, &sample)) {
+            std::this_thread::yield();
+            continue;
+        }
+        intact &= sample.timeUs == (timeUs_t)expected;
+        intact &= sample.adcRaw[X] == (int16_t)expected;
+        intact &= sample.adcRaw[Y] == (int16_t)~expected;
+        intact &= sample.adcRaw[Z] == (int16_t)(expected >> 16);
+        expected++;
+    }
+    producer.join();
+
+    EXPECT_TRUE(intact);
+    EXPECT_EQ(sampleCount, expected);
+    EXPECT_FALSE(gyroSampleRingPop(&ring, &sample));
+}
@@ -0,0 +1,379 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/maths.h"
+    #include "common/streambuf.h"
+    #include "common/utils.h"
+
+    #include "io/flashfs.h"
+
+    #include "msp/msp.h"
+    #include "msp/msp_dataflash_stream.h"
+    #include "msp/msp_protocol.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TEST_FLASH_SIZE 8192
+
+static struct {
+    uint8_t memory[TEST_FLASH_SIZE];
+    bool ready;
+    bool failReads;
+    int reads;
+    unsigned maxReadLength;
+} flash;
+
+// Only compared, never dereferenced
+static uint8_t portA, portB;
+#define PORT_A ((struct serialPort_s *)&portA)
+#define PORT_B ((struct serialPort_s *)&portB)
+
+typedef struct streamReply_s {
+    uint32_t address;
+    uint32_t length;
+    uint16_t chunkSize;
+    uint8_t window;
+} streamReply_t;
+
+typedef struct streamFrame_s {
+    uint32_t address;
+    uint16_t length;
+    const uint8_t *data;
+    uint16_t crc;
+} streamFrame_t;
+
+static void resetFlash(void)
+{
+    memset(&flash, 0, sizeof(flash));
+    for (int i = 0; i < TEST_FLASH_SIZE; i++) {
+        flash.memory[i] = (i * 7 + (i >> 8)) & 0xFF;
+    }
+    flash.ready = true;
+}
+
+static mspResult_e streamCommand(uint32_t address, uint32_t length, uint16_t chunkSize, uint8_t window, streamReply_t *reply)
+{
+    uint8_t request[11];
+    sbuf_t src = { request, ARRAYEND(request) };
+    sbufWriteU32(&src, address);
+    sbufWriteU32(&src, length);
+    sbufWriteU16(&src, chunkSize);
+    sbufWriteU8(&src, window);
+    sbufSwitchToReader(&src, request);
+
+    uint8_t replyBuffer[16];
+    sbuf_t dst = { replyBuffer, ARRAYEND(replyBuffer) };
+    const mspResult_e result = mspDataflashStreamCommand(&dst, &src);
+    sbufSwitchToReader(&dst, replyBuffer);
+
+    if (result == MSP_RESULT_ACK) {
+        EXPECT_EQ(11, sbufBytesRemaining(&dst));
+        reply->address = sbufReadU32(&dst);
+        reply->length = sbufReadU32(&dst);
+        reply->chunkSize = sbufReadU16(&dst);
+        reply->window = sbufReadU8(&dst);
+    }
+    return result;
+}
+
+static void startStream(uint32_t address, uint32_t length, uint16_t chunkSize, uint8_t window, uint32_t txBufferSize)
+{
+    streamReply_t reply;
+    EXPECT_EQ(MSP_RESULT_ACK, streamCommand(address, length, chunkSize, window, &reply));
+    EXPECT_TRUE(mspDataflashStreamIsPending());
+    mspDataflashStreamAttach(PORT_A, txBufferSize);
+    EXPECT_FALSE(mspDataflashStreamIsPending());
+}
+
+static void ack(uint32_t address)
+{
+    uint8_t request[4];
+    sbuf_t src = { request, ARRAYEND(request) };
+    sbufWriteU32(&src, address);
+    sbufSwitchToReader(&src, request);
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, mspDataflashStreamAckCommand(&src));
+}
+
+// Calls the stream like the serial task would until a frame comes out, `calls` counts the calls that took
+static mspResult_e nextFrame(struct serialPort_s *port, streamFrame_t *frame, int *calls = NULL)
+{
+    mspPacket_t packet;
+    memset(&packet, 0, sizeof(packet));
+
+    mspResult_e result = MSP_RESULT_NO_REPLY;
+    int count = 0;
+    while (result == MSP_RESULT_NO_REPLY && count < 100) {
+        result = mspDataflashStreamNext(port, &packet);
+        count++;
+    }
+    if (calls) {
+        *calls = count;
+    }
+
+    if (result == MSP_RESULT_ACK) {
+        EXPECT_EQ(MSP_DATAFLASH_STREAM_DATA, packet.cmd);
+        EXPECT_EQ(MSP_DIRECTION_REPLY, packet.direction);
+        sbuf_t *src = &packet.buf;
+        frame->address = sbufReadU32(src);
+        frame->length = sbufReadU16(src);
+        frame->data = sbufPtr(src);
+        sbufAdvance(src, frame->length);
+        frame->crc = sbufReadU16(src);
+        EXPECT_EQ(0, sbufBytesRemaining(src));
+    }
+    return result;
+}
+
+static void expectFrame(const streamFrame_t *frame, uint32_t address, uint16_t length)
+{
+    EXPECT_EQ(address, frame->address);
+    ASSERT_EQ(length, frame->length);
+    EXPECT_EQ(0, memcmp(frame->data, flash.memory + address, length));
+    EXPECT_EQ(crc16_ccitt_update(0, flash.memory + address, length), frame->crc);
+}
+
+TEST(MspDataflashStreamTest, SendsTheRangeInChunksWithTheirCrc)
+{
+    resetFlash();
+    startStream(100, 3000, 1024, 8, 4096);
+
+    streamFrame_t frame;
+    int calls;
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame, &calls));
+    expectFrame(&frame, 100, 1024);
+    // A chunk is read a piece per call, the serial task is never held up by a whole chunk
+    EXPECT_EQ(1024 / MSP_DATAFLASH_STREAM_READ_SIZE, calls);
+    EXPECT_EQ((unsigned)MSP_DATAFLASH_STREAM_READ_SIZE, flash.maxReadLength);
+
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 1124, 1024);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 2148, 952);
+
+    // A corrupted chunk does not match its CRC
+    uint8_t corrupted[952];
+    memcpy(corrupted, frame.data, sizeof(corrupted));
+    corrupted[500] ^= 0x10;
+    EXPECT_NE(frame.crc, crc16_ccitt_update(0, corrupted, sizeof(corrupted)));
+
+    // A zero length frame ends the stream, it is the last one
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    EXPECT_EQ(3100u, frame.address);
+    EXPECT_EQ(0, frame.length);
+    EXPECT_EQ(MSP_RESULT_ERROR, nextFrame(PORT_A, &frame));
+    EXPECT_EQ(NULL, mspDataflashStreamPort());
+    EXPECT_FALSE(mspDataflashStreamIsPending());
+}
+
+TEST(MspDataflashStreamTest, WindowLimitsFramesUntilAcked)
+{
+    resetFlash();
+    startStream(0, 1000, 64, 2, 4096);
+
+    streamFrame_t frame;
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 0, 64);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 64, 64);
+
+    // The window is full, nothing is read or sent however often the task runs
+    flash.reads = 0;
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, nextFrame(PORT_A, &frame));
+    EXPECT_EQ(0, flash.reads);
+
+    // Acks past what was sent, or behind the last one, are ignored
+    ack(192);
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, nextFrame(PORT_A, &frame));
+    ack(0);
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, nextFrame(PORT_A, &frame));
+
+    // Each acked chunk lets one more go
+    ack(64);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 128, 64);
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, nextFrame(PORT_A, &frame));
+
+    ack(192);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 192, 64);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 256, 64);
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, nextFrame(PORT_A, &frame));
+}
+
+TEST(MspDataflashStreamTest, NewStreamRetransmitsFromItsAddress)
+{
+    resetFlash();
+    startStream(0, 4096, 256, 4, 4096);
+
+    streamFrame_t frame;
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 256, 256);
+
+    // The host got the second chunk with a bad CRC and asks for the rest again from there
+    streamReply_t reply;
+    EXPECT_EQ(MSP_RESULT_ACK, streamCommand(256, 4096 - 256, 256, 4, &reply));
+    EXPECT_EQ(256u, reply.address);
+    EXPECT_EQ(4096u - 256, reply.length);
+    EXPECT_EQ(NULL, mspDataflashStreamPort());
+    EXPECT_EQ(MSP_RESULT_ERROR, nextFrame(PORT_A, &frame));
+
+    mspDataflashStreamAttach(PORT_A, 4096);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 256, 256);
+    // The window starts over with the new stream
+    for (int i = 1; i < 4; i++) {
+        EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+        expectFrame(&frame, 256 + i * 256, 256);
+    }
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, nextFrame(PORT_A, &frame));
+
+    // A stream started from another port takes over, the first one gets nothing more
+    EXPECT_EQ(MSP_RESULT_ACK, streamCommand(1024, 512, 256, 4, &reply));
+    mspDataflashStreamAttach(PORT_B, 4096);
+    EXPECT_EQ(MSP_RESULT_ERROR, nextFrame(PORT_A, &frame));
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_B, &frame));
+    expectFrame(&frame, 1024, 256);
+}
+
+TEST(MspDataflashStreamTest, WaitsForTheFlashWithoutReading)
+{
+    resetFlash();
+    startStream(0, 1024, 1024, 4, 4096);
+
+    mspPacket_t packet;
+    memset(&packet, 0, sizeof(packet));
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, mspDataflashStreamNext(PORT_A, &packet));
+    EXPECT_EQ(1, flash.reads);
+
+    // Logging programs a page, the chunk is finished once the flash is free
+    flash.ready = false;
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(MSP_RESULT_NO_REPLY, mspDataflashStreamNext(PORT_A, &packet));
+    }
+    EXPECT_EQ(1, flash.reads);
+
+    flash.ready = true;
+    streamFrame_t frame;
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 0, 1024);
+    EXPECT_EQ(4, flash.reads);
+
+    // A read that comes up short ends the stream
+    startStream(1024, 1024, 1024, 4, 4096);
+    flash.failReads = true;
+    EXPECT_EQ(MSP_RESULT_ERROR, nextFrame(PORT_A, &frame));
+    EXPECT_EQ(NULL, mspDataflashStreamPort());
+}
+
+TEST(MspDataflashStreamTest, ChunkFitsTheTransmitBuffer)
+{
+    resetFlash();
+    streamFrame_t frame;
+
+    // Two frames with their header, address, length and CRC fit a 256 byte buffer
+    startStream(0, 1000, 1024, 4, 256);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 0, 112);
+
+    // Never below the smallest chunk
+    startStream(0, 1000, 1024, 4, 64);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 0, MSP_DATAFLASH_STREAM_CHUNK_MIN);
+
+    // The host asks for smaller chunks than the port takes
+    startStream(0, 1000, 100, 4, 4096);
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 0, 100);
+}
+
+TEST(MspDataflashStreamTest, CommandIsCheckedAndClamped)
+{
+    resetFlash();
+    streamReply_t reply;
+
+    EXPECT_EQ(MSP_RESULT_ACK, streamCommand(TEST_FLASH_SIZE - 100, 1000, 5000, 0, &reply));
+    EXPECT_EQ((uint32_t)TEST_FLASH_SIZE - 100, reply.address);
+    EXPECT_EQ(100u, reply.length);
+    EXPECT_EQ(MSP_DATAFLASH_STREAM_CHUNK_MAX, reply.chunkSize);
+    EXPECT_EQ(1, reply.window);
+    EXPECT_TRUE(mspDataflashStreamIsPending());
+
+    // Nothing to send, a zero length stream stops the one going on and is not attached
+    EXPECT_EQ(MSP_RESULT_ACK, streamCommand(TEST_FLASH_SIZE + 100, 1000, 64, 4, &reply));
+    EXPECT_EQ((uint32_t)TEST_FLASH_SIZE, reply.address);
+    EXPECT_EQ(0u, reply.length);
+    EXPECT_FALSE(mspDataflashStreamIsPending());
+
+    // Address and length are needed, chunk size and window are optional
+    uint8_t request[8] = { 0 };
+    uint8_t replyBuffer[16];
+    sbuf_t src = { request, request + 7 };
+    sbuf_t dst = { replyBuffer, ARRAYEND(replyBuffer) };
+    EXPECT_EQ(MSP_RESULT_ERROR, mspDataflashStreamCommand(&dst, &src));
+
+    src.ptr = request;
+    src.end = ARRAYEND(request);
+    request[4] = 10;
+    EXPECT_EQ(MSP_RESULT_ACK, mspDataflashStreamCommand(&dst, &src));
+    EXPECT_TRUE(mspDataflashStreamIsPending());
+    mspDataflashStreamAttach(PORT_A, 4096);
+    streamFrame_t frame;
+    EXPECT_EQ(MSP_RESULT_ACK, nextFrame(PORT_A, &frame));
+    expectFrame(&frame, 0, 10);
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t flashfsGetSize(void)
+{
+    return TEST_FLASH_SIZE;
+}
+
+bool flashfsIsReady(void)
+{
+    return flash.ready;
+}
+
+int flashfsReadAbs(uint32_t offset, uint8_t *data, unsigned int len)
+{
+    EXPECT_TRUE(flash.ready);
+    flash.reads++;
+    flash.maxReadLength = MAX(flash.maxReadLength, len);
+
+    len = MIN(len, TEST_FLASH_SIZE - offset);
+    if (flash.failReads) {
+        len /= 2;
+    }
+    memcpy(data, flash.memory + offset, len);
+    return len;
+}
+
+}
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <stdio.h>
 
 #define USE_PARAMETER_GROUPS
@@ -73,6 +74,10 @@ typedef struct {
     void* test;
 } DMA_Channel_TypeDef;
 
+typedef struct {
+    void* test;
+} DMA_InitTypeDef;
+
 uint8_t DMA_GetFlagStatus(void *);
 void DMA_Cmd(DMA_Channel_TypeDef*, FunctionalState );
 void DMA_ClearFlag(uint32_t);
@@ -92,6 +97,32 @@ typedef struct
     void *test;
 } I2C_TypeDef;
 
+typedef enum {
+    FLASH_BUSY = 1,
+    FLASH_ERROR_PG,
+    FLASH_ERROR_WRP,
+    FLASH_COMPLETE,
+    FLASH_TIMEOUT
+} FLASH_Status;
+
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+FLASH_Status FLASH_ErasePage(uintptr_t Page_Address);
+FLASH_Status FLASH_ProgramWord(uintptr_t addr, uint32_t Data);
+
+#ifdef EEPROM_IN_RAM
+#define EEPROM_SIZE     16384
+extern uint8_t eepromData[EEPROM_SIZE];
+#define __config_start (*eepromData)
+#define __config_end (eepromData[EEPROM_SIZE])
+#endif
+
+#ifdef USE_FLASH_M25P16
+// the chip select padding of flash_m25p16.c, the tests that use arm_math.h get the CMSIS one
+#define __NOP()
+#endif
+#define SPI_IO_CS_CFG 0
+
 #define WS2811_DMA_TC_FLAG (void *)1
 #define WS2811_DMA_HANDLER_IDENTIFER 0
 #define NVIC_PriorityGroup_2 0x500
@@ -0,0 +1,94 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/profiler.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+TEST(ProfilerUnittest, TestScopeNames)
+{
+    EXPECT_STREQ("GYRO_FILTERS", profilerScopeName(PROFILER_SCOPE_GYRO_FILTERS));
+    EXPECT_STREQ("AFATFS_POLL", profilerScopeName(PROFILER_SCOPE_AFATFS_POLL));
+}
+
+TEST(ProfilerUnittest, TestEmptyScope)
+{
+    profilerInit();
+
+    EXPECT_EQ(0, profilerScopes[PROFILER_SCOPE_PID].count);
+    EXPECT_EQ(0, profilerScopeLatest(PROFILER_SCOPE_PID));
+    EXPECT_EQ(0, profilerScopeAverage(PROFILER_SCOPE_PID));
+}
+
+TEST(ProfilerUnittest, TestRecord)
+{
+    profilerReset();
+
+    profilerRecord(PROFILER_SCOPE_MIXER, 100);
+    profilerRecord(PROFILER_SCOPE_MIXER, 300);
+    profilerRecord(PROFILER_SCOPE_MIXER, 200);
+
+    EXPECT_EQ(3, profilerScopes[PROFILER_SCOPE_MIXER].count);
+    EXPECT_EQ(200, profilerScopeLatest(PROFILER_SCOPE_MIXER));
+    EXPECT_EQ(200, profilerScopeAverage(PROFILER_SCOPE_MIXER));
+    EXPECT_EQ(300, profilerScopes[PROFILER_SCOPE_MIXER].maxCycles);
+
+    // other scopes are untouched
+    EXPECT_EQ(0, profilerScopes[PROFILER_SCOPE_PID].count);
+}
+
+TEST(ProfilerUnittest, TestRingWraparound)
+{
+    profilerReset();
+
+    profilerRecord(PROFILER_SCOPE_BLACKBOX, 10000);
+    for (unsigned i = 0; i < PROFILER_RING_SIZE; i++) {
+        profilerRecord(PROFILER_SCOPE_BLACKBOX, 10 + i);
+    }
+
+    // the first sample has been overwritten, but still counts towards the maximum
+    EXPECT_EQ(PROFILER_RING_SIZE + 1, profilerScopes[PROFILER_SCOPE_BLACKBOX].count);
+    EXPECT_EQ(10 + PROFILER_RING_SIZE - 1, profilerScopeLatest(PROFILER_SCOPE_BLACKBOX));
+    EXPECT_EQ(10 + (PROFILER_RING_SIZE - 1) / 2, profilerScopeAverage(PROFILER_SCOPE_BLACKBOX));
+    EXPECT_EQ(10000, profilerScopes[PROFILER_SCOPE_BLACKBOX].maxCycles);
+}
+
+TEST(ProfilerUnittest, TestScopeMacros)
+{
+    profilerReset();
+
+    volatile uint32_t sum = 0;
+    PROFILE_BEGIN(PROFILER_SCOPE_GYRO_FILTERS);
+    for (int i = 0; i < 100000; i++) {
+        sum += i;
+    }
+    PROFILE_END(PROFILER_SCOPE_GYRO_FILTERS);
+
+    EXPECT_EQ(1, profilerScopes[PROFILER_SCOPE_GYRO_FILTERS].count);
+    EXPECT_GT(profilerScopeLatest(PROFILER_SCOPE_GYRO_FILTERS), 0);
+    // a 100k iteration loop takes well under a second
+    EXPECT_LT(profilerCyclesToNs(profilerScopeLatest(PROFILER_SCOPE_GYRO_FILTERS)), 1000000000);
+}
@@ -0,0 +1,189 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/debug.h"
+
+    #include "common/axis.h"
+    #include "common/filter.h"
+    #include "common/maths.h"
+
+    #include "config/parameter_group.h"
+    #include "config/parameter_group_ids.h"
+
+    #include "drivers/pwm_output.h"
+
+    #include "flight/mixer.h"
+    #include "flight/pid.h"
+    #include "flight/rpm_filter.h"
+
+    #include "sensors/gyro.h"
+
+    PG_REGISTER(motorConfig_t, motorConfig, PG_MOTOR_CONFIG, 0);
+
+    uint32_t targetPidLooptime;
+    gyro_t gyro;
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define MOTOR_COUNT 4
+#define LOOPTIME_US 125
+#define POLE_COUNT  14
+
+static bool telemetryActive;
+static uint16_t telemetry[MOTOR_COUNT];
+
+// the eRPM / 100 an ESC reports for a motor turning at the given frequency
+static uint16_t telemetryForHz(float hz)
+{
+    return lrintf(hz * 60.0f * (POLE_COUNT / 2) / 100.0f);
+}
+
+static void setup(void)
+{
+    pgResetAll();
+    motorConfigMutable()->motorPoleCount = POLE_COUNT;
+    gyro.targetLooptime = LOOPTIME_US;
+    targetPidLooptime = LOOPTIME_US;
+    telemetryActive = true;
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        telemetry[i] = 0;
+    }
+    rpmFilterInit();
+}
+
+static void setMotorsHz(float hz)
+{
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        telemetry[i] = telemetryForHz(hz);
+    }
+}
+
+// runs the PID loops of the given time, so the frequency filter settles and every notch is retuned
+static void runUpdates(float seconds)
+{
+    for (int i = 0; i < seconds * 1e6f / LOOPTIME_US; i++) {
+        rpmFilterUpdate();
+    }
+}
+
+// peak output of the filter over the last half of a sine of the given frequency
+static float filteredAmplitude(int axis, float hz)
+{
+    const int samples = 1e6f / LOOPTIME_US * 0.2f;
+    float peak = 0.0f;
+    for (int i = 0; i < samples; i++) {
+        const float value = rpmFilterGyro(axis, 100.0f * sinf(2.0f * M_PIf * hz * i * LOOPTIME_US * 1e-6f));
+        if (i > samples / 2) {
+            peak = MAX(peak, fabsf(value));
+        }
+    }
+    return peak / 100.0f;
+}
+
+TEST(RpmFilterUnittest, TestInitNeedsTelemetry)
+{
+    setup();
+    EXPECT_TRUE(isRpmFilterEnabled());
+
+    telemetryActive = false;
+    rpmFilterInit();
+    EXPECT_FALSE(isRpmFilterEnabled());
+    // a disabled filter is a pass through
+    EXPECT_EQ(12.5f, rpmFilterGyro(FD_ROLL, 12.5f));
+
+    telemetryActive = true;
+    rpmFilterConfigMutable()->gyro_rpm_notch_harmonics = 0;
+    rpmFilterInit();
+    EXPECT_FALSE(isRpmFilterEnabled());
+
+    rpmFilterConfigMutable()->gyro_rpm_notch_harmonics = 3;
+    targetPidLooptime = 0;
+    rpmFilterInit();
+    EXPECT_FALSE(isRpmFilterEnabled());
+}
+
+TEST(RpmFilterUnittest, TestUpdateFollowsTelemetry)
+{
+    setup();
+    setMotorsHz(200.0f);
+    runUpdates(0.1f);
+    for (int i = 0; i < MOTOR_COUNT; i++) {
+        EXPECT_NEAR(200.0f, rpmFilterGetMotorFrequencyHz(i), 1.0f);
+    }
+
+    // the motor frequency is smoothed, a step in the telemetry takes a few loops to come through
+    setMotorsHz(300.0f);
+    rpmFilterUpdate();
+    EXPECT_GT(rpmFilterGetMotorFrequencyHz(0), 200.0f);
+    EXPECT_LT(rpmFilterGetMotorFrequencyHz(0), 300.0f);
+    runUpdates(0.1f);
+    EXPECT_NEAR(300.0f, rpmFilterGetMotorFrequencyHz(0), 1.0f);
+}
+
+TEST(RpmFilterUnittest, TestGyroNotchesMotorHarmonics)
+{
+    setup();
+    setMotorsHz(200.0f);
+    runUpdates(0.1f);
+
+    // the motor frequency and its harmonics are removed on every axis, with the notches updated on X only
+    EXPECT_LT(filteredAmplitude(FD_ROLL, 200.0f), 0.05f);
+    EXPECT_LT(filteredAmplitude(FD_PITCH, 400.0f), 0.05f);
+    EXPECT_LT(filteredAmplitude(FD_YAW, 600.0f), 0.05f);
+    // and what lies between passes
+    EXPECT_GT(filteredAmplitude(FD_ROLL, 50.0f), 0.9f);
+    EXPECT_GT(filteredAmplitude(FD_ROLL, 2000.0f), 0.9f);
+}
+
+TEST(RpmFilterUnittest, TestNotchLimits)
+{
+    setup();
+
+    // a slow motor keeps its first notch at gyro_rpm_notch_min, so 50Hz is not notched
+    setMotorsHz(50.0f);
+    runUpdates(0.1f);
+    EXPECT_GT(filteredAmplitude(FD_ROLL, 50.0f), 0.9f);
+    EXPECT_LT(filteredAmplitude(FD_ROLL, 100.0f), 0.05f);
+
+    // at 8kHz the notches stop at 3840Hz, the third harmonic of 1500Hz is passed through
+    setMotorsHz(1500.0f);
+    runUpdates(0.1f);
+    EXPECT_LT(filteredAmplitude(FD_ROLL, 3000.0f), 0.05f);
+    EXPECT_GT(filteredAmplitude(FD_ROLL, 3900.0f), 0.9f);
+    const float value = rpmFilterGyro(FD_ROLL, 10.0f);
+    EXPECT_FALSE(isnan(value));
+}
+
+// STUBS
+
+extern "C" {
+    int16_t debug[DEBUG16_VALUE_COUNT];
+    uint8_t debugMode;
+
+    uint8_t getMotorCount(void) { return MOTOR_COUNT; }
+    bool isDshotTelemetryActive(void) { return telemetryActive; }
+    uint16_t getDshotTelemetry(uint8_t index) { return telemetry[index]; }
+}
@@ -49,6 +49,7 @@ extern "C" {
     extern uint32_t crsfChannelData[CRSF_MAX_CHANNEL];
 
     uint32_t dummyTimeUs;
+    int rxFrameSignalCount = 0;
 
     PG_REGISTER(rxConfig_t, rxConfig, PG_RX_CONFIG, 0);
 }
@@ -275,12 +276,36 @@ TEST(CrossFireTest, TestCrsfDataReceive)
     EXPECT_EQ(crc, crsfFrame.frame.payload[CRSF_FRAME_RC_CHANNELS_PAYLOAD_SIZE]);
 }
 
+TEST(CrossFireTest, TestCrsfFrameTimestamp)
+{
+    rxRuntimeConfig_t rxRuntimeConfig;
+    crsfRxInit(rxConfig(), &rxRuntimeConfig);
+    ASSERT_NE((void *)NULL, (void *)rxRuntimeConfig.rcFrameTimeUsFn);
+    EXPECT_TRUE(rxRuntimeConfig.rcFrameSignalled);
+
+    // the frame is stamped with the time its last byte was received, not when it is processed
+    dummyTimeUs += 10000;
+    const int frameSignalCount = rxFrameSignalCount;
+    const uint8_t *pData = capturedData;
+    for (unsigned int ii = 0; ii < sizeof(crsfRcChannelsFrame_t); ++ii) {
+        dummyTimeUs += 22;
+        crsfDataReceive(*pData++);
+    }
+    const timeUs_t frameDoneUs = dummyTimeUs;
+    // the RX task is woken once, by the last byte of the frame
+    EXPECT_EQ(frameSignalCount + 1, rxFrameSignalCount);
+    dummyTimeUs += 3000;
+    EXPECT_EQ(RX_FRAME_COMPLETE, crsfFrameStatus());
+    EXPECT_EQ(frameDoneUs, rxRuntimeConfig.rcFrameTimeUsFn());
+}
+
 // STUBS
 
 extern "C" {
 
 int16_t debug[DEBUG16_VALUE_COUNT];
 uint32_t micros(void) {return dummyTimeUs;}
+void rxSignalFrameComplete(void) {rxFrameSignalCount++;}
 serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, uint32_t, portMode_e, portOptions_e) {return NULL;}
 serialPortConfig_t *findSerialPortConfig(serialPortFunction_e ) {return NULL;}
 bool telemetryCheckRxPortShared(const serialPortConfig_t *) {return false;}
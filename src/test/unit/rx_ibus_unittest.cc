@@ -67,6 +67,8 @@ uint32_t micros(void)
     return microseconds_stub_value;
 }
 
+void rxSignalFrameComplete(void) {}
+
 #define SERIAL_BUFFER_SIZE 256
 #define SERIAL_PORT_DUMMY_IDENTIFIER  (serialPortIdentifier_e)0x1234
 
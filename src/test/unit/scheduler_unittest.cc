@@ -17,6 +17,8 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+
 extern "C" {
     #include "platform.h"
     #include "scheduler/scheduler.h"
@@ -51,7 +53,9 @@ extern "C" {
     void taskUpdateAccelerometer(timeUs_t) { simulatedTime += TEST_UPDATE_ACCEL_TIME; }
     void taskHandleSerial(timeUs_t) { simulatedTime += TEST_HANDLE_SERIAL_TIME; }
     void taskUpdateBatteryVoltage(timeUs_t) { simulatedTime += TEST_UPDATE_BATTERY_TIME; }
-    bool rxUpdateCheck(timeUs_t, timeDelta_t) { simulatedTime += TEST_UPDATE_RX_CHECK_TIME; return false; }
+    int rxUpdateCheckCount = 0;
+    bool rxUpdateCheckResult = false;
+    bool rxUpdateCheck(timeUs_t, timeDelta_t) { simulatedTime += TEST_UPDATE_RX_CHECK_TIME; rxUpdateCheckCount++; return rxUpdateCheckResult; }
     void taskUpdateRxMain(timeUs_t) { simulatedTime += TEST_UPDATE_RX_MAIN_TIME; }
     void imuUpdateAttitude(timeUs_t) { simulatedTime += TEST_IMU_UPDATE_TIME; }
     void dispatchProcess(timeUs_t) { simulatedTime += TEST_DISPATCH_TIME; }
@@ -66,6 +70,10 @@ extern "C" {
     extern cfTask_t *queueFirst(void);
     extern cfTask_t *queueNext(void);
 
+    extern uint32_t readyTaskMask;
+    extern timeUs_t checkFuncMovingSumExecutionTime;
+    extern int taskHeapSize;
+
     cfTask_t cfTasks[TASK_COUNT] = {
         [TASK_SYSTEM] = {
             .taskName = "SYSTEM",
@@ -391,3 +399,365 @@ TEST(SchedulerUnittest, TestTwoTasks)
     scheduler();
     EXPECT_EQ(&cfTasks[TASK_ACCEL], unittest_scheduler_selectedTask);
 }
+
+TEST(SchedulerUnittest, TestTaskHistogramPercentile)
+{
+    uint32_t histogram[TASK_HISTOGRAM_BUCKET_COUNT] = { 0 };
+    EXPECT_EQ(0, taskHistogramPercentile(histogram, 500));
+
+    histogram[0] = 500;     // 0us
+    histogram[4] = 490;     // 8..15us
+    histogram[7] = 9;       // 64..127us
+    histogram[12] = 1;      // 2048..4095us
+    EXPECT_EQ(0, taskHistogramPercentile(histogram, 500));
+    EXPECT_EQ(15, taskHistogramPercentile(histogram, 990));
+    EXPECT_EQ(127, taskHistogramPercentile(histogram, 999));
+    EXPECT_EQ(4095, taskHistogramPercentile(histogram, 1000));
+}
+
+TEST(SchedulerUnittest, TestTaskHistograms)
+{
+    schedulerInit();
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), false);
+    }
+    setTaskEnabled(TASK_GYROPID, true);
+    schedulerResetTaskStatistics(TASK_GYROPID);
+
+    cfTasks[TASK_GYROPID].lastExecutedAt = 1000;
+    simulatedTime = 4000;
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+
+    cfTaskInfo_t taskInfo;
+    getTaskInfo(TASK_GYROPID, &taskInfo);
+    // TEST_PID_LOOP_TIME of 650us lands in the 512..1023us bucket
+    EXPECT_EQ(1u, taskInfo.executionTimeHistogram[10]);
+    EXPECT_EQ(1023, taskInfo.executionTimePercentile[TASK_PERCENTILE_50]);
+    EXPECT_EQ(1023, taskInfo.executionTimePercentile[TASK_PERCENTILE_99_9]);
+    // task was due at 2000us and started at 4000us, so 2000us late
+    EXPECT_EQ(1u, taskInfo.startLatencyHistogram[11]);
+    EXPECT_EQ(2047, taskInfo.startLatencyPercentile[TASK_PERCENTILE_50]);
+
+    // next execution is exactly on time
+    simulatedTime = cfTasks[TASK_GYROPID].lastExecutedAt + cfTasks[TASK_GYROPID].desiredPeriod;
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+    getTaskInfo(TASK_GYROPID, &taskInfo);
+    EXPECT_EQ(1u, taskInfo.startLatencyHistogram[0]);
+    EXPECT_EQ(2u, taskInfo.executionTimeHistogram[10]);
+
+    schedulerResetTaskStatistics(TASK_GYROPID);
+    getTaskInfo(TASK_GYROPID, &taskInfo);
+    EXPECT_EQ(0, taskInfo.startLatencyPercentile[TASK_PERCENTILE_99]);
+}
+
+TEST(SchedulerUnittest, TestReadyQueueSingleTask)
+{
+    schedulerInit();
+    schedulerSetReadyQueueMode(true);
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), false);
+    }
+    EXPECT_EQ(0, taskHeapSize);
+    setTaskEnabled(TASK_GYROPID, true);
+    EXPECT_EQ(1, taskHeapSize);
+
+    cfTasks[TASK_GYROPID].lastExecutedAt = 1000;
+    cfTasks[TASK_GYROPID].totalExecutionTime = 0;
+    simulatedTime = 1500;
+    scheduler();
+    // deadline not reached yet
+    EXPECT_EQ(NULL, unittest_scheduler_selectedTask);
+    EXPECT_EQ(1, taskHeapSize);
+
+    simulatedTime = 4000;
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+    EXPECT_EQ(3000, cfTasks[TASK_GYROPID].taskLatestDeltaTime);
+    EXPECT_EQ(4000, cfTasks[TASK_GYROPID].lastExecutedAt);
+    EXPECT_EQ(TEST_PID_LOOP_TIME, cfTasks[TASK_GYROPID].totalExecutionTime);
+    // task is waiting for its next deadline again
+    EXPECT_EQ(1, taskHeapSize);
+    EXPECT_EQ(0u, readyTaskMask);
+
+    schedulerSetReadyQueueMode(false);
+}
+
+TEST(SchedulerUnittest, TestReadyQueueTwoTasks)
+{
+    schedulerInit();
+    schedulerSetReadyQueueMode(true);
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), false);
+    }
+    setTaskEnabled(TASK_ACCEL, true);
+    setTaskEnabled(TASK_GYROPID, true);
+
+    static const uint32_t startTime = 4000;
+    simulatedTime = startTime;
+    cfTasks[TASK_GYROPID].lastExecutedAt = simulatedTime;
+    cfTasks[TASK_ACCEL].lastExecutedAt = cfTasks[TASK_GYROPID].lastExecutedAt - TEST_UPDATE_ACCEL_TIME;
+    // the heap was built before the deadlines were changed
+    rescheduleTask(TASK_GYROPID, 1000);
+    rescheduleTask(TASK_ACCEL, 10000);
+
+    scheduler();
+    EXPECT_EQ(static_cast<cfTask_t*>(0), unittest_scheduler_selectedTask);
+
+    simulatedTime += 1000;
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+    EXPECT_EQ(1, unittest_scheduler_waitingTasks);
+
+    scheduler();
+    EXPECT_EQ(static_cast<cfTask_t*>(0), unittest_scheduler_selectedTask);
+    EXPECT_EQ(0, unittest_scheduler_waitingTasks);
+
+    simulatedTime = startTime + 10500; // TASK_GYROPID and TASK_ACCEL deadlines have passed
+    // of the two TASK_GYROPID should run first
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+    EXPECT_EQ(2, unittest_scheduler_waitingTasks);
+    // and then TASK_ACCEL
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_ACCEL], unittest_scheduler_selectedTask);
+
+    schedulerSetReadyQueueMode(false);
+}
+
+TEST(SchedulerUnittest, TestReadyQueueEventTask)
+{
+    schedulerInit();
+    checkFuncMovingSumExecutionTime = TEST_UPDATE_RX_CHECK_TIME * 32;
+    schedulerSetReadyQueueMode(true);
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), false);
+    }
+    setTaskEnabled(TASK_GYROPID, true);
+    setTaskEnabled(TASK_RX, true);
+    // event driven tasks do not wait in the deadline heap
+    EXPECT_EQ(1, taskHeapSize);
+
+    simulatedTime = 10000;
+    cfTasks[TASK_GYROPID].lastExecutedAt = simulatedTime - 1000;
+    rescheduleTask(TASK_GYROPID, 1000);
+
+    // the check function is not polled on a pass that runs the realtime task
+    rxUpdateCheckCount = 0;
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+    EXPECT_EQ(0, rxUpdateCheckCount);
+
+    // but it is on an idle pass
+    scheduler();
+    EXPECT_EQ(static_cast<cfTask_t*>(0), unittest_scheduler_selectedTask);
+    EXPECT_EQ(1, rxUpdateCheckCount);
+
+    // a signalled task runs on the next pass without polling
+    schedulerSignalTask(TASK_RX);
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_RX], unittest_scheduler_selectedTask);
+    EXPECT_EQ(1, rxUpdateCheckCount);
+
+    // signals for disabled tasks are ignored
+    schedulerSignalTask(TASK_ACCEL);
+    simulatedTime = cfTasks[TASK_GYROPID].lastExecutedAt + 100;
+    scheduler();
+    EXPECT_EQ(static_cast<cfTask_t*>(0), unittest_scheduler_selectedTask);
+
+    schedulerSetReadyQueueMode(false);
+}
+
+TEST(SchedulerUnittest, TestReadyQueueSignalDrivenTask)
+{
+    schedulerInit();
+    checkFuncMovingSumExecutionTime = TEST_UPDATE_RX_CHECK_TIME * 32;
+    schedulerSetReadyQueueMode(true);
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), false);
+    }
+    setTaskEnabled(TASK_GYROPID, true);
+    setTaskEnabled(TASK_RX, true);
+    schedulerSetTaskSignalDriven(TASK_RX, true);
+
+    simulatedTime = 10000;
+    cfTasks[TASK_GYROPID].lastExecutedAt = simulatedTime;
+    cfTasks[TASK_RX].lastExecutedAt = simulatedTime;
+    rescheduleTask(TASK_GYROPID, 1000);
+
+    // the check function is not polled on idle passes
+    rxUpdateCheckCount = 0;
+    rxUpdateCheckResult = true;
+    scheduler();
+    scheduler();
+    EXPECT_EQ(static_cast<cfTask_t*>(0), unittest_scheduler_selectedTask);
+    EXPECT_EQ(0, rxUpdateCheckCount);
+
+    // a signal has the check function called on the next pass, even one with realtime work
+    simulatedTime = cfTasks[TASK_GYROPID].lastExecutedAt + 1000;
+    schedulerSignalTask(TASK_RX);
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+    EXPECT_EQ(1, rxUpdateCheckCount);
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_RX], unittest_scheduler_selectedTask);
+    EXPECT_EQ(1, rxUpdateCheckCount);
+
+    // a signal for a frame that is not complete doesn't run the task
+    rxUpdateCheckResult = false;
+    schedulerSignalTask(TASK_RX);
+    scheduler();
+    EXPECT_EQ(static_cast<cfTask_t*>(0), unittest_scheduler_selectedTask);
+    EXPECT_EQ(2, rxUpdateCheckCount);
+
+    // without signals the check function runs as a timeout once the task period has passed
+    simulatedTime = cfTasks[TASK_RX].lastExecutedAt + cfTasks[TASK_RX].desiredPeriod;
+    cfTasks[TASK_GYROPID].lastExecutedAt = simulatedTime;
+    rxUpdateCheckResult = true;
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_RX], unittest_scheduler_selectedTask);
+    EXPECT_EQ(3, rxUpdateCheckCount);
+
+    schedulerSetTaskSignalDriven(TASK_RX, false);
+    rxUpdateCheckResult = false;
+    schedulerSetReadyQueueMode(false);
+}
+
+TEST(SchedulerUnittest, TestReadyQueueRealtimeGuard)
+{
+    schedulerInit();
+    schedulerSetReadyQueueMode(true);
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), false);
+    }
+    setTaskEnabled(TASK_GYROPID, true);
+    setTaskEnabled(TASK_ACCEL, true);
+    setTaskEnabled(TASK_BATTERY_VOLTAGE, true);
+    // TASK_ACCEL takes longer than the gap TASK_GYROPID leaves, TASK_BATTERY_VOLTAGE fits in it
+    cfTasks[TASK_ACCEL].movingSumExecutionTime = 400 * 32;
+    cfTasks[TASK_BATTERY_VOLTAGE].movingSumExecutionTime = TEST_UPDATE_BATTERY_TIME * 32;
+
+    simulatedTime = 100000;
+    cfTasks[TASK_GYROPID].lastExecutedAt = simulatedTime - 1000;
+    cfTasks[TASK_ACCEL].lastExecutedAt = simulatedTime - 10000;
+    cfTasks[TASK_BATTERY_VOLTAGE].lastExecutedAt = simulatedTime - TASK_PERIOD_HZ(50);
+    rescheduleTask(TASK_GYROPID, 1000);
+    rescheduleTask(TASK_ACCEL, 10000);
+    rescheduleTask(TASK_BATTERY_VOLTAGE, TASK_PERIOD_HZ(50));
+
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_GYROPID], unittest_scheduler_selectedTask);
+
+    // 350us to the next gyro deadline, the higher priority TASK_ACCEL has to wait for a bigger gap
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_BATTERY_VOLTAGE], unittest_scheduler_selectedTask);
+    scheduler();
+    EXPECT_EQ(static_cast<cfTask_t*>(0), unittest_scheduler_selectedTask);
+
+    // a slower gyro leaves enough time
+    simulatedTime = cfTasks[TASK_GYROPID].lastExecutedAt + 1000;
+    rescheduleTask(TASK_GYROPID, 2000);
+    scheduler();
+    EXPECT_EQ(&cfTasks[TASK_ACCEL], unittest_scheduler_selectedTask);
+
+    schedulerSetReadyQueueMode(false);
+}
+
+TEST(SchedulerUnittest, TestReadyQueueStarvationBound)
+{
+    schedulerInit();
+    schedulerSetReadyQueueMode(true);
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), false);
+    }
+    setTaskEnabled(TASK_GYROPID, true);
+    setTaskEnabled(TASK_ACCEL, true);
+    cfTasks[TASK_ACCEL].movingSumExecutionTime = TEST_UPDATE_ACCEL_TIME * 32;
+
+    // the gyro loop leaves 150us out of every 800us, never enough for TASK_ACCEL
+    simulatedTime = 100000;
+    cfTasks[TASK_GYROPID].lastExecutedAt = simulatedTime - 800;
+    cfTasks[TASK_ACCEL].lastExecutedAt = simulatedTime - 10000;
+    rescheduleTask(TASK_GYROPID, 800);
+    rescheduleTask(TASK_ACCEL, 10000);
+
+    int gyroRuns = 0;
+    int accelRuns = 0;
+    timeDelta_t maxGyroLatency = 0;
+    while (simulatedTime < 200000) {
+        const timeUs_t gyroDueAt = cfTasks[TASK_GYROPID].lastExecutedAt + cfTasks[TASK_GYROPID].desiredPeriod;
+        scheduler();
+        if (unittest_scheduler_selectedTask == &cfTasks[TASK_GYROPID]) {
+            gyroRuns++;
+            maxGyroLatency = std::max(maxGyroLatency, (timeDelta_t)(cfTasks[TASK_GYROPID].lastExecutedAt - gyroDueAt));
+        } else if (unittest_scheduler_selectedTask == &cfTasks[TASK_ACCEL]) {
+            accelRuns++;
+            // TASK_ACCEL waits no more than the starvation bound
+            EXPECT_LE(cfTasks[TASK_ACCEL].taskLatestDeltaTime, 5 * 10000 + 800);
+        } else {
+            simulatedTime += 10;
+        }
+    }
+    EXPECT_GE(accelRuns, 100000 / (5 * 10000 + 800));
+    EXPECT_GT(gyroRuns, 100);
+    // and the gyro loop is only ever late by one TASK_ACCEL execution
+    EXPECT_LE(maxGyroLatency, TEST_UPDATE_ACCEL_TIME + 10);
+
+    schedulerSetReadyQueueMode(false);
+}
+
+static void fillerTaskFunc(timeUs_t) { simulatedTime += 2; }
+
+TEST(SchedulerUnittest, TestReadyQueueWithAllTasksEnabled)
+{
+    // fill the unused task slots so that every task id can be enabled, the queue then holds TASK_COUNT tasks
+    static uint8_t savedTasks[sizeof(cfTasks)];
+    memcpy(savedTasks, static_cast<void *>(cfTasks), sizeof(cfTasks));
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        if (!cfTasks[taskId].taskFunc) {
+            cfTasks[taskId].taskFunc = fillerTaskFunc;
+            cfTasks[taskId].desiredPeriod = TASK_PERIOD_HZ(100);
+        }
+    }
+    cfTasks[TASK_GYROPID].desiredPeriod = 1000;
+
+    schedulerInit();
+    schedulerSetReadyQueueMode(true);
+    simulatedTime = 100000;
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        cfTasks[taskId].lastExecutedAt = simulatedTime - cfTasks[taskId].desiredPeriod;
+        setTaskEnabled(static_cast<cfTaskId_e>(taskId), true);
+    }
+    rxUpdateCheckResult = true;
+
+    int taskRuns[TASK_COUNT] = { 0 };
+    timeDelta_t maxGyroLatency = 0;
+    while (simulatedTime < 1100000) {
+        const timeUs_t gyroDueAt = cfTasks[TASK_GYROPID].lastExecutedAt + cfTasks[TASK_GYROPID].desiredPeriod;
+        scheduler();
+        if (unittest_scheduler_selectedTask) {
+            const int taskId = unittest_scheduler_selectedTask - cfTasks;
+            taskRuns[taskId]++;
+            if (taskId == TASK_GYROPID) {
+                maxGyroLatency = std::max(maxGyroLatency, (timeDelta_t)(cfTasks[TASK_GYROPID].lastExecutedAt - gyroDueAt));
+            }
+        } else {
+            simulatedTime += 10;
+        }
+    }
+
+    // the gyro loop is only ever late by one TASK_ACCEL execution
+    EXPECT_LE(maxGyroLatency, TEST_UPDATE_ACCEL_TIME + 10);
+    // and every time driven task runs at least once per starvation bound
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        if (!cfTasks[taskId].checkFunc) {
+            EXPECT_GE(taskRuns[taskId], 1000000 / (6 * (int)cfTasks[taskId].desiredPeriod));
+        }
+    }
+
+    rxUpdateCheckResult = false;
+    schedulerSetReadyQueueMode(false);
+    memcpy(static_cast<void *>(cfTasks), savedTasks, sizeof(cfTasks));
+    schedulerInit();
+}
@@ -0,0 +1,272 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/time.h"
+    #include "common/utils.h"
+
+    #include "drivers/serial.h"
+
+    #include "io/serial.h"
+
+    #include "rx/rx.h"
+    #include "rx/ibus.h"
+
+    #include "telemetry/ibus_shared.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static std::vector<uint8_t> received;
+
+static void rxCallback(uint16_t data)
+{
+    received.push_back(data);
+}
+
+#define TEST_RX_BUFFER_SIZE 512 // UART_RX_BUFFER_SIZE on F4
+
+static volatile uint8_t rxBuffer[TEST_RX_BUFFER_SIZE];
+
+static serialPort_t makePort(uint32_t rxBufferSize)
+{
+    serialPort_t port;
+    memset(&port, 0, sizeof(port));
+    port.rxBuffer = rxBuffer;
+    port.rxBufferSize = rxBufferSize;
+    port.rxCallback = rxCallback;
+    return port;
+}
+
+TEST(SerialTest, TestRxDeliverFrameWraps)
+{
+    serialPort_t port = makePort(8);
+    received.clear();
+
+    port.rxBufferTail = 6;
+    const uint8_t frame[] = { 0xC8, 0x18, 0x16, 0x55 };
+    for (unsigned ii = 0; ii < sizeof(frame); ii++) {
+        rxBuffer[(6 + ii) % 8] = frame[ii];
+    }
+
+    EXPECT_EQ(4u, serialRxDeliverFrame(&port, 2));
+    EXPECT_EQ(2u, port.rxBufferTail);
+    ASSERT_EQ(4u, received.size());
+    EXPECT_EQ(0, memcmp(frame, received.data(), sizeof(frame)));
+
+    // nothing new, the callback is not called
+    EXPECT_EQ(0u, serialRxDeliverFrame(&port, 2));
+    EXPECT_EQ(4u, received.size());
+}
+
+TEST(SerialTest, TestRxDeliverDmaWraps)
+{
+    serialPort_t port = makePort(8);
+    received.clear();
+    for (unsigned ii = 0; ii < 8; ii++) {
+        rxBuffer[ii] = ii;
+    }
+
+    // The DMA has written 6 bytes, NDTR counts what is left before it wraps
+    EXPECT_EQ(6u, serialRxDeliverDma(&port, 2, true));
+    EXPECT_EQ(6u, port.rxBufferTail);
+
+    // NDTR reloads to the buffer size when the DMA wraps, head is back at the start
+    EXPECT_EQ(2u, serialRxDeliverDma(&port, 8, true));
+    EXPECT_EQ(0u, port.rxBufferTail);
+
+    // Past the end into the next lap
+    port.rxBufferTail = 6;
+    received.clear();
+    EXPECT_EQ(5u, serialRxDeliverDma(&port, 5, true));
+    EXPECT_EQ(3u, port.rxBufferTail);
+    const uint8_t wrapped[] = { 6, 7, 0, 1, 2 };
+    ASSERT_EQ(sizeof(wrapped), received.size());
+    EXPECT_EQ(0, memcmp(wrapped, received.data(), sizeof(wrapped)));
+
+    // NDTR can read 0 for a moment before the reload, that is the start of the buffer too
+    port.rxBufferTail = 5;
+    EXPECT_EQ(3u, serialRxDeliverDma(&port, 0, true));
+    EXPECT_EQ(0u, port.rxBufferTail);
+
+    // Half and full buffer interrupts leave less than half a buffer for the idle line
+    received.clear();
+    EXPECT_EQ(0u, serialRxDeliverDma(&port, 5, false));
+    EXPECT_EQ(0u, port.rxBufferTail);
+    EXPECT_EQ(0u, received.size());
+    EXPECT_EQ(4u, serialRxDeliverDma(&port, 4, false));
+    EXPECT_EQ(4u, port.rxBufferTail);
+    port.rxBufferTail = 6;
+    EXPECT_EQ(0u, serialRxDeliverDma(&port, 7, false));
+    EXPECT_EQ(4u, serialRxDeliverDma(&port, 6, false));
+    EXPECT_EQ(2u, port.rxBufferTail);
+}
+
+#define IBUS_FRAME_SIZE     32
+#define IBUS_CHANNELS       14
+#define IBUS_BYTE_TIME_US   87      // 10 bits at 115200 baud
+#define IBUS_FRAME_PERIOD   7000
+
+static timeUs_t simTimeUs;
+static serialPort_t ibusPort;
+static serialReceiveCallbackPtr ibusCallback;
+
+/*
+ * A UART receiving into a circular DMA buffer, the RX DMA counts down NDTR and reloads it at the end of the buffer.
+ * The half and full buffer interrupts fire as the DMA passes them, the idle line interrupt a byte time after a burst.
+ */
+static void simulatedRxDmaReceive(serialPort_t *port, uint32_t *ndtr, const uint8_t *data, int length)
+{
+    for (int ii = 0; ii < length; ii++) {
+        simTimeUs += IBUS_BYTE_TIME_US;
+        port->rxBuffer[port->rxBufferSize - *ndtr] = data[ii];
+        if (--*ndtr == 0) {
+            *ndtr = port->rxBufferSize;
+            serialRxDeliverDma(port, *ndtr, false);
+        } else if (*ndtr == port->rxBufferSize / 2) {
+            serialRxDeliverDma(port, *ndtr, false);
+        }
+    }
+    simTimeUs += IBUS_BYTE_TIME_US;
+    serialRxDeliverDma(port, *ndtr, true);
+}
+
+static void makeIbusFrame(uint8_t *frame, uint16_t firstChannelValue)
+{
+    frame[0] = IBUS_FRAME_SIZE;
+    frame[1] = 0x40;
+    for (int ii = 0; ii < IBUS_CHANNELS; ii++) {
+        frame[2 + ii * 2] = (firstChannelValue + ii) & 0xFF;
+        frame[3 + ii * 2] = (firstChannelValue + ii) >> 8;
+    }
+    uint16_t checksum = 0xFFFF;
+    for (int ii = 0; ii < IBUS_FRAME_SIZE - 2; ii++) {
+        checksum -= frame[ii];
+    }
+    frame[IBUS_FRAME_SIZE - 2] = checksum & 0xFF;
+    frame[IBUS_FRAME_SIZE - 1] = checksum >> 8;
+}
+
+TEST(SerialTest, TestIbusFramesAcrossDmaInterrupts)
+{
+    const rxConfig_t rxConfig = {};
+    rxRuntimeConfig_t rxRuntimeConfig;
+    memset(&rxRuntimeConfig, 0, sizeof(rxRuntimeConfig));
+    ibusPort = makePort(TEST_RX_BUFFER_SIZE);
+    ASSERT_TRUE(ibusInit(&rxConfig, &rxRuntimeConfig));
+    ASSERT_TRUE(ibusCallback != NULL);
+    ibusPort.rxCallback = ibusCallback;
+
+    // iBus times the gaps between bytes, a frame handed over in two parts a few bytes apart would be dropped
+    uint32_t ndtr = TEST_RX_BUFFER_SIZE;
+    int framesCrossingHalfOrFull = 0;
+    for (int ii = 0; ii < 100; ii++) {
+        // Frames of 32 bytes drift across the half and full buffer marks of the DMA
+        const uint32_t head = TEST_RX_BUFFER_SIZE - ndtr;
+        const uint32_t half = TEST_RX_BUFFER_SIZE / 2;
+        if ((head < half && head + IBUS_FRAME_SIZE > half) || head + IBUS_FRAME_SIZE > TEST_RX_BUFFER_SIZE) {
+            framesCrossingHalfOrFull++;
+        }
+
+        uint8_t frame[IBUS_FRAME_SIZE];
+        makeIbusFrame(frame, 1000 + ii);
+        // A stray byte now and then keeps the frames off the 32 byte grid
+        if (ii % 3 == 0) {
+            const uint8_t noise = 0;
+            simulatedRxDmaReceive(&ibusPort, &ndtr, &noise, 1);
+            simTimeUs += IBUS_FRAME_PERIOD / 2;
+        }
+        simulatedRxDmaReceive(&ibusPort, &ndtr, frame, sizeof(frame));
+
+        EXPECT_EQ(RX_FRAME_COMPLETE, rxRuntimeConfig.rcFrameStatusFn()) << "frame " << ii;
+        for (int channel = 0; channel < IBUS_CHANNELS; channel++) {
+            EXPECT_EQ(1000 + ii + channel, rxRuntimeConfig.rcReadRawFn(&rxRuntimeConfig, channel));
+        }
+        simTimeUs += IBUS_FRAME_PERIOD;
+    }
+    EXPECT_LT(10, framesCrossingHalfOrFull);
+}
+
+// STUBS
+
+extern "C" {
+
+timeUs_t micros(void)
+{
+    return simTimeUs;
+}
+
+void rxSignalFrameComplete(void) {}
+
+static serialPortConfig_t ibusPortConfig;
+
+serialPortConfig_t *findSerialPortConfig(serialPortFunction_e function)
+{
+    UNUSED(function);
+    return &ibusPortConfig;
+}
+
+bool isSerialPortShared(const serialPortConfig_t *portConfig, uint16_t functionMask, serialPortFunction_e sharedWithFunction)
+{
+    UNUSED(portConfig);
+    UNUSED(functionMask);
+    UNUSED(sharedWithFunction);
+    return false;
+}
+
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr callback,
+    uint32_t baudrate, portMode_e mode, portOptions_e options)
+{
+    UNUSED(identifier);
+    UNUSED(function);
+    UNUSED(baudrate);
+    UNUSED(mode);
+    UNUSED(options);
+    ibusCallback = callback;
+    return &ibusPort;
+}
+
+bool isChecksumOkIa6b(const uint8_t *ibusPacket, const uint8_t length)
+{
+    uint16_t checksum = 0xFFFF;
+    for (int ii = 0; ii < length - 2; ii++) {
+        checksum -= ibusPacket[ii];
+    }
+    return ibusPacket[length - 2] == (checksum & 0xFF) && ibusPacket[length - 1] == (checksum >> 8);
+}
+
+uint8_t respondToIbusRequest(uint8_t const * const ibusPacket)
+{
+    UNUSED(ibusPacket);
+    return 0;
+}
+
+void initSharedIbusTelemetry(serialPort_t *port)
+{
+    UNUSED(port);
+}
+
+}
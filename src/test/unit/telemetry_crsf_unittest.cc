@@ -291,6 +291,7 @@ gpsSolutionData_t gpsSol;
 void beeperConfirmationBeeps(uint8_t beepCount) {UNUSED(beepCount);}
 
 uint32_t micros(void) {return 0;}
+void rxSignalFrameComplete(void) {}
 
 bool feature(uint32_t) {return true;}
 